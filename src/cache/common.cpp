@@ -133,6 +133,28 @@ int CacheCommon::get_listening_socket(int port, bool nonblock, int backlog) {
 	return sock;
 }
 
+bool CacheCommon::is_local_host(const std::string &host) {
+	struct addrinfo hints, *addresses;
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &addresses) != 0)
+		return false;
+
+	// binding to an address only succeeds if it belongs to one of our interfaces
+	bool local = false;
+	for (auto p = addresses; p != nullptr && !local; p = p->ai_next) {
+		int sock = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+		if (sock == -1)
+			continue;
+		local = bind(sock, p->ai_addr, p->ai_addrlen) == 0;
+		close(sock);
+	}
+	freeaddrinfo(addresses);
+	return local;
+}
+
 void CacheCommon::set_uncaught_exception_handler() {
 	std::set_terminate(ex_handler);
 }
@@ -91,6 +91,13 @@ public:
 	 */
 	static int get_listening_socket(int port, bool nonblock = true, int backlog = 10);
 
+	/**
+	 * Checks whether the given host refers to this machine, i.e. one of its
+	 * addresses can be bound locally.
+	 * @param host the hostname or address
+	 */
+	static bool is_local_host( const std::string &host );
+
 	/**
 	 * @return a string-representation for the given query-rectange
 	 */
@@ -15,40 +15,64 @@
 
 #include <mutex>
 #include <random>
+#include <algorithm>
 
 #include <sys/socket.h>
 
+// Events of the blocking connections are tagged with this bit and their fd.
+// Delivery-connections are tagged with their address.
+static const uint64_t WRAPPER_TAG = (uint64_t) 1 << 63;
+
+EpollReactor reactor;
+// the events for the blocking connections of the current cycle, by fd
+std::map<int,uint32_t> wrapper_events;
+
 class PollWrapper {
 public:
-	PollWrapper( std::unique_ptr<BlockingConnection> con );
-	void prepare( struct pollfd *poll_fd );
+	PollWrapper( std::unique_ptr<BlockingConnection> con, time_t issued );
+	void attach( EpollReactor &reactor );
 	bool is_ready() const;
 	bool has_error() const;
 	std::unique_ptr<BlockingConnection> connection;
+	// when the request was written
+	time_t issued;
 private:
-	struct pollfd *poll_fd;
+	uint32_t get_events() const;
+	bool attached;
 };
 
-void PollWrapper::prepare(struct pollfd* poll_fd) {
-	this->poll_fd = poll_fd;
-	this->poll_fd->fd = connection->get_read_fd();
-	this->poll_fd->events = POLLIN;
-	this->poll_fd->revents = 0;
+void PollWrapper::attach(EpollReactor &reactor) {
+	if ( attached )
+		return;
+	// level-triggered, as the connection is read with blocking calls
+	int fd = connection->get_read_fd();
+	reactor.add(fd, EpollReactor::READ, WRAPPER_TAG | (uint64_t) fd);
+	attached = true;
 }
 
-PollWrapper::PollWrapper(std::unique_ptr<BlockingConnection> con) : connection(std::move(con)), poll_fd(nullptr) {
+PollWrapper::PollWrapper(std::unique_ptr<BlockingConnection> con, time_t issued) : connection(std::move(con)), issued(issued), attached(false) {
+}
+
+uint32_t PollWrapper::get_events() const {
+	if ( !attached )
+		return 0;
+	auto it = wrapper_events.find(connection->get_read_fd());
+	return it == wrapper_events.end() ? 0 : it->second;
 }
 
 bool PollWrapper::is_ready() const {
-	return (poll_fd != nullptr) && (poll_fd->revents & POLLIN);
+	return get_events() & EpollReactor::READ;
 }
 
 bool PollWrapper::has_error() const {
-	return (poll_fd != nullptr) && poll_fd->revents != 0 && poll_fd->revents != POLLIN;
+	uint32_t events = get_events();
+	return events != 0 && events != EpollReactor::READ;
 }
 
 std::vector<PollWrapper> connections;
 std::vector<std::unique_ptr<NBClientDeliveryConnection>> del_cons;
+// issue-time of the request belonging to a delivery-connection
+std::map<const NBClientDeliveryConnection*,time_t> del_issued;
 std::mutex mtx;
 bool done = false;
 size_t max_res_size = 0;
@@ -61,6 +85,27 @@ std::string host = "127.0.0.1";
 size_t responses_read = 0;
 size_t results_read = 0;
 
+// latencies in ms: until the index responded and until the result was read
+std::vector<time_t> index_latencies;
+std::vector<time_t> total_latencies;
+
+void print_latencies( const char *name, std::vector<time_t> &values ) {
+	if ( values.empty() ) {
+		Log::info("%s latency: no samples", name);
+		return;
+	}
+	std::sort(values.begin(), values.end());
+	auto percentile = [&values]( double p ) {
+		size_t idx = std::min( values.size()-1, (size_t) (p * values.size()) );
+		return (long) values[idx];
+	};
+	double sum = 0;
+	for ( auto v : values )
+		sum += v;
+	Log::info("%s latency (ms): count: %lu, mean: %.2f, p50: %ld, p90: %ld, p99: %ld, max: %ld",
+		name, values.size(), sum / values.size(), percentile(0.5), percentile(0.9), percentile(0.99), (long) values.back());
+}
+
 //
 // RANDOM STUFF
 //
@@ -126,17 +171,26 @@ std::queue<QTriple> queries_from_spec(uint32_t num_queries, const QuerySpec &s,
 
 
 
-void issue_queries(std::queue<QTriple> *queries, int inter_arrival) {
+/**
+ * Poses the given queries. Bursts of burst_size queries are issued back-to-back,
+ * the inter-arrival time applies between bursts.
+ */
+void issue_queries(std::queue<QTriple> *queries, int inter_arrival, int burst_size) {
 
 	time_t sleep = 0;
+	time_t burst_start = 0;
+	int burst_pos = 0;
 
-	Log::info("Posing %lu queries with %dms inter-arrival time.",
-			queries->size(), inter_arrival);
+	Log::info("Posing %lu queries with %dms inter-arrival time, burst-size: %d.",
+			queries->size(), inter_arrival, burst_size);
 
 	while (!queries->empty()) {
 		try {
-			if ( sleep > 0 )
-				std::this_thread::sleep_for(std::chrono::milliseconds(sleep));
+			if ( burst_pos == 0 ) {
+				if ( sleep > 0 )
+					std::this_thread::sleep_for(std::chrono::milliseconds(sleep));
+				burst_start = CacheCommon::time_millis();
+			}
 			auto start = CacheCommon::time_millis();
 			std::unique_ptr<BlockingConnection> con =
 					BlockingConnection::create(host, port, true,
@@ -158,10 +212,13 @@ void issue_queries(std::queue<QTriple> *queries, int inter_arrival) {
 					BaseRequest(q.type, q.semantic_id, q.query));
 			{
 				std::lock_guard<std::mutex> guard(mtx);
-				connections.push_back( PollWrapper(std::move(con)) );
+				connections.push_back( PollWrapper(std::move(con), start) );
+			}
+			if ( ++burst_pos == burst_size ) {
+				burst_pos = 0;
+				time_t elapsed = CacheCommon::time_millis() - burst_start;
+				sleep = std::max((time_t)0, next_poisson(inter_arrival) - elapsed );
 			}
-			time_t elapsed = CacheCommon::time_millis() - start;
-			sleep = std::max((time_t)0, next_poisson(inter_arrival) - elapsed );
 		} catch (const NetworkException &ex) {
 			Log::error("Issuing request failed: %s", ex.what());
 		}
@@ -172,17 +229,17 @@ void issue_queries(std::queue<QTriple> *queries, int inter_arrival) {
 
 }
 
-void setup_fdset(struct pollfd *fds, size_t &pos) {
+void setup_connections() {
 
 	auto it = del_cons.begin();
 	while (it != del_cons.end()) {
 		auto &c = **it;
-		if (c.is_faulty())
+		if (c.is_faulty()) {
+			del_issued.erase(&c);
 			it = del_cons.erase(it);
-		else {
-			c.prepare(&fds[pos++]);
-			it++;
 		}
+		else
+			it++;
 	}
 
 	std::lock_guard<std::mutex> guard(mtx);
@@ -191,10 +248,21 @@ void setup_fdset(struct pollfd *fds, size_t &pos) {
 		if ( cit->has_error() )
 			cit = connections.erase(cit);
 		else {
-			cit->prepare(&fds[pos++]);
+			// closing the socket removes it from the reactor, new ones are attached here
+			cit->attach(reactor);
 			cit++;
 		}
 	}
+	wrapper_events.clear();
+}
+
+void dispatch_events(const std::vector<EpollReactor::Event> &events) {
+	for ( auto &event : events ) {
+		if ( event.tag & WRAPPER_TAG )
+			wrapper_events[ (int) (event.tag & ~WRAPPER_TAG) ] = event.events;
+		else
+			PollableConnection::from_tag(event.tag)->notify(event.events);
+	}
 }
 
 void process_connections() {
@@ -205,6 +273,7 @@ void process_connections() {
 			if ( it->is_ready() ) {
 				auto resp = it->connection->read();
 				responses_read++;
+				index_latencies.push_back( CacheCommon::time_millis() - it->issued );
 //				Log::info("Progress: %lu/%lu", responses_read, results_read);
 				uint8_t rc = resp->read<uint8_t>();
 				switch (rc) {
@@ -212,6 +281,8 @@ void process_connections() {
 					DeliveryResponse dr(*resp);
 					Log::debug("Revceived response: %s", dr.to_string().c_str());
 					del_cons.push_back(NBClientDeliveryConnection::create(dr));
+					del_cons.back()->attach(reactor);
+					del_issued[del_cons.back().get()] = it->issued;
 //					NBClientDeliveryConnection::create(dr);
 					break;
 				}
@@ -242,11 +313,14 @@ void process_del_cons() {
 				results_read++;
         max_res_size = std::max(max_res_size, c.get_bytes_read());
 //				Log::debug("Progress: %lu/%lu", responses_read, results_read);
+				total_latencies.push_back( CacheCommon::time_millis() - del_issued.at(&c) );
+				del_issued.erase(&c);
 				it = del_cons.erase(it);
 			} else
 				it++;
 		} catch (const std::exception &ex) {
 			Log::error("Error reading response: %s", ex.what());
+			del_issued.erase(&c);
 			it = del_cons.erase(it);
 		}
 	}
@@ -413,6 +487,8 @@ int main(int argc, char *argv[]) {
 
 	std::queue<QTriple> qs;
 	int inter_arrival;
+	// optional third argument: number of queries posed back-to-back
+	int burst_size = 1;
 
 	if ( argc < 3 ) {
 		inter_arrival = 6;
@@ -422,6 +498,8 @@ int main(int argc, char *argv[]) {
 	else {
 		inter_arrival = atoi(argv[1]);
 		qs = create_run(argc,argv);
+		if ( argc > 3 )
+			burst_size = std::max(1, atoi(argv[3]));
 	}
 
 	auto c = BlockingConnection::create(host, port, true,
@@ -430,10 +508,7 @@ int main(int argc, char *argv[]) {
 
 	auto start = CacheCommon::time_millis();
 
-	std::thread t(issue_queries, &qs, inter_arrival);
-
-	struct pollfd fds[0xffff];
-	size_t num_fds;
+	std::thread t(issue_queries, &qs, inter_arrival, burst_size);
 
 	while (!done || !connections.empty() || !del_cons.empty()) {
 		if (connections.empty() && del_cons.empty()) {
@@ -441,19 +516,19 @@ int main(int argc, char *argv[]) {
 			continue;
 		}
 
-		num_fds = 0;
-
-		setup_fdset(fds,num_fds);
-		int poll_ret = poll(fds,num_fds,1000);
-		if (poll_ret < 0 && errno != EINTR) {
-			Log::error("Poll returned error: %s", strerror(errno));
+		setup_connections();
+		try {
+			dispatch_events(reactor.wait(1000));
+		} catch ( const NetworkException &ne ) {
+			Log::error("Waiting for events failed: %s", ne.what());
 			exit(1);
-		} else if (poll_ret > 0) {
-			process_del_cons();
-			process_connections();
 		}
+		process_del_cons();
+		process_connections();
 	}
 	Log::info("Processing finished. Duration: %ldms. Requesting stats: Max result-size: %lu", (CacheCommon::time_millis()-start), max_res_size);
+	print_latencies("Index-response", index_latencies);
+	print_latencies("End-to-end", total_latencies);
 	t.join();
 	std::this_thread::sleep_for(std::chrono::seconds(1));
 
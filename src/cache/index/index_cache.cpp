@@ -111,6 +111,19 @@ void IndexCache::remove_all_by_node(uint32_t node_id) {
 	entries_by_node.erase(node_id);
 }
 
+bool IndexCache::contains_all(const std::string& semantic_id, const std::vector<std::shared_ptr<const IndexCacheEntry>>& entries) const {
+	for ( auto &e : entries ) {
+		try {
+			// Moved entries keep their identity, removed ones are gone or replaced
+			if ( this->get_int(semantic_id,e->id) != e )
+				return false;
+		} catch ( const NoSuchElementException &nse ) {
+			return false;
+		}
+	}
+	return true;
+}
+
 std::vector<std::shared_ptr<const IndexCacheEntry> > IndexCache::get_all() const {
 	std::vector<std::shared_ptr<const IndexCacheEntry>> result;
 	size_t size = 0;
@@ -139,6 +139,16 @@ public:
 	 */
 	void remove_all_by_node( uint32_t node_id );
 
+	/**
+	 * Checks whether the given entries are still stored in this cache. Used to
+	 * validate lookup-results obtained without the index-server's scheduling lock,
+	 * as entries may have been removed in the meantime.
+	 * @param semantic_id the semantic id of the entries
+	 * @param entries the entries to check
+	 * @return true if all entries are still present
+	 */
+	bool contains_all( const std::string &semantic_id, const std::vector<std::shared_ptr<const IndexCacheEntry>> &entries ) const;
+
 	/**
 	 * @return all entries currently stored in the cache
 	 */
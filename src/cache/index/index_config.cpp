@@ -7,6 +7,7 @@
 
 #include "index_config.h"
 #include "util/configuration.h"
+#include "util/exceptions.h"
 
 #include <sstream>
 
@@ -18,11 +19,14 @@ IndexConfig IndexConfig::fromConfiguration() {
 	result.relevance_function = Configuration::get("indexserver.reorg.relevance","lru");
 	result.update_interval = Configuration::getInt("indexserver.reorg.interval");
 	result.batching_enabled = Configuration::getBool("indexserver.batching.enable",true);
+	result.scheduling_threads = Configuration::getInt("indexserver.scheduling_threads",2);
+	if ( result.scheduling_threads < 1 )
+		throw ArgumentException("indexserver.scheduling_threads must be at least 1");
 	return result;
 }
 
 IndexConfig::IndexConfig() :
-	port(0), update_interval(0), batching_enabled(true) {
+	port(0), update_interval(0), batching_enabled(true), scheduling_threads(2) {
 
 }
 
@@ -34,6 +38,7 @@ std::string IndexConfig::to_string() const {
 		ss << "  Reorg-Strategy    : " << reorg_strategy << std::endl;
 		ss << "  Relevance-Function: " << relevance_function << std::endl;
 		ss << "  Update-Interval   : " << update_interval << std::endl;
-		ss << "  Batching          : " << batching_enabled;
+		ss << "  Batching          : " << batching_enabled << std::endl;
+		ss << "  Scheduling-Threads: " << scheduling_threads;
 		return ss.str();
 }
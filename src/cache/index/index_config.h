@@ -21,6 +21,7 @@ public:
 	std::string scheduler;
 	int update_interval;
 	bool batching_enabled;
+	int scheduling_threads;
 
 	std::string to_string() const;
 };
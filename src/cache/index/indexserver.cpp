@@ -11,6 +11,7 @@
 #include "util/concat.h"
 
 #include <memory>
+#include <algorithm>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -30,7 +31,8 @@
 
 IndexServer::IndexServer(const IndexConfig &config) :
 	caches(config), config(config), shutdown(false), next_node_id(1),
-	query_manager(QueryManager::from_config(this->caches,this->nodes,config)), last_reorg(CacheCommon::time_millis()), wakeup_pipe(BinaryStream::makePipe()) {
+	query_manager(QueryManager::from_config(this->caches,this->nodes,config)), last_reorg(CacheCommon::time_millis()), last_timeout_check(0),
+	tasks_shutdown(false), scheduling_requested(false) {
 	Log::info("IndexServer successfully setup. %s", config.to_string().c_str());
 }
 
@@ -41,81 +43,86 @@ void IndexServer::stop() {
 }
 
 void IndexServer::wakeup() {
-	BinaryWriteBuffer buffer;
-	buffer.write('w');
-	wakeup_pipe.write(buffer);
+	reactor.wakeup();
 }
 
+// The tag of the listen-socket. Connections are tagged with their address.
+static const uint64_t LISTEN_TAG = 0;
+
 void IndexServer::run() {
 	int listen_socket = CacheCommon::get_listening_socket(config.port,true,SOMAXCONN);
 	Log::info("index-server: listening on node-port: %d", config.port);
 
 
-	struct pollfd fds[0xffff];
-	fds[0].fd = listen_socket;
-	fds[0].events = POLLIN;
-	fds[1].fd = wakeup_pipe.getReadFD();
-	fds[1].events = POLLIN;
+	// The listen-socket is level-triggered, we accept one connection per cycle.
+	reactor.add(listen_socket, EpollReactor::READ, LISTEN_TAG);
 
+	for ( int i = 0; i < config.scheduling_threads; i++ )
+		scheduling_threads.emplace_back( &IndexServer::scheduling_loop, this );
 
 	std::vector<std::unique_ptr<NewNBConnection>> new_cons;
-	size_t num_fds;
+	// The connections with events in the current cycle
+	std::vector<PollableConnection*> ready;
 
+	std::unique_lock<std::mutex> lock(scheduling_mutex);
 	while (!shutdown) {
-		// Prepare listen socket
-		fds[0].revents = 0;
-
-		// Prepare wakeup
-		fds[1].revents = 0;
-
-		num_fds = 2;
-
-		// setup new connections
+		// kill faulty connections, before we wait for events
 		auto nc_iter = new_cons.begin();
 		while ( nc_iter != new_cons.end() ){
 			if ( (*nc_iter)->is_faulty() )
 				nc_iter = new_cons.erase(nc_iter);
-			else {
-				(*nc_iter)->prepare(&fds[num_fds++]);
+			else
 				nc_iter++;
-			}
 		}
 
-
-		setup_fdset(fds,num_fds);
-
-		int poll_ret = poll(fds, num_fds, 1000 );
-		if (poll_ret < 0 && errno != EINTR) {
-			Log::error("Poll returned error: %s", strerror(errno));
+		bool accept_pending = false;
+		ready.clear();
+		try {
+			// The scheduling-threads may work while we are waiting
+			lock.unlock();
+			auto &events = reactor.wait(1000);
+			lock.lock();
+			// Events must be dispatched before any connection is destroyed
+			for ( auto &event : events ) {
+				if ( event.tag == LISTEN_TAG )
+					accept_pending = true;
+				else {
+					auto con = PollableConnection::from_tag(event.tag);
+					con->notify(event.events);
+					ready.push_back(con);
+				}
+			}
+		} catch ( const NetworkException &ne ) {
+			Log::error("Waiting for events failed: %s", ne.what());
 			exit(1);
 		}
-		else if (poll_ret > 0) {
-			if ( fds[1].revents & POLLIN ) {
-				// we have been woken, now we need to read any outstanding data or the pipe will remain readable
-				char buf[1024];
-				read(wakeup_pipe.getReadFD(), buf, 1024);
+		// A connection may have a socket-event and an activation
+		std::sort(ready.begin(), ready.end());
+		ready.erase(std::unique(ready.begin(), ready.end()), ready.end());
+
+		// Only connections with pending events are touched. The handshakes are
+		// processed last, as they destroy the new connections they are done with.
+		process_connections(ready);
+		remove_faulty_connections(ready);
+		process_handshake(new_cons);
+		check_timeouts();
+
+		// Accept new connections
+		if ( accept_pending ) {
+			struct sockaddr_storage remote_addr;
+			socklen_t sin_size = sizeof(remote_addr);
+			int new_fd = accept(listen_socket, (struct sockaddr *) &remote_addr, &sin_size);
+			if (new_fd == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				Log::error("Accept failed: %d", strerror(errno));
 			}
-
-			process_client_connections();
-			process_nodes();
-			process_handshake(new_cons);
-
-			// Accept new connections
-			if ( fds[0].revents & POLLIN ) {
-				struct sockaddr_storage remote_addr;
-				socklen_t sin_size = sizeof(remote_addr);
-				int new_fd = accept(listen_socket, (struct sockaddr *) &remote_addr, &sin_size);
-				if (new_fd == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
-					Log::error("Accept failed: %d", strerror(errno));
-				}
-				else if (new_fd > 0) {
-					Log::debug("New connection established, fd: %d", new_fd);
-					new_cons.push_back( make_unique<NewNBConnection>(&remote_addr,new_fd) );
-				}
+			else if (new_fd > 0) {
+				Log::debug("New connection established, fd: %d", new_fd);
+				new_cons.push_back( make_unique<NewNBConnection>(&remote_addr,new_fd) );
+				new_cons.back()->attach(reactor);
 			}
 		}
 		// Schedule Jobs
-		query_manager->schedule_pending_jobs();
+		request_scheduling();
 
 		if ( config.update_interval == 0 )
 			continue;
@@ -154,38 +161,201 @@ void IndexServer::run() {
 		}
 	}
 
+	lock.unlock();
+	stop_scheduling_threads();
 	close(listen_socket);
 	Log::info("Index-Server done.");
 }
 
-void IndexServer::setup_fdset(struct pollfd *fds, size_t &pos) {
-	auto niter = nodes.begin();
-	while ( niter != nodes.end() ) {
-		auto node = niter->second;
+void IndexServer::post_task(std::function<void()> task) {
+	std::lock_guard<std::mutex> guard(tasks_mutex);
+	tasks.push_back(std::move(task));
+	tasks_cond.notify_one();
+}
+
+void IndexServer::scheduling_loop() {
+	while ( true ) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> guard(tasks_mutex);
+			tasks_cond.wait(guard, [this] { return tasks_shutdown || !tasks.empty(); });
+			if ( tasks_shutdown )
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
 		try {
-			node->setup_connections(fds,pos,*query_manager);
-			niter++;
-		} catch ( const NodeFailedException &nfe ) {
-			Log::warn("Node-failure: %s", nfe.what() );
-			niter = nodes.erase(niter);
-			caches.node_failed(node->id);
-			query_manager->node_failed(*node);
+			task();
+		} catch ( const std::exception &e ) {
+			Log::error("Unexpected error in scheduling-thread: %s", e.what());
+		}
+	}
+}
+
+void IndexServer::stop_scheduling_threads() {
+	{
+		std::lock_guard<std::mutex> guard(tasks_mutex);
+		tasks_shutdown = true;
+		tasks.clear();
+		tasks_cond.notify_all();
+	}
+	for ( auto &t : scheduling_threads )
+		t.join();
+	scheduling_threads.clear();
+}
+
+void IndexServer::request_scheduling() {
+	if ( scheduling_requested.exchange(true) )
+		return;
+	post_task( [this] {
+		scheduling_requested = false;
+		std::lock_guard<std::mutex> lock(scheduling_mutex);
+		query_manager->schedule_pending_jobs();
+	});
+}
+
+void IndexServer::handle_client_request(uint64_t client_id, const BaseRequest& req) {
+	std::unique_lock<std::mutex> lock(scheduling_mutex);
+	try {
+		// Batching with existing jobs makes the lookup unnecessary
+		if ( query_manager->add_to_existing_job(client_id, req) )
+			return;
+		lock.unlock();
+		auto lookup = query_manager->lookup_request(req);
+		lock.lock();
+		query_manager->add_request(client_id, req, std::move(lookup));
+	} catch ( const std::exception &ex ) {
+		Log::warn("QueryManager returned error while adding request: %s",ex.what());
+		if ( !lock.owns_lock() )
+			lock.lock();
+		auto cc = suspended_client_connections.find(client_id);
+		if ( cc != suspended_client_connections.end() ) {
+			cc->second->send_error("Unable to serve request. Try again later!");
+			resume_client(cc);
 		}
+		return;
+	}
+	query_manager->schedule_pending_jobs();
+}
+
+void IndexServer::handle_worker_query(uint32_t node_id, uint64_t worker_id, const BaseRequest& req) {
+	std::unique_ptr<CacheQueryResult<IndexCacheEntry>> res;
+	std::string error;
+	try {
+		res = make_unique<CacheQueryResult<IndexCacheEntry>>(query_manager->lookup_worker_query(req));
+	} catch ( const std::exception &ex ) {
+		error = ex.what();
+	}
+
+	std::lock_guard<std::mutex> lock(scheduling_mutex);
+	// The worker may have failed in the meantime
+	auto node = nodes.find(node_id);
+	if ( node == nodes.end() )
+		return;
+	auto &workers = node->second->get_busy_workers();
+	auto wi = workers.find(worker_id);
+	if ( wi == workers.end() || wi->second->get_state() != WorkerState::QUERY_REQUESTED )
+		return;
+
+	WorkerConnection &wc = *wi->second;
+	try {
+		if ( res == nullptr )
+			throw IllegalStateException(concat("Cache-lookup failed: ", error));
+		query_manager->process_worker_query(wc, std::move(*res));
+	} catch ( const std::exception &ex ) {
+		Log::error("Processing worker-query failed: %s. Closing connection.", ex.what());
+		wc.set_faulty();
+		wakeup();
+	}
+}
+
+void IndexServer::process_connections(const std::vector<PollableConnection*> &ready) {
+	for ( auto con : ready ) {
+		if ( auto cc = dynamic_cast<ClientConnection*>(con) ) {
+			// Suspended clients wait for the scheduling-threads
+			auto it = client_connections.find(cc->id);
+			if ( it != client_connections.end() )
+				process_client_connection(it);
+		}
+		else if ( auto wc = dynamic_cast<WorkerConnection*>(con) ) {
+			// Idle workers have nothing to do
+			auto node = nodes.find(wc->node_id);
+			if ( node != nodes.end() && node->second->get_busy_workers().count(wc->id) > 0 )
+				process_worker_connection(*node->second, *wc);
+		}
+		else if ( auto cc = dynamic_cast<ControlConnection*>(con) ) {
+			auto node = nodes.find(cc->node_id);
+			if ( node != nodes.end() )
+				process_control_connection(*node->second);
+		}
+	}
+}
+
+void IndexServer::remove_faulty_connections(const std::vector<PollableConnection*> &ready) {
+	// Collect the ids first, as a failed node destroys all of its connections
+	std::vector<uint32_t> failed_nodes;
+	std::vector<std::pair<uint32_t,uint64_t>> faulty_workers;
+	std::vector<uint64_t> faulty_clients;
+	for ( auto con : ready ) {
+		if ( !con->is_faulty() )
+			continue;
+		if ( auto cc = dynamic_cast<ClientConnection*>(con) )
+			faulty_clients.push_back(cc->id);
+		else if ( auto wc = dynamic_cast<WorkerConnection*>(con) )
+			faulty_workers.emplace_back(wc->node_id, wc->id);
+		else if ( auto cc = dynamic_cast<ControlConnection*>(con) )
+			failed_nodes.push_back(cc->node_id);
+	}
+
+	for ( auto node_id : failed_nodes ) {
+		auto niter = nodes.find(node_id);
+		if ( niter == nodes.end() )
+			continue;
+		auto node = niter->second;
+		Log::warn("Node-failure: ControlConnection of node %d is faulty!", node_id);
+		nodes.erase(niter);
+		caches.node_failed(node->id);
+		query_manager->node_failed(*node);
 	}
 
-	auto clit = client_connections.begin();
-	while (clit != client_connections.end()) {
+	for ( auto &w : faulty_workers ) {
+		auto niter = nodes.find(w.first);
+		if ( niter != nodes.end() )
+			niter->second->worker_failed(w.second, *query_manager);
+	}
+
+	for ( auto client_id : faulty_clients ) {
+		auto clit = client_connections.find(client_id);
+		if ( clit == client_connections.end() )
+			continue;
 		ClientConnection &cc = *clit->second;
-		if (cc.is_faulty()) {
-			if ( cc.get_state() != ClientState::IDLE ) {
-				Log::debug("Client connection cancelled: %ld", cc.id);
-				query_manager->handle_client_abort(cc.id);
-			}
-			client_connections.erase(clit++);
+		if ( cc.get_state() != ClientState::IDLE ) {
+			Log::debug("Client connection cancelled: %ld", cc.id);
+			query_manager->handle_client_abort(cc.id);
 		}
-		else {
-			cc.prepare(&fds[pos++]);
-			clit++;
+		client_connections.erase(clit);
+	}
+}
+
+void IndexServer::check_timeouts() {
+	time_t now = CacheCommon::time_millis();
+	if ( now - last_timeout_check < 1000 )
+		return;
+	last_timeout_check = now;
+
+	// Marking a connection faulty activates it, so it is removed in the next cycle
+	for ( auto &p : nodes ) {
+		auto &cc = p.second->get_control_connection();
+		if ( cc.get_last_action() + 60000 < now && cc.get_state() != ControlState::IDLE ) {
+			Log::warn("Control-Connection stuck in non-idle state for more than 1 min. Closing!");
+			cc.set_faulty();
+		}
+		for ( auto &e : p.second->get_busy_workers() ) {
+			WorkerConnection &wc = *e.second;
+			if ( wc.get_last_action() + 60000 < now && wc.get_state() != WorkerState::IDLE && !wc.is_faulty() ) {
+				Log::warn("Worker-Connection stuck in non-idle state for more than 1 min. Closing!");
+				wc.set_faulty();
+			}
 		}
 	}
 }
@@ -201,6 +371,7 @@ void IndexServer::process_handshake(std::vector<std::unique_ptr<NewNBConnection>
 				switch (magic) {
 					case ClientConnection::MAGIC_NUMBER: {
 						std::unique_ptr<ClientConnection> cc = make_unique<ClientConnection>(nc.release_socket());
+						cc->attach(reactor);
 						Log::trace("New client connections established, id: %lu", cc->id);
 						if ( !client_connections.emplace(cc->id, std::move(cc)).second )
 							throw MustNotHappenException("Emplaced same connection-id twice!");
@@ -209,6 +380,7 @@ void IndexServer::process_handshake(std::vector<std::unique_ptr<NewNBConnection>
 					case WorkerConnection::MAGIC_NUMBER: {
 						uint32_t node_id = data.read<uint32_t>();
 						std::unique_ptr<WorkerConnection> wc = make_unique<WorkerConnection>(nc.release_socket(),node_id);
+						wc->attach(reactor);
 						Log::info("New worker registered for node: %d, id: %d", node_id, wc->id);
 						nodes.at(node_id)->add_worker(std::move(wc));
 						break;
@@ -218,6 +390,7 @@ void IndexServer::process_handshake(std::vector<std::unique_ptr<NewNBConnection>
 						uint32_t id = next_node_id++;
 
 						auto node = std::make_shared<Node>(id, nc.hostname, hs, make_unique<ControlConnection>(nc.release_socket(), id, nc.hostname) );
+						node->get_control_connection().attach(reactor);
 						nodes.emplace(node->id, node);
 						caches.process_handshake(node->id,hs);
 						Log::info("New node registered. ID: %d, hostname: %s", node->id, nc.hostname.c_str() );
@@ -237,24 +410,9 @@ void IndexServer::process_handshake(std::vector<std::unique_ptr<NewNBConnection>
 	}
 }
 
-void IndexServer::process_nodes() {
-	for ( auto &p : nodes ) {
-		auto &node = *p.second;
-		process_control_connection(node);
-		process_worker_connections(node);
-	}
-}
-
 void IndexServer::process_control_connection( Node &node ) {
 	auto &cc = node.get_control_connection();
-	if ( cc.get_last_action() + 60000 < CacheCommon::time_millis() && cc.get_state() != ControlState::IDLE ) {
-		Log::warn("Control-Connection stuck in non-idle state for more than 1 min. Closing!");
-		cc.set_faulty();
-		return;
-	}
-
-	// Default handling
-	else if ( cc.process() ) {
+	if ( cc.process() ) {
 		switch (cc.get_state()) {
 			case ControlState::MOVE_RESULT_READ: {
 				Log::trace("Node %d migrated one cache-entry.", cc.node_id);
@@ -290,119 +448,103 @@ void IndexServer::handle_reorg_result(const ReorgMoveResult& res) {
 	caches.get_cache(res.type).move(old,new_key);
 }
 
-void IndexServer::process_client_connections() {
-	auto it = client_connections.begin();
-	while (it != client_connections.end()) {
-		ClientConnection &cc = *it->second;
-		if ( cc.process() ) {
-			// Handle state-changes
-			switch (cc.get_state()) {
-				case ClientState::AWAIT_RESPONSE:
-					Log::debug("Client-request read: %s", cc.get_request().to_string().c_str() );
-					try {
-						query_manager->add_request(cc.id, cc.get_request());
-						it = suspend_client(it);
-					} catch ( const std::exception &ex ) {
-						Log::warn("QueryManager returned error while adding request: %s",ex.what());
-						cc.send_error("Unable to serve request. Try again later!");
-					}
-					continue;
-				case ClientState::AWAIT_STATS: {
-					SystemStats cumulated( query_manager->get_stats() );
-					for ( auto &p : nodes )
-						cumulated += p.second->get_query_stats();
-					cc.send_stats(cumulated);
-					break;
-				}
-				case ClientState::AWAIT_RESET:
-					query_manager->reset_stats();
-					for ( auto &p : nodes )
-						p.second->reset_query_stats();
-					cc.confirm_reset();
-					break;
-				default:
-					throw IllegalStateException(
-						concat("Illegal client-connection state after read: ", (int) cc.get_state()));
+void IndexServer::process_client_connection( client_map::iterator it ) {
+	ClientConnection &cc = *it->second;
+	if ( cc.process() ) {
+		// Handle state-changes
+		switch (cc.get_state()) {
+			case ClientState::AWAIT_RESPONSE: {
+				Log::debug("Client-request read: %s", cc.get_request().to_string().c_str() );
+				uint64_t client_id = cc.id;
+				BaseRequest req = cc.get_request();
+				suspend_client(it);
+				post_task( [this,client_id,req] { handle_client_request(client_id, req); } );
+				break;
+			}
+			case ClientState::AWAIT_STATS: {
+				SystemStats cumulated( query_manager->get_stats() );
+				for ( auto &p : nodes )
+					cumulated += p.second->get_query_stats();
+				cc.send_stats(cumulated);
+				break;
 			}
+			case ClientState::AWAIT_RESET:
+				query_manager->reset_stats();
+				for ( auto &p : nodes )
+					p.second->reset_query_stats();
+				cc.confirm_reset();
+				break;
+			default:
+				throw IllegalStateException(
+					concat("Illegal client-connection state after read: ", (int) cc.get_state()));
 		}
-		it++;
 	}
 }
 
-void IndexServer::process_worker_connections(Node &node) {
-	std::vector<uint64_t> finished_workers;
-	for (auto &e : node.get_busy_workers() ) {
-		WorkerConnection &wc = *e.second;
-
-		if ( wc.get_last_action() + 60000 < CacheCommon::time_millis() && wc.get_state() != WorkerState::IDLE ) {
-			Log::warn("Worker-Connection stuck in non-idle state for more than 1 min. Closing!");
-			wc.set_faulty();
-			continue;
-		}
-
-		if (wc.process()) {
-			// Handle state-changes
-			switch (wc.get_state()) {
-				case WorkerState::ERROR: {
-					Log::warn("Worker returned error: %s. Forwarding to client.",
-						wc.get_error_message().c_str());
-					query_manager->close_worker(wc.id);
-					auto clients = query_manager->release_worker(wc.id, wc.node_id);
-					for (auto &cid : clients) {
-						auto cc = suspended_client_connections.find(cid);
-						if ( cc != suspended_client_connections.end() ) {
-							cc->second->send_error(wc.get_error_message());
-							resume_client(cc);
-						}
-						else
-							Log::warn("Client %d does not exist.", cid);
+void IndexServer::process_worker_connection(Node &node, WorkerConnection &wc) {
+	if (wc.process()) {
+		// Handle state-changes
+		switch (wc.get_state()) {
+			case WorkerState::ERROR: {
+				Log::warn("Worker returned error: %s. Forwarding to client.",
+					wc.get_error_message().c_str());
+				query_manager->close_worker(wc.id);
+				auto clients = query_manager->release_worker(wc.id, wc.node_id);
+				for (auto &cid : clients) {
+					auto cc = suspended_client_connections.find(cid);
+					if ( cc != suspended_client_connections.end() ) {
+						cc->second->send_error(wc.get_error_message());
+						resume_client(cc);
 					}
-					finished_workers.push_back(wc.id);
-					break;
+					else
+						Log::warn("Client %d does not exist.", cid);
 				}
-				case WorkerState::DONE: {
-					Log::debug("Worker returned result. Determinig delivery qty.");
-					size_t qty = query_manager->close_worker(wc.id);
-					wc.send_delivery_qty(qty);
-					break;
-				}
-				case WorkerState::DELIVERY_READY: {
-					DeliveryResponse response(node.host,node.port, wc.get_delivery_id());
-					Log::debug("Worker returned delivery: %s", response.to_string().c_str());
-					auto clients = query_manager->release_worker(wc.id, wc.node_id);
-					for (auto &cid : clients) {
-						auto cc = suspended_client_connections.find(cid);
-						if ( cc != suspended_client_connections.end() ) {
-							cc->second->send_response(response);
-							resume_client(cc);
-						}
-						else
-							Log::warn("Client %d does not exist.", cid);
+				node.release_worker(wc.id);
+				break;
+			}
+			case WorkerState::DONE: {
+				Log::debug("Worker returned result. Determinig delivery qty.");
+				size_t qty = query_manager->close_worker(wc.id);
+				wc.send_delivery_qty(qty);
+				break;
+			}
+			case WorkerState::DELIVERY_READY: {
+				DeliveryResponse response(node.host,node.port, wc.get_delivery_id());
+				Log::debug("Worker returned delivery: %s", response.to_string().c_str());
+				auto clients = query_manager->release_worker(wc.id, wc.node_id);
+				for (auto &cid : clients) {
+					auto cc = suspended_client_connections.find(cid);
+					if ( cc != suspended_client_connections.end() ) {
+						cc->second->send_response(response);
+						resume_client(cc);
 					}
-					finished_workers.push_back(wc.id);
-					break;
-				}
-				case WorkerState::NEW_ENTRY: {
-					auto &mce = wc.get_new_entry();
-					Log::debug("Worker added new cache-entry, type: %d", (int) mce.type);
-					caches.get_cache( mce.type ).put(mce.semantic_id,wc.node_id,mce.entry_id,mce);
-					wc.entry_cached();
-					break;
-				}
-				case WorkerState::QUERY_REQUESTED: {
-					Log::debug("Worker issued cache-query: %s", wc.get_query().to_string().c_str());
-					query_manager->process_worker_query(wc);
-					break;
-				}
-				default: {
-					throw IllegalStateException(
-						concat("Illegal worker-connection state after read: ", (int) wc.get_state()));
+					else
+						Log::warn("Client %d does not exist.", cid);
 				}
+				node.release_worker(wc.id);
+				break;
+			}
+			case WorkerState::NEW_ENTRY: {
+				auto &mce = wc.get_new_entry();
+				Log::debug("Worker added new cache-entry, type: %d", (int) mce.type);
+				caches.get_cache( mce.type ).put(mce.semantic_id,wc.node_id,mce.entry_id,mce);
+				wc.entry_cached();
+				break;
+			}
+			case WorkerState::QUERY_REQUESTED: {
+				Log::debug("Worker issued cache-query: %s", wc.get_query().to_string().c_str());
+				uint32_t node_id = node.id;
+				uint64_t worker_id = wc.id;
+				BaseRequest req = wc.get_query();
+				post_task( [this,node_id,worker_id,req] { handle_worker_query(node_id, worker_id, req); } );
+				break;
+			}
+			default: {
+				throw IllegalStateException(
+					concat("Illegal worker-connection state after read: ", (int) wc.get_state()));
 			}
 		}
 	}
-	for ( auto &id : finished_workers )
-		node.release_worker(id);
 }
 
 void IndexServer::reorganize(bool force) {
@@ -26,6 +26,10 @@
 #include <map>
 #include <vector>
 #include <deque>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
 
 
 /**
@@ -38,7 +42,12 @@
  * this node must use this id to register themselves at the index.
  *
  * Client-connections may issue requests to the server.
- * The server handles everything in a single thread.
+ * The network-IO is handled by the thread calling run(). Cache-lookups
+ * for client-requests and worker-queries are handed to a pool of scheduling
+ * threads, so slow lookups do not block the event-loop. The lookup itself
+ * relies on the internally synchronized caches. Everything else (connections,
+ * nodes and the query-manager) is guarded by the scheduling-mutex, which
+ * the network-thread holds while processing the events of one cycle.
  */
 class IndexServer {
 	friend class TestIdxServer;
@@ -65,43 +74,49 @@ public:
 	virtual void stop();
 private:
 	/**
-	 * Adds the fds of all connections to the read-/write-set and kills faulty connections
+	 * Processes the connections the reactor reported events for
+	 * @param ready the connections with pending events
 	 */
-	void setup_fdset( struct pollfd *fds, size_t &pos );
+	void process_connections( const std::vector<PollableConnection*> &ready );
 
 	/**
-	 * Processes the handshake with newly accepted connections
-	 * @param new_fds the accepted but not initialized connections
-	 * @param readfds the set of fds
+	 * Kills faulty connections among the given ones. Their sockets are removed
+	 * from the reactor on destruction.
+	 * @param ready the connections with pending events
 	 */
-	void process_handshake( std::vector<std::unique_ptr<NewNBConnection>> &new_fds );
+	void remove_faulty_connections( const std::vector<PollableConnection*> &ready );
 
 	/**
-	 * Processes actions on control-connections
-	 * @param readfds the set of fds to wait for data to read
-	 * @param writefds the set of fds to wait for data to write
+	 * Marks connections stuck in a non-idle state as faulty. Runs at most once per second.
 	 */
-	void process_nodes();
+	void check_timeouts();
 
+	/**
+	 * Processes the handshake with newly accepted connections
+	 * @param new_fds the accepted but not initialized connections
+	 */
+	void process_handshake( std::vector<std::unique_ptr<NewNBConnection>> &new_fds );
 
 	/**
 	 * Processes actions on control-connections
-	 * @param cc the connection to handle
+	 * @param node the node owning the connection
 	 */
 	void process_control_connection(Node &node);
 
 	/**
-	 * Processes actions on worker-connections
-	 * @param the connection to handle
+	 * Processes actions on a busy worker-connection
+	 * @param node the node owning the connection
+	 * @param wc the connection to handle
 	 */
-	void process_worker_connections(Node &node);
+	void process_worker_connection(Node &node, WorkerConnection &wc);
+
+	typedef std::map<uint64_t,std::unique_ptr<ClientConnection>> client_map;
 
 	/**
-	 * Processes actions on client-connections
-	 * @param readfds the set of fds to wait for data to read
-	 * @param writefds the set of fds to wait for data to write
+	 * Processes actions on an active client-connection
+	 * @param it the position of the connection in client_connections
 	 */
-	void process_client_connections();
+	void process_client_connection( client_map::iterator it );
 
 	// Adjusts the cache according to the given reorg
 	/**
@@ -124,11 +139,33 @@ private:
 
 	void wakeup();
 
-	typedef std::map<uint64_t,std::unique_ptr<ClientConnection>> client_map;
-
 	client_map::iterator suspend_client( client_map::iterator element );
 	client_map::iterator resume_client( client_map::iterator element );
 
+	/**
+	 * Looks up the request of a suspended client and hands it
+	 * to the query-manager. Executed by the scheduling-threads.
+	 */
+	void handle_client_request( uint64_t client_id, const BaseRequest &req );
+
+	/**
+	 * Looks up the query of a worker and hands the result
+	 * to the query-manager. Executed by the scheduling-threads.
+	 */
+	void handle_worker_query( uint32_t node_id, uint64_t worker_id, const BaseRequest &req );
+
+	/**
+	 * Queues a call to schedule_pending_jobs, unless one is already pending.
+	 */
+	void request_scheduling();
+
+	void post_task( std::function<void()> task );
+	void scheduling_loop();
+	void stop_scheduling_threads();
+
+	// The event-loop all connections are attached to. Declared first, as the connections detach on destruction.
+	EpollReactor reactor;
+
 	// The currently known nodes
 	std::map<uint32_t,std::shared_ptr<Node>> nodes;
 	// Connections
@@ -154,7 +191,19 @@ private:
 	// timestamp of the last reorganization
 	time_t last_reorg;
 
-	BinaryStream wakeup_pipe;
+	// timestamp of the last check for stuck connections
+	time_t last_timeout_check;
+
+	// Guards the connections, the nodes and the query-manager
+	std::mutex scheduling_mutex;
+
+	// Pool executing lookups and scheduling
+	std::vector<std::thread> scheduling_threads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex tasks_mutex;
+	std::condition_variable tasks_cond;
+	bool tasks_shutdown;
+	std::atomic<bool> scheduling_requested;
 };
 
 #endif /* INDEX_INDEXSERVER_H_ */
@@ -28,27 +28,11 @@ Node::Node(uint32_t id, const std::string &host, const NodeHandshake &hs, std::u
 	}
 }
 
-void Node::setup_connections(struct pollfd* fds, size_t& pos, QueryManager &query_manager) {
-	ControlConnection &cc = *control_connection;
-	if (cc.is_faulty()) {
-		throw NodeFailedException("ControlConnection is faulty!");
-	}
-	else {
-		cc.prepare(&fds[pos++]);
-	}
-
-
-	auto wit = busy_workers.begin();
-	while (wit != busy_workers.end()) {
-		WorkerConnection &wc = *wit->second;
-		if (wc.is_faulty()) {
-			query_manager.worker_failed(wc.id);
-			wit = busy_workers.erase(wit);
-		}
-		else {
-			wc.prepare(&fds[pos++]);
-			wit++;
-		}
+void Node::worker_failed(uint64_t id, QueryManager &query_manager) {
+	auto it = busy_workers.find(id);
+	if ( it != busy_workers.end() ) {
+		query_manager.worker_failed(id);
+		busy_workers.erase(it);
 	}
 }
 
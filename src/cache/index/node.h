@@ -46,7 +46,12 @@ public:
 	 */
 	std::string to_string() const;
 
-	void setup_connections(struct pollfd *fds, size_t &pos, QueryManager &query_manager);
+	/**
+	 * Removes a faulty busy worker-connection and reports its failure
+	 * to the query-manager
+	 * @param id the id of the worker
+	 */
+	void worker_failed(uint64_t id, QueryManager &query_manager);
 
 	time_t last_stats_request() const;
 
@@ -20,30 +20,49 @@ bool DefaultQueryManager::use_reorg() const {
 	return true;
 }
 
-void DefaultQueryManager::add_request(uint64_t client_id, const BaseRequest &req ) {
-	stats.issued();
-	TIME_EXEC("QueryManager.add_request");
+std::unique_ptr<CacheQueryResult<IndexCacheEntry>> DefaultQueryManager::lookup_request(const BaseRequest &req) const {
+	auto &cache = caches.get_cache(req.type);
+	return make_unique<CacheQueryResult<IndexCacheEntry>>(cache.query(req.semantic_id, req.query));
+}
 
-	if ( enable_batching ) {
-		// Check if running jobs satisfy the given query
-		for (auto &qi : queries) {
-			if (qi.second->satisfies(req)) {
-				qi.second->add_client(client_id);
-				return;
-			}
+bool DefaultQueryManager::add_to_existing_job(uint64_t client_id, const BaseRequest &req) {
+	if ( !enable_batching )
+		return false;
+
+	// Check if running jobs satisfy the given query
+	for (auto &qi : queries) {
+		if (qi.second->satisfies(req)) {
+			stats.issued();
+			qi.second->add_client(client_id);
+			return true;
 		}
+	}
 
-		// Check if pending jobs satisfy the given query
-		for (auto &j : pending_jobs) {
-			if (j.second->satisfies(req)) {
-				j.second->add_client(client_id);
-				return;
-			}
+	// Check if pending jobs satisfy the given query
+	for (auto &j : pending_jobs) {
+		if (j.second->satisfies(req)) {
+			stats.issued();
+			j.second->add_client(client_id);
+			return true;
 		}
+	}
+	return false;
+}
+
+void DefaultQueryManager::add_request(uint64_t client_id, const BaseRequest &req, std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup ) {
+	// A job answering the request may have been added since the lookup
+	if ( add_to_existing_job(client_id, req) )
+		return;
+
+	stats.issued();
+	TIME_EXEC("QueryManager.add_request");
 
-		// Perform a cache-query
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
+	// The lookup ran without the scheduling lock, so its entries may have been removed since
+	if ( lookup == nullptr || !caches.get_cache(req.type).contains_all(req.semantic_id, lookup->items) )
+		lookup = lookup_request(req);
+	auto &res = *lookup;
+
+	if ( enable_batching ) {
 		stats.add_query(res.hit_ratio);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 
@@ -62,9 +81,6 @@ void DefaultQueryManager::add_request(uint64_t client_id, const BaseRequest &req
 		add_query(std::move(job));
 	}
 	else {
-		// Perform a cache-query
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
 		stats.add_query(res.hit_ratio);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 		auto job = create_job(req,res);
@@ -73,12 +89,18 @@ void DefaultQueryManager::add_request(uint64_t client_id, const BaseRequest &req
 	}
 }
 
-void DefaultQueryManager::process_worker_query(WorkerConnection& con) {
+CacheQueryResult<IndexCacheEntry> DefaultQueryManager::lookup_worker_query(const BaseRequest &req) const {
+	auto &cache = caches.get_cache(req.type);
+	return cache.query(req.semantic_id, req.query);
+}
+
+void DefaultQueryManager::process_worker_query(WorkerConnection& con, CacheQueryResult<IndexCacheEntry> &&res) {
 	auto &req = con.get_query();
 	try {
 		queries.at(con.id);
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
+		// The lookup ran without the scheduling lock, so its entries may have been removed since
+		if ( !caches.get_cache(req.type).contains_all(req.semantic_id, res.items) )
+			res = lookup_worker_query(req);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 
 		stats.add_query(res.hit_ratio);
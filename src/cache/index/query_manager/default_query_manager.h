@@ -87,8 +87,11 @@ class DefaultQueryManager : public QueryManager {
 	friend class CreateJob;
 public:
 	DefaultQueryManager(const std::map<uint32_t,std::shared_ptr<Node>> &nodes,IndexCacheManager &caches, bool enable_batching);
-	void add_request( uint64_t client_id, const BaseRequest &req );
-	void process_worker_query(WorkerConnection& con);
+	std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup_request( const BaseRequest &req ) const;
+	bool add_to_existing_job( uint64_t client_id, const BaseRequest &req );
+	void add_request( uint64_t client_id, const BaseRequest &req, std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup );
+	CacheQueryResult<IndexCacheEntry> lookup_worker_query( const BaseRequest &req ) const;
+	void process_worker_query(WorkerConnection& con, CacheQueryResult<IndexCacheEntry> &&res);
 	bool use_reorg() const;
 protected:
 	std::unique_ptr<PendingQuery> recreate_job( const RunningQuery &query );
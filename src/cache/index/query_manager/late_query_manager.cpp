@@ -159,7 +159,9 @@ LateQueryManager::LateQueryManager(
 		IndexCacheManager& caches, bool enable_batching) : QueryManager(nodes), caches(caches), enable_batching(enable_batching) {
 }
 
-void LateQueryManager::add_request(uint64_t client_id, const BaseRequest& req) {
+void LateQueryManager::add_request(uint64_t client_id, const BaseRequest& req, std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup) {
+	// the cache is queried when the job is submitted
+	(void) lookup;
 	stats.issued();
 	if ( enable_batching ) {
 		TIME_EXEC("QueryManager.add_request");
@@ -193,11 +195,17 @@ void LateQueryManager::add_request(uint64_t client_id, const BaseRequest& req) {
 	add_query(std::move(job));
 }
 
-void LateQueryManager::process_worker_query(WorkerConnection& con) {
+CacheQueryResult<IndexCacheEntry> LateQueryManager::lookup_worker_query(const BaseRequest &req) const {
+	auto &cache = caches.get_cache(req.type);
+	return cache.query(req.semantic_id, req.query);
+}
+
+void LateQueryManager::process_worker_query(WorkerConnection& con, CacheQueryResult<IndexCacheEntry> &&res) {
 	auto &req = con.get_query();
 	try {
-		auto &cache = caches.get_cache(req.type);
-		auto res = cache.query(req.semantic_id, req.query);
+		// The lookup ran without the scheduling lock, so its entries may have been removed since
+		if ( !caches.get_cache(req.type).contains_all(req.semantic_id, res.items) )
+			res = lookup_worker_query(req);
 		Log::debug("QueryResult: %s", res.to_string().c_str());
 
 		stats.add_query(res.hit_ratio);
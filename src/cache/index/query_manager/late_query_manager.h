@@ -30,8 +30,9 @@ private:
 class LateQueryManager : public QueryManager {
 public:
 	LateQueryManager(const std::map<uint32_t,std::shared_ptr<Node>> &nodes,IndexCacheManager &caches, bool enable_batching);
-	void add_request( uint64_t client_id, const BaseRequest &req );
-	void process_worker_query(WorkerConnection& con);
+	void add_request( uint64_t client_id, const BaseRequest &req, std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup );
+	CacheQueryResult<IndexCacheEntry> lookup_worker_query( const BaseRequest &req ) const;
+	void process_worker_query(WorkerConnection& con, CacheQueryResult<IndexCacheEntry> &&res);
 	bool use_reorg() const;
 protected:
 	std::unique_ptr<PendingQuery> recreate_job( const RunningQuery &query );
@@ -37,7 +37,9 @@ const BaseRequest& SimpleJob::get_request() const {
 SimpleQueryManager::SimpleQueryManager(const std::map<uint32_t, std::shared_ptr<Node> >& nodes) : QueryManager(nodes) {
 }
 
-void SimpleQueryManager::add_request(uint64_t client_id, const BaseRequest& req) {
+void SimpleQueryManager::add_request(uint64_t client_id, const BaseRequest& req, std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup) {
+	// scheduling is based on the query only
+	(void) lookup;
 	stats.issued();
 	std::unique_ptr<PendingQuery> j;
 	try {
@@ -51,8 +53,14 @@ void SimpleQueryManager::add_request(uint64_t client_id, const BaseRequest& req)
 	add_query(std::move(j));
 }
 
-void SimpleQueryManager::process_worker_query(WorkerConnection& con) {
+CacheQueryResult<IndexCacheEntry> SimpleQueryManager::lookup_worker_query(const BaseRequest &req) const {
+	(void) req;
+	throw MustNotHappenException("No worker-queries allowed in BEMA-scheduling! Check your node-configuration!");
+}
+
+void SimpleQueryManager::process_worker_query(WorkerConnection& con, CacheQueryResult<IndexCacheEntry> &&res) {
 	(void) con;
+	(void) res;
 	throw MustNotHappenException("No worker-queries allowed in BEMA-scheduling! Check your node-configuration!");
 }
 
@@ -37,6 +37,17 @@ std::unique_ptr<QueryManager> QueryManager::from_config( IndexCacheManager &mgr,
 QueryManager::QueryManager(const std::map<uint32_t, std::shared_ptr<Node>> &nodes ) : nodes(nodes) {
 }
 
+std::unique_ptr<CacheQueryResult<IndexCacheEntry>> QueryManager::lookup_request(const BaseRequest &req) const {
+	(void) req;
+	return nullptr;
+}
+
+bool QueryManager::add_to_existing_job(uint64_t client_id, const BaseRequest &req) {
+	(void) client_id;
+	(void) req;
+	return false;
+}
+
 void QueryManager::schedule_pending_jobs() {
 
 	size_t num_workers = 0;
@@ -124,7 +124,14 @@ public:
 };
 
 /**
- * The query-manager manages all pending and running queries
+ * The query-manager manages all pending and running queries.
+ *
+ * The index-server calls the manager from several scheduling threads.
+ * The lookup-methods only access the (internally synchronized) cache-structures
+ * and may run concurrently. All other methods modify the manager's state and
+ * must only be called while holding the index-server's scheduling lock. They
+ * re-validate the lookup-results they are handed, as the cache may have changed
+ * after the lookup.
  */
 class QueryManager {
 private:
@@ -147,20 +154,47 @@ public:
 	 */
 	QueryManager(const std::map<uint32_t,std::shared_ptr<Node>> &nodes);
 
+	/**
+	 * Performs the cache-lookup for a client-request ahead of add_request().
+	 * May be called concurrently without holding the scheduling lock.
+	 * @param req the query-spec
+	 * @return the lookup-result or nullptr if this manager does not use one
+	 */
+	virtual std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup_request( const BaseRequest &req ) const;
+
+	/**
+	 * Adds the client to a running or pending job whose result answers the given
+	 * request. Called before lookup_request(), which is not needed if this succeeds.
+	 * @param client_id the connection-id of the client issued this query
+	 * @param req the query-spec
+	 * @return whether the client was added to an existing job
+	 */
+	virtual bool add_to_existing_job( uint64_t client_id, const BaseRequest &req );
+
 	/**
 	 * Adds a new client-request to the processing pipeline. The manager
 	 * checks all running and pending queries, if their result might be
 	 * used to answer the new query. If not a new job is queued for execution.
 	 * @param client_id the connection-id of the client issued this query
 	 * @param req the query-spec
+	 * @param lookup the result of lookup_request() for this request
+	 */
+	virtual void add_request( uint64_t client_id, const BaseRequest &req, std::unique_ptr<CacheQueryResult<IndexCacheEntry>> lookup ) = 0;
+
+	/**
+	 * Performs the cache-lookup for a query issued by a worker.
+	 * May be called concurrently without holding the scheduling lock.
+	 * @param req the query-spec issued by the worker
+	 * @return the lookup-result passed to process_worker_query()
 	 */
-	virtual void add_request( uint64_t client_id, const BaseRequest &req ) = 0;
+	virtual CacheQueryResult<IndexCacheEntry> lookup_worker_query( const BaseRequest &req ) const = 0;
 
 	/**
 	 * Processes cache-requests from workers.
 	 * @param con the worker-connection issued the cache-query
+	 * @param res the result of lookup_worker_query() for the worker's query
 	 */
-	virtual void process_worker_query(WorkerConnection& con) = 0;
+	virtual void process_worker_query(WorkerConnection& con, CacheQueryResult<IndexCacheEntry> &&res) = 0;
 
 	/**
 	 * Schedules the jobs waiting for exectuion, according to their
@@ -15,8 +15,12 @@
 #include "datatypes/plot.h"
 
 #include "util/binarystream.h"
+#include "util/shared_memory.h"
 #include "util/log.h"
 
+#include <mutex>
+#include <unordered_map>
+
 //
 // Cache-Manager
 //
@@ -99,7 +103,21 @@ CacheWrapper<ProvenanceCollection>& NopCacheManager::get_provenance_cache() {
 
 template<typename T>
 ClientCacheWrapper<T>::ClientCacheWrapper(CacheType type, const std::string& idx_host,
-		int idx_port) : type(type), idx_host(idx_host), idx_port(idx_port) {
+		int idx_port, bool shared_memory) : type(type), idx_host(idx_host), idx_port(idx_port), shared_memory(shared_memory) {
+}
+
+/**
+ * Checks whether a node runs on this host, so its deliveries can be fetched
+ * through shared memory. The result is kept for each host.
+ */
+static bool is_colocated( const std::string &host ) {
+	static std::mutex mutex;
+	static std::unordered_map<std::string,bool> hosts;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = hosts.find(host);
+	if ( it == hosts.end() )
+		it = hosts.emplace(host, CacheCommon::is_local_host(host)).first;
+	return it->second;
 }
 
 template<typename T>
@@ -136,10 +154,39 @@ std::unique_ptr<T> ClientCacheWrapper<T>::query(
 			Log::debug("Contacting delivery-server: %s:%d, delivery_id: %d", dr.host.c_str(), dr.port, dr.delivery_id);
 
 			try {
+				bool shared = shared_memory && is_colocated(dr.host);
 				auto del_con = BlockingConnection::create(dr.host, dr.port, true, DeliveryConnection::MAGIC_NUMBER);
-				auto del_resp = del_con->write_and_read(DeliveryConnection::CMD_GET, dr.delivery_id);
+				// results sent over the socket are deserialized while they are read, the connection is not reused afterwards
+				std::unique_ptr<BinaryReadBuffer> del_resp;
+				if ( shared )
+					del_resp = del_con->write_and_read(DeliveryConnection::CMD_GET_SHARED, dr.delivery_id);
+				else {
+					del_con->write(DeliveryConnection::CMD_GET, dr.delivery_id);
+					del_resp = del_con->read_incrementally();
+				}
 
 				uint8_t del_rc = del_resp->read<uint8_t>();
+				if ( del_rc == DeliveryConnection::RESP_OK_SHARED ) {
+					auto name = del_resp->read<std::string>();
+					Log::debug("Delivery responded OK, reading shared memory: %s", name.c_str());
+					std::unique_ptr<SharedMemorySegment> segment;
+					try {
+						segment = make_unique<SharedMemorySegment>(SharedMemorySegment::open(name));
+					} catch ( const PlatformException &pe ) {
+						// e.g. the node runs in a container with its own /dev/shm
+						Log::warn("Could not open shared memory of delivery %d, requesting it over the socket: %s", dr.delivery_id, pe.what());
+						del_con->write(DeliveryConnection::CMD_GET, dr.delivery_id);
+						del_resp = del_con->read_incrementally();
+						del_rc = del_resp->read<uint8_t>();
+					}
+					if ( segment ) {
+						// The mapping stays valid after the name is gone
+						SharedMemorySegment::unlink(name);
+						BinaryReadBuffer data(segment->getData(), segment->getSize());
+						return read_result(data);
+					}
+				}
+
 				switch (del_rc) {
 					case DeliveryConnection::RESP_OK: {
 						Log::debug("Delivery responded OK.");
@@ -203,14 +250,14 @@ std::unique_ptr<ProvenanceCollection> ClientCacheWrapper<ProvenanceCollection>::
 // Client-cache
 //
 
-ClientCacheManager::ClientCacheManager(const std::string& idx_host, int idx_port) :
+ClientCacheManager::ClientCacheManager(const std::string& idx_host, int idx_port, bool shared_memory) :
 	idx_host(idx_host), idx_port(idx_port),
-	raster_cache(CacheType::RASTER, idx_host, idx_port),
-	point_cache(CacheType::POINT, idx_host, idx_port),
-	line_cache(CacheType::LINE, idx_host, idx_port),
-	poly_cache(CacheType::POLYGON, idx_host, idx_port),
-	plot_cache(CacheType::PLOT, idx_host, idx_port),
-	provenance_cache(CacheType::UNKNOWN, idx_host, idx_port){
+	raster_cache(CacheType::RASTER, idx_host, idx_port, shared_memory),
+	point_cache(CacheType::POINT, idx_host, idx_port, shared_memory),
+	line_cache(CacheType::LINE, idx_host, idx_port, shared_memory),
+	poly_cache(CacheType::POLYGON, idx_host, idx_port, shared_memory),
+	plot_cache(CacheType::PLOT, idx_host, idx_port, shared_memory),
+	provenance_cache(CacheType::UNKNOWN, idx_host, idx_port, shared_memory){
 }
 
 CacheWrapper<GenericRaster>& ClientCacheManager::get_raster_cache() {
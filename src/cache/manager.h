@@ -143,7 +143,7 @@ private:
 template<typename T>
 class ClientCacheWrapper : public CacheWrapper<T> {
 public:
-	ClientCacheWrapper( CacheType type, const std::string &idx_host, int idx_port );
+	ClientCacheWrapper( CacheType type, const std::string &idx_host, int idx_port, bool shared_memory = false );
 	bool put(const std::string &semantic_id, const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
 	std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
 protected:
@@ -152,6 +152,7 @@ private:
 	CacheType type;
 	const std::string idx_host;
 	const int idx_port;
+	const bool shared_memory;
 };
 
 /**
@@ -164,8 +165,9 @@ public:
 	 * Constructs a new instance
 	 * @param idx_host the hostname of the index-server
 	 * @param idx_port the port, the index-server listens
+	 * @param shared_memory whether to fetch results of nodes on the same host through shared memory
 	 */
-	ClientCacheManager(const std::string &idx_host, int idx_port);
+	ClientCacheManager(const std::string &idx_host, int idx_port, bool shared_memory = false);
 	CacheWrapper<GenericRaster>& get_raster_cache();
 	CacheWrapper<PointCollection>& get_point_cache();
 	CacheWrapper<LineCollection>& get_line_cache();
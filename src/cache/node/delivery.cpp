@@ -11,6 +11,8 @@
 #include "util/make_unique.h"
 #include "util/log.h"
 
+#include <algorithm>
+
 #include <sys/select.h>
 #include <sys/socket.h>
 
@@ -56,7 +58,7 @@ void Delivery::send(DeliveryConnection& connection) {
 ////////////////////////////////////////////////////////////
 
 DeliveryManager::DeliveryManager(const NodeConfig &config, NodeCacheManager &manager) :
-	shutdown(false), config(config), delivery_id(1), manager(manager), wakeup_pipe(BinaryStream::makePipe()) {
+	shutdown(false), config(config), delivery_id(1), manager(manager) {
 }
 
 template <typename T>
@@ -101,92 +103,77 @@ DeliveryManager::~DeliveryManager() {
 }
 
 void DeliveryManager::wakeup() {
-	BinaryWriteBuffer buffer;
-	buffer.write('w');
-	wakeup_pipe.write(buffer);
+	reactor.wakeup();
 }
 
+// The tag of the listen-socket. Connections are tagged with their address.
+static const uint64_t LISTEN_TAG = 0;
+
 
 void DeliveryManager::run() {
 	Log::info("Starting Delivery-Manager");
 	int delivery_fd = CacheCommon::get_listening_socket(config.delivery_port,true,SOMAXCONN);
 
-	struct pollfd fds[0xffff];
-	fds[0].fd = delivery_fd;
-	fds[0].events = POLLIN;
-	fds[1].fd = wakeup_pipe.getReadFD();
-	fds[1].events = POLLIN;
-
-	size_t num_fds;
+	// The listen-socket is level-triggered, we accept one connection per cycle.
+	reactor.add(delivery_fd, EpollReactor::READ, LISTEN_TAG);
 
 	std::vector<std::unique_ptr<NewNBConnection>> new_cons;
+	// The connections with events in the current cycle
+	std::vector<PollableConnection*> ready;
 
 	// Read on delivery-socket
 	while (!shutdown) {
-		// Prepare listen socket
-		fds[0].revents = 0;
-		// Prepare wakeup
-		fds[1].revents = 0;
-
-		num_fds = 2;
-
-		// setup new connections
+		// Kill faulty connections, before we wait for events
 		auto nc_iter = new_cons.begin();
 		while ( nc_iter != new_cons.end() ){
 			if ( (*nc_iter)->is_faulty() )
 				nc_iter = new_cons.erase(nc_iter);
-			else {
-				(*nc_iter)->prepare(&fds[num_fds++]);
+			else
 				nc_iter++;
-			}
 		}
 
-		// Setup active connections
-		auto dciter = connections.begin();
-			while (dciter != connections.end()) {
-			DeliveryConnection &dc = **dciter;
-			if ( dc.is_faulty() )
-				dciter = connections.erase(dciter);
-			else {
-				dc.prepare(&fds[num_fds++]);
-				dciter++;
+		bool accept_pending = false;
+		ready.clear();
+		try {
+			// Events must be dispatched before any connection is destroyed
+			for ( auto &event : reactor.wait(1000) ) {
+				if ( event.tag == LISTEN_TAG )
+					accept_pending = true;
+				else {
+					auto con = PollableConnection::from_tag(event.tag);
+					con->notify(event.events);
+					ready.push_back(con);
+				}
 			}
-		}
-
-
-		int poll_ret = poll(fds, num_fds, 1000 );
-		if (poll_ret < 0 && errno != EINTR) {
-			Log::error("Select returned error: %s", strerror(errno));
+		} catch ( const NetworkException &ne ) {
+			Log::error("Waiting for events failed: %s", ne.what());
 			exit(1);
 		}
-		else if (poll_ret > 0) {
-			if ( fds[1].revents & POLLIN ) {
-				// we have been woken, now we need to read any outstanding data or the pipe will remain readable
-				char buf[1024];
-				read(wakeup_pipe.getReadFD(), buf, 1024);
+		// A connection may have a socket-event and an activation
+		std::sort(ready.begin(), ready.end());
+		ready.erase(std::unique(ready.begin(), ready.end()), ready.end());
+
+		// Action on delivery connections with pending events. The handshakes
+		// are processed last, as they destroy the new connections they are done with.
+		process_connections(ready);
+
+		// Handshake
+		process_handshake(new_cons);
+
+		// New delivery connection
+		if ( accept_pending ) {
+			struct sockaddr_storage remote_addr;
+			socklen_t sin_size = sizeof(remote_addr);
+			int new_fd = accept(delivery_fd, (struct sockaddr *) &remote_addr, &sin_size);
+			if (new_fd == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+				Log::error("Accept failed: %d", strerror(errno));
+			else if (new_fd > 0) {
+				Log::debug("New connection established, fd: %d", new_fd);
+				new_cons.push_back( make_unique<NewNBConnection>(&remote_addr,new_fd) );
+				new_cons.back()->attach(reactor);
 			}
-
-			// Current connections
-			// Action on delivery connections
-			process_connections();
-
-			// Handshake
-			process_handshake(new_cons);
-
-			// New delivery connection
-			if ( fds[0].revents & POLLIN ) {
-				struct sockaddr_storage remote_addr;
-				socklen_t sin_size = sizeof(remote_addr);
-				int new_fd = accept(delivery_fd, (struct sockaddr *) &remote_addr, &sin_size);
-				if (new_fd == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
-					Log::error("Accept failed: %d", strerror(errno));
-				else if (new_fd > 0) {
-					Log::debug("New connection established, fd: %d", new_fd);
-					new_cons.push_back( make_unique<NewNBConnection>(&remote_addr,new_fd) );
-				}
-			}
-			remove_expired_deliveries();
 		}
+		remove_expired_deliveries();
 	}
 	close(delivery_fd);
 	Log::info("Delivery-Manager done.");
@@ -203,8 +190,10 @@ void DeliveryManager::process_handshake(
 				uint32_t magic = data.read<uint32_t>();
 				if (magic == DeliveryConnection::MAGIC_NUMBER) {
 					std::unique_ptr<DeliveryConnection> dc = make_unique<DeliveryConnection>(nc.release_socket());
+					dc->attach(reactor);
 					Log::debug("New delivery-connection createdm, id: %d", dc->id);
-					connections.push_back(std::move(dc));
+					auto id = dc->id;
+					connections.emplace(id, std::move(dc));
 				}
 				else
 					Log::warn("Received unknown magic-number: %d. Dropping connection.", magic);
@@ -220,12 +209,21 @@ void DeliveryManager::process_handshake(
 
 }
 
-void DeliveryManager::process_connections() {
-	for ( auto &dc : connections ) {
+void DeliveryManager::process_connections( const std::vector<PollableConnection*> &ready ) {
+	std::vector<uint64_t> faulty;
+	for ( auto con : ready ) {
+		auto dc = dynamic_cast<DeliveryConnection*>(con);
+		if ( dc == nullptr )
+			continue;
 		if ( dc->process() ) {
 			switch ( dc->get_state() ) {
 				case DeliveryState::DELIVERY_REQUEST_READ: {
 					uint64_t id = dc->get_delivery_id();
+					// The delivery was already counted when it was placed in shared memory
+					if ( dc->resend_shared() ) {
+						Log::debug("Sending delivery over the socket, the client could not open its shared memory: %d", id);
+						break;
+					}
 					try {
 						auto &res = get_delivery(id);
 						Log::debug("Sending delivery: %d", id);
@@ -252,7 +250,11 @@ void DeliveryManager::process_connections() {
 					Log::trace("Nothing todo on delivery connection: %d", dc->id);
 			}
 		}
+		if ( dc->is_faulty() )
+			faulty.push_back(dc->id);
 	}
+	for ( auto id : faulty )
+		connections.erase(id);
 }
 
 void DeliveryManager::handle_cache_request(DeliveryConnection& dc) {
@@ -160,12 +160,11 @@ private:
 	void process_handshake( std::vector<std::unique_ptr<NewNBConnection>> &new_fds );
 
 	/**
-	 * Processes all active connections. Checks if socket is ready
-	 * to send/receive data and takes the appropriate actions
-	 * @param readfds the fd_set for reads
-	 * @param writefds the fd_set for writes
+	 * Processes the delivery-connections the reactor reported events for
+	 * and removes those that turned out to be faulty
+	 * @param ready the connections with pending events
 	 */
-	void process_connections();
+	void process_connections( const std::vector<PollableConnection*> &ready );
 
 	/**
 	 * Processes direct requests to a cache-entry.
@@ -214,13 +213,14 @@ private:
 	/** the currently stored deliveries */
 	std::map<uint64_t, Delivery> deliveries;
 
-	/**  the currently open connections */
-	std::vector<std::unique_ptr<DeliveryConnection>> connections;
+	/** the event-loop, declared before the connections as they detach on destruction */
+	EpollReactor reactor;
+
+	/**  the currently open connections by id */
+	std::map<uint64_t,std::unique_ptr<DeliveryConnection>> connections;
 
 	/** Reference to the cache-manager */
 	NodeCacheManager &manager;
-
-	BinaryStream wakeup_pipe;
 };
 
 #endif /* DELIVERY_H_ */
@@ -87,7 +87,7 @@ template<typename T>
 std::unique_ptr<T> HybridCacheWrapper<T>::query(GenericOperator& op,
 		const QueryRectangle& rect, QueryProfiler &profiler) {
 
-	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticId(), rect);
+	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticDigest(), op.getSemanticId(), rect);
 	for ( auto &e : qres.items ) {
 		// Track costs
 		profiler.addTotalCosts(e->profile);
@@ -75,7 +75,7 @@ std::unique_ptr<T> LocalCacheWrapper<T>::query(GenericOperator& op,
 	if ( mgr.get_worker_context().get_puzzle_depth() > op.getDepth() )
 		throw NoSuchElementException("No query");
 
-	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticId(), rect);
+	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticDigest(), op.getSemanticId(), rect);
 	for ( auto &e : qres.items ) {
 		// Track costs
 		profiler.addTotalCosts(e->profile);
@@ -7,6 +7,7 @@
 
 #include "cache/node/manager/remote_manager.h"
 #include "cache/priv/connection.h"
+#include "operators/plan_cache.h"
 
 #include "datatypes/raster.h"
 #include "datatypes/pointcollection.h"
@@ -96,7 +97,7 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 			op.getSemanticId().c_str());
 
 	// Local lookup
-	CacheQueryResult < NodeCacheEntry < T >> qres = this->cache.query(op.getSemanticId(), rect);
+	CacheQueryResult < NodeCacheEntry < T >> qres = this->cache.query(op.getSemanticDigest(), op.getSemanticId(), rect);
 	// Only process locally if there is no remainder
 	if (!qres.has_remainder()) {
 		this->stats.add_query(qres.hit_ratio);
@@ -208,7 +209,7 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::process_puzzle(
 	std::unique_ptr<T> result;
 	QueryProfiler profiler;
 	{
-		auto op = GenericOperator::fromJSON(request.semantic_id);
+		auto op = OperatorPlanCache::get(request.semantic_id);
 		QueryProfilerRunningGuard guard(parent_profiler, profiler);
 		result = process_puzzle_int(*op,request, profiler);
 	}
@@ -74,9 +74,9 @@ NodeCache<GenericPlot>::NodeCache(CacheType type, size_t max_size) : Cache(true)
 
 template<typename EType>
 const CacheQueryResult<NodeCacheEntry<EType> > NodeCache<EType>::query(
-		const std::string& semantic_id, const QueryRectangle& qr) const {
+		const SemanticDigest& digest, const std::string& semantic_id, const QueryRectangle& qr) const {
 
-	auto res = Cache<uint64_t,NodeCacheEntry<EType>>::query(semantic_id,qr);
+	auto res = Cache<uint64_t,NodeCacheEntry<EType>>::query(digest,semantic_id,qr);
 	for ( std::shared_ptr<const NodeCacheEntry<EType>> &e : res.items ) {
 		track_access(NodeCacheKey(semantic_id,e->entry_id), * const_cast<NodeCacheEntry<EType>*>( e.get()));
 	}
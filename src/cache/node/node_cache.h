@@ -67,7 +67,8 @@ public:
 	NodeCache() = delete;
 	NodeCache( const NodeCache& ) = delete;
 
-	const CacheQueryResult<NodeCacheEntry<EType>> query( const std::string &semantic_id, const QueryRectangle &qr ) const;
+	using Cache<uint64_t,NodeCacheEntry<EType>>::query;
+	const CacheQueryResult<NodeCacheEntry<EType>> query( const SemanticDigest &digest, const std::string &semantic_id, const QueryRectangle &qr ) const;
 
 	/**
 	 * Adds an entry to the cache. The given data-item is cloned and stored.
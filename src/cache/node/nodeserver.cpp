@@ -10,6 +10,7 @@
 #include "cache/node/nodeserver.h"
 #include "cache/node/delivery.h"
 #include "cache/priv/connection.h"
+#include "operators/plan_cache.h"
 
 #include "datatypes/raster.h"
 #include "datatypes/pointcollection.h"
@@ -110,7 +111,7 @@ void NodeServer::process_worker_command(BlockingConnection &index_con, BinaryRea
 void NodeServer::process_create_request(BlockingConnection &index_con,
 		const BaseRequest& request) {
 	TIME_EXEC("RequestProcessing.create");
-	auto op = GenericOperator::fromJSON(request.semantic_id);
+	auto op = OperatorPlanCache::get(request.semantic_id);
 
 	QueryProfiler profiler;
 	switch ( request.type ) {
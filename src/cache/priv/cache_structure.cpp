@@ -429,8 +429,14 @@ Cache<KType, EType>::Cache(bool query_exact) : query_exact(query_exact) {
 template<typename KType, typename EType>
 const CacheQueryResult<EType> Cache<KType, EType>::query(
 	const std::string& semantic_id, const QueryRectangle& qr) const {
+	return query(SemanticDigest(semantic_id), semantic_id, qr);
+}
+
+template<typename KType, typename EType>
+const CacheQueryResult<EType> Cache<KType, EType>::query(
+	const SemanticDigest& digest, const std::string& semantic_id, const QueryRectangle& qr) const {
 	try {
-		return get_cache(semantic_id).query(qr);
+		return get_cache(digest,semantic_id).query(qr);
 	} catch ( const NoSuchElementException &nse ) {
 		return CacheQueryResult<EType>(qr);
 	}
@@ -439,19 +445,19 @@ const CacheQueryResult<EType> Cache<KType, EType>::query(
 template<typename KType, typename EType>
 void Cache<KType, EType>::put_int(const std::string& semantic_id,
 		const KType& key, const std::shared_ptr<EType>& entry) {
-	get_cache(semantic_id,true).put( key, entry );
+	get_cache(SemanticDigest(semantic_id),semantic_id,true).put( key, entry );
 }
 
 template<typename KType, typename EType>
 std::shared_ptr<EType> Cache<KType, EType>::get_int(
 	const std::string& semantic_id, const KType& key) const {
-	return get_cache(semantic_id).get(key);
+	return get_cache(SemanticDigest(semantic_id),semantic_id).get(key);
 }
 
 template<typename KType, typename EType>
 std::shared_ptr<EType> Cache<KType, EType>::remove_int(
 	const std::string& semantic_id,const KType& key) {
-	return get_cache(semantic_id).remove(key);
+	return get_cache(SemanticDigest(semantic_id),semantic_id).remove(key);
 	// TODO: Find a safe way to remove structures
 //	auto &cache = get_cache(semantic_id);
 //	auto res = cache.remove(key);
@@ -467,25 +473,30 @@ std::unordered_map<std::string, std::vector<std::shared_ptr<EType>> > Cache<KTyp
 
 	std::unordered_map<std::string, std::vector<std::shared_ptr<EType>>> result;
 	for ( auto &p : caches ) {
-		result.emplace( p.first, p.second->get_all() );
+		result.emplace( p.second->semantic_id, p.second->get_all() );
 	}
 	return result;
 }
 
 template<typename KType, typename EType>
 CacheStructure<KType, EType>& Cache<KType, EType>::get_cache(
-		const std::string& semantic_id, bool create) const {
+		const SemanticDigest& digest, const std::string& semantic_id, bool create) const {
 
 	std::lock_guard<std::mutex> guard(mtx);
 	Log::trace("Retrieving cache-structure for semantic_id: %s", semantic_id.c_str() );
-	auto got = caches.find(semantic_id);
+	auto got = caches.find(digest);
 	if (got == caches.end() && create) {
 		Log::trace("No cache-structure found for semantic_id: %s. Creating.", semantic_id.c_str() );
-		auto e = caches.emplace(semantic_id, make_unique<CacheStructure<KType,EType>>(semantic_id,query_exact));
+		auto e = caches.emplace(digest, make_unique<CacheStructure<KType,EType>>(semantic_id,query_exact));
 		return *e.first->second;
 	}
-	else if (got != caches.end())
+	else if (got != caches.end()) {
+		if (got->second->semantic_id != semantic_id) {
+			Log::warn("Semantic id digest %s collides for two different semantic ids", digest.asHex().c_str());
+			throw NoSuchElementException("The digest of the given semantic id belongs to another semantic id");
+		}
 		return *got->second;
+	}
 	else
 		throw NoSuchElementException("No structure present for given semantic id");
 }
@@ -10,6 +10,7 @@
 
 #include "cache/priv/shared.h"
 #include "cache/common.h"
+#include "util/semantic_digest.h"
 
 #include <map>
 #include <unordered_map>
@@ -218,7 +219,17 @@ public:
 	 * @param spec the extend of the query
 	 * @return the search result description
 	 */
-	virtual const CacheQueryResult<EType> query( const std::string &semantic_id, const QueryRectangle &qr ) const;
+	const CacheQueryResult<EType> query( const std::string &semantic_id, const QueryRectangle &qr ) const;
+
+	/**
+	 * Queries the cache, using the given query-spec. Operators compute the digest of their
+	 * semantic id once, so repeated queries skip hashing the full id.
+	 * @param digest the digest of the semantic id
+	 * @param semantic_id the semantic id of the query
+	 * @param spec the extend of the query
+	 * @return the search result description
+	 */
+	virtual const CacheQueryResult<EType> query( const SemanticDigest &digest, const std::string &semantic_id, const QueryRectangle &qr ) const;
 protected:
 	/**
 	 * Inserts an element into the cache-structure for the given semantic id
@@ -250,13 +261,15 @@ protected:
 	std::shared_ptr<EType> remove_int( const std::string &semantic_id, const KType &key );
 private:
 	/**
-	 * Helper to retrieve the cache-structure for a given semantic id
+	 * Helper to retrieve the cache-structure for a given semantic id. Structures are keyed by the
+	 * digest of the semantic id, the full id is only compared to rule out collisions.
+	 * @param digest the digest of the semantic id
 	 * @param semantic_id the semantic id to retrieve the structure for
 	 * @param create tells whether a new structure should be created if none can be found
 	 * @return the structure for the given semantic id
 	 */
-	CacheStructure<KType,EType>& get_cache( const std::string &semantic_id, bool create = false ) const;
-	mutable std::unordered_map<std::string,std::unique_ptr<CacheStructure<KType,EType>>> caches;
+	CacheStructure<KType,EType>& get_cache( const SemanticDigest &digest, const std::string &semantic_id, bool create = false ) const;
+	mutable std::unordered_map<SemanticDigest,std::unique_ptr<CacheStructure<KType,EType>>> caches;
 	mutable std::mutex mtx;
 	const bool query_exact;
 };
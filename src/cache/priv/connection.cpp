@@ -19,6 +19,7 @@
 #include "util/log.h"
 #include "util/make_unique.h"
 #include "util/concat.h"
+#include "util/shared_memory.h"
 
 
 #include <fcntl.h>
@@ -31,6 +32,12 @@ std::unique_ptr<BinaryReadBuffer> BlockingConnection::read()  {
 	return result;
 }
 
+std::unique_ptr<BinaryReadBuffer> BlockingConnection::read_incrementally()  {
+	auto result = make_unique<BinaryReadBuffer>();
+	socket.readIncrementally(*result);
+	return result;
+}
+
 
 std::unique_ptr<BinaryReadBuffer> WakeableBlockingConnection::read_timeout(
 		int timeout) {
@@ -67,24 +74,67 @@ std::unique_ptr<BinaryReadBuffer> WakeableBlockingConnection::read_timeout(
 //
 ///////////////////////////////////////////////////////////
 
-PollableConnection::PollableConnection(BinaryStream&& socket) : socket(std::move(socket)),  poll_fd(nullptr) {
+PollableConnection::PollableConnection(BinaryStream&& socket) : socket(std::move(socket)),  reactor(nullptr), readable(false), writable(false) {
+}
+
+PollableConnection::~PollableConnection() {
+	detach();
+}
+
+PollableConnection* PollableConnection::from_tag(uint64_t tag) {
+	return reinterpret_cast<PollableConnection*>( static_cast<uintptr_t>(tag) );
+}
+
+void PollableConnection::attach(EpollReactor& reactor) {
+	if ( this->reactor != nullptr )
+		throw IllegalStateException("PollableConnection: already attached to a reactor.");
+	reactor.add( socket.getReadFD(),
+		EpollReactor::READ | EpollReactor::WRITE | EpollReactor::HANGUP | EpollReactor::EDGE_TRIGGERED,
+		reinterpret_cast<uintptr_t>(this) );
+	this->reactor = &reactor;
+	// we do not know the state of the socket yet, the first read or write will tell.
+	readable = true;
+	writable = true;
+	activate();
+}
+
+void PollableConnection::detach() {
+	if ( reactor != nullptr ) {
+		reactor->remove( socket.getReadFD(), reinterpret_cast<uintptr_t>(this) );
+		reactor = nullptr;
+	}
+}
+
+void PollableConnection::notify(uint32_t events) {
+	if ( events & EpollReactor::ERROR )
+		Log::debug("Connection: epoll delivered error state: %s", flags_to_string(events).c_str() );
+	// errors and hangups are reported by the next read or write
+	if ( events & (EpollReactor::READ | EpollReactor::HANGUP | EpollReactor::ERROR) )
+		readable = true;
+	if ( events & (EpollReactor::WRITE | EpollReactor::HANGUP | EpollReactor::ERROR) )
+		writable = true;
 }
 
-std::string PollableConnection::flags_to_string(short flags) const {
+void PollableConnection::activate() {
+	if ( reactor != nullptr )
+		reactor->activate( reinterpret_cast<uintptr_t>(this), 0 );
+}
+
+std::string PollableConnection::flags_to_string(uint32_t flags) const {
 	std::ostringstream ss;
 
-	if ( flags & POLLIN )
-		ss << "POLLIN,";
-	if ( flags & POLLOUT )
-		ss << "POLLOUT,";
-	if ( flags & POLLPRI )
-		ss << "POLLPRI,";
-	if ( flags & POLLERR )
-		ss << "POLLERR,";
-	if ( flags & POLLHUP )
-		ss << "POLLHUP,";
-	if ( flags & POLLNVAL)
-		ss << "POLLNVAL,";
+	if ( flags & EPOLLIN )
+		ss << "EPOLLIN,";
+	if ( flags & EPOLLOUT )
+		ss << "EPOLLOUT,";
+	if ( flags & EPOLLPRI )
+		ss << "EPOLLPRI,";
+	if ( flags & EPOLLERR )
+		ss << "EPOLLERR,";
+	if ( flags & EPOLLHUP )
+		ss << "EPOLLHUP,";
+	if ( flags & EPOLLRDHUP)
+		ss << "EPOLLRDHUP,";
 
 	auto res = ss.str();
 
@@ -121,33 +171,23 @@ BinaryReadBuffer& NewNBConnection::get_data() {
 		throw IllegalStateException("Buffer not fully read");
 }
 
-void NewNBConnection::prepare(struct pollfd *poll_fd) {
-	this->poll_fd = poll_fd;
-	poll_fd->fd = socket.getReadFD();
-	poll_fd->revents = 0;
-	poll_fd->events = POLLIN;
-}
-
 bool NewNBConnection::process() {
-	bool res = false;
-	if ( poll_fd == nullptr )
-		throw IllegalStateException("NewNBConnection: Process called without previous call to prepare.");
+	if ( reactor == nullptr )
+		throw IllegalStateException("NewNBConnection: Process called without previous call to attach.");
 
 	try {
-		if ( (poll_fd->revents & POLLIN) != 0 ) {
-			socket.readNB(buffer);
-			res = buffer.isRead();
-		}
-		else if ( poll_fd->revents != 0 ) {
-			Log::warn("Poll delivered unexpected state: %s", flags_to_string(poll_fd->revents).c_str() );
-			faulty = true;
+		while ( readable && !buffer.isRead() ) {
+			bool would_block;
+			socket.readNB(buffer, false, &would_block);
+			if ( would_block )
+				readable = false;
 		}
 	} catch ( const NetworkException &ne ) {
 		Log::warn("Error reading from new established connection: %s", ne.what());
 		faulty = true;
+		return false;
 	}
-	poll_fd = nullptr;
-	return res;
+	return buffer.isRead();
 }
 
 bool NewNBConnection::is_faulty() const {
@@ -155,6 +195,7 @@ bool NewNBConnection::is_faulty() const {
 }
 
 BinaryStream NewNBConnection::release_socket() {
+	detach();
 	return std::move(socket);
 }
 
@@ -173,7 +214,10 @@ template<typename StateType>
 bool BaseConnection<StateType>::input() {
 
 	try {
-		bool eof = socket.readNB(*reader, reader->isEmpty() );
+		bool would_block;
+		bool eof = socket.readNB(*reader, reader->isEmpty(), &would_block );
+		if ( would_block )
+			readable = false;
 		if ( eof ) {
 			Log::debug("%s-connection (%lu): closed", type.c_str(), id);
 			faulty = true;
@@ -195,7 +239,10 @@ template<typename StateType>
 void BaseConnection<StateType>::output() {
 	if ( writer ) {
 		try {
-			socket.writeNB(*writer);
+			bool would_block;
+			socket.writeNB(*writer, &would_block);
+			if ( would_block )
+				writable = false;
 			if ( writer->isFinished() ) {
 				write_finished();
 				writer.reset();
@@ -215,6 +262,8 @@ void BaseConnection<StateType>::begin_write(std::unique_ptr<BinaryWriteBuffer> b
 	if ( reader->isEmpty() && !writer ) {
 		this->writer = std::move(buffer);
 		last_action = CacheCommon::time_millis();
+		// the socket may be writable already, in which case there won't be an event
+		activate();
 	}
 	else
 		throw IllegalStateException(concat(type, "-connection (",id,"): cannot start write: Another read or write action is in progress."));
@@ -262,6 +311,8 @@ time_t BaseConnection<StateType>::get_last_action() const {
 template<typename StateType>
 void BaseConnection<StateType>::set_faulty() {
 	faulty = true;
+	// the owner only looks at connections with events, so it must learn about this one
+	activate();
 }
 
 template<typename StateType>
@@ -270,42 +321,32 @@ bool BaseConnection<StateType>::_ensure_state(StateType state) const {
 }
 
 
-template<typename StateType>
-void BaseConnection<StateType>::prepare(struct pollfd *poll_fd) {
-	this->poll_fd = poll_fd;
-	poll_fd->revents = 0;
-	if ( is_writing() ) {
-		poll_fd->fd = socket.getWriteFD();
-		poll_fd->events = POLLOUT;
-	}
-	else {
-		poll_fd->fd = socket.getReadFD();
-		poll_fd->events = POLLIN;
-	}
-}
-
 template<typename StateType>
 bool BaseConnection<StateType>::process() {
-	bool res = false;
-	if ( poll_fd == nullptr )
-		throw IllegalStateException(concat(type,"-connection (", id, "): process called without previous call to prepare."));
-
-	if ( is_writing() && (poll_fd->revents & POLLOUT) ) {
-		output();
-		last_action = CacheCommon::time_millis();
-	}
-	else if ( !is_writing() && (poll_fd->revents & POLLIN) ) {
-		res = input();
+	if ( reactor == nullptr )
+		throw IllegalStateException(concat(type,"-connection (", id, "): process called without previous call to attach."));
+
+	// The socket is edge-triggered, so we continue until it would block.
+	// We stop after each command to give the caller a chance to react.
+	while ( !faulty ) {
+		if ( is_writing() ) {
+			if ( !writable )
+				break;
+			output();
+		}
+		else {
+			if ( !readable )
+				break;
+			if ( input() ) {
+				last_action = CacheCommon::time_millis();
+				// more data may be waiting, so make sure we are called again
+				activate();
+				return true;
+			}
+		}
 		last_action = CacheCommon::time_millis();
 	}
-	else if ( poll_fd->revents != 0 ){
-		Log::warn("%s-connection: poll delivered unexpected state: %s", type.c_str(), flags_to_string(poll_fd->revents).c_str() );
-		faulty = true;
-	}
-
-	poll_fd = nullptr;
-
-	return res;
+	return false;
 }
 
 template<typename StateType>
@@ -690,15 +731,34 @@ const uint8_t ControlConnection::RESP_STATS;
 /////////////////////////////////////////////////
 
 DeliveryConnection::DeliveryConnection(BinaryStream &&socket) :
-	BaseConnection(DeliveryState::IDLE, "Delivery", std::move(socket)), delivery_id(0), cache_key(CacheType::UNKNOWN,"", 0) {
+	BaseConnection(DeliveryState::IDLE, "Delivery", std::move(socket)), delivery_id(0), cache_key(CacheType::UNKNOWN,"", 0), shared_delivery(false), shared_delivery_id(0) {
+}
+
+DeliveryConnection::~DeliveryConnection() {
+	release_shared_segment();
 }
 
 void DeliveryConnection::process_command(uint8_t cmd, BinaryReadBuffer &payload) {
 	ensure_state( DeliveryState::IDLE, DeliveryState::AWAITING_MOVE_CONFIRM );
 
+	// The client has opened the segment of the last delivery before sending another command,
+	// unless it requests the same delivery over the socket
+	auto last_segment = shared_segment;
+	release_shared_segment();
+	resend_segment.reset();
+	shared_delivery = false;
+
 	switch (cmd) {
 		case CMD_GET: {
 			delivery_id = payload.read<uint64_t>();
+			if ( last_segment && delivery_id == shared_delivery_id )
+				resend_segment = last_segment;
+			set_state(DeliveryState::DELIVERY_REQUEST_READ);
+			break;
+		}
+		case CMD_GET_SHARED: {
+			delivery_id = payload.read<uint64_t>();
+			shared_delivery = true;
 			set_state(DeliveryState::DELIVERY_REQUEST_READ);
 			break;
 		}
@@ -755,11 +815,46 @@ uint64_t DeliveryConnection::get_delivery_id() const {
 	return delivery_id;
 }
 
+bool DeliveryConnection::resend_shared() {
+	ensure_state(DeliveryState::DELIVERY_REQUEST_READ);
+	if ( !resend_segment )
+		return false;
+	set_state(DeliveryState::SENDING);
+
+	// The segment holds the data of a RESP_OK response and stays mapped until it is sent
+	auto segment = std::move(resend_segment);
+	auto buffer = make_unique<BinaryWriteBufferWithSharedObject<SharedMemorySegment>>(segment);
+	buffer->write(RESP_OK);
+	buffer->write(segment->getData(), segment->getSize(), true);
+	begin_write(std::move(buffer));
+	return true;
+}
+
 template<typename T>
 void DeliveryConnection::send(std::shared_ptr<const T> item) {
 	ensure_state(DeliveryState::CACHE_REQUEST_READ, DeliveryState::DELIVERY_REQUEST_READ);
 	set_state(DeliveryState::SENDING);
 
+	if ( shared_delivery ) {
+		try {
+			BinaryWriteBuffer data;
+			write_data(data,item);
+			auto segment = std::make_shared<SharedMemorySegment>(SharedMemorySegment::create(data.getPayloadSize()));
+			data.copyPayload(segment->getData());
+			shared_segment = segment;
+			shared_delivery_id = delivery_id;
+
+			auto buffer = make_unique<BinaryWriteBuffer>();
+			buffer->write(RESP_OK_SHARED);
+			buffer->write(segment->getName());
+			begin_write(std::move(buffer));
+			return;
+		} catch ( const PlatformException &pe ) {
+			// the client can read both responses, so fall back to the socket
+			Log::warn("Could not place delivery in shared memory: %s", pe.what());
+		}
+	}
+
 	auto buffer = make_unique<BinaryWriteBufferWithSharedObject<const T>>(item);
 	buffer->write(RESP_OK);
 	write_data(*buffer,item);
@@ -826,13 +921,23 @@ void DeliveryConnection::write_data(BinaryWriteBuffer& buffer,
 }
 
 
+void DeliveryConnection::release_shared_segment() {
+	if ( shared_segment ) {
+		SharedMemorySegment::unlink(shared_segment->getName());
+		shared_segment.reset();
+	}
+}
+
+
 const uint32_t DeliveryConnection::MAGIC_NUMBER;
 const uint8_t DeliveryConnection::CMD_GET;
 const uint8_t DeliveryConnection::CMD_GET_CACHED_ITEM;
 const uint8_t DeliveryConnection::CMD_MOVE_ITEM;
 const uint8_t DeliveryConnection::CMD_MOVE_DONE;
+const uint8_t DeliveryConnection::CMD_GET_SHARED;
 const uint8_t DeliveryConnection::RESP_OK;
 const uint8_t DeliveryConnection::RESP_ERROR;
+const uint8_t DeliveryConnection::RESP_OK_SHARED;
 
 
 //////////////////////////////////////////////////////////
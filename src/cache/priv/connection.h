@@ -12,6 +12,7 @@
 #include "cache/priv/cache_stats.h"
 #include "cache/priv/redistribution.h"
 #include "util/binarystream.h"
+#include "util/epoll_reactor.h"
 
 #include "util/concat.h"
 #include "util/exceptions.h"
@@ -20,9 +21,10 @@
 #include <map>
 #include <memory>
 #include <cstring> //strerror
-#include <poll.h>
 
 
+class SharedMemorySegment;
+
 /**
  * Models a simple blocking connection
  */
@@ -69,6 +71,14 @@ public:
 	 */
 	std::unique_ptr<BinaryReadBuffer> read();
 
+	/**
+	 * Reads the size of the next response from the underlying stream. Its payload is read from the
+	 * stream while it is deserialized, see BinaryStream::readIncrementally().
+	 * The payload must be read completely before the connection is used again.
+	 * @return a buffer for reading the response
+	 */
+	std::unique_ptr<BinaryReadBuffer> read_incrementally();
+
 	/**
 	 * Issues a write followed by a read
 	 * @param params the data to write
@@ -157,6 +167,11 @@ private:
 	bool consume_wakeup;
 };
 
+/**
+ * Base class for connections driven by an EpollReactor.
+ * The socket is registered edge-triggered once, the connection tracks
+ * the readiness of its socket and only touches it if it is ready.
+ */
 class PollableConnection {
 public:
 	PollableConnection() = delete;
@@ -164,20 +179,53 @@ public:
 	PollableConnection( PollableConnection&& ) = delete;
 	PollableConnection& operator=( const PollableConnection& ) = delete;
 	PollableConnection& operator=( PollableConnection&& ) = delete;
-	virtual ~PollableConnection() = default;
+	virtual ~PollableConnection();
 
 	PollableConnection( BinaryStream &&socket );
 
+	/**
+	 * Retrieves the connection for the tag of an event delivered by the reactor
+	 */
+	static PollableConnection* from_tag( uint64_t tag );
+
 	virtual bool is_faulty() const = 0;
 
-	virtual void prepare(struct pollfd *poll_fd) = 0;
+	/**
+	 * Registers the underlying socket with the given reactor.
+	 * Events for this connection carry its address as tag.
+	 */
+	void attach( EpollReactor &reactor );
 
+	/**
+	 * Unregisters the underlying socket. Called automatically on destruction.
+	 */
+	void detach();
+
+	/**
+	 * Passes the events delivered by the reactor to this connection
+	 * @param events the event flags
+	 */
+	void notify( uint32_t events );
+
+	/**
+	 * Handles pending socket-events, if any.
+	 * @return true if action is required, false otherwise
+	 */
 	virtual bool process() = 0;
 protected:
-	std::string flags_to_string( short flags ) const;
+	/**
+	 * Makes the next call to EpollReactor::wait() return immediately,
+	 * e.g. because there is data to write.
+	 */
+	void activate();
+
+	std::string flags_to_string( uint32_t flags ) const;
 
 	BinaryStream socket;
-	struct pollfd *poll_fd;
+	EpollReactor *reactor;
+	// whether the socket may be read from/written to without blocking
+	bool readable;
+	bool writable;
 };
 
 /**
@@ -200,13 +248,8 @@ public:
 	NewNBConnection( struct sockaddr_storage *remote_addr, int fd );
 
 	/**
-	 * Prepares the pollfd structure for the next cycle
-	 */
-	virtual void prepare(struct pollfd *poll_fd);
-
-	/**
-	 * Handles socket-event if any.
-	 * @return true if action is required, false otherwise
+	 * Reads the handshake, if data is available.
+	 * @return true if the handshake was read completely, false otherwise
 	 */
 	virtual bool process();
 
@@ -221,7 +264,7 @@ public:
 	BinaryReadBuffer& get_data();
 
 	/**
-	 * Releases the underlying stream for usage in concrete connections
+	 * Detaches and releases the underlying stream for usage in concrete connections
 	 */
 	BinaryStream release_socket();
 
@@ -254,13 +297,8 @@ public:
 	virtual ~BaseConnection() = default;
 
 	/**
-	 * Prepares the pollfd structure for the next cycle
-	 */
-	virtual void prepare(struct pollfd *poll_fd);
-
-	/**
-	 * Handles socket-event if any.
-	 * @return true if action is required, false otherwise
+	 * Reads and writes until the socket would block or a command was read.
+	 * @return true if a command was processed, false otherwise
 	 */
 	virtual bool process();
 
@@ -781,6 +819,14 @@ public:
 	//
 	static const uint8_t CMD_MOVE_DONE = 63;
 
+	//
+	// Command to pick up a delivery through shared memory,
+	// only usable by clients on the same host.
+	// Expected data on stream is:
+	// delivery_id:uint64_t
+	//
+	static const uint8_t CMD_GET_SHARED = 64;
+
 
 	//
 	// Response if delivery is send. Data:
@@ -794,7 +840,18 @@ public:
 	//
 	static const uint8_t RESP_ERROR = 80;
 
+	//
+	// Response if delivery is placed in shared memory. Data:
+	// name:string -- the name of a shared memory segment, holding the same data as RESP_OK
+	// The client must unlink the segment after opening it. The segment is
+	// unlinked by the server on the next command or when the connection closes.
+	// If the client cannot open the segment, it may request the same delivery
+	// with CMD_GET as its next command and receives RESP_OK.
+	//
+	static const uint8_t RESP_OK_SHARED = 81;
+
 	DeliveryConnection(BinaryStream &&socket);
+	~DeliveryConnection();
 
 	/**
 	 * Required states are CACHE_REQUEST_READ, MOVE_REQUEST_READ, AWAITING_MOVE_CONFIRM, MOVE_DONE
@@ -808,6 +865,14 @@ public:
 	 */
 	uint64_t get_delivery_id() const;
 
+	/**
+	 * Sends the last delivery placed in shared memory again over the socket,
+	 * if the current request is for it.
+	 * Required state is DELIVERY_REQUEST_READ
+	 * @return whether the delivery was sent
+	 */
+	bool resend_shared();
+
 	/**
 	 * Sends the given data-item.
 	 * Required state is DELIVERY_REQUEST_READ
@@ -854,8 +919,21 @@ private:
 	template<typename T>
 	void write_data( BinaryWriteBuffer &buffer, std::shared_ptr<const T> &item );
 
+	/**
+	 * Unlinks and unmaps the shared memory segment of the last delivery, if any
+	 */
+	void release_shared_segment();
+
 	uint64_t delivery_id;
 	TypedNodeCacheKey cache_key;
+	/** whether the current delivery is requested through shared memory */
+	bool shared_delivery;
+	/** the shared memory segment of the last delivery, mapped until the next command */
+	std::shared_ptr<SharedMemorySegment> shared_segment;
+	/** the id of the delivery in shared_segment */
+	uint64_t shared_delivery_id;
+	/** the segment of the requested delivery, if the client could not open it */
+	std::shared_ptr<SharedMemorySegment> resend_segment;
 };
 
 enum class ClientDeliveryState {
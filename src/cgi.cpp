@@ -89,7 +89,7 @@ int main() {
 		} else if(cacheType == "remote") {
 			std::string host = Configuration::get<std::string>("indexserver.host");
 			int port = Configuration::get<int>("indexserver.port");
-			cm = make_unique<ClientCacheManager>(host,port);
+			cm = make_unique<ClientCacheManager>(host,port,Configuration::get<bool>("cache.shared_memory",false));
 		} else {
 			throw ArgumentException("Invalid cache.type");
 		}
@@ -206,10 +206,16 @@ class AttributeArrays {
 				friend class RasterOpenCL::CLProgram;
 				friend AttributeArrays;
 				friend class AttributeArraysHelper;
+				// the columnar export writes the values as a whole
+				friend class SimpleFeatureCollection;
 
 				array_type array;
 		};
 	public:
+		// allow resolving columns once, e.g. before iterating over all features of a collection
+		using NumericArray = AttributeArray<double>;
+		using TextualArray = AttributeArray<std::string>;
+
 		AttributeArrays();
 		AttributeArrays(BinaryReadBuffer &buffer);
 		~AttributeArrays();
@@ -2,6 +2,7 @@
 #include <sstream>
 #include "util/make_unique.h"
 #include "util/binarystream.h"
+#include "util/bufferedtextwriter.h"
 
 
 std::unique_ptr<LineCollection> LineCollection::clone() const {
@@ -165,7 +166,7 @@ size_t LineCollection::finishFeature(){
 	return start_feature.size() -2;
 }
 
-void LineCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const {
+void LineCollection::featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const {
 	auto feature = getFeatureReference(featureIndex);
 
 	if(feature.size() == 1)
@@ -173,22 +174,28 @@ void LineCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostrings
 	else
 		json << "{\"type\":\"MultiLineString\",\"coordinates\":[";
 
+	bool first_line = true;
 	for(auto line : feature){
-		json << "[";
+		if (!first_line)
+			json << ',';
+		first_line = false;
+		json << '[';
+		bool first = true;
 		for(auto& c : line){
-			json << "[" << c.x << "," << c.y << "],";
+			if (!first)
+				json << ',';
+			first = false;
+			json << '[' << c.x << ',' << c.y << ']';
 		}
-		json.seekp(((long)json.tellp()) - 1); //delete last ,
-		json << "],";
+		json << ']';
 	}
-	json.seekp(((long)json.tellp()) - 1); //delete last ,
 
 	if(feature.size() > 1)
-		json << "]";
-	json << "}";
+		json << ']';
+	json << '}';
 }
 
-void LineCollection::featureToWKT(size_t featureIndex, std::ostringstream& wkt) const {
+void LineCollection::featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const {
 	if(featureIndex >= getFeatureCount()){
 		throw ArgumentException("featureIndex is greater than featureCount");
 	}
@@ -197,28 +204,43 @@ void LineCollection::featureToWKT(size_t featureIndex, std::ostringstream& wkt)
 
 	if(feature.size() == 1) {
 		wkt << "LINESTRING(";
+		bool first = true;
 		for(auto& coordinate: *feature.begin()){
-			wkt << coordinate.x << " " << coordinate.y << ",";
+			if (!first)
+				wkt << ',';
+			first = false;
+			wkt << coordinate.x << ' ' << coordinate.y;
 		}
-		wkt.seekp(((long)wkt.tellp()) - 1);
-		wkt << ")";
+		wkt << ')';
 	}
 	else {
 		wkt << "MULTILINESTRING(";
 
+		bool first_line = true;
 		for(auto line : feature){
-			wkt << "(";
+			if (!first_line)
+				wkt << ',';
+			first_line = false;
+			wkt << '(';
+			bool first = true;
 			for(auto& coordinate: line){
-				wkt << coordinate.x << " " << coordinate.y << ",";
+				if (!first)
+					wkt << ',';
+				first = false;
+				wkt << coordinate.x << ' ' << coordinate.y;
 			}
-			wkt.seekp(((long)wkt.tellp()) - 1);
-			wkt << "),";
+			wkt << ')';
 		}
-		wkt.seekp(((long)wkt.tellp()) - 1);
-		wkt << ")";
+		wkt << ')';
 	}
 }
 
+std::string LineCollection::getColumnarGeometry(GeometryOffsets &offsets) const {
+	offsets.emplace_back("feature_offsets", &start_feature);
+	offsets.emplace_back("line_offsets", &start_line);
+	return "MultiLineString";
+}
+
 
 bool LineCollection::isSimple() const {
 	return getFeatureCount() == (start_line.size() - 1);
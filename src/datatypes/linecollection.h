@@ -180,8 +180,9 @@ public:
 	virtual ~LineCollection(){};
 
 protected:
-	virtual void featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const;
-	virtual void featureToWKT(size_t featureIndex, std::ostringstream& wkt) const;
+	virtual void featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const;
+	virtual void featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const;
+	virtual std::string getColumnarGeometry(GeometryOffsets &offsets) const;
 
 	virtual void validateSpecifics() const;
 
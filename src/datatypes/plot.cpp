@@ -1,5 +1,6 @@
 #include "datatypes/plot.h"
 #include "datatypes/plots/histogram.h"
+#include "datatypes/plots/raster_summary.h"
 
 #include "util/make_unique.h"
 
@@ -9,6 +10,8 @@ std::unique_ptr<GenericPlot> GenericPlot::deserialize(BinaryReadBuffer &buffer)
 	switch (plotType) {
 	case GenericPlot::Type::Histogram:
 		return make_unique<Histogram>(buffer);
+	case GenericPlot::Type::RasterSummary:
+		return make_unique<RasterSummary>(buffer);
 	}
 
 	throw MustNotHappenException("Deserialization of Plot failed");
@@ -12,7 +12,7 @@
  */
 class GenericPlot {
 protected:
-	enum class Type { Histogram };
+	enum class Type { Histogram, RasterSummary };
 
 public:
 	virtual ~GenericPlot() {};
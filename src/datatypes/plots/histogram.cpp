@@ -32,6 +32,15 @@ void Histogram::inc(double value) {
     counts[calculateBucketForValue(value)]++;
 }
 
+void Histogram::inc(double value, uint64_t count) {
+    if (value < min || value > max) {
+        incNoData(count);
+        return;
+    }
+
+    counts[calculateBucketForValue(value)] += count;
+}
+
 int Histogram::calculateBucketForValue(double value) {
     if (max > min) {
         auto bucket = static_cast<int>(std::floor(((value - min) / (max - min)) * counts.size()));
@@ -50,6 +59,10 @@ void Histogram::incNoData() {
     nodata_count++;
 }
 
+void Histogram::incNoData(uint64_t count) {
+    nodata_count += count;
+}
+
 int Histogram::getValidDataCount() {
     //return std::accumulate(counts.begin(), counts.end(), 0);
     int sum = 0;
@@ -4,6 +4,7 @@
 #include <vector>
 #include <sstream>
 #include <string>
+#include <cstdint>
 
 #include "datatypes/plot.h"
 
@@ -20,8 +21,15 @@ class Histogram : public GenericPlot {
 
         void inc(double value);
 
+        /**
+         * add count occurrences of value
+         */
+        void inc(double value, uint64_t count);
+
         void incNoData();
 
+        void incNoData(uint64_t count);
+
         const std::string toJSON() const override;
 
         int getCountForBucket(unsigned long bucket) {
@@ -0,0 +1,265 @@
+
+#include "datatypes/plots/raster_summary.h"
+#include "datatypes/raster.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/typejuggling.h"
+#include "util/make_unique.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+
+/**
+ * floor(value / 2^shift) for positive and negative values
+ */
+static int64_t floorShift(int64_t value, int shift) {
+    shift = std::min(shift, 63);
+    return value >= 0 ? value >> shift : -((-(value + 1)) >> shift) - 1;
+}
+
+RasterSummary::RasterSummary()
+        : count(0), nodata_count(0), min(std::numeric_limits<double>::quiet_NaN()),
+          max(std::numeric_limits<double>::quiet_NaN()), mean(0), m2(0), integral(true),
+          lowest(std::numeric_limits<double>::infinity()), highest(-std::numeric_limits<double>::infinity()), exponent(0), first_bin(0) {
+}
+
+template<typename T>
+struct raster_summary {
+    static void execute(Raster2D<T> *raster, RasterSummary *summary) {
+        raster->setRepresentation(GenericRaster::Representation::CPU);
+        const T *data = raster->data;
+        const size_t size = raster->getPixelCount();
+
+        // moments are accumulated relative to the first value for numerical stability
+        uint64_t count = 0;
+        double shift = 0, sum = 0, sum_of_squares = 0;
+        T min = std::numeric_limits<T>::max(), max = std::numeric_limits<T>::lowest();
+        for (size_t i = 0; i < size; i++) {
+            T value = data[i];
+            if (raster->dd.is_no_data(value) || std::isnan((double) value))
+                continue;
+            if (count == 0)
+                shift = value;
+            count++;
+            double d = value - shift;
+            sum += d;
+            sum_of_squares += d * d;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+
+        summary->count = count;
+        summary->nodata_count = size - count;
+        summary->integral = RasterTypeInfo<T>::isinteger;
+        summary->lowest = std::numeric_limits<T>::lowest();
+        summary->highest = std::numeric_limits<T>::max();
+        if (raster->dd.unit.hasMinMax()) {
+            summary->lowest = std::max(summary->lowest, raster->dd.unit.getMin());
+            summary->highest = std::min(summary->highest, raster->dd.unit.getMax());
+        }
+        if (count == 0)
+            return;
+        summary->min = min;
+        summary->max = max;
+        summary->mean = shift + sum / count;
+        summary->m2 = std::max(0.0, sum_of_squares - sum * sum / count);
+
+        summary->initializeBins();
+        auto &bins = summary->bins;
+        const int64_t first_bin = summary->first_bin;
+        for (size_t i = 0; i < size; i++) {
+            T value = data[i];
+            if (raster->dd.is_no_data(value) || std::isnan((double) value))
+                continue;
+            bins[summary->binIndex(value) - first_bin]++;
+        }
+    }
+};
+
+RasterSummary::RasterSummary(GenericRaster &raster) : RasterSummary() {
+    callUnaryOperatorFunc<raster_summary>(&raster, this);
+}
+
+RasterSummary::RasterSummary(BinaryReadBuffer &buffer) {
+    buffer.read(&count);
+    buffer.read(&nodata_count);
+    buffer.read(&min);
+    buffer.read(&max);
+    buffer.read(&mean);
+    buffer.read(&m2);
+    buffer.read(&integral);
+    buffer.read(&lowest);
+    buffer.read(&highest);
+    buffer.read(&exponent);
+    buffer.read(&first_bin);
+    buffer.read(&bins);
+}
+
+void RasterSummary::serialize(BinaryWriteBuffer &buffer, bool is_persistent_memory) const {
+    buffer << Type::RasterSummary;
+
+    buffer << count << nodata_count;
+    buffer << min << max << mean << m2;
+    buffer << integral << lowest << highest << exponent << first_bin;
+    buffer << bins;
+}
+
+std::unique_ptr<GenericPlot> RasterSummary::clone() const {
+    return std::unique_ptr<GenericPlot>(new RasterSummary(*this));
+}
+
+void RasterSummary::initializeBins() {
+    // the bin index of every value must be representable
+    double magnitude = std::max(std::abs(min), std::abs(max));
+    exponent = magnitude > 0 ? std::ilogb(magnitude) - 60 : 0;
+
+    double range = max - min;
+    if (range > 0)
+        exponent = std::max(exponent, std::ilogb(range) - std::ilogb((double) MAX_BINS));
+    while (binIndex(max) - binIndex(min) + 1 > (int64_t) MAX_BINS)
+        exponent++;
+
+    first_bin = binIndex(min);
+    bins.assign(binIndex(max) - first_bin + 1, 0);
+}
+
+int64_t RasterSummary::binIndex(double value) const {
+    return (int64_t) std::floor(std::ldexp(value, -exponent));
+}
+
+double RasterSummary::binValue(int64_t index) const {
+    double lower = std::ldexp((double) index, exponent);
+    if (integral && exponent <= 0)
+        return lower;
+    return std::min(max, std::max(min, lower + std::ldexp(0.5, exponent)));
+}
+
+void RasterSummary::coarsen(int new_exponent) {
+    if (new_exponent <= exponent)
+        return;
+    int shift = new_exponent - exponent;
+
+    int64_t new_first_bin = floorShift(first_bin, shift);
+    std::vector<uint64_t> new_bins(floorShift(first_bin + (int64_t) bins.size() - 1, shift) - new_first_bin + 1, 0);
+    for (size_t i = 0; i < bins.size(); i++)
+        new_bins[floorShift(first_bin + (int64_t) i, shift) - new_first_bin] += bins[i];
+
+    exponent = new_exponent;
+    first_bin = new_first_bin;
+    bins = std::move(new_bins);
+}
+
+void RasterSummary::merge(const RasterSummary &other) {
+    double merged_lowest = std::min(lowest, other.lowest), merged_highest = std::max(highest, other.highest);
+    if (other.count == 0) {
+        nodata_count += other.nodata_count;
+        integral = integral && other.integral;
+        lowest = merged_lowest;
+        highest = merged_highest;
+        return;
+    }
+    if (count == 0) {
+        uint64_t previous_nodata_count = nodata_count;
+        bool previous_integral = integral;
+        *this = other;
+        nodata_count += previous_nodata_count;
+        integral = integral && previous_integral;
+        lowest = merged_lowest;
+        highest = merged_highest;
+        return;
+    }
+
+    uint64_t total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * ((double) count * other.count / total);
+    count = total;
+    nodata_count += other.nodata_count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    integral = integral && other.integral;
+    lowest = merged_lowest;
+    highest = merged_highest;
+
+    // find the finest common resolution that covers both ranges
+    int new_exponent = std::max(exponent, other.exponent);
+    int64_t begin, end;
+    while (true) {
+        begin = std::min(floorShift(first_bin, new_exponent - exponent),
+                         floorShift(other.first_bin, new_exponent - other.exponent));
+        end = std::max(floorShift(first_bin + (int64_t) bins.size() - 1, new_exponent - exponent),
+                       floorShift(other.first_bin + (int64_t) other.bins.size() - 1, new_exponent - other.exponent));
+        if (end - begin + 1 <= (int64_t) MAX_BINS)
+            break;
+        new_exponent++;
+    }
+
+    coarsen(new_exponent);
+    std::vector<uint64_t> merged(end - begin + 1, 0);
+    for (size_t i = 0; i < bins.size(); i++)
+        merged[first_bin + (int64_t) i - begin] += bins[i];
+    int shift = new_exponent - other.exponent;
+    for (size_t i = 0; i < other.bins.size(); i++)
+        merged[floorShift(other.first_bin + (int64_t) i, shift) - begin] += other.bins[i];
+
+    first_bin = begin;
+    bins = std::move(merged);
+}
+
+double RasterSummary::getMean() const {
+    return count > 0 ? mean : std::numeric_limits<double>::quiet_NaN();
+}
+
+double RasterSummary::getStdDev() const {
+    return count > 1 ? std::sqrt(m2 / (count - 1)) : std::numeric_limits<double>::quiet_NaN();
+}
+
+double RasterSummary::getQuantile(double quantile) const {
+    if (count == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+    if (quantile <= 0)
+        return min;
+    if (quantile >= 1)
+        return max;
+
+    double rank = quantile * (count - 1);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < bins.size(); i++) {
+        cumulative += bins[i];
+        if (cumulative > rank)
+            return binValue(first_bin + (int64_t) i);
+    }
+    return max;
+}
+
+std::unique_ptr<Histogram> RasterSummary::toHistogram(unsigned long number_of_buckets, double min, double max) const {
+    auto histogram = make_unique<Histogram>(number_of_buckets, min, max);
+    for (size_t i = 0; i < bins.size(); i++) {
+        if (bins[i] > 0)
+            histogram->inc(binValue(first_bin + (int64_t) i), bins[i]);
+    }
+    histogram->incNoData(nodata_count);
+    return histogram;
+}
+
+const std::string RasterSummary::toJSON() const {
+    auto number = [](double value) -> std::string {
+        if (!std::isfinite(value))
+            return "null";
+        std::ostringstream stream;
+        stream.precision(std::numeric_limits<double>::max_digits10);
+        stream << value;
+        return stream.str();
+    };
+
+    std::stringstream buffer;
+    buffer << R"({"type": "summary", "data": {)";
+    buffer << R"("count": )" << count << R"(, "nodata": )" << nodata_count;
+    buffer << R"(, "min": )" << number(getMin()) << R"(, "max": )" << number(getMax());
+    buffer << R"(, "mean": )" << number(getMean()) << R"(, "stddev": )" << number(getStdDev());
+    buffer << R"(, "quartiles": [)" << number(getQuantile(0.25)) << ", " << number(getQuantile(0.5)) << ", "
+           << number(getQuantile(0.75)) << "]";
+    buffer << "}}";
+    return buffer.str();
+}
@@ -0,0 +1,143 @@
+#ifndef PLOT_RASTER_SUMMARY_H
+#define PLOT_RASTER_SUMMARY_H
+
+#include "datatypes/plot.h"
+#include "datatypes/plots/histogram.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class GenericRaster;
+
+/**
+ * A mergeable summary of the values of a raster: count, min, max, mean and variance plus a fixed-resolution
+ * histogram of the value distribution.
+ *
+ * The distribution is kept in at most MAX_BINS bins of width 2^exponent that are aligned at zero. If merging
+ * two summaries exceeds MAX_BINS, neighbouring bins are combined until the range fits again. Because of the
+ * alignment, summaries of different tiles can always be merged. Integer values are kept exactly as long as
+ * the value range is smaller than MAX_BINS, otherwise each value is only known up to its bin width.
+ */
+class RasterSummary : public GenericPlot {
+    public:
+        static const size_t MAX_BINS = 4096;
+
+        /**
+         * Create an empty summary
+         */
+        RasterSummary();
+
+        /**
+         * Summarize all pixels of a raster
+         */
+        explicit RasterSummary(GenericRaster &raster);
+
+        explicit RasterSummary(BinaryReadBuffer &buffer);
+
+        ~RasterSummary() override = default;
+
+        /**
+         * Add the values of another summary
+         */
+        void merge(const RasterSummary &other);
+
+        uint64_t getCount() const {
+            return count;
+        }
+
+        uint64_t getNoDataCount() const {
+            return nodata_count;
+        }
+
+        double getMin() const {
+            return min;
+        }
+
+        double getMax() const {
+            return max;
+        }
+
+        /**
+         * @return whether all values are integers
+         */
+        bool isIntegral() const {
+            return integral;
+        }
+
+        /**
+         * @return whether the bins hold every value exactly, which is the case for integers
+         *         whose range is smaller than MAX_BINS
+         */
+        bool isExact() const {
+            return integral && exponent <= 0;
+        }
+
+        /**
+         * @return whether the summary stays exact whatever is merged into it from the same raster, because the
+         *         data type and unit of its integers allow fewer than MAX_BINS different values
+         */
+        bool staysExact() const {
+            return integral && highest - lowest < MAX_BINS;
+        }
+
+        double getMean() const;
+
+        /**
+         * @return the sample standard deviation
+         */
+        double getStdDev() const;
+
+        /**
+         * @param quantile between 0 and 1
+         * @return the approximate value at the given quantile, exact for 0 and 1
+         */
+        double getQuantile(double quantile) const;
+
+        /**
+         * Fill an equi-width histogram from the binned values. Values outside of [min, max] are counted as no data.
+         */
+        std::unique_ptr<Histogram> toHistogram(unsigned long number_of_buckets, double min, double max) const;
+
+        const std::string toJSON() const override;
+
+        std::unique_ptr<GenericPlot> clone() const override;
+
+        void serialize(BinaryWriteBuffer &buffer, bool is_persistent_memory) const override;
+
+    private:
+        template<typename T> friend struct raster_summary;
+
+        /**
+         * Set the bin resolution for the current [min, max] and bin the given values
+         */
+        void initializeBins();
+
+        /**
+         * Combine neighbouring bins until the resolution is at least 2^new_exponent
+         */
+        void coarsen(int new_exponent);
+
+        int64_t binIndex(double value) const;
+
+        /**
+         * the value a bin stands for: its lower border for bins up to a width of 1 (so integers stay exact),
+         * the center otherwise
+         */
+        double binValue(int64_t index) const;
+
+        uint64_t count;
+        uint64_t nodata_count;
+        double min, max;
+        // mean and sum of squared differences from the mean, merged with Chan et al.'s formula
+        double mean, m2;
+        // whether all values are integers
+        bool integral;
+        // the values the summarized rasters can hold by their data type and unit
+        double lowest, highest;
+        int exponent;
+        int64_t first_bin;
+        std::vector<uint64_t> bins;
+};
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "util/binarystream.h"
 #include "util/make_unique.h"
+#include "util/bufferedtextwriter.h"
 
 #include <sstream>
 #include <iomanip>
@@ -216,7 +217,7 @@ void PointCollection::toOGR(const char *driver = "ESRI Shapefile") {
 #endif
 
 
-void PointCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const {
+void PointCollection::featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const {
 	auto feature = getFeatureReference(featureIndex);
 
 	if(feature.size() == 1)
@@ -224,23 +225,26 @@ void PointCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostring
 	else
 		json << "{\"type\":\"MultiPoint\",\"coordinates\":[";
 
+	bool first = true;
 	for(auto& c : feature){
-		json << "[" << c.x << "," << c.y << "],";
+		if (!first)
+			json << ',';
+		first = false;
+		json << '[' << c.x << ',' << c.y << ']';
 	}
-	json.seekp(((long)json.tellp()) - 1); //delete last ,
 
 	if(feature.size() > 1)
-		json << "]";
-	json << "}";
+		json << ']';
+	json << '}';
 }
 
 //TODO: include global metadata?
-std::string PointCollection::toCSV() const {
-	std::ostringstream csv;
-	csv << std::fixed; // std::setprecision(4);
+void PointCollection::toCSV(std::ostream &output) const {
+	BufferedTextWriter csv(output, BufferedTextWriter::DoubleFormat::FIXED);
 
-	auto string_keys = feature_attributes.getTextualKeys();
-	auto value_keys = feature_attributes.getNumericKeys();
+	std::vector<const AttributeArrays::TextualArray *> string_columns;
+	std::vector<const AttributeArrays::NumericArray *> value_columns;
+	resolveAttributeColumns(string_columns, value_columns);
 
 	bool isSimpleCollection = isSimple();
 
@@ -248,43 +252,29 @@ std::string PointCollection::toCSV() const {
 	if(!isSimpleCollection){
 		csv << "feature,";
 	}
-	csv << "lon" << "," << "lat";
+	csv << "lon,lat";
 	if (hasTime())
 		csv << ",\"time_start\",\"time_end\"";
-	for(auto &key : string_keys) {
-		csv << ",\"" << key << "\"";
+	for(auto &key : feature_attributes.getTextualKeys()) {
+		csv << ",\"" << key << '"';
 	}
-	for(auto &key : value_keys) {
-		csv << ",\"" << key << "\"";
+	for(auto &key : feature_attributes.getNumericKeys()) {
+		csv << ",\"" << key << '"';
 	}
-	csv << std::endl;
+	csv << '\n';
 
 	for (auto feature : *this) {
 		for (auto & c : feature) {
 			if(!isSimpleCollection)
-				csv << (size_t) feature << ",";
-			csv << c.x << "," << c.y;
-
-			if (hasTime()){
-				csv << "," << "\"" << stref.toIsoString(time[feature].t1) << "\"" << ","
-						 << "\"" << stref.toIsoString(time[feature].t2) << "\"";
-			}
-
-			//TODO: handle missing metadata values
-			for(auto &key : string_keys) {
-				csv << ",\"" << feature_attributes.textual(key).get(feature) << "\"";
-			}
-			for(auto &key : value_keys) {
-				csv << "," << feature_attributes.numeric(key).get(feature);
-			}
-			csv << std::endl;
+				csv << (size_t) feature << ',';
+			csv << c.x << ',' << c.y;
+			featureAttributesToCSV(feature, csv, string_columns, value_columns);
+			csv << '\n';
 		}
 	}
-
-	return csv.str();
 }
 
-void PointCollection::featureToWKT(size_t featureIndex, std::ostringstream& wkt) const {
+void PointCollection::featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const {
 	if(featureIndex >= getFeatureCount()){
 		throw ArgumentException("featureIndex is greater than featureCount");
 	}
@@ -293,77 +283,72 @@ void PointCollection::featureToWKT(size_t featureIndex, std::ostringstream& wkt)
 
 	if(feature.size() == 1) {
 		const Coordinate& coordinate = *feature.begin();
-		wkt << "POINT(" << coordinate.x << " " << coordinate.y << ")";
+		wkt << "POINT(" << coordinate.x << ' ' << coordinate.y << ')';
 	}
 	else {
 		wkt << "MULTIPOINT(";
 
+		bool first = true;
 		for(auto& coordinate : feature){
-			wkt << "(" << coordinate.x << " " << coordinate.y << "),";
+			if (!first)
+				wkt << ',';
+			first = false;
+			wkt << '(' << coordinate.x << ' ' << coordinate.y << ')';
 		}
-		wkt.seekp(((long) wkt.tellp()) - 1); // delete last ,
 
-		wkt << ")";
+		wkt << ')';
 	}
 }
 
-std::string PointCollection::toARFF(std::string layerName) const {
-	std::ostringstream arff;
+std::string PointCollection::getColumnarGeometry(GeometryOffsets &offsets) const {
+	offsets.emplace_back("feature_offsets", &start_feature);
+	return "MultiPoint";
+}
+
+void PointCollection::toARFF(std::ostream &output, const std::string &layerName) const {
+	BufferedTextWriter arff(output, BufferedTextWriter::DoubleFormat::GENERAL);
 
 	//TODO: maybe take name of layer as relation name, but this is not accessible here
-	arff << "@RELATION " << layerName << std::endl << std::endl;
+	arff << "@RELATION " << layerName << "\n\n";
 
 	bool isSimpleCollection = isSimple();
 
 	if(!isSimpleCollection){
-		arff << "@ATTRIBUTE feature NUMERIC" << std::endl;
+		arff << "@ATTRIBUTE feature NUMERIC\n";
 	}
-	arff << "@ATTRIBUTE longitude NUMERIC" << std::endl;
-	arff << "@ATTRIBUTE latitude NUMERIC" << std::endl;
+	arff << "@ATTRIBUTE longitude NUMERIC\n";
+	arff << "@ATTRIBUTE latitude NUMERIC\n";
 
 	if (hasTime()){
-		arff << "@ATTRIBUTE time_start DATE" << std::endl;
-		arff << "@ATTRIBUTE time_end DATE" << std::endl;
+		arff << "@ATTRIBUTE time_start DATE\n";
+		arff << "@ATTRIBUTE time_end DATE\n";
 	}
 
-	auto string_keys = feature_attributes.getTextualKeys();
-	auto value_keys = feature_attributes.getNumericKeys();
-
-
 	//TODO: handle missing metadata values
-	for(auto &key : string_keys) {
-		arff << "@ATTRIBUTE" << " " << key << " " << "STRING" << std::endl;
+	for(auto &key : feature_attributes.getTextualKeys()) {
+		arff << "@ATTRIBUTE " << key << " STRING\n";
 	}
-	for(auto &key : value_keys) {
-		arff << "@ATTRIBUTE" << " " << key << " " << "NUMERIC" << std::endl;
+	for(auto &key : feature_attributes.getNumericKeys()) {
+		arff << "@ATTRIBUTE " << key << " NUMERIC\n";
 	}
 
-	arff << std::endl;
+	arff << "\n";
+
+	arff << "@DATA\n";
 
-	arff << "@DATA" << std::endl;
+	std::vector<const AttributeArrays::TextualArray *> string_columns;
+	std::vector<const AttributeArrays::NumericArray *> value_columns;
+	resolveAttributeColumns(string_columns, value_columns);
 
 	for (auto feature : *this) {
 		for (auto & c : feature) {
 			if(!isSimpleCollection)
-				arff << (size_t) feature << ",";
-			arff << c.x << "," << c.y;
-
-			if (hasTime()){
-				arff << "," << "\"" << stref.toIsoString(time[feature].t1) << "\"" << ","
-						 << "\"" << stref.toIsoString(time[feature].t2) << "\"";
-			}
-
-			for(auto &key : string_keys) {
-				arff << ",\"" << feature_attributes.textual(key).get(feature) << "\"";
-			}
-			for(auto &key : value_keys) {
-				arff << "," << feature_attributes.numeric(key).get(feature);
-			}
-			arff << std::endl;
+				arff << (size_t) feature << ',';
+			arff << c.x << ',' << c.y;
+			featureAttributesToCSV(feature, arff, string_columns, value_columns);
+			arff << '\n';
 		}
 	}
-
-	return arff.str();
 }
 
 bool PointCollection::isSimple() const {
@@ -180,8 +180,10 @@ public:
 
 	virtual SpatialReference getFeatureMBR(size_t featureIndex) const;
 
-	virtual std::string toCSV() const;
-	virtual std::string toARFF(std::string layerName = "export") const;
+	using SimpleFeatureCollection::toCSV;
+	using SimpleFeatureCollection::toARFF;
+	virtual void toCSV(std::ostream &output) const;
+	virtual void toARFF(std::ostream &output, const std::string &layerName = "export") const;
 
 	virtual bool isSimple() const final;
 
@@ -200,8 +202,9 @@ public:
 	virtual ~PointCollection() = default;
 
 protected:
-	virtual void featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const;
-	virtual void featureToWKT(size_t featureIndex, std::ostringstream& wkt) const;
+	virtual void featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const;
+	virtual void featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const;
+	virtual std::string getColumnarGeometry(GeometryOffsets &offsets) const;
 
 	virtual void validateSpecifics() const;
 
@@ -2,6 +2,7 @@
 #include "datatypes/polygoncollection.h"
 #include "util/make_unique.h"
 #include "util/binarystream.h"
+#include "util/bufferedtextwriter.h"
 
 #include <sstream>
 
@@ -161,7 +162,21 @@ bool PolygonCollection::featureIntersectsRectangle(size_t featureIndex, double x
 	return false;
 }
 
-void PolygonCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const {
+/**
+ * Writes the coordinates of a ring, separated by the given strings
+ */
+template<typename Ring>
+static void writeRing(BufferedTextWriter& writer, const Ring &ring, const char *coordinate_start, char separator, const char *coordinate_end) {
+	bool first = true;
+	for(auto& c : ring){
+		if (!first)
+			writer << ',';
+		first = false;
+		writer << coordinate_start << c.x << separator << c.y << coordinate_end;
+	}
+}
+
+void PolygonCollection::featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const {
 	auto feature = getFeatureReference(featureIndex);
 
 	if(feature.size() == 1)
@@ -169,27 +184,30 @@ void PolygonCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostri
 	else
 		json << "{\"type\":\"MultiPolygon\",\"coordinates\":[";
 
+	bool first_polygon = true;
 	for(auto polygon : feature){
-		json << "[";
+		if (!first_polygon)
+			json << ',';
+		first_polygon = false;
+		json << '[';
+		bool first_ring = true;
 		for(auto ring : polygon){
-			json << "[";
-			for(auto& c : ring){
-				json << "[" << c.x << "," << c.y << "],";
-			}
-			json.seekp(((long)json.tellp()) - 1); //delete last ,
-			json << "],";
+			if (!first_ring)
+				json << ',';
+			first_ring = false;
+			json << '[';
+			writeRing(json, ring, "[", ',', "]");
+			json << ']';
 		}
-		json.seekp(((long)json.tellp()) - 1); //delete last ,
-		json << "],";
+		json << ']';
 	}
-	json.seekp(((long)json.tellp()) - 1); //delete last ,
 
 	if(feature.size() > 1)
-		json << "]";
-	json << "}";
+		json << ']';
+	json << '}';
 }
 
-void PolygonCollection::featureToWKT(size_t featureIndex, std::ostringstream& wkt) const {
+void PolygonCollection::featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const {
 	if(featureIndex >= getFeatureCount()){
 		throw ArgumentException("featureIndex is greater than featureCount");
 	}
@@ -198,37 +216,47 @@ void PolygonCollection::featureToWKT(size_t featureIndex, std::ostringstream& wk
 
 	if(feature.size() == 1) {
 		wkt << "POLYGON(";
+		bool first_ring = true;
 		for(auto ring : *feature.begin()){
-			wkt << "(";
-			for(auto& coordinate : ring){
-				wkt << coordinate.x << " " << coordinate.y << ",";
-			}
-			wkt.seekp(((long)wkt.tellp()) - 1);
-			wkt << "),";
+			if (!first_ring)
+				wkt << ',';
+			first_ring = false;
+			wkt << '(';
+			writeRing(wkt, ring, "", ' ', "");
+			wkt << ')';
 		}
-		wkt.seekp(((long)wkt.tellp()) - 1);
-		wkt << ")";
+		wkt << ')';
 	}
 	else {
 		wkt << "MULTIPOLYGON(";
+		bool first_polygon = true;
 		for(auto polygon : feature){
-			wkt << "(";
+			if (!first_polygon)
+				wkt << ',';
+			first_polygon = false;
+			wkt << '(';
+			bool first_ring = true;
 			for(auto ring : polygon){
-				wkt << "(";
-				for(auto& coordinate : ring){
-					wkt << coordinate.x << " " << coordinate.y << ",";
-				}
-				wkt.seekp(((long)wkt.tellp()) - 1);
-				wkt << "),";
+				if (!first_ring)
+					wkt << ',';
+				first_ring = false;
+				wkt << '(';
+				writeRing(wkt, ring, "", ' ', "");
+				wkt << ')';
 			}
-			wkt.seekp(((long)wkt.tellp()) - 1);
-			wkt << "),";
+			wkt << ')';
 		}
-		wkt.seekp(((long)wkt.tellp()) - 1);
-		wkt << ")";
+		wkt << ')';
 	}
 }
 
+std::string PolygonCollection::getColumnarGeometry(GeometryOffsets &offsets) const {
+	offsets.emplace_back("feature_offsets", &start_feature);
+	offsets.emplace_back("polygon_offsets", &start_polygon);
+	offsets.emplace_back("ring_offsets", &start_ring);
+	return "MultiPolygon";
+}
+
 bool PolygonCollection::isSimple() const {
 	return getFeatureCount() == (start_polygon.size() - 1);
 }
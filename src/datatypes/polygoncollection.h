@@ -214,8 +214,9 @@ public:
 	std::string getAsString();
 
 protected:
-	virtual void featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const;
-	virtual void featureToWKT(size_t featureIndex, std::ostringstream& wkt) const;
+	virtual void featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const;
+	virtual void featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const;
+	virtual std::string getColumnarGeometry(GeometryOffsets &offsets) const;
 
 	virtual void validateSpecifics() const;
 
@@ -476,6 +476,8 @@ std::unique_ptr<GenericRaster> Raster2D<T>::cut(int x1, int y1, int z1, int widt
 	if (x1 < 0 || x1 + width > (int) this->width || y1 < 0 || y1 + height > (int) this->height)
 		throw MetadataException("cut() not inside the raster");
 
+	setRepresentation(GenericRaster::Representation::CPU);
+
 	double world_x1 = PixelToWorldX(x1) - pixel_scale_x * 0.5;
 	double world_y1 = PixelToWorldY(y1) - pixel_scale_y * 0.5;
 	double world_x2 = world_x1 + pixel_scale_x * width;
@@ -495,7 +497,7 @@ std::unique_ptr<GenericRaster> Raster2D<T>::cut(int x1, int y1, int z1, int widt
 			outputraster->set(x, y, getSafe(x+x1, y+y1));
 #elif CUT_TYPE == 2 // 0.0246
 	for (int y=0;y<height;y++) {
-		size_t rowoffset_src = (size_t) (y+y1) * width + x1;
+		size_t rowoffset_src = (size_t) (y+y1) * this->width + x1;
 		size_t rowoffset_dest = (size_t) y * width;
 		memcpy(&outputraster->data[rowoffset_dest], &data[rowoffset_src], width * sizeof(T));
 	}
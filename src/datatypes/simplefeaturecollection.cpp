@@ -4,6 +4,7 @@
 #include "util/binarystream.h"
 #include "util/make_unique.h"
 #include "util/sizeutil.h"
+#include "util/bufferedtextwriter.h"
 
 #include <sstream>
 #include <iomanip>
@@ -70,169 +71,320 @@ void SimpleFeatureCollection::validate() const {
  */
 std::string SimpleFeatureCollection::toGeoJSON(bool displayMetadata) const {
 	std::ostringstream json;
-	json << std::fixed; // std::setprecision(4);
+	toGeoJSON(json, displayMetadata);
+	return json.str();
+}
+
+void SimpleFeatureCollection::resolveAttributeColumns(std::vector<const AttributeArrays::TextualArray *> &string_columns, std::vector<const AttributeArrays::NumericArray *> &value_columns) const {
+	for (auto &key : feature_attributes.getTextualKeys())
+		string_columns.push_back(&feature_attributes.textual(key));
+	for (auto &key : feature_attributes.getNumericKeys())
+		value_columns.push_back(&feature_attributes.numeric(key));
+}
+
+void SimpleFeatureCollection::toGeoJSON(std::ostream &output, bool displayMetadata) const {
+	BufferedTextWriter json(output, BufferedTextWriter::DoubleFormat::FIXED);
 
 	json << "{\"type\":\"FeatureCollection\",\"crs\":{\"type\":\"name\",\"properties\":{\"name\":\"" << stref.crsId.to_string() <<"\"}},\"features\":[";
 
 	auto value_keys = feature_attributes.getNumericKeys();
 	auto string_keys = feature_attributes.getTextualKeys();
-	bool isSimpleCollection = isSimple();
-	for (size_t feature = 0; feature < getFeatureCount(); ++feature) {
+	std::vector<const AttributeArrays::TextualArray *> string_columns;
+	std::vector<const AttributeArrays::NumericArray *> value_columns;
+	resolveAttributeColumns(string_columns, value_columns);
+
+	// the keys are the same for every feature, so prepare their json representation once
+	std::vector<std::string> string_names, value_names;
+	for (auto &key : string_keys)
+		string_names.push_back("\"" + key + "\":");
+	for (auto &key : value_keys)
+		value_names.push_back("\"" + key + "\":");
+
+	const bool has_time = hasTime();
+	const bool write_properties = displayMetadata && (string_keys.size() > 0 || value_keys.size() > 0 || has_time);
+	const size_t feature_count = getFeatureCount();
+	for (size_t feature = 0; feature < feature_count; ++feature) {
+		if (feature > 0)
+			json << ',';
 		json << "{\"type\":\"Feature\",\"geometry\":";
 		featureToGeoJSONGeometry(feature, json);
 
-		if(displayMetadata && (string_keys.size() > 0 || value_keys.size() > 0 || hasTime())){
-			json << ",\"properties\":{";
+		if (write_properties) {
+			json << ",\"properties\":";
+			char separator = '{';
 
 			//TODO: handle missing metadata values
-			for (auto &key : string_keys) {
-				json << "\"" << key << "\":" << Json::valueToQuotedString(feature_attributes.textual(key).get(feature).c_str()) << ",";
+			for (size_t i = 0; i < string_columns.size(); ++i) {
+				json << separator << string_names[i] << Json::valueToQuotedString(string_columns[i]->get(feature).c_str());
+				separator = ',';
 			}
 
-			for (auto &key : value_keys) {
-				double value = feature_attributes.numeric(key).get(feature);
-				json << "\"" << key << "\":";
+			for (size_t i = 0; i < value_columns.size(); ++i) {
+				double value = value_columns[i]->get(feature);
+				json << separator << value_names[i];
 				if (std::isfinite(value)) {
 					json << value;
 				}
 				else {
 					json << "null";
 				}
-
-				json << ",";
+				separator = ',';
 			}
 
-			if (hasTime()) {
-				json << "\"time_start\":\"" << stref.toIsoString(time[feature].t1) << "\",\"time_end\":\"" << stref.toIsoString(time[feature].t2) << "\",";
+			if (has_time) {
+				json << separator << "\"time_start\":\"" << stref.toIsoString(time[feature].t1) << "\",\"time_end\":\"" << stref.toIsoString(time[feature].t2) << "\"";
 			}
 
-			json.seekp(((long) json.tellp()) - 1); // delete last ,
-			json << "}";
+			json << '}';
 		}
-		json << "},";
-
+		json << '}';
 	}
 
-	if(getFeatureCount() > 0)
-		json.seekp(((long) json.tellp()) - 1); // delete last ,
 	json << "]}";
-
-	return json.str();
 }
 
 
 std::string SimpleFeatureCollection::toWKT() const {
 	std::ostringstream wkt;
+	toWKT(wkt);
+	return wkt.str();
+}
+
+void SimpleFeatureCollection::toWKT(std::ostream &output) const {
+	BufferedTextWriter wkt(output, BufferedTextWriter::DoubleFormat::GENERAL);
 
 	wkt << "GEOMETRYCOLLECTION(";
 
 	for(size_t i = 0; i < getFeatureCount(); ++i){
+		if (i > 0)
+			wkt << ',';
 		featureToWKT(i, wkt);
-		wkt << ",";
 	}
-	if(getFeatureCount() > 0)
-		wkt.seekp(((long) wkt.tellp()) - 1); // delete last ,
 
-	wkt << ")";
+	wkt << ')';
+}
+
+void SimpleFeatureCollection::featureAttributesToCSV(size_t featureIndex, BufferedTextWriter& csv, const std::vector<const AttributeArrays::TextualArray *> &string_columns, const std::vector<const AttributeArrays::NumericArray *> &value_columns) const {
+	if (hasTime()){
+		csv << ",\"" << stref.toIsoString(time[featureIndex].t1) << "\",\"" << stref.toIsoString(time[featureIndex].t2) << "\"";
+	}
 
-	return wkt.str();
+	//TODO: handle missing metadata values
+	for (auto column : string_columns) {
+		csv << ",\"" << column->get(featureIndex) << '"';
+	}
+	for (auto column : value_columns) {
+		csv << ',' << column->get(featureIndex);
+	}
 }
 
 std::string SimpleFeatureCollection::toCSV() const {
-	//TODO: include global metadata
 	std::ostringstream csv;
-	csv << std::fixed; // std::setprecision(4);
+	toCSV(csv);
+	return csv.str();
+}
 
-	auto string_keys = feature_attributes.getTextualKeys();
-	auto value_keys = feature_attributes.getNumericKeys();
+void SimpleFeatureCollection::toCSV(std::ostream &output) const {
+	//TODO: include global metadata
+	BufferedTextWriter csv(output, BufferedTextWriter::DoubleFormat::FIXED);
 
-	bool isSimpleCollection = isSimple();
+	std::vector<const AttributeArrays::TextualArray *> string_columns;
+	std::vector<const AttributeArrays::NumericArray *> value_columns;
+	resolveAttributeColumns(string_columns, value_columns);
 
 	//header
 	csv << "wkt";
 	if (hasTime())
 		csv << ",\"time_start\",\"time_end\"";
-	for(auto &key : string_keys) {
-		csv << ",\"" << key << "\"";
+	for(auto &key : feature_attributes.getTextualKeys()) {
+		csv << ",\"" << key << '"';
 	}
-	for(auto &key : value_keys) {
-		csv << ",\"" << key << "\"";
+	for(auto &key : feature_attributes.getNumericKeys()) {
+		csv << ",\"" << key << '"';
 	}
-	csv << std::endl;
+	csv << '\n';
 
 	for (size_t featureIndex = 0; featureIndex < getFeatureCount(); ++featureIndex) {
-		csv << "\"";
+		csv << '"';
 		featureToWKT(featureIndex, csv);
-		csv << "\"";
-		if (hasTime()){
-			csv << "," << "\"" << stref.toIsoString(time[featureIndex].t1) << "\"" << ","
-					 << "\"" << stref.toIsoString(time[featureIndex].t2) << "\"";
-		}
-
-		//TODO: handle missing metadata values
-		for(auto &key : string_keys) {
-			csv << ",\"" << feature_attributes.textual(key).get(featureIndex) << "\"";
-		}
-		for(auto &key : value_keys) {
-			csv << "," << feature_attributes.numeric(key).get(featureIndex);
-		}
-		csv << std::endl;
+		csv << '"';
+		featureAttributesToCSV(featureIndex, csv, string_columns, value_columns);
+		csv << '\n';
 	}
-
-	return csv.str();
 }
 
 std::string SimpleFeatureCollection::featureToWKT(size_t featureIndex) const{
 	std::ostringstream wkt;
-	featureToWKT(featureIndex, wkt);
+	{
+		BufferedTextWriter writer(wkt, BufferedTextWriter::DoubleFormat::GENERAL);
+		featureToWKT(featureIndex, writer);
+	}
 	return wkt.str();
 }
 
 std::string SimpleFeatureCollection::toARFF(std::string layerName) const {
 	std::ostringstream arff;
+	toARFF(arff, layerName);
+	return arff.str();
+}
+
+void SimpleFeatureCollection::toARFF(std::ostream &output, const std::string &layerName) const {
+	BufferedTextWriter arff(output, BufferedTextWriter::DoubleFormat::GENERAL);
 
-	arff << "@RELATION " << layerName << std::endl << std::endl;
+	arff << "@RELATION " << layerName << "\n\n";
 
-	arff << "@ATTRIBUTE wkt STRING" << std::endl;
+	arff << "@ATTRIBUTE wkt STRING\n";
 
 	if (hasTime()){
-		arff << "@ATTRIBUTE time_start DATE" << std::endl;
-		arff << "@ATTRIBUTE time_end DATE" << std::endl;
+		arff << "@ATTRIBUTE time_start DATE\n";
+		arff << "@ATTRIBUTE time_end DATE\n";
 	}
 
-	auto string_keys = feature_attributes.getTextualKeys();
-	auto value_keys = feature_attributes.getNumericKeys();
-
-	for(auto &key : string_keys) {
-		arff << "@ATTRIBUTE" << " " << key << " " << "STRING" << std::endl;
+	for(auto &key : feature_attributes.getTextualKeys()) {
+		arff << "@ATTRIBUTE " << key << " STRING\n";
 	}
-	for(auto &key : value_keys) {
-		arff << "@ATTRIBUTE" << " " << key << " " << "NUMERIC" << std::endl;
+	for(auto &key : feature_attributes.getNumericKeys()) {
+		arff << "@ATTRIBUTE " << key << " NUMERIC\n";
 	}
 
-	arff << std::endl;
-	arff << "@DATA" << std::endl;
+	arff << "\n";
+	arff << "@DATA\n";
+
+	std::vector<const AttributeArrays::TextualArray *> string_columns;
+	std::vector<const AttributeArrays::NumericArray *> value_columns;
+	resolveAttributeColumns(string_columns, value_columns);
 
 	for (size_t featureIndex = 0; featureIndex < getFeatureCount(); ++featureIndex) {
-		arff << "\"";
+		arff << '"';
 		featureToWKT(featureIndex, arff);
-		arff << "\"";
-		if (hasTime()){
-			arff << "," << "\"" << stref.toIsoString(time[featureIndex].t1) << "\"" << ","
-					 << "\"" << stref.toIsoString(time[featureIndex].t2) << "\"";
-		}
+		arff << '"';
+		featureAttributesToCSV(featureIndex, arff, string_columns, value_columns);
+		arff << '\n';
+	}
+}
 
-		//TODO: handle missing metadata values
-		for(auto &key : string_keys) {
-			arff << ",\"" << feature_attributes.textual(key).get(featureIndex) << "\"";
-		}
-		for(auto &key : value_keys) {
-			arff << "," << feature_attributes.numeric(key).get(featureIndex);
-		}
-		arff << std::endl;
+/*
+ * Columnar export
+ */
+static const size_t COLUMNAR_ALIGNMENT = 8;
+
+static size_t alignColumnar(size_t size) {
+	return (size + COLUMNAR_ALIGNMENT - 1) / COLUMNAR_ALIGNMENT * COLUMNAR_ALIGNMENT;
+}
+
+static void writeColumnarPadding(BufferedTextWriter &out, size_t size) {
+	static const char zeros[COLUMNAR_ALIGNMENT] = {0};
+	out.write(zeros, alignColumnar(size) - size);
+}
+
+template<typename T>
+static void writeColumnarBuffer(BufferedTextWriter &out, const T *data, size_t count) {
+	out.write(reinterpret_cast<const char *>(data), count * sizeof(T));
+	writeColumnarPadding(out, count * sizeof(T));
+}
+
+void SimpleFeatureCollection::toColumnar(std::ostream &output) const {
+	// coordinates and time intervals are written as they are stored in memory
+	static_assert(sizeof(Coordinate) == 2 * sizeof(double), "Coordinate is expected to consist of two doubles");
+	static_assert(sizeof(TimeInterval) == 2 * sizeof(double), "TimeInterval is expected to consist of two doubles");
+
+	const size_t feature_count = getFeatureCount();
+	const bool has_time = hasTime();
+
+	GeometryOffsets offsets;
+	std::string geometry_type = getColumnarGeometry(offsets);
+
+	auto string_keys = feature_attributes.getTextualKeys();
+	auto value_keys = feature_attributes.getNumericKeys();
+	std::vector<const AttributeArrays::TextualArray *> string_columns;
+	std::vector<const AttributeArrays::NumericArray *> value_columns;
+	resolveAttributeColumns(string_columns, value_columns);
+
+	// all buffer sizes are known in advance, so the header can describe the complete body
+	size_t body_size = 0;
+	auto describeBuffer = [&body_size](const char *type, size_t length, size_t element_size) {
+		Json::Value buffer(Json::objectValue);
+		buffer["type"] = type;
+		buffer["offset"] = (Json::UInt64) body_size;
+		buffer["length"] = (Json::UInt64) length;
+		body_size += alignColumnar(length * element_size);
+		return buffer;
+	};
+
+	uint16_t byteorder_probe = 1;
+	Json::Value header(Json::objectValue);
+	header["version"] = 1;
+	header["byteorder"] = *reinterpret_cast<const uint8_t *>(&byteorder_probe) == 1 ? "little" : "big";
+	header["crs"] = stref.crsId.to_string();
+	header["features"] = (Json::UInt64) feature_count;
+
+	Json::Value geometry(Json::objectValue);
+	geometry["type"] = geometry_type;
+	geometry["offsets"] = Json::Value(Json::arrayValue);
+	for (auto &offset : offsets) {
+		Json::Value buffer = describeBuffer("uint32", offset.second->size(), sizeof(uint32_t));
+		buffer["name"] = offset.first;
+		geometry["offsets"].append(buffer);
 	}
+	geometry["coordinates"] = describeBuffer("float64", 2 * coordinates.size(), sizeof(double));
+	header["geometry"] = geometry;
 
-	return arff.str();
+	header["time"] = has_time ? describeBuffer("float64", 2 * feature_count, sizeof(double)) : Json::Value(Json::nullValue);
+
+	Json::Value attributes(Json::arrayValue);
+	for (size_t i = 0; i < value_columns.size(); ++i) {
+		Json::Value buffer = describeBuffer("float64", feature_count, sizeof(double));
+		buffer["name"] = value_keys[i];
+		buffer["unit"] = value_columns[i]->unit.toJsonObject();
+		attributes.append(buffer);
+	}
+	std::vector<std::vector<uint64_t>> string_offsets(string_columns.size());
+	for (size_t i = 0; i < string_columns.size(); ++i) {
+		auto &column_offsets = string_offsets[i];
+		column_offsets.reserve(feature_count + 1);
+		uint64_t data_size = 0;
+		column_offsets.push_back(0);
+		for (auto &value : string_columns[i]->array) {
+			data_size += value.size();
+			column_offsets.push_back(data_size);
+		}
+
+		Json::Value buffer(Json::objectValue);
+		buffer["type"] = "utf8";
+		buffer["length"] = (Json::UInt64) feature_count;
+		buffer["name"] = string_keys[i];
+		buffer["unit"] = string_columns[i]->unit.toJsonObject();
+		buffer["offsets"] = describeBuffer("uint64", feature_count + 1, sizeof(uint64_t));
+		buffer["data"] = describeBuffer("uint8", data_size, 1);
+		attributes.append(buffer);
+	}
+	header["attributes"] = attributes;
+
+	Json::FastWriter writer;
+	std::string header_json = writer.write(header);
+	header_json.resize(alignColumnar(header_json.size()), ' ');
+
+	BufferedTextWriter out(output);
+	out.write("MAPCOL01", 8);
+	uint64_t header_length = header_json.size();
+	for (int i = 0; i < 8; ++i)
+		out << (char) ((header_length >> (8 * i)) & 0xff);
+	out << header_json;
+
+	// body, in the order described by the header
+	for (auto &offset : offsets)
+		writeColumnarBuffer(out, offset.second->data(), offset.second->size());
+	writeColumnarBuffer(out, reinterpret_cast<const double *>(coordinates.data()), 2 * coordinates.size());
+	if (has_time)
+		writeColumnarBuffer(out, reinterpret_cast<const double *>(time.data()), 2 * feature_count);
+	for (auto column : value_columns)
+		writeColumnarBuffer(out, column->array.data(), feature_count);
+	for (size_t i = 0; i < string_columns.size(); ++i) {
+		writeColumnarBuffer(out, string_offsets[i].data(), string_offsets[i].size());
+		for (auto &value : string_columns[i]->array)
+			out << value;
+		writeColumnarPadding(out, string_offsets[i].back());
+	}
 }
 
 SpatialReference SimpleFeatureCollection::calculateMBR(size_t coordinateIndexStart, size_t coordinateIndexStop) const {
@@ -8,6 +8,11 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <ostream>
+#include <utility>
+#include <cstdint>
+
+class BufferedTextWriter;
 
 /**
  * Base class for collection data types (Point, Polygon, Line)
@@ -99,11 +104,24 @@ public:
 	 */
 	std::string toGeoJSON(bool displayMetadata = false) const;
 
+	/**
+	 * Write a GeoJSON representation of the collection to a stream, without building the whole document in memory
+	 * @param output the stream to write to
+	 * @param displayMetadata if true, include attributes
+	 */
+	void toGeoJSON(std::ostream &output, bool displayMetadata = false) const;
+
 	/**
 	 * Get a CSV representation of this collection
 	 * @return a CSV representation of this collection
 	 */
-	virtual std::string toCSV() const;
+	std::string toCSV() const;
+
+	/**
+	 * Write a CSV representation of this collection to a stream
+	 * @param output the stream to write to
+	 */
+	virtual void toCSV(std::ostream &output) const;
 
 	/**
 	 * Get a WKT representation of this collection
@@ -111,12 +129,39 @@ public:
 	 */
 	std::string toWKT() const;
 
+	/**
+	 * Write a WKT representation of this collection to a stream
+	 * @param output the stream to write to
+	 */
+	void toWKT(std::ostream &output) const;
+
 	/**
 	 * Get a ARFF representation of this collection
 	 * @param layerName the name of the relation in the ARFF file
 	 * @return a ARFF representation of this collection
 	 */
-	virtual std::string toARFF(std::string layerName = "export") const;
+	std::string toARFF(std::string layerName = "export") const;
+
+	/**
+	 * Write a ARFF representation of this collection to a stream
+	 * @param output the stream to write to
+	 * @param layerName the name of the relation in the ARFF file
+	 */
+	virtual void toARFF(std::ostream &output, const std::string &layerName = "export") const;
+
+	/**
+	 * Write a binary columnar representation of this collection to a stream.
+	 *
+	 * The stream starts with the 8 byte magic "MAPCOL01", followed by the length of a JSON header
+	 * as a little endian uint64 and the header itself. The header describes the location of the
+	 * buffers in the body following it: the geometry offset arrays (uint32), the interleaved x/y
+	 * coordinates (float64), the interleaved time intervals (float64) and one buffer per attribute
+	 * (float64 or uint64 offsets into utf8 data). Offsets in the header are relative to the start of
+	 * the body and every buffer is 8 byte aligned. The geometry uses the same nested offset layout as
+	 * GeoArrow, so clients can map the buffers without parsing individual features.
+	 * @param output the stream to write to
+	 */
+	void toColumnar(std::ostream &output) const;
 
 	/**
 	 * Get a WKT representation of a given feature in this collection
@@ -157,8 +202,23 @@ public:
 	virtual size_t get_byte_size() const;
 
 protected:
-	virtual void featureToGeoJSONGeometry(size_t featureIndex, std::ostringstream& json) const = 0;
-	virtual void featureToWKT(size_t featureIndex, std::ostringstream& wkt) const = 0;
+	virtual void featureToGeoJSONGeometry(size_t featureIndex, BufferedTextWriter& json) const = 0;
+	virtual void featureToWKT(size_t featureIndex, BufferedTextWriter& wkt) const = 0;
+
+	using GeometryOffsets = std::vector<std::pair<std::string, const std::vector<uint32_t> *>>;
+
+	/**
+	 * Describes the geometry for the columnar export
+	 * @param offsets receives the named offset arrays, from the outermost level (features) to the one pointing into the coordinates
+	 * @return the geometry type
+	 */
+	virtual std::string getColumnarGeometry(GeometryOffsets &offsets) const = 0;
+
+	/**
+	 * Writes the time and the attribute values of a feature as CSV columns, each preceded by a comma
+	 */
+	void featureAttributesToCSV(size_t featureIndex, BufferedTextWriter& csv, const std::vector<const AttributeArrays::TextualArray *> &string_columns, const std::vector<const AttributeArrays::NumericArray *> &value_columns) const;
+	void resolveAttributeColumns(std::vector<const AttributeArrays::TextualArray *> &string_columns, std::vector<const AttributeArrays::NumericArray *> &value_columns) const;
 
 	virtual void validateSpecifics() const = 0;
 
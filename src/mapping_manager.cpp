@@ -25,9 +25,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <exception>
 #include <memory>
 #include <utility>
+#include <string>
+#include <limits>
 
 #include <json/json.h>
 
@@ -63,6 +66,7 @@ static void usage() {
 		printf("%s createsource <crs> <channel1_example> <channel2_example> ...\n", program_name);
 		printf("%s loadsource <sourcename>\n", program_name);
 		printf("%s import <sourcename> <filename> <filechannel> <sourcechannel> <time_start> <duration> <compression>\n", program_name);
+		printf("%s bulkimport <sourcename> <listfile> <compression> [threads]\n", program_name);
 		printf("%s link <sourcename> <sourcechannel> <time_reference> <time_start> <duration>\n", program_name);
 		printf("%s query <queryname> <png_filename>\n", program_name);
 		printf("%s testquery <queryname> [S|F]\n", program_name);
@@ -190,6 +194,55 @@ static void import(int argc, char *argv[]) {
 	}
 }
 
+// bulkimport <sourcename> <listfile> <compression> [threads]
+// Each line of the listfile describes one import: <filename> <filechannel> <sourcechannel> <time_start> <duration>
+static void bulkimport(int argc, char *argv[]) {
+	if (argc < 5) {
+		usage();
+	}
+	try {
+		std::vector<RasterDB::ImportFile> files;
+		std::ifstream listfile(argv[3]);
+		if (!listfile.is_open())
+			throw ArgumentException(concat("Could not open list file ", argv[3]));
+		std::string line;
+		while (std::getline(listfile, line)) {
+			if (line.empty() || line[0] == '#')
+				continue;
+			std::istringstream fields(line);
+			RasterDB::ImportFile file;
+			double duration;
+			if (!(fields >> file.filename >> file.sourcechannel >> file.channelid >> file.time_start >> duration))
+				throw ArgumentException(concat("Invalid line in list file: ", line));
+			file.time_end = file.time_start + duration;
+			files.push_back(file);
+		}
+
+		std::string compression = argv[4];
+		// without a thread count, one thread per core is used
+		uint32_t threads = 0;
+		if (argc > 5) {
+			size_t parsed = 0;
+			unsigned long value = 0;
+			try {
+				value = std::stoul(argv[5], &parsed);
+			}
+			catch (const std::exception &) {
+				parsed = 0;
+			}
+			if (parsed == 0 || argv[5][parsed] != '\0' || argv[5][0] == '-' || value == 0 || value > std::numeric_limits<uint32_t>::max())
+				throw ArgumentException(concat("Invalid number of threads: ", argv[5]));
+			threads = (uint32_t) value;
+		}
+
+		auto db = RasterDB::open(argv[2], RasterDB::READ_WRITE);
+		db->import(files, compression, threads);
+	}
+	catch (std::exception &e) {
+		printf("Failure: %s\n", e.what());
+	}
+}
+
 // link <sourcename> <channel> <reference_time> <new_time_start> <new_duration>
 static void link(int argc, char *argv[]) {
 	if (argc < 7) {
@@ -285,13 +338,10 @@ static QueryRectangle qrect_from_json(Json::Value &root, bool &flipx, bool &flip
 
 template<typename T> void runfeaturequery(GenericOperator *graph, const QueryRectangle &qrect, const char *out_filename) {
 	auto features = queryFeature<T>::query(graph, qrect);
-	auto csv = features->toCSV();
 	if (out_filename) {
-		FILE *f = fopen(out_filename, "w");
-		if (f) {
-			fwrite(csv.c_str(), csv.length(), 1, f);
-			fclose(f);
-		}
+		std::ofstream f(out_filename);
+		if (f)
+			features->toCSV(f);
 	}
 	else
 		printf("No output filename given, discarding result\n");
@@ -807,6 +857,9 @@ int main(int argc, char *argv[]) {
 	else if (strcmp(command, "import") == 0) {
 		import(argc, argv);
 	}
+	else if (strcmp(command, "bulkimport") == 0) {
+		bulkimport(argc, argv);
+	}
 	else if (strcmp(command, "link") == 0) {
 		link(argc, argv);
 	}
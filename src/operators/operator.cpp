@@ -6,6 +6,7 @@
 #include "util/log.h"
 
 #include "operators/operator.h"
+#include "operators/pixel_operator.h"
 #include "cache/manager.h"
 
 
@@ -42,7 +43,7 @@ OperatorRegistration::OperatorRegistration(const char *name, OPConstructor const
 /*
  * GenericOperator class
  */
-GenericOperator::GenericOperator(int _sourcecounts[], GenericOperator *_sources[]) : type(), semantic_id(), depth(0) {
+GenericOperator::GenericOperator(int _sourcecounts[], GenericOperator *_sources[]) : type(), semantic_id(), semantic_digest(), depth(0) {
 	for (int i=0;i<MAX_INPUT_TYPES;i++)
 		sourcecounts[i] = _sourcecounts[i];
 
@@ -454,7 +455,8 @@ std::unique_ptr<GenericOperator> GenericOperator::fromJSON(Json::Value &json, in
 		}
 		semantic_id << "}}";
 		op->semantic_id = semantic_id.str();
-		return op;
+		op->semantic_digest = SemanticDigest(op->semantic_id);
+		return FusedPixelOperator::fuse(std::move(op));
 	}
 	catch (const std::exception &e) {
 		for (int i=0;i<MAX_SOURCES;i++) {
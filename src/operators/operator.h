@@ -5,6 +5,7 @@
 #include "operators/provenance.h"
 #include "operators/queryrectangle.h"
 #include "operators/querytools.h"
+#include "util/semantic_digest.h"
 
 #include <ctime>
 #include <string>
@@ -35,6 +36,7 @@ class GenericOperator {
 	friend class PuzzleUtil;
 	friend class GraphReorgStrategy;
 	friend class QuerySpec;
+	friend class FusedPixelOperator;
 	public:
 		/*
 		 * Restricts the spatial extent and resolution of a raster returned from an operator.
@@ -79,6 +81,8 @@ class GenericOperator {
 
 		const std::string &getType() const { return type; }
 		const std::string &getSemanticId() const { return semantic_id; }
+		// a fixed-size digest of the semantic id, used as key by the caches
+		const SemanticDigest &getSemanticDigest() const { return semantic_digest; }
 		int getDepth() const { return depth; }
 
 	protected:
@@ -118,6 +122,7 @@ class GenericOperator {
 
 		std::string type;
 		std::string semantic_id;
+		SemanticDigest semantic_digest;
 		int depth;
 
 		void operator=(GenericOperator &) = delete;
@@ -0,0 +1,278 @@
+
+#include "operators/pixel_operator.h"
+#include "datatypes/raster/typejuggling.h"
+#include "raster/opencl.h"
+#include "util/configuration.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+
+void PixelStage::addArg(const std::string &name, int value) {
+	args.push_back(Arg{Arg::Type::INT, name, (double) value, {}, {}});
+}
+
+void PixelStage::addArg(const std::string &name, float value) {
+	args.push_back(Arg{Arg::Type::FLOAT, name, value, {}, {}});
+}
+
+void PixelStage::addArg(const std::string &name, double value) {
+	args.push_back(Arg{Arg::Type::DOUBLE, name, value, {}, {}});
+}
+
+void PixelStage::addArg(const std::string &name, const std::vector<int> &table) {
+	// OpenCL cannot create empty buffers
+	args.push_back(Arg{Arg::Type::INT_TABLE, name, 0, table.empty() ? std::vector<int>{0} : table, {}});
+}
+
+void PixelStage::addArg(const std::string &name, const std::vector<float> &table) {
+	args.push_back(Arg{Arg::Type::FLOAT_TABLE, name, 0, {}, table.empty() ? std::vector<float>{0} : table});
+}
+
+
+FusedPixelOperator::FusedPixelOperator(int sourcecounts[], GenericOperator *sources[]) : GenericOperator(sourcecounts, sources) {
+}
+
+FusedPixelOperator::~FusedPixelOperator() {
+}
+
+bool FusedPixelOperator::isFusable(GenericOperator *op) {
+	if (op == nullptr || dynamic_cast<PixelOperator *>(op) == nullptr)
+		return false;
+	return op->getRasterSourceCount() == 1 && op->getPointCollectionSourceCount() == 0
+		&& op->getLineCollectionSourceCount() == 0 && op->getPolygonCollectionSourceCount() == 0;
+}
+
+std::unique_ptr<GenericOperator> FusedPixelOperator::fuse(std::unique_ptr<GenericOperator> op) {
+#if defined(MAPPING_NO_OPENCL) || defined(MAPPING_OPERATOR_STUBS)
+	return op;
+#else
+	if (!isFusable(op.get()) || !Configuration::get<bool>("operators.fusion.enabled", true))
+		return op;
+
+	// the source is fused already if it is the end of a chain
+	std::unique_ptr<GenericOperator> fused_guard;
+	auto fused = dynamic_cast<FusedPixelOperator *>(op->sources[0]);
+	if (fused != nullptr) {
+		fused_guard.reset(fused);
+		op->sources[0] = nullptr;
+	}
+	else if (isFusable(op->sources[0])) {
+		std::unique_ptr<GenericOperator> first(op->sources[0]);
+		op->sources[0] = nullptr;
+
+		int sourcecounts[MAX_INPUT_TYPES] = {1, 0, 0, 0};
+		GenericOperator *sources[MAX_SOURCES] = {first->sources[0]};
+		first->sources[0] = nullptr;
+		fused = new FusedPixelOperator(sourcecounts, sources);
+		fused_guard.reset(fused);
+		fused->appendStage(std::move(first));
+	}
+	else
+		return op;
+
+	fused->appendStage(std::move(op));
+	return fused_guard;
+#endif
+}
+
+void FusedPixelOperator::appendStage(std::unique_ptr<GenericOperator> op) {
+	// the chain computes the same result as its last operator
+	type = op->type;
+	semantic_id = op->semantic_id;
+	semantic_digest = op->semantic_digest;
+	depth = op->depth;
+	stages.push_back(std::move(op));
+}
+
+void FusedPixelOperator::getProvenance(ProvenanceCollection &pc) {
+	for (auto &stage : stages)
+		stage->getProvenance(pc);
+}
+
+
+#ifndef MAPPING_OPERATOR_STUBS
+#ifdef MAPPING_NO_OPENCL
+std::unique_ptr<GenericRaster> FusedPixelOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+	throw OperatorException("FusedPixelOperator: cannot be executed without OpenCL support");
+}
+#else
+
+static std::string clTypeName(GDALDataType datatype) {
+	switch (datatype) {
+		case GDT_Byte: return RasterTypeInfo<uint8_t>::cltypename;
+		case GDT_Int16: return RasterTypeInfo<int16_t>::cltypename;
+		case GDT_UInt16: return RasterTypeInfo<uint16_t>::cltypename;
+		case GDT_Int32: return RasterTypeInfo<int32_t>::cltypename;
+		case GDT_UInt32: return RasterTypeInfo<uint32_t>::cltypename;
+		case GDT_Float32: return RasterTypeInfo<float>::cltypename;
+		case GDT_Float64: return RasterTypeInfo<double>::cltypename;
+		default:
+			throw MetadataException("FusedPixelOperator: unsupported data type");
+	}
+}
+
+/*
+ * The OpenCL condition for a no data value, like ISNODATA in the single kernels
+ */
+static std::string noDataCondition(const DataDescription &dd, const std::string &variable) {
+	if (!dd.has_no_data)
+		return "false";
+	std::ostringstream condition;
+	condition.precision(std::numeric_limits<double>::max_digits10);
+	bool is_float = dd.datatype == GDT_Float32 || dd.datatype == GDT_Float64;
+	if (is_float)
+		condition << "isnan(" << variable << ")";
+	if (!std::isnan(dd.no_data)) {
+		if (is_float)
+			condition << " || ";
+		condition << variable << " == (double) " << dd.no_data;
+	}
+	return condition.str();
+}
+
+/*
+ * Assembles one kernel that passes each pixel through all stages. The intermediate values only live in
+ * registers; a pixel becomes no data as soon as a stage produces the no data value of its data description.
+ */
+static std::string assembleKernel(const std::vector<PixelStage> &plan) {
+	std::ostringstream functions, parameters, body;
+
+	std::vector<const std::string *> included_functions;
+	for (size_t i = 0; i < plan.size(); i++) {
+		const PixelStage &stage = plan[i];
+		const std::string prefix = "s" + std::to_string(i) + "_";
+
+		bool included = stage.functions.empty();
+		for (auto f : included_functions)
+			included = included || *f == stage.functions;
+		if (!included) {
+			functions << stage.functions << "\n";
+			included_functions.push_back(&stage.functions);
+		}
+
+		std::ostringstream aliases;
+		for (auto &arg : stage.args) {
+			switch (arg.type) {
+				case PixelStage::Arg::Type::INT:
+					parameters << ", const int " << prefix << arg.name;
+					aliases << "const int " << arg.name << " = " << prefix << arg.name << ";\n";
+					break;
+				case PixelStage::Arg::Type::FLOAT:
+					parameters << ", const float " << prefix << arg.name;
+					aliases << "const float " << arg.name << " = " << prefix << arg.name << ";\n";
+					break;
+				case PixelStage::Arg::Type::DOUBLE:
+					parameters << ", const double " << prefix << arg.name;
+					aliases << "const double " << arg.name << " = " << prefix << arg.name << ";\n";
+					break;
+				case PixelStage::Arg::Type::INT_TABLE:
+					parameters << ", __global const int *" << prefix << arg.name;
+					aliases << "__global const int *" << arg.name << " = " << prefix << arg.name << ";\n";
+					break;
+				case PixelStage::Arg::Type::FLOAT_TABLE:
+					parameters << ", __global const float *" << prefix << arg.name;
+					aliases << "__global const float *" << arg.name << " = " << prefix << arg.name << ";\n";
+					break;
+			}
+		}
+
+		const std::string in_type = i == 0 ? "IN_TYPE0" : clTypeName(plan[i-1].out_dd.datatype);
+		const std::string out_type = clTypeName(stage.out_dd.datatype);
+		const std::string in_variable = "value" + std::to_string(i);
+		const std::string out_variable = "value" + std::to_string(i+1);
+
+		body << out_type << " " << out_variable << " = 0;\n"
+			<< "{\n"
+			<< "typedef " << in_type << " STAGE_IN_TYPE;\n"
+			<< "typedef " << out_type << " STAGE_OUT_TYPE;\n"
+			<< "const STAGE_IN_TYPE value = " << in_variable << ";\n"
+			<< "STAGE_OUT_TYPE result = 0;\n"
+			<< aliases.str();
+		if (stage.handles_no_data)
+			body << stage.code << "\n";
+		else
+			body << "if (!nodata) {\n" << stage.code << "\n}\n";
+		body << out_variable << " = result;\n"
+			<< "}\n"
+			<< "if (!nodata && (" << noDataCondition(stage.out_dd, out_variable) << "))\n"
+			<< "	nodata = true;\n";
+	}
+
+	std::ostringstream kernel;
+	kernel << functions.str()
+		<< "__kernel void fusedpixelkernel(__global const IN_TYPE0 *in_data, __global const RasterInfo *in_info, __global OUT_TYPE0 *out_data, __global const RasterInfo *out_info"
+		<< parameters.str() << ") {\n"
+		<< "const int posx = get_global_id(0);\n"
+		<< "const int posy = get_global_id(1);\n"
+		<< "if (posx >= out_info->size[0] || posy >= out_info->size[1])\n"
+		<< "	return;\n"
+		<< "const int gid = posy * out_info->size[0] + posx;\n"
+		<< "IN_TYPE0 value0 = in_data[gid];\n"
+		<< "bool nodata = ISNODATA0(value0, in_info);\n"
+		<< body.str()
+		<< "out_data[gid] = nodata ? (OUT_TYPE0) out_info->no_data : value" << plan.size() << ";\n"
+		<< "}\n";
+	return kernel.str();
+}
+
+std::unique_ptr<GenericRaster> FusedPixelOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+	auto raster_in = getRasterFromSource(0, rect, tools);
+
+	// describe all stages for the actual input, as the single operators would
+	std::vector<PixelStage> plan;
+	plan.reserve(stages.size());
+	AttributeMaps no_attributes;
+	const AttributeMaps *attributes = &raster_in->global_attributes;
+	for (auto &stage : stages) {
+		auto pixel_operator = dynamic_cast<PixelOperator *>(stage.get());
+		plan.push_back(pixel_operator->getPixelStage(plan.empty() ? raster_in->dd : plan.back().out_dd, *attributes));
+		if (!plan.back().keeps_attributes)
+			attributes = &no_attributes;
+	}
+
+	RasterOpenCL::init();
+	raster_in->setRepresentation(GenericRaster::Representation::OPENCL);
+	auto raster_out = GenericRaster::create(plan.back().out_dd, *raster_in, GenericRaster::Representation::OPENCL);
+
+	try {
+		RasterOpenCL::CLProgram prog;
+		prog.setProfiler(tools.profiler);
+		prog.addInRaster(raster_in.get());
+		prog.addOutRaster(raster_out.get());
+		prog.compile(assembleKernel(plan), "fusedpixelkernel");
+		for (auto &stage : plan) {
+			for (auto &arg : stage.args) {
+				switch (arg.type) {
+					case PixelStage::Arg::Type::INT:
+						prog.addArg((cl_int) arg.scalar);
+						break;
+					case PixelStage::Arg::Type::FLOAT:
+						prog.addArg((cl_float) arg.scalar);
+						break;
+					case PixelStage::Arg::Type::DOUBLE:
+						prog.addArg((cl_double) arg.scalar);
+						break;
+					case PixelStage::Arg::Type::INT_TABLE:
+						prog.addArg(arg.int_table, true);
+						break;
+					case PixelStage::Arg::Type::FLOAT_TABLE:
+						prog.addArg(arg.float_table, true);
+						break;
+				}
+			}
+		}
+		prog.run();
+	}
+	catch (cl::Error &e) {
+		std::stringstream ss;
+		ss << "cl::Error " << e.err() << ": " << e.what();
+		throw OpenCLException(ss.str(), MappingExceptionType::CONFIDENTIAL);
+	}
+
+	raster_out->global_attributes = *attributes;
+	return raster_out;
+}
+#endif
+#endif
@@ -0,0 +1,110 @@
+#ifndef OPERATORS_PIXEL_OPERATOR_H
+#define OPERATORS_PIXEL_OPERATOR_H
+
+#include "operators/operator.h"
+#include "datatypes/raster.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+/**
+ * One step of a per-pixel computation, given as OpenCL code.
+ *
+ * The code is a block of statements that computes `result` (of the output data type STAGE_OUT_TYPE) from
+ * `value` (of the input data type STAGE_IN_TYPE). It can use posx, posy and in_info, the RasterInfo of the raster the chain started with,
+ * which has the same grid as all intermediate rasters. Unless handles_no_data is set, the code is skipped for
+ * no data pixels. Otherwise it must check `nodata` on its own and may clear it.
+ *
+ * Parameters that vary between rasters (e.g. calibration constants) should be added as arguments instead of
+ * literals, so the compiled program can be reused.
+ */
+class PixelStage {
+	public:
+		PixelStage(const DataDescription &out_dd) : out_dd(out_dd), handles_no_data(false), keeps_attributes(false) {}
+
+		void addArg(const std::string &name, int value);
+		void addArg(const std::string &name, float value);
+		void addArg(const std::string &name, double value);
+		void addArg(const std::string &name, const std::vector<int> &table);
+		void addArg(const std::string &name, const std::vector<float> &table);
+
+		// the data description of the result
+		DataDescription out_dd;
+		std::string code;
+		// helper functions the code calls, placed in front of the kernel
+		std::string functions;
+		bool handles_no_data;
+		// whether the result has the global attributes of the input
+		bool keeps_attributes;
+
+		struct Arg {
+			enum class Type {
+				INT, FLOAT, DOUBLE, INT_TABLE, FLOAT_TABLE
+			};
+			Type type;
+			std::string name;
+			double scalar;
+			std::vector<int> int_table;
+			std::vector<float> float_table;
+		};
+		std::vector<Arg> args;
+};
+
+
+/**
+ * Interface of operators whose output pixels only depend on the pixel at the same position of their single
+ * raster source, like expressions or classifications.
+ *
+ * When GenericOperator::fromJSON() finds a chain of these, it replaces the chain by a FusedPixelOperator.
+ */
+class PixelOperator {
+	public:
+		virtual ~PixelOperator() = default;
+
+#ifndef MAPPING_OPERATOR_STUBS
+		/**
+		 * Describes the computation for an input with the given metadata.
+		 * Throws like getRaster() if the input is not supported.
+		 */
+		virtual PixelStage getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const = 0;
+#endif
+};
+
+
+/**
+ * Computes a chain of PixelOperators in a single OpenCL kernel, so the intermediate rasters are neither
+ * allocated nor written to memory. The fused operator has the semantic id of the last operator of the chain
+ * and the source of the first one.
+ *
+ * Fusion can be disabled with operators.fusion.enabled. It is not available without OpenCL.
+ */
+class FusedPixelOperator : public GenericOperator {
+	public:
+		/**
+		 * Fuses op with its source if both are PixelOperators with a single raster source.
+		 * @return the fused operator or op if it cannot be fused
+		 */
+		static std::unique_ptr<GenericOperator> fuse(std::unique_ptr<GenericOperator> op);
+
+		virtual ~FusedPixelOperator();
+
+		size_t getStageCount() const { return stages.size(); }
+
+#ifndef MAPPING_OPERATOR_STUBS
+		virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools);
+#endif
+	protected:
+		virtual void getProvenance(ProvenanceCollection &pc);
+	private:
+		FusedPixelOperator(int sourcecounts[], GenericOperator *sources[]);
+
+		static bool isFusable(GenericOperator *op);
+
+		void appendStage(std::unique_ptr<GenericOperator> op);
+
+		// the operators of the chain without their sources, in the order they are applied
+		std::vector<std::unique_ptr<GenericOperator>> stages;
+};
+
+#endif
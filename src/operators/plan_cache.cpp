@@ -0,0 +1,142 @@
+
+#include "operators/plan_cache.h"
+#include "util/configuration.h"
+#include "util/semantic_digest.h"
+#include "util/exceptions.h"
+
+#include <json/json.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+	struct Plan {
+		SemanticDigest digest;
+		std::string canonical_json;
+		std::vector<std::unique_ptr<GenericOperator>> idle;
+	};
+
+	struct PlanCacheState {
+		std::mutex mutex;
+		bool configured = false;
+		size_t capacity = 0;
+		size_t idle_trees = 0;
+		// most recently used first
+		std::list<Plan> plans;
+		std::unordered_map<SemanticDigest, std::list<Plan>::iterator> index;
+		OperatorPlanCache::Statistics statistics;
+	};
+}
+
+// never destroyed, so trees released during shutdown still find their cache
+static PlanCacheState &getState() {
+	static PlanCacheState *state = new PlanCacheState();
+	return *state;
+}
+
+static void configure(PlanCacheState &state) {
+	if (!state.configured) {
+		state.capacity = Configuration::get<size_t>("operators.plancache.size", 64);
+		state.configured = true;
+	}
+}
+
+static void giveBack(const SemanticDigest &digest, const std::string &canonical_json, GenericOperator *op) {
+	std::unique_ptr<GenericOperator> tree(op);
+	std::vector<std::unique_ptr<GenericOperator>> evicted;
+
+	auto &state = getState();
+	{
+		std::lock_guard<std::mutex> guard(state.mutex);
+		if (state.capacity == 0)
+			return;
+
+		auto it = state.index.find(digest);
+		if (it == state.index.end()) {
+			state.plans.push_front(Plan{digest, canonical_json, {}});
+			it = state.index.emplace(digest, state.plans.begin()).first;
+		}
+		else {
+			// a digest collision, the plan already cached keeps its slot
+			if (it->second->canonical_json != canonical_json)
+				return;
+			state.plans.splice(state.plans.begin(), state.plans, it->second);
+		}
+		it->second->idle.push_back(std::move(tree));
+		state.idle_trees++;
+
+		while (state.idle_trees > state.capacity) {
+			auto &oldest = state.plans.back();
+			evicted.push_back(std::move(oldest.idle.back()));
+			oldest.idle.pop_back();
+			state.idle_trees--;
+			if (oldest.idle.empty()) {
+				state.index.erase(oldest.digest);
+				state.plans.pop_back();
+			}
+		}
+	}
+	// evicted trees are destroyed outside of the lock
+}
+
+static std::shared_ptr<GenericOperator> lend(std::unique_ptr<GenericOperator> tree, const SemanticDigest &digest, const std::string &canonical_json) {
+	return std::shared_ptr<GenericOperator>(tree.release(), [digest, canonical_json](GenericOperator *op) {
+		giveBack(digest, canonical_json, op);
+	});
+}
+
+
+std::shared_ptr<GenericOperator> OperatorPlanCache::get(const std::string &json) {
+	Json::Reader reader(Json::Features::strictMode());
+	Json::Value root;
+	if (!reader.parse(json, root))
+		throw OperatorException("unable to parse json");
+
+	// objects keep their keys sorted, so this is the same for equivalent workflows
+	Json::FastWriter writer;
+	std::string canonical_json = writer.write(root);
+	SemanticDigest digest(canonical_json);
+
+	auto &state = getState();
+	{
+		std::lock_guard<std::mutex> guard(state.mutex);
+		configure(state);
+
+		auto it = state.index.find(digest);
+		if (it != state.index.end() && it->second->canonical_json == canonical_json) {
+			auto &plan = *it->second;
+			auto tree = std::move(plan.idle.back());
+			plan.idle.pop_back();
+			state.idle_trees--;
+			if (plan.idle.empty()) {
+				state.plans.erase(it->second);
+				state.index.erase(it);
+			}
+			state.statistics.hits++;
+			return lend(std::move(tree), digest, canonical_json);
+		}
+		state.statistics.misses++;
+	}
+
+	return lend(GenericOperator::fromJSON(root), digest, canonical_json);
+}
+
+OperatorPlanCache::Statistics OperatorPlanCache::getStatistics() {
+	auto &state = getState();
+	std::lock_guard<std::mutex> guard(state.mutex);
+	return state.statistics;
+}
+
+void OperatorPlanCache::clear() {
+	std::list<Plan> dropped;
+
+	auto &state = getState();
+	std::lock_guard<std::mutex> guard(state.mutex);
+	dropped.swap(state.plans);
+	state.index.clear();
+	state.idle_trees = 0;
+	state.statistics = Statistics();
+	state.configured = false;
+}
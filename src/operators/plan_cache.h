@@ -0,0 +1,45 @@
+#ifndef OPERATORS_PLAN_CACHE_H
+#define OPERATORS_PLAN_CACHE_H
+
+#include "operators/operator.h"
+
+#include <memory>
+#include <string>
+#include <cstddef>
+
+/**
+ * A bounded cache of operator trees, keyed by a digest of the canonical form of their workflow JSON.
+ *
+ * Parsing a workflow and constructing its operators, including the semantic ids of every node, is repeated
+ * for every request of a tile or a coverage. The cache keeps trees of recently used workflows around and
+ * hands them to the next request of the same workflow, no matter which thread asks for it.
+ *
+ * Operators keep state between calls (e.g. the histogram builds its summary operator on first use), so a
+ * tree is only ever lent to one request at a time. The returned pointer gives the tree back to the cache
+ * when it is released. Concurrent requests of the same workflow build additional trees, which are kept as
+ * well, up to operators.plancache.size trees in total.
+ */
+class OperatorPlanCache {
+	public:
+		struct Statistics {
+			size_t hits = 0;
+			size_t misses = 0;
+		};
+
+		/**
+		 * Returns an operator tree for the given workflow, either an idle one from the cache or a new one.
+		 * Workflows that only differ in whitespace or in the order of their keys share their trees.
+		 * @param json the workflow
+		 * @return the operator tree, which is returned to the cache once the pointer is released
+		 */
+		static std::shared_ptr<GenericOperator> get(const std::string &json);
+
+		static Statistics getStatistics();
+
+		/**
+		 * Drops all idle trees and resets the statistics. The configured size is read again on the next call.
+		 */
+		static void clear();
+};
+
+#endif
@@ -1,6 +1,7 @@
 
 #include "datatypes/raster.h"
 #include "datatypes/plots/histogram.h"
+#include "datatypes/plots/raster_summary.h"
 #include "datatypes/pointcollection.h"
 #include "datatypes/linecollection.h"
 #include "datatypes/polygoncollection.h"
@@ -8,6 +9,7 @@
 #include "raster/profiler.h"
 #include "operators/operator.h"
 #include "util/make_unique.h"
+#include "util/configuration.h"
 
 #include <memory>
 #include <cmath>
@@ -33,6 +35,13 @@ enum class RangeMode {
  *       throws error if unit is unknown
  *     - "data" String value to compute min/max based on the given raster/feature collection data
  *   - buckets: the number of buckets, can be omitted for integral types (then it is estimated via square root of elements).
+ *
+ * Histograms of rasters with range "data" or [min, max] are built from summaries of fixed tiles of the pixel grid
+ * (see RasterSummary), which are cached like any other plot. Overlapping queries in the same resolution therefore
+ * only read the pixels of tiles they do not share. Floating point values are bucketed within the resolution of the
+ * summary. Integer values are bucketed exactly: if their data type and unit allow too many values for the summary to
+ * keep every one, the histogram is computed from the raster directly. This is known from the summary of the first
+ * tile, so no other tiles are summarized in vain.
  */
 class HistogramOperator : public GenericOperator {
 	public:
@@ -46,10 +55,16 @@ class HistogramOperator : public GenericOperator {
 		void writeSemanticParameters(std::ostringstream& stream);
 
 	private:
+#ifndef MAPPING_OPERATOR_STUBS
+		std::unique_ptr<RasterSummary> getTiledSummary(const QueryRectangle &rect, const QueryTools &tools);
+#endif
+
 		RangeMode rangeMode;
 		std::string attribute;
 		unsigned int buckets;
 		double min, max;
+		// computes the summaries of the tiles, created on first use
+		std::unique_ptr<GenericOperator> summary_operator;
 };
 
 
@@ -239,10 +254,107 @@ std::unique_ptr<GenericPlot> createHistogram(SimpleFeatureCollection &features,
 	return std::unique_ptr<GenericPlot>(std::move(histogram));
 }
 
+std::unique_ptr<GenericPlot> createHistogram(const RasterSummary &summary, RangeMode rangeMode, double min, double max, size_t buckets) {
+	if (rangeMode == RangeMode::DATA) {
+		if (summary.getCount() == 0) {
+			min = 0;
+			max = 0;
+		} else {
+			min = summary.getMin();
+			max = summary.getMax();
+		}
+
+		if (min == max) {
+			buckets = 1;
+		}
+	}
+
+	if (buckets == 0) {
+		//estimate via square root
+		buckets = sqrt(summary.getCount() + summary.getNoDataCount());
+
+		//upper limit for discrete types
+		if (summary.isIntegral()) {
+			buckets = std::min((size_t)(max - min + 1), buckets);
+		}
+	}
+
+	return std::unique_ptr<GenericPlot>(summary.toHistogram(buckets, min, max));
+}
+
+/*
+ * Merges the summaries of the tiles of a fixed grid that cover the query. The grid has the pixel size of the query and
+ * is anchored at the origin of the crs, so that every query in the same resolution uses the same tiles.
+ *
+ * Returns nullptr if the query is not aligned to such a grid, or if the raster has integers which the summary cannot
+ * keep exactly.
+ */
+std::unique_ptr<RasterSummary> HistogramOperator::getTiledSummary(const QueryRectangle &rect, const QueryTools &tools) {
+	const int64_t tile_size = Configuration::get<uint32_t>("operators.histogram.summary_tile_size", 512);
+	if (tile_size == 0 || rect.restype != QueryResolution::Type::PIXELS)
+		return nullptr;
+
+	double scale_x = (rect.x2 - rect.x1) / rect.xres;
+	double scale_y = (rect.y2 - rect.y1) / rect.yres;
+	double offset_x = rect.x1 / scale_x;
+	double offset_y = rect.y1 / scale_y;
+	if (std::abs(offset_x - std::round(offset_x)) > 1e-6 || std::abs(offset_y - std::round(offset_y)) > 1e-6)
+		return nullptr;
+	int64_t px1 = std::llround(offset_x), px2 = px1 + rect.xres;
+	int64_t py1 = std::llround(offset_y), py2 = py1 + rect.yres;
+
+	if (summary_operator == nullptr) {
+		// wrap our raster source, its semantic id is a valid operator graph
+		Json::Value semantic_id;
+		Json::Reader reader(Json::Features::strictMode());
+		if (!reader.parse(getSemanticId(), semantic_id))
+			throw OperatorException("HistogramOperator: could not parse semantic id");
+
+		Json::Value summary_json(Json::objectValue);
+		summary_json["type"] = "raster_summary";
+		summary_json["params"] = Json::Value(Json::objectValue);
+		summary_json["sources"]["raster"].append(semantic_id["sources"]["raster"][0]);
+		summary_operator = GenericOperator::fromJSON(summary_json, getDepth() + 1);
+	}
+
+	auto floorDiv = [](int64_t a, int64_t b) -> int64_t {
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	};
+
+	auto summary = make_unique<RasterSummary>();
+	for (int64_t ty = floorDiv(py1, tile_size); ty * tile_size < py2; ty++) {
+		for (int64_t tx = floorDiv(px1, tile_size); tx * tile_size < px2; tx++) {
+			// tiles on the border of the query are cut, these are cached as well but are rarely reused
+			int64_t x1 = std::max(px1, tx * tile_size), x2 = std::min(px2, (tx + 1) * tile_size);
+			int64_t y1 = std::max(py1, ty * tile_size), y2 = std::min(py2, (ty + 1) * tile_size);
+
+			QueryRectangle tile_rect(
+				SpatialReference(rect.crsId, x1 * scale_x, y1 * scale_y, x2 * scale_x, y2 * scale_y),
+				rect,
+				QueryResolution::pixels(x2 - x1, y2 - y1)
+			);
+			auto tile_summary = summary_operator->getCachedPlot(tile_rect, tools);
+			auto &raster_summary = dynamic_cast<RasterSummary &>(*tile_summary);
+			if (raster_summary.isIntegral() && !raster_summary.staysExact())
+				return nullptr;
+			summary->merge(raster_summary);
+		}
+	}
+	return summary;
+}
+
 std::unique_ptr<GenericPlot> HistogramOperator::getPlot(const QueryRectangle &rect, const QueryTools &tools) {
 	Profiler::Profiler p("HISTOGRAM_OPERATOR");
 
 	if(getRasterSourceCount() == 1) {
+		// the unit is only known from the raster itself
+		if (rangeMode != RangeMode::UNIT) {
+			auto summary = getTiledSummary(rect, tools);
+			// values outside of the unit can still make the summary inexact
+			if (summary != nullptr && (summary->isExact() || !summary->isIntegral()))
+				return createHistogram(*summary, rangeMode, min, max, buckets);
+		}
+
 		auto raster = getRasterFromSource(0, rect, tools);
 
 		return callUnaryOperatorFunc<histogram>(raster.get(), rangeMode, min, max, buckets);
@@ -0,0 +1,48 @@
+
+#include "datatypes/raster.h"
+#include "datatypes/plots/raster_summary.h"
+#include "raster/profiler.h"
+#include "operators/operator.h"
+
+#include <memory>
+#include <json/json.h>
+
+/**
+ * This operator summarizes the values of a raster: count, no data count, min, max, mean, standard deviation and
+ * approximate quartiles.
+ *
+ * The result is a RasterSummary, which can be merged with the summaries of other extents. The histogram operator
+ * uses it to build histograms of large extents from cached summaries of tiles.
+ *
+ * There are no parameters.
+ */
+class RasterSummaryOperator : public GenericOperator {
+	public:
+		RasterSummaryOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
+		virtual ~RasterSummaryOperator();
+
+#ifndef MAPPING_OPERATOR_STUBS
+		virtual std::unique_ptr<GenericPlot> getPlot(const QueryRectangle &rect, const QueryTools &tools);
+#endif
+};
+
+
+RasterSummaryOperator::RasterSummaryOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params) : GenericOperator(sourcecounts, sources) {
+	assumeSources(1);
+}
+
+RasterSummaryOperator::~RasterSummaryOperator() {
+}
+REGISTER_OPERATOR(RasterSummaryOperator, "raster_summary");
+
+
+#ifndef MAPPING_OPERATOR_STUBS
+std::unique_ptr<GenericPlot> RasterSummaryOperator::getPlot(const QueryRectangle &rect, const QueryTools &tools) {
+	// the summary must cover exactly the requested pixels, so that summaries of neighbouring tiles can be merged
+	auto query_mode = rect.restype == QueryResolution::Type::PIXELS ? RasterQM::EXACT : RasterQM::LOOSE;
+	auto raster = getRasterFromSource(0, rect, tools, query_mode);
+
+	Profiler::Profiler p("RASTER_SUMMARY_OPERATOR");
+	return std::unique_ptr<GenericPlot>(new RasterSummary(*raster));
+}
+#endif
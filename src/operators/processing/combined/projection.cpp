@@ -5,22 +5,46 @@
 #include "operators/operator.h"
 #include "util/gdal.h"
 #include "util/make_unique.h"
+#include "util/enumconverter.h"
+#include "util/configuration.h"
+#include "util/reprojection_grid.h"
 
 #include <memory>
 #include <sstream>
 #include <cmath>
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
 #include <json/json.h>
 #include <geos/geom/util/GeometryTransformer.h>
 #include "datatypes/pointcollection.h"
 #include "datatypes/polygoncollection.h"
 
+enum class Resampling {
+	NEAREST, BILINEAR
+};
+
+const std::vector<std::pair<Resampling, std::string> > ResamplingMap {
+	std::make_pair(Resampling::NEAREST, "nearest"),
+	std::make_pair(Resampling::BILINEAR, "bilinear")
+};
+
+static EnumConverter<Resampling> ResamplingConverter(ResamplingMap);
+
+static const double DEFAULT_ERROR_THRESHOLD = 0.125;
+
 /**
  * Operator that projects raster and feature data to a given projection
  *
+ * Rasters are not transformed pixel by pixel. Only a grid of control points is projected, the
+ * source coordinates of all other pixels are interpolated.
+ *
  * Parameters:
  * - src_crsId: the crsId of the source projection
  * - dest_crsId: the crsId of the destination projection
+ * - resampling: "nearest" (default) or "bilinear", only used for rasters
+ * - error_threshold: the maximum interpolation error in source pixels, defaults to 0.125
  */
 class ProjectionOperator : public GenericOperator {
 	public:
@@ -38,6 +62,8 @@ class ProjectionOperator : public GenericOperator {
 	private:
 		QueryRectangle projectQueryRectangle(const QueryRectangle &rect, const GDAL::CRSTransformer &transformer);
 		CrsId src_crsId, dest_crsId;
+		Resampling resampling;
+		double error_threshold;
 };
 
 
@@ -56,9 +82,13 @@ class MeteosatLatLongOperator : public GenericOperator {
 ProjectionOperator::ProjectionOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params) :
 		GenericOperator(sourcecounts, sources),
 		src_crsId(CrsId::from_srs_string(params["src_projection"].asString())),
-		dest_crsId(CrsId::from_srs_string(params["dest_projection"].asString())) {
+		dest_crsId(CrsId::from_srs_string(params["dest_projection"].asString())),
+		resampling(ResamplingConverter.from_string(params.get("resampling", "nearest").asString())),
+		error_threshold(params.get("error_threshold", DEFAULT_ERROR_THRESHOLD).asDouble()) {
 	if (src_crsId == CrsId::unreferenced() || dest_crsId == CrsId::unreferenced())
 		throw OperatorException("Unknown EPSG");
+	if (!(error_threshold >= 0))
+		throw OperatorException("Projection: error_threshold must not be negative");
 	assumeSources(1);
 }
 
@@ -67,13 +97,19 @@ ProjectionOperator::~ProjectionOperator() {
 REGISTER_OPERATOR(ProjectionOperator, "projection");
 
 void ProjectionOperator::writeSemanticParameters(std::ostringstream &stream) {
-	stream << "{\"src_projection\":" << src_crsId.to_string() << "\", \"dest_projection\":" << dest_crsId.to_string() << "\"}";
+	stream << "{\"src_projection\":" << src_crsId.to_string() << "\", \"dest_projection\":" << dest_crsId.to_string() << "\"";
+	// only written if set, so the ids of existing workflows stay the same
+	if (resampling != Resampling::NEAREST)
+		stream << ", \"resampling\":\"" << ResamplingConverter.to_string(resampling) << "\"";
+	if (error_threshold != DEFAULT_ERROR_THRESHOLD)
+		stream << ", \"error_threshold\":" << error_threshold;
+	stream << "}";
 }
 
 #ifndef MAPPING_OPERATOR_STUBS
 template<typename T>
 struct raster_projection {
-	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster_src, const GDAL::CRSTransformer *transformer, const SpatioTemporalReference &stref_dest, uint32_t width, uint32_t height) {
+	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster_src, const GDAL::CRSTransformer *transformer, const SpatioTemporalReference &stref_dest, uint32_t width, uint32_t height, Resampling resampling, double error_threshold) {
 		raster_src->setRepresentation(GenericRaster::Representation::CPU);
 
 		DataDescription out_dd = raster_src->dd;
@@ -84,25 +120,84 @@ struct raster_projection {
 
 		T nodata = (T) out_dd.no_data;
 
-		for (uint32_t y=0;y<raster_dest->height;y++) {
-			for (uint32_t x=0;x<raster_dest->width;x++) {
-				double px = raster_dest->PixelToWorldX(x);
-				double py = raster_dest->PixelToWorldY(y);
-				double pz = 0;
-
-				if (!transformer->transform(px, py, pz)) {
-					raster_dest->set(x, y, nodata);
-					continue;
+		// maps destination pixels to fractional source pixels in batches
+		auto transform = [&](size_t count, double *x, double *y, int *success) {
+			for (size_t i = 0; i < count; i++) {
+				x[i] = raster_dest->stref.x1 + (x[i] + 0.5) * raster_dest->pixel_scale_x;
+				y[i] = raster_dest->stref.y1 + (y[i] + 0.5) * raster_dest->pixel_scale_y;
+			}
+			transformer->transform(count, x, y, success);
+			for (size_t i = 0; i < count; i++) {
+				x[i] = (x[i] - raster_src->stref.x1) / raster_src->pixel_scale_x;
+				y[i] = (y[i] - raster_src->stref.y1) / raster_src->pixel_scale_y;
+			}
+		};
+		ReprojectionGrid grid(raster_dest->width, raster_dest->height, transform, error_threshold);
+
+		// The grid is read-only now, so the rows can be sampled in parallel
+		auto sample_rows = [&](uint32_t y_begin, uint32_t y_end) {
+			std::vector<double> src_x(raster_dest->width), src_y(raster_dest->width);
+			std::unique_ptr<bool[]> valid(new bool[raster_dest->width]);
+			for (uint32_t y = y_begin; y < y_end; y++) {
+				grid.getRow(y, src_x.data(), src_y.data(), valid.get());
+				for (uint32_t x = 0; x < raster_dest->width; x++) {
+					if (!valid[x])
+						raster_dest->set(x, y, nodata);
+					else if (resampling == Resampling::BILINEAR)
+						raster_dest->set(x, y, sampleBilinear(raster_src, src_x[x], src_y[x], nodata));
+					else
+						raster_dest->set(x, y, raster_src->getSafe(std::floor(src_x[x]), std::floor(src_y[x]), nodata));
 				}
-
-				auto tx = raster_src->WorldToPixelX(px);
-				auto ty = raster_src->WorldToPixelY(py);
-				raster_dest->set(x, y, raster_src->getSafe(tx, ty, nodata));
 			}
+		};
+
+		uint32_t num_threads = Configuration::get<uint32_t>("operators.projection.threads", 0);
+		if (num_threads == 0)
+			num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+		// small rasters are not worth the threads
+		const uint32_t min_rows_per_thread = 64;
+		num_threads = std::max(std::min(num_threads, raster_dest->height / min_rows_per_thread), 1u);
+
+		std::vector<std::thread> threads;
+		uint32_t rows_per_thread = (raster_dest->height + num_threads - 1) / num_threads;
+		for (uint32_t t = 1; t < num_threads; t++) {
+			uint32_t y_begin = t * rows_per_thread;
+			uint32_t y_end = std::min(y_begin + rows_per_thread, raster_dest->height);
+			if (y_begin < y_end)
+				threads.emplace_back(sample_rows, y_begin, y_end);
 		}
+		sample_rows(0, std::min(rows_per_thread, raster_dest->height));
+		for (auto &thread : threads)
+			thread.join();
 
 		return raster_dest_guard;
 	}
+
+	/*
+	 * Interpolates between the four pixels surrounding the given position. Falls back
+	 * to the nearest pixel at the border and next to nodata values.
+	 */
+	static T sampleBilinear(const Raster2D<T> *raster, double px, double py, T nodata) {
+		// pixel centers are at .5
+		double fx = px - 0.5, fy = py - 0.5;
+		int64_t x0 = std::floor(fx), y0 = std::floor(fy);
+		if (x0 < 0 || y0 < 0 || x0 + 1 >= raster->width || y0 + 1 >= raster->height)
+			return raster->getSafe(std::floor(px), std::floor(py), nodata);
+
+		T v00 = raster->get(x0, y0), v10 = raster->get(x0 + 1, y0);
+		T v01 = raster->get(x0, y0 + 1), v11 = raster->get(x0 + 1, y0 + 1);
+		auto &dd = raster->dd;
+		if (dd.is_no_data(v00) || dd.is_no_data(v10) || dd.is_no_data(v01) || dd.is_no_data(v11))
+			return raster->getSafe(std::floor(px), std::floor(py), nodata);
+
+		double wx = fx - x0, wy = fy - y0;
+		double top = v00 + (v10 - (double) v00) * wx;
+		double bottom = v01 + (v11 - (double) v01) * wx;
+		double value = top + (bottom - top) * wy;
+		if (std::is_integral<T>::value)
+			value = std::round(value);
+		return (T) value;
+	}
 };
 
 //GenericRaster *ProjectionOperator::execute(int timestamp, double x1, double y1, double x2, double y2, int xres, int yres) {
@@ -114,81 +209,88 @@ std::unique_ptr<GenericRaster> ProjectionOperator::getRaster(const QueryRectangl
 		return getRasterFromSource(0, rect, tools);
 	}
 
-	GDAL::CRSTransformer transformer(dest_crsId, src_crsId);
-    QueryRectangle src_rect = rect.project(src_crsId, transformer);
+	auto transformer = GDAL::CRSTransformer::get(dest_crsId, src_crsId);
+	QueryRectangle src_rect = rect.project(src_crsId, *transformer);
 
 	auto raster_in = getRasterFromSource(0, src_rect, tools);
 
 	if (src_crsId != raster_in->stref.crsId)
 		throw OperatorException("ProjectionOperator: Source Raster not in expected projection");
 
-	return callUnaryOperatorFunc<raster_projection>(raster_in.get(), &transformer, rect, rect.xres, rect.yres);
+	return callUnaryOperatorFunc<raster_projection>(raster_in.get(), transformer.get(), rect, rect.xres, rect.yres, resampling, error_threshold);
 }
 
 
-std::unique_ptr<PointCollection> ProjectionOperator::getPointCollection(const QueryRectangle &rect, const QueryTools &tools) {
-	if (dest_crsId != rect.crsId)
-		throw OperatorException("Projection: asked to transform to a different CRS than specified in QueryRectangle");
-	if (src_crsId == dest_crsId)
-		return getPointCollectionFromSource(0, rect, tools);
-
-
-	// Need to transform "backwards" to project the query rectangle..
-	GDAL::CRSTransformer qrect_transformer(dest_crsId, src_crsId);
-	QueryRectangle src_rect = rect.project(src_crsId, qrect_transformer);
-
-	// ..but "forward" to project the points
-	GDAL::CRSTransformer transformer(src_crsId, dest_crsId);
-
-
-	auto points_in = getPointCollectionFromSource(0, src_rect, tools);
+/*
+ * Projects all coordinates of the collection in one batch. Features with coordinates that could not
+ * be projected or that do not intersect the query rectangle afterwards are removed.
+ * coordinateRange returns the range of a feature's coordinates in the coordinate vector.
+ */
+template<typename Collection, typename CoordinateRange>
+static std::unique_ptr<Collection> projectFeatures(std::unique_ptr<Collection> collection, const CrsId &src_crsId, const CrsId &dest_crsId, const QueryRectangle &rect, CoordinateRange coordinateRange) {
+	auto transformer = GDAL::CRSTransformer::get(src_crsId, dest_crsId);
 
-	if (src_crsId != points_in->stref.crsId) {
-		std::ostringstream msg;
-		msg << "ProjectionOperator: Source Points not in expected projection, expected " << src_crsId.to_string() << " got " << points_in->stref.crsId.to_string();
-		throw OperatorException(msg.str());
-	}
+	std::vector<bool> failed;
+	transformer->transform(collection->coordinates, failed);
 
-	std::vector<bool> keep(points_in->getFeatureCount(), true);
+	size_t feature_count = collection->getFeatureCount();
+	std::vector<bool> keep(feature_count, true);
 	bool has_filter = false;
 
-	for(auto feature : *points_in){
-		//project points in feature
-		for(auto& coordinate : feature){
-			if (!transformer.transform(coordinate.x, coordinate.y)) {
+	for (size_t feature = 0; feature < feature_count; feature++) {
+		auto range = coordinateRange(*collection, feature);
+		for (size_t i = range.first; i < range.second; i++) {
+			if (failed[i]) {
 				//projection failed
 				keep[feature] = false;
-				has_filter = true;
 				break;
 			}
 		}
 
 		//check if feature is still in query rectangle
-		if(keep[feature] && !points_in->featureIntersectsRectangle(feature, rect.x1, rect.y1, rect.x2, rect.y2)) {
+		if (keep[feature] && !collection->featureIntersectsRectangle(feature, rect.x1, rect.y1, rect.x2, rect.y2))
 			keep[feature] = false;
-			has_filter = true;
-		}
+
+		has_filter |= !keep[feature];
 	}
 
-	points_in->replaceSTRef(rect);
+	collection->replaceSTRef(rect);
 
 	if (!has_filter)
-		return points_in;
+		return collection;
 	else
-		return points_in->filter(keep);
+		return collection->filter(keep);
 }
 
+std::unique_ptr<PointCollection> ProjectionOperator::getPointCollection(const QueryRectangle &rect, const QueryTools &tools) {
+	if (dest_crsId != rect.crsId)
+		throw OperatorException("Projection: asked to transform to a different CRS than specified in QueryRectangle");
+	if (src_crsId == dest_crsId)
+		return getPointCollectionFromSource(0, rect, tools);
+
 
+	// Need to transform "backwards" to project the query rectangle..
+	QueryRectangle src_rect = rect.project(src_crsId);
 
+	auto points_in = getPointCollectionFromSource(0, src_rect, tools);
+
+	if (src_crsId != points_in->stref.crsId) {
+		std::ostringstream msg;
+		msg << "ProjectionOperator: Source Points not in expected projection, expected " << src_crsId.to_string() << " got " << points_in->stref.crsId.to_string();
+		throw OperatorException(msg.str());
+	}
+
+	// ..but "forward" to project the points
+	return projectFeatures(std::move(points_in), src_crsId, dest_crsId, rect, [](const PointCollection &points, size_t feature) {
+		return std::make_pair(points.start_feature[feature], points.start_feature[feature+1]);
+	});
+}
 
 std::unique_ptr<LineCollection> ProjectionOperator::getLineCollection(const QueryRectangle &rect, const QueryTools &tools) {
 	if (dest_crsId != rect.crsId)
 		throw OperatorException("Projection: asked to transform to a different CRS than specified in QueryRectangle");
 
-	GDAL::CRSTransformer qrect_transformer(dest_crsId, src_crsId);
-	QueryRectangle src_rect = rect.project(src_crsId, qrect_transformer);
-
-	GDAL::CRSTransformer transformer(src_crsId, dest_crsId);
+	QueryRectangle src_rect = rect.project(src_crsId);
 
 	auto lines_in = getLineCollectionFromSource(0, src_rect, tools);
 
@@ -198,49 +300,16 @@ std::unique_ptr<LineCollection> ProjectionOperator::getLineCollection(const Quer
 		throw OperatorException(msg.str());
 	}
 
-	std::vector<bool> keep(lines_in->getFeatureCount(), true);
-	bool has_filter = false;
-
-	for(auto feature : *lines_in){
-		//project lines in feature
-		for(auto line : feature){
-			//project points in line
-			for(auto& coordinate : line){
-				if (!transformer.transform(coordinate.x, coordinate.y)) {
-					//projection failed
-					keep[feature] = false;
-					has_filter = true;
-					break;
-				}
-			}
-			if(!keep[feature])
-				break;
-		}
-
-		//check if feature is still in query rectangle
-		if(keep[feature] && !lines_in->featureIntersectsRectangle(feature, rect.x1, rect.y1, rect.x2, rect.y2)){
-			keep[feature] = false;
-			has_filter = true;
-		}
-	}
-
-	lines_in->replaceSTRef(rect);
-
-	if (!has_filter)
-		return lines_in;
-	else
-		return lines_in->filter(keep);
+	return projectFeatures(std::move(lines_in), src_crsId, dest_crsId, rect, [](const LineCollection &lines, size_t feature) {
+		return std::make_pair(lines.start_line[lines.start_feature[feature]], lines.start_line[lines.start_feature[feature+1]]);
+	});
 }
 
 std::unique_ptr<PolygonCollection> ProjectionOperator::getPolygonCollection(const QueryRectangle &rect, const QueryTools &tools) {
 	if (dest_crsId != rect.crsId)
 		throw OperatorException("Projection: asked to transform to a different CRS than specified in QueryRectangle");
 
-	GDAL::CRSTransformer qrect_transformer(dest_crsId, src_crsId);
-	QueryRectangle src_rect = rect.project(src_crsId, qrect_transformer);
-
-	GDAL::CRSTransformer transformer(src_crsId, dest_crsId);
-
+	QueryRectangle src_rect = rect.project(src_crsId);
 
 	auto polygons_in = getPolygonCollectionFromSource(0, src_rect, tools);
 
@@ -250,43 +319,10 @@ std::unique_ptr<PolygonCollection> ProjectionOperator::getPolygonCollection(cons
 		throw OperatorException(msg.str());
 	}
 
-	std::vector<bool> keep(polygons_in->getFeatureCount(), true);
-	bool has_filter = false;
-
-	for(auto feature : *polygons_in){
-		//project polygons in feature
-		for(auto polygon : feature){
-			//project rings in polygon
-			for(auto ring : polygon){
-				//project points in ring
-				for(auto& coordinate : ring){
-					if (!transformer.transform(coordinate.x, coordinate.y)) {
-						//projection failed
-						keep[feature] = false;
-						has_filter = true;
-						break;
-					}
-				}
-				if(!keep[feature])
-					break;
-			}
-			if(!keep[feature])
-				break;
-		}
-
-		//check if feature is still in query rectangle
-		if(keep[feature] && !polygons_in->featureIntersectsRectangle(feature, rect.x1, rect.y1, rect.x2, rect.y2)){
-			keep[feature] = false;
-			has_filter = true;
-		}
-	}
-
-	polygons_in->replaceSTRef(rect);
-
-	if (!has_filter)
-		return polygons_in;
-	else
-		return polygons_in->filter(keep);
+	return projectFeatures(std::move(polygons_in), src_crsId, dest_crsId, rect, [](const PolygonCollection &polygons, size_t feature) {
+		return std::make_pair(polygons.start_ring[polygons.start_polygon[polygons.start_feature[feature]]],
+			polygons.start_ring[polygons.start_polygon[polygons.start_feature[feature+1]]]);
+	});
 }
 #endif
 
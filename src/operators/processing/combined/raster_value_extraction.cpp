@@ -1,10 +1,12 @@
 #include "datatypes/raster.h"
 #include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/typejuggling.h"
 #include "datatypes/pointcollection.h"
 #include "raster/profiler.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
-#include "util/rasterize_polygons.h"
+#include "util/zonal_statistics.h"
+#include "util/configuration.h"
 
 #include <json/json.h>
 #include <algorithm>
@@ -18,6 +20,8 @@
  *          A name has to be specified for each input raster
  * - xResolution: the x resolution for the input rasters in pixels
  * - yResolution: the y resolution for the input rasters in pixels
+ * - percentiles: (optional) array of percentiles between 0 and 100 that are additionally computed for
+ *                polygon features, e.g. [50, 90] adds the attributes name_p50 and name_p90
  */
 class RasterValueExtractionOperator : public GenericOperator {
     public:
@@ -41,6 +45,7 @@ class RasterValueExtractionOperator : public GenericOperator {
         std::vector<std::string> names;
         uint32_t x_resolution;
         uint32_t y_resolution;
+        std::vector<double> percentiles;
 };
 
 RasterValueExtractionOperator::RasterValueExtractionOperator(int sourcecounts[], GenericOperator *sources[],
@@ -73,6 +78,17 @@ RasterValueExtractionOperator::RasterValueExtractionOperator(int sourcecounts[],
         x_resolution = params["xResolution"].asUInt();
         y_resolution = params["yResolution"].asUInt();
     }
+
+    if (params.isMember("percentiles")) {
+        auto &percentiles_param = params["percentiles"];
+        if (!percentiles_param.isArray())
+            throw OperatorException("raster_value_extraction: percentiles parameter invalid");
+        for (auto &percentile : percentiles_param) {
+            if (!percentile.isNumeric() || percentile.asDouble() < 0 || percentile.asDouble() > 100)
+                throw OperatorException("raster_value_extraction: percentiles must be numbers between 0 and 100");
+            percentiles.push_back(percentile.asDouble());
+        }
+    }
 }
 
 RasterValueExtractionOperator::~RasterValueExtractionOperator() = default;
@@ -87,7 +103,17 @@ void RasterValueExtractionOperator::writeSemanticParameters(std::ostringstream &
     stream.seekp(((long) stream.tellp()) - 1); // remove last comma
     stream << "],";
     stream << "\"x_resolution\": " << x_resolution << ",";
-    stream << "\"y_resolution\": " << y_resolution << "}";
+    stream << "\"y_resolution\": " << y_resolution;
+    if (!percentiles.empty()) {
+        stream << ",\"percentiles\":[";
+        for (size_t i = 0; i < percentiles.size(); ++i) {
+            if (i > 0)
+                stream << ",";
+            stream << percentiles[i];
+        }
+        stream << "]";
+    }
+    stream << "}";
 }
 
 
@@ -222,6 +248,17 @@ RasterValueExtractionOperator::getPointCollection(const QueryRectangle &rect, co
     return points;
 }
 
+/**
+ * Attribute suffix of a percentile, e.g. 50 for 50 and 99_9 for 99.9
+ */
+static auto percentile_suffix(double percentile) -> std::string {
+    std::ostringstream stream;
+    stream << percentile;
+    auto suffix = stream.str();
+    std::replace(suffix.begin(), suffix.end(), '.', '_');
+    return suffix;
+}
+
 auto RasterValueExtractionOperator::getPolygonCollection(const QueryRectangle &rect,
                                                          const QueryTools &tools) -> std::unique_ptr<PolygonCollection> {
     auto polygon_collection = getPolygonCollectionFromSource(0, rect, tools);
@@ -236,6 +273,8 @@ auto RasterValueExtractionOperator::getPolygonCollection(const QueryRectangle &r
             QueryResolution::pixels(this->x_resolution, this->y_resolution)
     };
 
+    const auto threads = Configuration::get<uint32_t>("operators.rastervalueextraction.threads", 0);
+
     // loop through rasters
     for (int raster_source_id = 0; raster_source_id < this->names.size(); ++raster_source_id) {
         const std::string &name_prefix = this->names[raster_source_id];
@@ -249,60 +288,27 @@ auto RasterValueExtractionOperator::getPolygonCollection(const QueryRectangle &r
             );
         }
 
-        // loop through features
-        for (const auto feature : const_cast<const PolygonCollection &>(*polygon_collection)) {
-            const auto raster_stat_cells = RasterizePolygons{raster_rect, feature}.get_raster();
-
-            // gather stats from raster (Welford's algorithm)
-            size_t n = 0;
-            double mean = 0;
-            double M2 = 0;
-            double min = std::numeric_limits<double>::infinity();
-            double max = -std::numeric_limits<double>::infinity();
-
-            bool ignore_nan = true; // TODO: extract as parameter
-            bool has_nan = false;
-
-            for (uint32_t x = 0; x < raster_stat_cells->width; ++x) {
-                for (uint32_t y = 0; y < raster_stat_cells->height; ++y) {
-                    if (raster_stat_cells->get(x, y) > 0) { // include into stats
-                        double value = raster->getAsDouble(x, y);
-
-                        if (std::isnan(value)) {
-                            has_nan = true;
-                            if (ignore_nan) {
-                                continue;
-                            } else {
-                                goto out_of_loop;
-                            }
-                        }
-
-                        ++n;
-                        double delta = value - mean;
-                        mean += delta / n;
-                        double delta2 = value - mean;
-                        M2 += delta * delta2;
-
-                        if (value > max) {
-                            max = value;
-                        }
-                        if (value < min) {
-                            min = value;
-                        }
-                    }
-                }
-            }
-            out_of_loop:;
+        const auto statistics = ZonalStatistics{percentiles}.compute(*raster, *polygon_collection, threads);
+
+        auto &mean = polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "mean"));
+        auto &stdev = polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "stdev"));
+        auto &min = polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "min"));
+        auto &max = polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "max"));
+        for (size_t feature = 0; feature < statistics.size(); ++feature) {
+            mean.set(feature, statistics[feature].mean);
+            stdev.set(feature, statistics[feature].stdev);
+            min.set(feature, statistics[feature].min);
+            max.set(feature, statistics[feature].max);
+        }
 
-            if (n == 0 || (has_nan && !ignore_nan)) {
-                mean = M2 = min = max = std::numeric_limits<double>::quiet_NaN();
+        for (size_t i = 0; i < percentiles.size(); ++i) {
+            auto &attribute = polygon_collection->feature_attributes.addNumericAttribute(
+                    concat(name_prefix, "_p", percentile_suffix(percentiles[i])),
+                    raster->dd.unit
+            );
+            for (size_t feature = 0; feature < statistics.size(); ++feature) {
+                attribute.set(feature, statistics[feature].percentiles[i]);
             }
-
-            polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "mean")).set(feature, mean);
-            double variance = M2 / (n - 1);
-            polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "stdev")).set(feature, std::sqrt(variance));
-            polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "min")).set(feature, min);
-            polygon_collection->feature_attributes.numeric(concat(name_prefix, "_", "max")).set(feature, max);
         }
     }
 
@@ -4,7 +4,7 @@
 #include "operators/operator.h"
 #include "raster/opencl.h"
 #include "datatypes/polygoncollection.h"
-#include "util/rasterize_polygons.h"
+#include "util/zonal_statistics.h"
 
 #include <json/json.h>
 #include <algorithm>
@@ -53,23 +53,23 @@ auto RasterizePolygonOperator::getRaster(const QueryRectangle &rect,
     QueryRectangle vector_rect{rect, rect, QueryResolution::none()};
     const auto polygon_collection = getPolygonCollectionFromSource(0, vector_rect, tools);
 
-    if (polygon_collection->getFeatureCount() == 0) {
-        // create empty raster
-        Unit unit = Unit::unknown();
-        size_t number_of_polygons = 0; // TODO: need total number of features on whole extent
-        unit.setMinMax(0, number_of_polygons);
-
-        DataDescription data_description(GDT_UInt32, unit, true, 0);
-        return make_unique<Raster2D<uint32_t>>(
-                data_description,
-                rect,
-                rect.xres,
-                rect.yres);
-    } else {
-        RasterizePolygons rasterizePolygons{rect, *polygon_collection};
-
-        return rasterizePolygons.get_raster();
+    // pixels covered by any feature are 1, all others 0
+    Unit unit = Unit::unknown();
+    unit.setMinMax(0, 1);
+    DataDescription data_description(GDT_Byte, unit, true, 0);
+
+    auto raster = make_unique<Raster2D<uint8_t>>(data_description, rect, rect.xres, rect.yres);
+    raster->clear(0);
+
+    // the features are rasterized as pixel spans within their own bounding boxes
+    for (size_t feature = 0; feature < polygon_collection->getFeatureCount(); ++feature) {
+        for (const auto &span : ZonalStatistics::feature_spans(*raster, *polygon_collection, feature)) {
+            uint8_t *row = raster->data + (size_t) span.y * raster->width;
+            std::fill(row + span.x_begin, row + span.x_end, 1);
+        }
     }
+
+    return std::unique_ptr<GenericRaster>(std::move(raster));
 }
 
 #endif
@@ -5,6 +5,8 @@
 #include "raster/opencl.h"
 #include "operators/operator.h"
 #include "msg_constants.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "util/configuration.h"
 
 #include <limits>
 #include <memory>
@@ -38,30 +40,33 @@ REGISTER_OPERATOR(MeteosatCo2CorrectionOperator, "meteosat_co2_correction");
 
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MeteosatCo2CorrectionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATCo2CorrectionOperator: cannot be executed without OpenCL support");
-}
-#else
-
+#ifndef MAPPING_NO_OPENCL
 #include "operators/processing/meteosat/co2correction.cl.h"
+#endif
 
 std::unique_ptr<GenericRaster> MeteosatCo2CorrectionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+#ifndef MAPPING_NO_OPENCL
 	RasterOpenCL::init();
+#endif
 	auto raster_bt039 = getRasterFromSource(0, rect, tools, RasterQM::LOOSE);
 	QueryRectangle exact_rect(*raster_bt039);
 	auto raster_bt108 = getRasterFromSource(1, exact_rect, tools, RasterQM::EXACT);
 	auto raster_bt134 = getRasterFromSource(2, exact_rect, tools, RasterQM::EXACT);
 
+	//TODO: check if raster lcrs are equal
+	DataDescription out_dd(GDT_Float32, raster_bt039->dd.unit); // no no_data //raster->dd.has_no_data, output_no_data);
+	if (raster_bt039->dd.has_no_data||raster_bt108->dd.has_no_data||raster_bt134->dd.has_no_data)
+		out_dd.addNoData();
+
+#ifdef MAPPING_NO_OPENCL
+	Profiler::Profiler p("MSATCO2CORRECTION_OPERATOR");
+	return msg::cpu::co2Correction(*raster_bt039, *raster_bt108, *raster_bt134, out_dd, Configuration::get<uint32_t>("operators.meteosat.threads", 0));
+#else
 	Profiler::Profiler p("CL_MSATCO2CORRECTION_OPERATOR");
 	raster_bt039->setRepresentation(GenericRaster::OPENCL);
 	raster_bt108->setRepresentation(GenericRaster::OPENCL);
 	raster_bt134->setRepresentation(GenericRaster::OPENCL);
 
-	//TODO: check if raster lcrs are equal
-	DataDescription out_dd(GDT_Float32, raster_bt039->dd.unit); // no no_data //raster->dd.has_no_data, output_no_data);
-	if (raster_bt039->dd.has_no_data||raster_bt108->dd.has_no_data||raster_bt134->dd.has_no_data)
-		out_dd.addNoData();
 	auto raster_out = GenericRaster::create(out_dd, *raster_bt039, GenericRaster::Representation::OPENCL);
 
 	RasterOpenCL::CLProgram prog;
@@ -73,6 +78,6 @@ std::unique_ptr<GenericRaster> MeteosatCo2CorrectionOperator::getRaster(const Qu
 	prog.run();
 
 	return raster_out;
-}
 #endif
+}
 #endif
@@ -0,0 +1,450 @@
+
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "datatypes/raster/raster_priv.h"
+#include "util/parallel_for.h"
+#include "util/exceptions.h"
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+
+// the number of rows handed to a thread at once
+static const size_t ROWS_PER_CHUNK = 16;
+
+static double radians(double degrees) {
+	return degrees * (M_PI / 180.0);
+}
+
+static double degrees(double radians) {
+	return radians * (180.0 / M_PI);
+}
+
+
+template<typename T>
+static void readRow(Raster2D<T> *raster, uint32_t y, double *values, uint8_t *no_data) {
+	const T *row = raster->data + (size_t) y * raster->width;
+	const bool has_no_data = raster->dd.has_no_data, floating = std::is_floating_point<T>::value;
+	const double no_data_value = raster->dd.no_data;
+	for (uint32_t x = 0; x < raster->width; x++) {
+		values[x] = (double) row[x];
+		no_data[x] = has_no_data && (values[x] == no_data_value || (floating && std::isnan(values[x])));
+	}
+}
+
+/*
+ * Reads a row of a raster of any type as doubles and flags no data like the ISNODATA macros of the kernels
+ */
+static void readRow(GenericRaster &raster, uint32_t y, double *values, uint8_t *no_data) {
+	switch (raster.dd.datatype) {
+		case GDT_Byte: readRow((Raster2D<uint8_t> *) &raster, y, values, no_data); break;
+		case GDT_Int16: readRow((Raster2D<int16_t> *) &raster, y, values, no_data); break;
+		case GDT_UInt16: readRow((Raster2D<uint16_t> *) &raster, y, values, no_data); break;
+		case GDT_Int32: readRow((Raster2D<int32_t> *) &raster, y, values, no_data); break;
+		case GDT_UInt32: readRow((Raster2D<uint32_t> *) &raster, y, values, no_data); break;
+		case GDT_Float32: readRow((Raster2D<float> *) &raster, y, values, no_data); break;
+		case GDT_Float64: readRow((Raster2D<double> *) &raster, y, values, no_data); break;
+		default: throw MetadataException("Cannot call operator with this data type");
+	}
+}
+
+template<typename T>
+static void writeRow(Raster2D<T> *raster, uint32_t y, const double *values) {
+	T *row = raster->data + (size_t) y * raster->width;
+	for (uint32_t x = 0; x < raster->width; x++)
+		row[x] = (T) values[x];
+}
+
+static void writeRow(GenericRaster &raster, uint32_t y, const double *values) {
+	switch (raster.dd.datatype) {
+		case GDT_Byte: writeRow((Raster2D<uint8_t> *) &raster, y, values); break;
+		case GDT_Int16: writeRow((Raster2D<int16_t> *) &raster, y, values); break;
+		case GDT_UInt16: writeRow((Raster2D<uint16_t> *) &raster, y, values); break;
+		case GDT_Int32: writeRow((Raster2D<int32_t> *) &raster, y, values); break;
+		case GDT_UInt32: writeRow((Raster2D<uint32_t> *) &raster, y, values); break;
+		case GDT_Float32: writeRow((Raster2D<float> *) &raster, y, values); break;
+		case GDT_Float64: writeRow((Raster2D<double> *) &raster, y, values); break;
+		default: throw MetadataException("Cannot call operator with this data type");
+	}
+}
+
+/*
+ * Creates the output raster and calls fn(y, in, no_data, out) for every row of the input
+ */
+static std::unique_ptr<GenericRaster> mapRows(GenericRaster &raster, const DataDescription &out_dd, uint32_t num_threads,
+		const std::function<void(uint32_t y, const double *in, const uint8_t *no_data, double *out)> &fn) {
+	raster.setRepresentation(GenericRaster::Representation::CPU);
+	auto raster_out = GenericRaster::create(out_dd, raster, GenericRaster::Representation::CPU);
+
+	parallelFor(raster.height, ROWS_PER_CHUNK, num_threads, [&](size_t begin, size_t end) {
+		std::vector<double> in(raster.width), out(raster.width);
+		std::vector<uint8_t> no_data(raster.width);
+		for (size_t y = begin; y < end; y++) {
+			readRow(raster, (uint32_t) y, in.data(), no_data.data());
+			fn((uint32_t) y, in.data(), no_data.data(), out.data());
+			writeRow(*raster_out, (uint32_t) y, out.data());
+		}
+	});
+	return raster_out;
+}
+
+
+/*
+ * The sines and cosines of the satellite view angles of the pixel centers, which only depend on the column
+ * or the row. The GEOS x axis points east, the scan angle of the satellite west.
+ */
+class ViewAngles {
+	public:
+		ViewAngles(const GenericRaster &raster, double view_angle_factor)
+			: sin_x(raster.width), cos_x(raster.width), sin_y(raster.height), cos_y(raster.height) {
+			for (uint32_t x = 0; x < raster.width; x++) {
+				double angle = radians((x * raster.pixel_scale_x + raster.PixelToWorldX(0)) * view_angle_factor * -1);
+				sin_x[x] = std::sin(angle);
+				cos_x[x] = std::cos(angle);
+			}
+			for (uint32_t y = 0; y < raster.height; y++) {
+				double angle = radians((y * raster.pixel_scale_y + raster.PixelToWorldY(0)) * view_angle_factor);
+				sin_y[y] = std::sin(angle);
+				cos_y[y] = std::cos(angle);
+			}
+		}
+
+		// satelliteViewAngleToLatLon with a sub satellite longitude of 0, in degrees
+		void toLatLon(uint32_t x, uint32_t y, double &lat, double &lon) const {
+			double cos2y = cos_y[y] * cos_y[y];
+			double sin2y = sin_y[y] * sin_y[y];
+			double cosxcosy = cos_x[x] * cos_y[y];
+			double cos2yconstsin2y = cos2y + 1.006803 * sin2y;
+
+			double sd = std::sqrt((42164 * cosxcosy) * (42164 * cosxcosy) - cos2yconstsin2y * 1737121856);
+			double sn = (42164 * cosxcosy - sd) / cos2yconstsin2y;
+			double s1 = 42164 - sn * cosxcosy;
+			double s2 = sn * sin_x[x] * cos_y[y];
+			double s3 = -1.0 * sn * sin_y[y];
+			double sxy = std::sqrt(s1 * s1 + s2 * s2);
+
+			lon = degrees(std::atan(s2 / s1));
+			lat = degrees(std::atan(1.006804 * s3 / sxy));
+		}
+
+	private:
+		std::vector<double> sin_x, cos_x, sin_y, cos_y;
+};
+
+/*
+ * solarAzimuthZenith, split into its two results
+ */
+class SunPosition {
+	public:
+		SunPosition(const cIntermediateVariables &sun)
+			: sun(sun), cos_declination(std::cos(sun.dDeclination)), sin_declination(std::sin(sun.dDeclination)),
+			  tan_declination(std::tan(sun.dDeclination)) {
+		}
+
+		double zenith(double lat, double lon) const {
+			double hour_angle = radians(sun.dGreenwichMeanSiderealTime * 15 + lon) - sun.dRightAscension;
+			double latitude = radians(lat);
+			double zenith = std::acos(std::cos(latitude) * std::cos(hour_angle) * cos_declination + sin_declination * std::sin(latitude));
+			// parallax correction
+			zenith += (dEarthMeanRadius / dAstronomicalUnit) * std::sin(zenith);
+			return degrees(zenith);
+		}
+
+		double azimuth(double lat, double lon) const {
+			double hour_angle = radians(sun.dGreenwichMeanSiderealTime * 15 + lon) - sun.dRightAscension;
+			double latitude = radians(lat);
+			double azimuth = std::atan2(-std::sin(hour_angle), tan_declination * std::cos(latitude) - std::sin(latitude) * std::cos(hour_angle));
+			if (azimuth < 0.0)
+				azimuth += M_PI * 2;
+			return degrees(azimuth);
+		}
+
+	private:
+		cIntermediateVariables sun;
+		double cos_declination, sin_declination, tan_declination;
+};
+
+
+namespace msg {
+namespace cpu {
+
+std::unique_ptr<GenericRaster> radiance(GenericRaster &raster, const DataDescription &out_dd,
+		float offset, float slope, float conversion_factor, uint32_t num_threads) {
+	const double out_no_data = out_dd.no_data;
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t, const double *in, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++) {
+			float result = (offset + (float) in[x] * slope) * conversion_factor;
+			out[x] = no_data[x] ? out_no_data : result;
+		}
+	});
+}
+
+std::unique_ptr<GenericRaster> temperature(GenericRaster &raster, const DataDescription &out_dd,
+		const std::vector<float> &lut, uint32_t num_threads) {
+	const double out_no_data = out_dd.no_data;
+	const double size = (double) lut.size();
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t, const double *in, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++) {
+			if (no_data[x] || !(in[x] >= 0 && in[x] < size))
+				out[x] = out_no_data;
+			else
+				out[x] = lut[(size_t) in[x]];
+		}
+	});
+}
+
+std::unique_ptr<GenericRaster> reflectance(GenericRaster &raster, const DataDescription &out_dd,
+		double etsr, double esd, uint32_t num_threads) {
+	const double out_no_data = out_dd.no_data;
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t, const double *in, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++)
+			out[x] = no_data[x] ? out_no_data : in[x] * (esd * esd) / etsr;
+	});
+}
+
+std::unique_ptr<GenericRaster> reflectanceWithSolarCorrection(GenericRaster &raster, const DataDescription &out_dd,
+		double etsr, double esd, const cIntermediateVariables &sun, double view_angle_factor, uint32_t num_threads) {
+	const double out_no_data = out_dd.no_data;
+	ViewAngles view_angles(raster, view_angle_factor);
+	SunPosition sun_position(sun);
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t y, const double *in, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++) {
+			if (no_data[x]) {
+				out[x] = out_no_data;
+				continue;
+			}
+			double lat, lon;
+			view_angles.toLatLon(x, y, lat, lon);
+			double zenith = sun_position.zenith(lat, lon);
+			out[x] = in[x] * (esd * esd) / (etsr * std::cos(radians(std::min(zenith, 80.0))));
+		}
+	});
+}
+
+std::unique_ptr<GenericRaster> solarAzimuth(GenericRaster &raster, const DataDescription &out_dd,
+		const cIntermediateVariables &sun, double view_angle_factor, uint32_t num_threads) {
+	const double out_no_data = out_dd.no_data;
+	ViewAngles view_angles(raster, view_angle_factor);
+	SunPosition sun_position(sun);
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t y, const double *, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++) {
+			if (no_data[x]) {
+				out[x] = out_no_data;
+				continue;
+			}
+			double lat, lon;
+			view_angles.toLatLon(x, y, lat, lon);
+			out[x] = sun_position.azimuth(lat, lon);
+		}
+	});
+}
+
+std::unique_ptr<GenericRaster> solarZenith(GenericRaster &raster, const DataDescription &out_dd,
+		const cIntermediateVariables &sun, double view_angle_factor, uint32_t num_threads) {
+	const double out_no_data = out_dd.no_data;
+	ViewAngles view_angles(raster, view_angle_factor);
+	SunPosition sun_position(sun);
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t y, const double *, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++) {
+			if (no_data[x]) {
+				out[x] = out_no_data;
+				continue;
+			}
+			double lat, lon;
+			view_angles.toLatLon(x, y, lat, lon);
+			out[x] = sun_position.zenith(lat, lon);
+		}
+	});
+}
+
+std::unique_ptr<GenericRaster> co2Correction(GenericRaster &bt039, GenericRaster &bt108, GenericRaster &bt134,
+		const DataDescription &out_dd, uint32_t num_threads) {
+	if (bt108.width != bt039.width || bt108.height != bt039.height || bt134.width != bt039.width || bt134.height != bt039.height)
+		throw OperatorException("MSATCo2CorrectionOperator: the input rasters differ in size");
+	bt108.setRepresentation(GenericRaster::Representation::CPU);
+	bt134.setRepresentation(GenericRaster::Representation::CPU);
+
+	const double out_no_data = out_dd.no_data;
+	const uint32_t width = bt039.width;
+	return mapRows(bt039, out_dd, num_threads, [&](uint32_t y, const double *in_bt039, const uint8_t *no_data_bt039, double *out) {
+		std::vector<double> in_bt108(width), in_bt134(width);
+		std::vector<uint8_t> no_data_bt108(width), no_data_bt134(width);
+		readRow(bt108, y, in_bt108.data(), no_data_bt108.data());
+		readRow(bt134, y, in_bt134.data(), no_data_bt134.data());
+
+		for (uint32_t x = 0; x < width; x++) {
+			if (no_data_bt039[x] || no_data_bt108[x] || no_data_bt134[x]) {
+				out[x] = out_no_data;
+				continue;
+			}
+			float value_bt039 = (float) in_bt039[x], value_bt108 = (float) in_bt108[x], value_bt134 = (float) in_bt134[x];
+			float dt_co2 = (value_bt108 - value_bt134) / 4.0f;
+			float corrected_bt108 = value_bt108 - dt_co2;
+			float r_corr = value_bt108 * value_bt108 * value_bt108 * value_bt108 - corrected_bt108 * corrected_bt108 * corrected_bt108 * corrected_bt108;
+			out[x] = std::pow(value_bt039 * value_bt039 * value_bt039 * value_bt039 + r_corr, 0.25f);
+		}
+	});
+}
+
+std::unique_ptr<GenericRaster> pansharpening(GenericRaster &hrv, GenericRaster &lowres, const SpatioTemporalReference &stref,
+		int ratio, const std::vector<float> &spatial_matrix, int local_regression, int distance, uint32_t num_threads) {
+	if (ratio < 1 || hrv.width != lowres.width * ratio || hrv.height != lowres.height * ratio)
+		throw ArgumentException("PansharpeningOperator: ratio between HRV and lowres canal is invalid\n");
+	hrv.setRepresentation(GenericRaster::Representation::CPU);
+	lowres.setRepresentation(GenericRaster::Representation::CPU);
+
+	const int low_width = lowres.width, low_height = lowres.height, high_width = hrv.width, high_height = hrv.height;
+	const DataDescription &dd = lowres.dd;
+	auto isNoData = [&](float value) {
+		return dd.has_no_data && (value == dd.no_data || std::isnan(value));
+	};
+
+	std::vector<float> high(hrv.getPixelCount()), low(lowres.getPixelCount());
+	std::vector<uint8_t> high_no_data(high.size()), low_no_data(low.size());
+	{
+		std::vector<double> row(std::max(high_width, low_width));
+		for (int y = 0; y < high_height; y++) {
+			readRow(hrv, y, row.data(), &high_no_data[(size_t) y * high_width]);
+			std::copy(row.begin(), row.begin() + high_width, high.begin() + (size_t) y * high_width);
+		}
+		for (int y = 0; y < low_height; y++) {
+			readRow(lowres, y, row.data(), &low_no_data[(size_t) y * low_width]);
+			std::copy(row.begin(), row.begin() + low_width, low.begin() + (size_t) y * low_width);
+		}
+	}
+
+	// degenerate the hrv raster to the low resolution, pan_downsample and pan_downsample_spatial
+	std::vector<float> low_high(low.size());
+	const int matrix_length = (int) std::lround(std::sqrt((double) spatial_matrix.size()));
+	parallelFor(low_height, ROWS_PER_CHUNK, num_threads, [&](size_t begin, size_t end) {
+		for (int out_y = (int) begin; out_y < (int) end; out_y++) {
+			for (int out_x = 0; out_x < low_width; out_x++) {
+				float value = 0;
+				if (spatial_matrix.empty()) {
+					const int in_x = out_x * ratio, in_y = out_y * ratio;
+					float sample_sum = 0.0f;
+					for (int sample_y = 0; sample_y < ratio; sample_y++)
+						for (int sample_x = 0; sample_x < ratio; sample_x++)
+							sample_sum += high[(size_t) (in_y + sample_y) * high_width + in_x + sample_x];
+					value = sample_sum / (ratio * ratio);
+				}
+				else {
+					const int in_x = out_x * ratio + ratio / 2, in_y = out_y * ratio + ratio / 2;
+					for (int local_x = in_x - matrix_length / 2; local_x <= in_x + matrix_length / 2; local_x++) {
+						for (int local_y = in_y - matrix_length / 2; local_y <= in_y + matrix_length / 2; local_y++) {
+							// like the kernel, the first row and column of the image are skipped
+							if (local_x > 0 && local_y > 0 && local_x < high_width && local_y < high_height) {
+								int matrix_x = local_x - (in_x - matrix_length / 2);
+								int matrix_y = local_y - (in_y - matrix_length / 2);
+								float add = high[(size_t) local_y * high_width + local_x] * spatial_matrix[matrix_y * matrix_length + matrix_x];
+								// weigh twice if the opposite field of the matrix lies outside of the image
+								if (in_x - (matrix_x - matrix_length / 2) < 0 || in_x - (matrix_x - matrix_length / 2) >= high_width)
+									add *= 2;
+								if (in_y - (matrix_y - matrix_length / 2) < 0 || in_y - (matrix_y - matrix_length / 2) >= high_height)
+									add *= 2;
+								value += add;
+							}
+						}
+					}
+				}
+				low_high[(size_t) out_y * low_width + out_x] = value;
+			}
+		}
+	});
+
+	// estimate a local regression of the low resolution raster with the degenerated hrv raster, pan_regression
+	std::vector<float> reg_a(low.size()), reg_b(low.size());
+	const int matrix_offset = (local_regression - 1) / 2;
+	parallelFor(low_height, ROWS_PER_CHUNK, num_threads, [&](size_t begin, size_t end) {
+		for (int posy = (int) begin; posy < (int) end; posy++) {
+			for (int posx = 0; posx < low_width; posx++) {
+				size_t gid = (size_t) posy * low_width + posx;
+				if (low_no_data[gid] || isNoData(low_high[gid])) {
+					reg_a[gid] = reg_b[gid] = (float) dd.no_data;
+					continue;
+				}
+
+				float sum_LNx_LNy = 0, sum_LNx = 0, sum_LNy = 0, sum_LNx_2 = 0, n = 0, weight = 1;
+				for (int local_y = posy - matrix_offset; local_y <= posy + matrix_offset; local_y++) {
+					for (int local_x = posx - matrix_offset; local_x <= posx + matrix_offset; local_x++) {
+						if (local_x < 0 || local_y < 0 || local_x >= low_width || local_y >= low_height)
+							continue;
+						size_t local_id = (size_t) local_y * low_width + local_x;
+						float high_low_value = low_high[local_id];
+						float low_value = low[local_id] + 0.1f;
+
+						if (distance) {
+							float dx = (float) (posx - local_x), dy = (float) (posy - local_y);
+							float dist = std::sqrt(dx * dx + dy * dy) / matrix_offset;
+							float dist_mid = 0.5f / matrix_offset;
+							weight = 10000.0f / std::max(dist, dist_mid);
+						}
+						n += weight;
+
+						float log_high = std::log(high_low_value), log_low = std::log(low_value);
+						sum_LNx_LNy += log_high * log_low * weight;
+						sum_LNx += log_high * weight;
+						sum_LNy += log_low * weight;
+						sum_LNx_2 += log_high * log_high * weight;
+					}
+				}
+
+				float b = (n * sum_LNx_LNy - sum_LNx * sum_LNy) / (n * sum_LNx_2 - sum_LNx * sum_LNx);
+				// an almost constant hrv window gives a very steep regression, its slope is set to 0
+				if (b > 20 || b < -20)
+					b = 0;
+				reg_b[gid] = b;
+				reg_a[gid] = std::exp((sum_LNy - b * sum_LNx) / n);
+			}
+		}
+	});
+
+	// interpolate the regression to the hrv resolution and apply it, pan_interpolate
+	auto raster_out = GenericRaster::create(dd, stref, hrv.width, hrv.height, 0, GenericRaster::Representation::CPU);
+	const double out_max = dd.unit.getMax(), out_no_data = dd.no_data;
+	parallelFor(high_height, ROWS_PER_CHUNK, num_threads, [&](size_t begin, size_t end) {
+		std::vector<double> out(high_width);
+		for (int posy = (int) begin; posy < (int) end; posy++) {
+			for (int posx = 0; posx < high_width; posx++) {
+				size_t low_id = (size_t) (posy / ratio) * low_width + posx / ratio, high_id = (size_t) posy * high_width + posx;
+				float a = reg_a[low_id], b = reg_b[low_id];
+				if (isNoData(a) || isNoData(b) || high_no_data[high_id]) {
+					out[posx] = out_no_data;
+					continue;
+				}
+				float result = a * std::pow(high[high_id], b) - 0.1f;
+				out[posx] = std::min((double) result, out_max);
+			}
+			writeRow(*raster_out, (uint32_t) posy, out.data());
+		}
+	});
+	return raster_out;
+}
+
+std::unique_ptr<GenericRaster> replacementByRange(GenericRaster &raster, const DataDescription &out_dd,
+		const std::vector<float> &lower_borders, const std::vector<float> &upper_borders, const std::vector<float> &replacements,
+		float no_data_replacement, uint32_t num_threads) {
+	if (lower_borders.size() != replacements.size() || upper_borders.size() != replacements.size())
+		throw ArgumentException("replacementByRange: the borders do not match the replacements");
+
+	const float unclassified = (float) out_dd.no_data;
+	return mapRows(raster, out_dd, num_threads, [&](uint32_t, const double *in, const uint8_t *no_data, double *out) {
+		for (uint32_t x = 0; x < raster.width; x++) {
+			if (no_data[x]) {
+				out[x] = no_data_replacement;
+				continue;
+			}
+			// like the kernel, the last matching range wins
+			float result = unclassified;
+			for (size_t i = 0; i < replacements.size(); i++) {
+				if (in[x] >= lower_borders[i] && in[x] <= upper_borders[i])
+					result = replacements[i];
+			}
+			out[x] = result;
+		}
+	});
+}
+
+}
+}
@@ -0,0 +1,66 @@
+#ifndef OPERATORS_PROCESSING_METEOSAT_CPU_KERNELS_H
+#define OPERATORS_PROCESSING_METEOSAT_CPU_KERNELS_H
+
+#include "datatypes/raster.h"
+#include "util/sunpos.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+namespace msg {
+
+	/**
+	 * CPU implementations of the Meteosat OpenCL kernels, used when mapping is built without OpenCL.
+	 *
+	 * Every function computes the same values as the kernel it is named after, with the same float or double
+	 * precision and the same handling of no data. The rows of the output are split across threads, a
+	 * num_threads of 0 uses one per core. Terms that only depend on the column or the row, like the satellite
+	 * view angles, are computed once per column and row instead of once per pixel.
+	 */
+	namespace cpu {
+
+		// radianceConvertedKernel
+		std::unique_ptr<GenericRaster> radiance(GenericRaster &raster, const DataDescription &out_dd,
+				float offset, float slope, float conversion_factor, uint32_t num_threads = 0);
+
+		// temperaturekernel, raw values outside of the lookup table become no data
+		std::unique_ptr<GenericRaster> temperature(GenericRaster &raster, const DataDescription &out_dd,
+				const std::vector<float> &lut, uint32_t num_threads = 0);
+
+		// reflectanceWithoutSolarCorrectionKernel
+		std::unique_ptr<GenericRaster> reflectance(GenericRaster &raster, const DataDescription &out_dd,
+				double etsr, double esd, uint32_t num_threads = 0);
+
+		// reflectanceWithSolarCorrectionKernel
+		std::unique_ptr<GenericRaster> reflectanceWithSolarCorrection(GenericRaster &raster, const DataDescription &out_dd,
+				double etsr, double esd, const cIntermediateVariables &sun, double view_angle_factor, uint32_t num_threads = 0);
+
+		// azimuthKernel and zenithKernel
+		std::unique_ptr<GenericRaster> solarAzimuth(GenericRaster &raster, const DataDescription &out_dd,
+				const cIntermediateVariables &sun, double view_angle_factor, uint32_t num_threads = 0);
+		std::unique_ptr<GenericRaster> solarZenith(GenericRaster &raster, const DataDescription &out_dd,
+				const cIntermediateVariables &sun, double view_angle_factor, uint32_t num_threads = 0);
+
+		// co2correctionkernel, all rasters must have the same size
+		std::unique_ptr<GenericRaster> co2Correction(GenericRaster &bt039, GenericRaster &bt108, GenericRaster &bt134,
+				const DataDescription &out_dd, uint32_t num_threads = 0);
+
+		/**
+		 * pan_downsample or pan_downsample_spatial, pan_regression and pan_interpolate. The result has the size of
+		 * the hrv raster and the data description of the low resolution raster.
+		 *
+		 * @param spatial_matrix the spatial response matrix, an empty one uses the mean of each ratio x ratio block
+		 */
+		std::unique_ptr<GenericRaster> pansharpening(GenericRaster &hrv, GenericRaster &lowres, const SpatioTemporalReference &stref,
+				int ratio, const std::vector<float> &spatial_matrix, int local_regression, int distance, uint32_t num_threads = 0);
+
+		// replacementByRangeKernel
+		std::unique_ptr<GenericRaster> replacementByRange(GenericRaster &raster, const DataDescription &out_dd,
+				const std::vector<float> &lower_borders, const std::vector<float> &upper_borders, const std::vector<float> &replacements,
+				float no_data_replacement, uint32_t num_threads = 0);
+	}
+}
+
+#endif
@@ -7,6 +7,8 @@
 #include "msg_constants.h"
 #include "sofos_constants.h"
 #include "datatypes/plots/histogram.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "util/configuration.h"
 
 #include <memory>
 #include <math.h>
@@ -50,14 +52,6 @@ REGISTER_OPERATOR(MeteosatGccThermThresholdDetectionOperator, "meteosat_gcctherm
 
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MeteosatGccThermThresholdDetectionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATGccThermThresholdDetectionOperator: cannot be executed without OpenCL support");
-}
-std::unique_ptr<GenericPlot> MeteosatGccThermThresholdDetectionOperator::getPlot(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATGccThermThresholdDetectionOperator: cannot be executed without OpenCL support");
-}
-#else
 
 template<typename T1, typename T2>
 struct RasterClassification{
@@ -309,6 +303,11 @@ std::unique_ptr<GenericRaster> MeteosatGccThermThresholdDetectionOperator::getRa
 	out_unit.setMinMax(min, max);
 	DataDescription out_dd(GDT_Float32, out_unit); // no no_data //raster->dd.has_no_data, output_no_data);
 	out_dd.addNoData();
+
+#ifdef MAPPING_NO_OPENCL
+	auto raster_out = msg::cpu::replacementByRange(*solar_zenith_angle_raster, out_dd, classification_bounds_lower, classification_bounds_upper,
+			classification_classes, static_cast<float>(out_dd.no_data), Configuration::get<uint32_t>("operators.meteosat.threads", 0));
+#else
 	auto raster_out = GenericRaster::create(out_dd, *solar_zenith_angle_raster, GenericRaster::Representation::OPENCL);
 
 	//Use the OpenCL classification kernel to fill a raster with the values
@@ -323,7 +322,7 @@ std::unique_ptr<GenericRaster> MeteosatGccThermThresholdDetectionOperator::getRa
 	prog.addArg(static_cast<int>(classification_classes.size()));
 	prog.addArg(static_cast<float>(out_dd.no_data)); //keep nodata as nodata
 	prog.run();
-
+#endif
 
 	//callBinaryOperatorFunc<RasterClassification>(solar_zenith_angle_raster.get(), raster_out.get(), classification_bounds_lower, classification_bounds_upper, classification_classes);
 	return (raster_out);
@@ -361,4 +360,3 @@ std::unique_ptr<GenericPlot> MeteosatGccThermThresholdDetectionOperator::getPlot
 	return (std::unique_ptr<GenericPlot>(std::move(histogram_ptr)));;
 }
 #endif
-#endif
@@ -4,6 +4,8 @@
 #include "raster/opencl.h"
 #include "operators/operator.h"
 #include "msg_constants.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "util/configuration.h"
 
 #include <limits>
 #include <memory>
@@ -61,19 +63,16 @@ void MeteosatPansharpeningOperator::writeSemanticParameters(std::ostringstream&
 
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MeteosatPansharpeningOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSG_Pansharpening_Operator: cannot be executed without OpenCL support");
-}
-#else
-
-
+#ifndef MAPPING_NO_OPENCL
 #include "operators/processing/meteosat/pansharpening_degenerate.cl.h"
 #include "operators/processing/meteosat/pansharpening_regression.cl.h"
 #include "operators/processing/meteosat/pansharpening_interpolate.cl.h"
+#endif
 
 std::unique_ptr<GenericRaster> MeteosatPansharpeningOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+#ifndef MAPPING_NO_OPENCL
 	RasterOpenCL::init();
+#endif
 
 	auto raster_lowres = getRasterFromSource(1, rect, tools, RasterQM::LOOSE);
 
@@ -84,9 +83,6 @@ std::unique_ptr<GenericRaster> MeteosatPansharpeningOperator::getRaster(const Qu
 
 	auto raster_hrv = getRasterFromSource(0, rect2, tools, RasterQM::EXACT);
 
-	Profiler::Profiler p("CL_PANSHARPENING_OPERATOR");
-	raster_hrv->setRepresentation(GenericRaster::OPENCL);
-
 	if(raster_hrv->width % raster_lowres->width != 0 || raster_hrv->height % raster_lowres->height != 0)
 		throw ArgumentException("PansharpeningOperator: ratio between HRV and lowres canal is invalid\n");
 
@@ -106,6 +102,18 @@ std::unique_ptr<GenericRaster> MeteosatPansharpeningOperator::getRaster(const Qu
 		0.000683f,0.001347f,0.002680f,0.003929f,0.004373f,0.003929f,0.002680f,0.001347f,0.000683f//8
 	};
 
+	TemporalReference tref(raster_hrv->stref);
+	tref.intersect(raster_lowres->stref);
+	SpatioTemporalReference stref(raster_hrv->stref, tref);
+
+#ifdef MAPPING_NO_OPENCL
+	Profiler::Profiler p("PANSHARPENING_OPERATOR");
+	return msg::cpu::pansharpening(*raster_hrv, *raster_lowres, stref, ratio, spatial ? spatialMatrix : std::vector<float>(),
+			local_regression, distance, Configuration::get<uint32_t>("operators.meteosat.threads", 0));
+#else
+	Profiler::Profiler p("CL_PANSHARPENING_OPERATOR");
+	raster_hrv->setRepresentation(GenericRaster::OPENCL);
+
 	//TODO:compute overall maximum:
 
 	// Degenerate:
@@ -148,9 +156,6 @@ std::unique_ptr<GenericRaster> MeteosatPansharpeningOperator::getRaster(const Qu
 	// Interpolate:
 	// interpolate low res matrices to high res and combine them to the result matrix:
 
-	TemporalReference tref(raster_hrv->stref);
-	tref.intersect(raster_lowres->stref);
-	SpatioTemporalReference stref(raster_hrv->stref, tref);
 	auto raster_out = GenericRaster::create(raster_lowres->dd, stref, raster_hrv->width, raster_hrv->height, 0, GenericRaster::OPENCL);
 
 	RasterOpenCL::CLProgram prog_interpolate;
@@ -165,6 +170,6 @@ std::unique_ptr<GenericRaster> MeteosatPansharpeningOperator::getRaster(const Qu
 	prog_interpolate.run();
 
 	return raster_out;
-}
 #endif
+}
 #endif
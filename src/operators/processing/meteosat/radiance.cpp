@@ -3,7 +3,10 @@
 #include "datatypes/raster/typejuggling.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
+#include "operators/pixel_operator.h"
 #include "msg_constants.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "util/configuration.h"
 
 #include <limits>
 #include <memory>
@@ -12,13 +15,14 @@
 #include <gdal_priv.h>
 
 
-class MeteosatRadianceOperator : public GenericOperator {
+class MeteosatRadianceOperator : public GenericOperator, public PixelOperator {
 	public:
 		MeteosatRadianceOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
 		virtual ~MeteosatRadianceOperator();
 
 #ifndef MAPPING_OPERATOR_STUBS
 		virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools);
+		virtual PixelStage getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const;
 #endif
 	protected:
 		void writeSemanticParameters(std::ostringstream& stream);
@@ -48,16 +52,44 @@ void MeteosatRadianceOperator::writeSemanticParameters(std::ostringstream& strea
 
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MeteosatRadianceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATRadianceOperator: cannot be executed without OpenCL support");
+static DataDescription getRadianceDataDescription(const DataDescription &in_dd, float offset, float slope) {
+	double newmin = offset + in_dd.unit.getMin() * slope;
+	double newmax = offset + in_dd.unit.getMax() * slope;
+
+	Unit out_unit("radiance", "W·m^(-2)·sr^(-1)·cm^(-1)");
+	out_unit.setMinMax(newmin, newmax);
+	out_unit.setInterpolation(Unit::Interpolation::Continuous);
+	DataDescription out_dd(GDT_Float32, out_unit); // no no_data //raster->dd.has_no_data, output_no_data);
+	if (in_dd.has_no_data)
+		out_dd.addNoData();
+	return out_dd;
 }
-#else
 
+PixelStage MeteosatRadianceOperator::getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const {
+	if (in_dd.unit.getMeasurement() != "raw" || !in_dd.unit.hasMinMax())
+		throw OperatorException("Input raster does not appear to be a raw meteosat raster");
+
+	float offset = attributes.getNumeric("msg.CalibrationOffset");
+	float slope = attributes.getNumeric("msg.CalibrationSlope");
+
+	// the same as radianceConvertedKernel
+	PixelStage stage(getRadianceDataDescription(in_dd, offset, slope));
+	stage.addArg("offset", offset);
+	stage.addArg("slope", slope);
+	stage.addArg("conversionFactor", 1.0f);
+	stage.code = "result = (offset + value * slope) * conversionFactor;";
+	stage.keeps_attributes = true;
+	return stage;
+}
+
+#ifndef MAPPING_NO_OPENCL
 #include "operators/processing/meteosat/radiance.cl.h"
+#endif
 
 std::unique_ptr<GenericRaster> MeteosatRadianceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+#ifndef MAPPING_NO_OPENCL
 	RasterOpenCL::init();
+#endif
 	auto raster = getRasterFromSource(0, rect, tools);
 
 	if (raster->dd.unit.getMeasurement() != "raw" || !raster->dd.unit.hasMinMax())
@@ -66,10 +98,6 @@ std::unique_ptr<GenericRaster> MeteosatRadianceOperator::getRaster(const QueryRe
 	float offset = raster->global_attributes.getNumeric("msg.CalibrationOffset");
 	float slope = raster->global_attributes.getNumeric("msg.CalibrationSlope");
 
-	raster->setRepresentation(GenericRaster::OPENCL);
-
-	double newmin = offset + raster->dd.unit.getMin() * slope;
-	double newmax = offset + raster->dd.unit.getMax() * slope;
 	float conversionFactor = 1.0f;
 
 	/*
@@ -79,12 +107,12 @@ std::unique_ptr<GenericRaster> MeteosatRadianceOperator::getRaster(const QueryRe
 	}
 	*/
 
-	Unit out_unit("radiance", "W·m^(-2)·sr^(-1)·cm^(-1)");
-	out_unit.setMinMax(newmin, newmax);
-	out_unit.setInterpolation(Unit::Interpolation::Continuous);
-	DataDescription out_dd(GDT_Float32, out_unit); // no no_data //raster->dd.has_no_data, output_no_data);
-	if (raster->dd.has_no_data)
-		out_dd.addNoData();
+	DataDescription out_dd = getRadianceDataDescription(raster->dd, offset, slope);
+
+#ifdef MAPPING_NO_OPENCL
+	auto raster_out = msg::cpu::radiance(*raster, out_dd, offset, slope, conversionFactor, Configuration::get<uint32_t>("operators.meteosat.threads", 0));
+#else
+	raster->setRepresentation(GenericRaster::OPENCL);
 
 	auto raster_out = GenericRaster::create(out_dd, *raster, GenericRaster::Representation::OPENCL);
 
@@ -97,10 +125,10 @@ std::unique_ptr<GenericRaster> MeteosatRadianceOperator::getRaster(const QueryRe
 	prog.addArg(slope);
 	prog.addArg(conversionFactor);
 	prog.run();
+#endif
 
 	raster_out->global_attributes = raster->global_attributes;
 
 	return raster_out;
 }
 #endif
-#endif
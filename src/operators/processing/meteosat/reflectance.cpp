@@ -4,8 +4,11 @@
 #include "raster/profiler.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
+#include "operators/pixel_operator.h"
 #include "msg_constants.h"
 #include "util/sunpos.h"
+#include "util/configuration.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
 
 
 
@@ -18,17 +21,31 @@
 #include <gdal_priv.h>
 
 
-class MSATReflectanceOperator : public GenericOperator {
+class MSATReflectanceOperator : public GenericOperator, public PixelOperator {
 	public:
 		MSATReflectanceOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
 		virtual ~MSATReflectanceOperator();
 
 #ifndef MAPPING_OPERATOR_STUBS
 		virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools);
+		virtual PixelStage getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const;
 #endif
 	protected:
 		void writeSemanticParameters(std::ostringstream& stream);
 	private:
+		// the arguments of the reflectance kernels
+		struct KernelParameters {
+			double dGreenwichMeanSiderealTime, dRightAscension, dDeclination;
+			double projectionCooridnateToViewAngleFactor;
+			double etsr, esd;
+		};
+#ifndef MAPPING_OPERATOR_STUBS
+		/**
+		 * Computes the kernel arguments from the metadata of the input raster
+		 * @return the data description of the result
+		 */
+		DataDescription getKernelParameters(const DataDescription &in_dd, const AttributeMaps &attributes, KernelParameters &parameters) const;
+#endif
 		bool solarCorrection;
 		bool forceHRV;
 		std::string forceSatellite;
@@ -60,12 +77,6 @@ void MSATReflectanceOperator::writeSemanticParameters(std::ostringstream& stream
 
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATReflectanceOperator: cannot be executed without OpenCL support");
-}
-#else
-
 /**
  * This function calculates the earth sun distance for a given day of year
  * @param dayOfYear day of year
@@ -75,16 +86,13 @@ double calculateESD(int dayOfYear){
 	return 1.0 - 0.0167 * cos(2.0 * acos(-1.0) * ((dayOfYear - 3.0) / 365.0));
 }
 
-std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	RasterOpenCL::init();
-	auto raster = getRasterFromSource(0, rect, tools);
-
-	if (raster->dd.unit.getMeasurement() != "radiance") // || raster->dd.unit.getUnit() != "W·m^(-2)·sr^(-1)·cm^(-1)")
-		throw OperatorException(concat("Input raster does not appear to be a meteosat radiance raster, unit: ", raster->dd.unit.toJson()));
+DataDescription MSATReflectanceOperator::getKernelParameters(const DataDescription &in_dd, const AttributeMaps &attributes, KernelParameters &parameters) const {
+	if (in_dd.unit.getMeasurement() != "radiance") // || in_dd.unit.getUnit() != "W·m^(-2)·sr^(-1)·cm^(-1)")
+		throw OperatorException(concat("Input raster does not appear to be a meteosat radiance raster, unit: ", in_dd.unit.toJson()));
 
 	// get all the metadata:
-	int channel = (forceHRV) ? 11 : ((int) raster->global_attributes.getNumeric("msg.Channel") - 1);
-	std::string timestamp = raster->global_attributes.getTextual("msg.TimeStamp");
+	int channel = (forceHRV) ? 11 : ((int) attributes.getNumeric("msg.Channel") - 1);
+	std::string timestamp = attributes.getTextual("msg.TimeStamp");
 
 	msg::Satellite satellite;
 
@@ -92,7 +100,7 @@ std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRec
 		satellite = msg::getSatelliteForName(forceSatellite);
 	}
 	else{
-		int satellite_id = (int) raster->global_attributes.getNumeric("msg.Satellite");
+		int satellite_id = (int) attributes.getNumeric("msg.Satellite");
 		satellite = msg::getSatelliteForMsgId(satellite_id);
 	}
 
@@ -107,6 +115,9 @@ std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRec
 
 	//now calculate the intermediate values using PSA algorithm
 	cIntermediateVariables psaIntermediateValues = sunposIntermediate(timeDate.tm_year+1900, timeDate.tm_mon+1,	timeDate.tm_mday, timeDate.tm_hour, timeDate.tm_min, 0.0);
+	parameters.dGreenwichMeanSiderealTime = psaIntermediateValues.dGreenwichMeanSiderealTime;
+	parameters.dRightAscension = psaIntermediateValues.dRightAscension;
+	parameters.dDeclination = psaIntermediateValues.dDeclination;
 
 	/* DEBUG infos
 	//get more information about the raster dimensions of the processed tile
@@ -135,25 +146,75 @@ std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRec
 
 
 	// get extra terrestrial solar radiation (...) and ESD (solar position)
-	double etsr = satellite.etsr[channel]/M_PI;
-	double esd = calculateESD(timeDate.tm_yday+1);
+	parameters.etsr = satellite.etsr[channel]/M_PI;
+	parameters.esd = calculateESD(timeDate.tm_yday+1);
 
 	//calculate the projection to viewangle factor:
 	// channel 01-10 (1-11) = -13642337.0 * 3000.403165817
 	// channel 11 (12 = HRV)= -40927014.0 * 1000.134348869
-	double projectionCooridnateToViewAngleFactor = 65536 / ((channel == 11)? (-40927014 * 1000.134348869) : (-13642337 * 3000.403165817)); //= -1.59914060874�10^-6
-
+	parameters.projectionCooridnateToViewAngleFactor = 65536 / ((channel == 11)? (-40927014 * 1000.134348869) : (-13642337 * 3000.403165817)); //= -1.59914060874�10^-6
 
-	Profiler::Profiler p("CL_MSATRADIANCE_OPERATOR");
-	raster->setRepresentation(GenericRaster::OPENCL);
 
 	//
 	Unit out_unit("reflectance", "fraction");
 	out_unit.setMinMax(-0.1, 1.2); // TODO: ??? Shouldn't this be between 0 and 1?
 	out_unit.setInterpolation(Unit::Interpolation::Continuous);
-	DataDescription out_dd(GDT_Float32, out_unit); // no no_data //raster->dd.has_no_data, output_no_data);
-	if (raster->dd.has_no_data)
+	DataDescription out_dd(GDT_Float32, out_unit); // no no_data //in_dd.has_no_data, output_no_data);
+	if (in_dd.has_no_data)
 		out_dd.addNoData();
+	return out_dd;
+}
+
+PixelStage MSATReflectanceOperator::getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const {
+	KernelParameters parameters;
+	PixelStage stage(getKernelParameters(in_dd, attributes, parameters));
+
+	// the same as the reflectance kernels, which also define the helper functions
+	stage.functions = operators_processing_meteosat_reflectance;
+	stage.addArg("dETSRconst", parameters.etsr);
+	stage.addArg("dESD", parameters.esd);
+	if (solarCorrection) {
+		stage.addArg("dGreenwichMeanSiderealTime", parameters.dGreenwichMeanSiderealTime);
+		stage.addArg("dRightAscension", parameters.dRightAscension);
+		stage.addArg("dDeclination", parameters.dDeclination);
+		stage.addArg("projectionCooridnateToViewAngleFactor", parameters.projectionCooridnateToViewAngleFactor);
+		stage.code =
+			"double2 geosPosition;\n"
+			"geosPosition.x = ((posx) * in_info->scale[0] + in_info->origin[0]);\n"
+			"geosPosition.y = ((posy) * in_info->scale[1] + in_info->origin[1]);\n"
+			"double2 satelliteViewAngle = geosPosition * projectionCooridnateToViewAngleFactor * (double2)(-1,1);\n"
+			"double2 latLonPosition = satelliteViewAngleToLatLon(satelliteViewAngle, 0.0);\n"
+			"double2 azimuthZenith = solarAzimuthZenith(dGreenwichMeanSiderealTime, dRightAscension, dDeclination, latLonPosition);\n"
+			"result = value * (dESD * dESD) / (dETSRconst * cos(radians(min(azimuthZenith.y, 80.0))));";
+	}
+	else
+		stage.code = "result = value * (dESD * dESD) / dETSRconst;";
+	return stage;
+}
+
+std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+#ifndef MAPPING_NO_OPENCL
+	RasterOpenCL::init();
+#endif
+	auto raster = getRasterFromSource(0, rect, tools);
+
+	KernelParameters parameters;
+	DataDescription out_dd = getKernelParameters(raster->dd, raster->global_attributes, parameters);
+
+#ifdef MAPPING_NO_OPENCL
+	Profiler::Profiler p("MSATREFLECTANCE_OPERATOR");
+	auto num_threads = Configuration::get<uint32_t>("operators.meteosat.threads", 0);
+	if (solarCorrection) {
+		cIntermediateVariables sun;
+		sun.dGreenwichMeanSiderealTime = parameters.dGreenwichMeanSiderealTime;
+		sun.dRightAscension = parameters.dRightAscension;
+		sun.dDeclination = parameters.dDeclination;
+		return msg::cpu::reflectanceWithSolarCorrection(*raster, out_dd, parameters.etsr, parameters.esd, sun, parameters.projectionCooridnateToViewAngleFactor, num_threads);
+	}
+	return msg::cpu::reflectance(*raster, out_dd, parameters.etsr, parameters.esd, num_threads);
+#else
+	Profiler::Profiler p("CL_MSATRADIANCE_OPERATOR");
+	raster->setRepresentation(GenericRaster::OPENCL);
 
 	auto raster_out = GenericRaster::create(out_dd, *raster, GenericRaster::Representation::OPENCL);
 
@@ -163,20 +224,20 @@ std::unique_ptr<GenericRaster> MSATReflectanceOperator::getRaster(const QueryRec
 	prog.addOutRaster(raster_out.get());
 	if(solarCorrection){
 		prog.compile(operators_processing_meteosat_reflectance, "reflectanceWithSolarCorrectionKernel");
-		prog.addArg(psaIntermediateValues.dGreenwichMeanSiderealTime);
-		prog.addArg(psaIntermediateValues.dRightAscension);
-		prog.addArg(psaIntermediateValues.dDeclination);
-		prog.addArg(projectionCooridnateToViewAngleFactor);
+		prog.addArg(parameters.dGreenwichMeanSiderealTime);
+		prog.addArg(parameters.dRightAscension);
+		prog.addArg(parameters.dDeclination);
+		prog.addArg(parameters.projectionCooridnateToViewAngleFactor);
 	}
 	else{
 		prog.compile(operators_processing_meteosat_reflectance, "reflectanceWithoutSolarCorrectionKernel");
 	}
-	prog.addArg(etsr);
-	prog.addArg(esd);
+	prog.addArg(parameters.etsr);
+	prog.addArg(parameters.esd);
 	prog.run();
 
 	return raster_out;
-}
 #endif
+}
 #endif
 
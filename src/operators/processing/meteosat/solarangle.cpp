@@ -6,6 +6,8 @@
 #include "operators/operator.h"
 #include "msg_constants.h"
 #include "util/sunpos.h"
+#include "util/configuration.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
 
 
 
@@ -63,16 +65,14 @@ void MeteosatSolarAngleOperator::writeSemanticParameters(std::ostringstream& str
 }
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MeteosatSolarAngleOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATSolarAngleOperator: cannot be executed without OpenCL support");
-}
-#else
-
+#ifndef MAPPING_NO_OPENCL
 #include "operators/processing/meteosat/solarangle.cl.h"
+#endif
 
 std::unique_ptr<GenericRaster> MeteosatSolarAngleOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+#ifndef MAPPING_NO_OPENCL
 	RasterOpenCL::init();
+#endif
 	auto raster = getRasterFromSource(0, rect, tools);
 
 	// TODO: do we have any requirement for the input raster?
@@ -120,9 +120,6 @@ std::unique_ptr<GenericRaster> MeteosatSolarAngleOperator::getRaster(const Query
 	//x = X * 65536 / (CFAC * ColumnDirGridStep)
 	double projectionCooridnateToViewAngleFactor = 65536 / (-13642337 * 3000.403165817);
 
-	Profiler::Profiler p("CL_MSAT_SOLARANGLE_OPERATOR");
-	raster->setRepresentation(GenericRaster::OPENCL);
-
 	//
 	Unit out_unit("solarangle", "degree");
 	out_unit.setMinMax(0.0, 360.0);
@@ -130,6 +127,16 @@ std::unique_ptr<GenericRaster> MeteosatSolarAngleOperator::getRaster(const Query
 	if (raster->dd.has_no_data)
 		out_dd.addNoData();
 
+#ifdef MAPPING_NO_OPENCL
+	Profiler::Profiler p("MSAT_SOLARANGLE_OPERATOR");
+	auto num_threads = Configuration::get<uint32_t>("operators.meteosat.threads", 0);
+	if (solarAngle == SolarAngles::AZIMUTH)
+		return msg::cpu::solarAzimuth(*raster, out_dd, psaIntermediateValues, projectionCooridnateToViewAngleFactor, num_threads);
+	return msg::cpu::solarZenith(*raster, out_dd, psaIntermediateValues, projectionCooridnateToViewAngleFactor, num_threads);
+#else
+	Profiler::Profiler p("CL_MSAT_SOLARANGLE_OPERATOR");
+	raster->setRepresentation(GenericRaster::OPENCL);
+
 	auto raster_out = GenericRaster::create(out_dd, *raster, GenericRaster::Representation::OPENCL);
 
 	std::string kernelName;
@@ -152,6 +159,6 @@ std::unique_ptr<GenericRaster> MeteosatSolarAngleOperator::getRaster(const Query
 	prog.run();
 
 	return raster_out;
-}
 #endif
+}
 #endif
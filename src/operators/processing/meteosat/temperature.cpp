@@ -4,7 +4,10 @@
 #include "raster/profiler.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
+#include "operators/pixel_operator.h"
 #include "operators/processing/meteosat/msg_constants.h"
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "util/configuration.h"
 
 
 #include <vector>
@@ -17,17 +20,25 @@
 #include <gdal_priv.h>
 
 
-class MeteosatTemperatureOperator : public GenericOperator {
+class MeteosatTemperatureOperator : public GenericOperator, public PixelOperator {
 	public:
 		MeteosatTemperatureOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
 		virtual ~MeteosatTemperatureOperator();
 
 #ifndef MAPPING_OPERATOR_STUBS
 		virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools);
+		virtual PixelStage getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const;
 #endif
 	protected:
 		void writeSemanticParameters(std::ostringstream& stream);
 	private:
+#ifndef MAPPING_OPERATOR_STUBS
+		/**
+		 * Creates the lookup table from raw values to temperatures
+		 * @return the data description of the result
+		 */
+		DataDescription createLookupTable(const DataDescription &in_dd, const AttributeMaps &attributes, std::vector<float> &lut) const;
+#endif
 		std::string forceSatellite;
 
 };
@@ -46,14 +57,6 @@ void MeteosatTemperatureOperator::writeSemanticParameters(std::ostringstream& st
 
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("MSATTemperatureOperator: cannot be executed without OpenCL support");
-}
-#else
-
-#include "operators/processing/meteosat/temperature.cl.h"
-
 /**
  * This function uses the approximation method published by Eumetsat to calculate BTs from Radiance.
  * https://www.eumetsat.int/website/wcm/idc/idcplg?IdcService=GET_FILE&dDocName=PDF_EFFECT_RAD_TO_BRIGHTNESS&RevisionSelectionMethod=LatestReleased&Rendition=Web
@@ -69,11 +72,8 @@ static double calculateTempFromEffectiveRadiance(double wavenumber, double alpha
 	return temp;
 }
 
-std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	RasterOpenCL::init();
-	auto raster = getRasterFromSource(0, rect, tools);
-
-	if (raster->dd.unit.getMeasurement() != "raw" || raster->dd.unit.getMin() != 0 || raster->dd.unit.getMax() != 1023)
+DataDescription MeteosatTemperatureOperator::createLookupTable(const DataDescription &in_dd, const AttributeMaps &attributes, std::vector<float> &lut) const {
+	if (in_dd.unit.getMeasurement() != "raw" || in_dd.unit.getMin() != 0 || in_dd.unit.getMax() != 1023)
 		throw OperatorException("Input raster does not appear to be a raw meteosat raster");
 
 	msg::Satellite satellite;
@@ -81,24 +81,22 @@ std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const Quer
 		satellite = msg::getSatelliteForName(forceSatellite);
 	}
 	else{
-		int satellite_id = (int) raster->global_attributes.getNumeric("msg.Satellite");
+		int satellite_id = (int) attributes.getNumeric("msg.Satellite");
 		satellite = msg::getSatelliteForMsgId(satellite_id);
 	}
 
-	int channel = (int) raster->global_attributes.getNumeric("msg.Channel") - 1;
+	int channel = (int) attributes.getNumeric("msg.Channel") - 1;
 
 	if (channel < 3 || channel > 10)
 		throw OperatorException("BT calculation is only valid for Channels 4-11");
 
-	float offset = raster->global_attributes.getNumeric("msg.CalibrationOffset");
-	float slope = raster->global_attributes.getNumeric("msg.CalibrationSlope");
+	float offset = attributes.getNumeric("msg.CalibrationOffset");
+	float slope = attributes.getNumeric("msg.CalibrationSlope");
 
 	double wavenumber = satellite.vc[channel];
 	double alpha = satellite.alpha[channel];
 	double beta = satellite.beta[channel];
 
-	Profiler::Profiler p1("CL_MSATTEMPERATURE_LOOKUPTABLE");
-	std::vector<float> lut;
 	lut.reserve(1024);
 	for(int i = 0; i < 1024; i++) {
 		float radiance = offset + i * slope;
@@ -106,9 +104,6 @@ std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const Quer
 		lut.push_back(temperature);
 	}
 
-	Profiler::Profiler p("CL_MSATRADIANCE_OPERATOR");
-	raster->setRepresentation(GenericRaster::OPENCL);
-
 	//TODO: find min/max in the lut or use min/max of the input data...
 	double newmin = 200;//table->getMinTemp();
 	double newmax = 330;//table->getMaxTemp();
@@ -117,12 +112,45 @@ std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const Quer
 	out_unit.setMinMax(newmin, newmax);
 	out_unit.setInterpolation(Unit::Interpolation::Continuous);
 	DataDescription out_dd(GDT_Float32, out_unit);
-	if (raster->dd.has_no_data) {
+	if (in_dd.has_no_data) {
 		out_dd.addNoData();
-		int no_data = (int) raster->dd.no_data;
+		int no_data = (int) in_dd.no_data;
 		if (no_data >= 0 && no_data < 1024)
 			lut[no_data] = out_dd.no_data;
 	}
+	return out_dd;
+}
+
+PixelStage MeteosatTemperatureOperator::getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const {
+	std::vector<float> lut;
+	PixelStage stage(createLookupTable(in_dd, attributes, lut));
+
+	// the same as temperaturekernel
+	stage.addArg("LuT", lut);
+	stage.code = "result = LuT[value];";
+	return stage;
+}
+
+#ifndef MAPPING_NO_OPENCL
+#include "operators/processing/meteosat/temperature.cl.h"
+#endif
+
+std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+#ifndef MAPPING_NO_OPENCL
+	RasterOpenCL::init();
+#endif
+	auto raster = getRasterFromSource(0, rect, tools);
+
+	Profiler::Profiler p1("CL_MSATTEMPERATURE_LOOKUPTABLE");
+	std::vector<float> lut;
+	DataDescription out_dd = createLookupTable(raster->dd, raster->global_attributes, lut);
+
+#ifdef MAPPING_NO_OPENCL
+	Profiler::Profiler p("MSATTEMPERATURE_OPERATOR");
+	return msg::cpu::temperature(*raster, out_dd, lut, Configuration::get<uint32_t>("operators.meteosat.threads", 0));
+#else
+	Profiler::Profiler p("CL_MSATRADIANCE_OPERATOR");
+	raster->setRepresentation(GenericRaster::OPENCL);
 
 	auto raster_out = GenericRaster::create(out_dd, *raster, GenericRaster::Representation::OPENCL);
 
@@ -135,6 +163,6 @@ std::unique_ptr<GenericRaster> MeteosatTemperatureOperator::getRaster(const Quer
 	prog.run();
 
 	return raster_out;
-}
 #endif
+}
 #endif
@@ -2,6 +2,9 @@
 #include "datatypes/raster/typejuggling.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
+#include "operators/pixel_operator.h"
+#include "util/range_classification.h"
+#include "util/configuration.h"
 
 #include <memory>
 #include <cmath>
@@ -11,20 +14,25 @@
 /**
  * Operator that classifies a raster based on given data ranges.
  *
+ * Without OpenCL, the classification runs on the CPU using a sorted breakpoint table (see RangeClassification).
+ *
  * Parameters:
  * not stable yet
  */
-class ClassificationOperator : public GenericOperator {
+class ClassificationOperator : public GenericOperator, public PixelOperator {
 	public:
 		ClassificationOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
 		virtual ~ClassificationOperator();
 
 #ifndef MAPPING_OPERATOR_STUBS
 		virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools);
+		virtual PixelStage getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const;
 #endif
 	protected:
 		void writeSemanticParameters(std::ostringstream& stream);
 	private:
+		DataDescription getOutputDataDescription(const DataDescription &in_dd) const;
+
 		std::vector<float> classification_lower_border{}, classification_upper_border{};
 		std::vector<int> classification_classes{};
 		bool reclassNoData{false};
@@ -89,33 +97,66 @@ void ClassificationOperator::writeSemanticParameters(std::ostringstream& stream)
 }
 
 #ifndef MAPPING_OPERATOR_STUBS
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> ClassificationOperator::getRaster(const QueryRectangle &rect, const QueryTools &profiler) {
-	throw OperatorException("ClassificationOperator: cannot be executed without OpenCL support");
-}
-#else
-
+#ifndef MAPPING_NO_OPENCL
 #include "operators/processing/raster/classification_kernels.cl.h"
+#endif
 
-std::unique_ptr<GenericRaster> ClassificationOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	const auto raster_in = getRasterFromSource(0, rect, tools);
-
-	RasterOpenCL::init();
-	raster_in->setRepresentation(GenericRaster::Representation::OPENCL);
-
+DataDescription ClassificationOperator::getOutputDataDescription(const DataDescription &in_dd) const {
 	const auto min_max_classes = std::minmax_element(classification_classes.begin(), classification_classes.end());
 	const double min = std::min(*min_max_classes.first, noDataClass);
 	const double max = std::max(*min_max_classes.second, noDataClass);
 
-	Unit output_unit = Unit(raster_in->dd.unit.getMeasurement(), "_classification");
+	Unit output_unit = Unit(in_dd.unit.getMeasurement(), "_classification");
 	output_unit.setMinMax(min, max);
 	// TODO: add classes
 
 	DataDescription out_data_description{GDT_Int32, output_unit};
 	out_data_description.addNoData();
+	return out_data_description;
+}
+
+PixelStage ClassificationOperator::getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const {
+	PixelStage stage(getOutputDataDescription(in_dd));
+	const int new_nodata_class = (reclassNoData)?noDataClass:static_cast<int>(stage.out_dd.no_data);
+
+	// the same as classificationByRangeKernel
+	stage.addArg("lower_border", classification_lower_border);
+	stage.addArg("upper_border", classification_upper_border);
+	stage.addArg("classes", classification_classes);
+	stage.addArg("number_of_classes", static_cast<int>(classification_classes.size()));
+	stage.addArg("no_data_class", new_nodata_class);
+	stage.addArg("unclassified", static_cast<int>(stage.out_dd.no_data));
+	stage.handles_no_data = true;
+	stage.code =
+		"if (nodata) {\n"
+		"	result = no_data_class;\n"
+		"	nodata = false;\n"
+		"}\n"
+		"else {\n"
+		"	result = unclassified;\n"
+		"	for (int i = 0; i < number_of_classes; i++) {\n"
+		"		if (value >= lower_border[i] && value <= upper_border[i])\n"
+		"			result = classes[i];\n"
+		"	}\n"
+		"}";
+	return stage;
+}
+
+std::unique_ptr<GenericRaster> ClassificationOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+	const auto raster_in = getRasterFromSource(0, rect, tools);
+
+	DataDescription out_data_description = getOutputDataDescription(raster_in->dd);
 
 	const int new_nodata_class = (reclassNoData)?noDataClass:static_cast<int>(out_data_description.no_data);
 
+#ifdef MAPPING_NO_OPENCL
+	RangeClassification classification(classification_lower_border, classification_upper_border, classification_classes,
+			static_cast<int>(out_data_description.no_data), new_nodata_class);
+	return classification.apply(*raster_in, out_data_description, Configuration::get<uint32_t>("operators.classification.threads", 0));
+#else
+	RasterOpenCL::init();
+	raster_in->setRepresentation(GenericRaster::Representation::OPENCL);
+
 	auto raster_out = GenericRaster::create(out_data_description, *raster_in, GenericRaster::Representation::OPENCL);
 
 	RasterOpenCL::CLProgram prog;
@@ -131,6 +172,6 @@ std::unique_ptr<GenericRaster> ClassificationOperator::getRaster(const QueryRect
 	prog.run();
 
 	return (raster_out);
-}
 #endif
+}
 #endif
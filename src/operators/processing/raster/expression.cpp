@@ -2,6 +2,7 @@
 #include "datatypes/raster/typejuggling.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
+#include "operators/pixel_operator.h"
 #include "util/formula.h"
 
 
@@ -25,14 +26,17 @@
  *   - Float32
  *   - Float64
  * - output_unit: Unit of the result, "unknown" if unspecified
+ *
+ * With a single input raster, the expression can be fused with other pixel operators (see FusedPixelOperator).
  */
-class ExpressionOperator : public GenericOperator {
+class ExpressionOperator : public GenericOperator, public PixelOperator {
 	public:
 		ExpressionOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
 		virtual ~ExpressionOperator();
 
 #ifndef MAPPING_OPERATOR_STUBS
 		virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools);
+		virtual PixelStage getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const;
 #endif
 	protected:
 		void writeSemanticParameters(std::ostringstream& stream);
@@ -75,6 +79,21 @@ void ExpressionOperator::writeSemanticParameters(std::ostringstream& stream) {
 
 #ifndef MAPPING_OPERATOR_STUBS
 
+PixelStage ExpressionOperator::getPixelStage(const DataDescription &in_dd, const AttributeMaps &attributes) const {
+	Formula f(expression);
+	f.addCLFunctions();
+	f.addVariable("A");
+	auto safe_expression = f.parse();
+
+	DataDescription out_dd(output_type == GDT_Unknown ? in_dd.datatype : output_type, output_unit);
+	if (in_dd.has_no_data)
+		out_dd.addNoData();
+
+	PixelStage stage(out_dd);
+	stage.code = "const STAGE_IN_TYPE A = value;\nresult = " + safe_expression + ";";
+	return stage;
+}
+
 #ifdef MAPPING_NO_OPENCL
 std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
 	throw OperatorException("ExpressionOperator: cannot be executed without OpenCL support");
@@ -2,13 +2,34 @@
 #include "datatypes/raster/typejuggling.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
+#include "util/focal_kernel.h"
+#include "util/enumconverter.h"
+#include "util/configuration.h"
 
 #include <memory>
 #include <cmath>
 #include <json/json.h>
 
+const std::vector<std::pair<FocalKernel::Operation, std::string> > OperationMap {
+	std::make_pair(FocalKernel::Operation::CONVOLUTION, "convolution"),
+	std::make_pair(FocalKernel::Operation::MEAN, "mean"),
+	std::make_pair(FocalKernel::Operation::MIN, "min"),
+	std::make_pair(FocalKernel::Operation::MAX, "max"),
+	std::make_pair(FocalKernel::Operation::MEDIAN, "median")
+};
+
+static EnumConverter<FocalKernel::Operation> OperationConverter(OperationMap);
+
 /**
  * Operator that computes a matrix kernel on a raster
+ *
+ * Parameters:
+ * - matrix_size: the odd width and height of the window
+ * - operation: "convolution" (default), "mean", "min", "max" or "median"
+ * - matrix: the matrix_size * matrix_size integer weights in row-major order, only used for "convolution"
+ *
+ * The source is queried with a border of matrix_size / 2 pixels, so the result does not depend on how a
+ * larger raster is split into tiles.
  */
 class MatrixOperator : public GenericOperator {
 	public:
@@ -21,89 +42,66 @@ class MatrixOperator : public GenericOperator {
 	protected:
 		void writeSemanticParameters(std::ostringstream& stream);
 	private:
-		int matrixsize, *matrix;
+		FocalKernel::Operation operation;
+		int matrixsize;
+		std::vector<int> matrix;
 };
 
 
 
-MatrixOperator::MatrixOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params) : GenericOperator(sourcecounts, sources), matrixsize(0), matrix(nullptr) {
+MatrixOperator::MatrixOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params) : GenericOperator(sourcecounts, sources), operation(FocalKernel::Operation::CONVOLUTION), matrixsize(0) {
 	assumeSources(1);
 
+	operation = OperationConverter.from_string(params.get("operation", "convolution").asString());
+
 	matrixsize = params.get("matrix_size", 0).asInt();
 	if (matrixsize <= 1 || matrixsize % 2 != 1)
 		throw OperatorException("MatrixKernel: kernel size must be odd and greater than 1");
 
+	if (operation != FocalKernel::Operation::CONVOLUTION)
+		return;
+
 	Json::Value array = params["matrix"];
 	size_t matrix_count = (size_t) matrixsize*matrixsize;
 	if (array.size() != matrix_count)
 		throw OperatorException("MatrixKernel: matrix array has the wrong length");
 
-	matrix = new int[matrix_count];
+	matrix.resize(matrix_count);
 	for (size_t i=0;i<matrix_count;i++) {
 		matrix[i] = array.get((Json::Value::ArrayIndex) i, 0).asInt();
 	}
 }
 
-MatrixOperator::~MatrixOperator() {
-	delete [] matrix;
-	matrix = nullptr;
-}
+MatrixOperator::~MatrixOperator() = default;
+
 REGISTER_OPERATOR(MatrixOperator, "matrix");
 
 void MatrixOperator::writeSemanticParameters(std::ostringstream& stream) {
-	stream << "{\"matrix\":[" << matrix[0];
-	for (int i = 1; i < matrixsize; ++i) {
+	stream << "{\"matrix_size\":" << matrixsize;
+	if (operation != FocalKernel::Operation::CONVOLUTION) {
+		stream << ",\"operation\":\"" << OperationConverter.to_string(operation) << "\"}";
+		return;
+	}
+	stream << ",\"matrix\":[" << matrix[0];
+	for (size_t i = 1; i < matrix.size(); ++i) {
 		stream << "," << matrix[i];
 	}
 	stream << "]}";
 }
 
 #ifndef MAPPING_OPERATOR_STUBS
-template<typename T> T cap(T v, T min, T max) {
-	return std::min(max, std::max(v, min));
-}
-
-template<typename T>
-struct matrixkernel{
-	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster_src, int matrix_size, int *matrix) {
-		raster_src->setRepresentation(GenericRaster::Representation::CPU);
-
-		auto raster_dest_guard = GenericRaster::create(raster_src->dd, *raster_src, GenericRaster::Representation::CPU);
-		Raster2D<T> *raster_dest = (Raster2D<T> *) raster_dest_guard.get();
-
-		auto max = raster_src->dd.unit.getMin();
-		auto min = raster_src->dd.unit.getMax();
-
-		int matrix_offset = matrix_size / 2;
-		int width = raster_src->width;
-		int height = raster_src->height;
-
-		// TODO: Rand getrennt verarbeiten, in der mitte ist kein cap nötig
-		for (int y=0;y<height;y++) {
-			for (int x=0;x<width;x++) {
-				typename RasterTypeInfo<T>::accumulator_type value = 0;
-				for (int ky=0;ky<matrix_size;ky++) {
-					for (int kx=0;kx<matrix_size;kx++) {
-						int source_x = cap(x+kx-matrix_offset, 0, width-1);
-						int source_y = cap(y+ky-matrix_offset, 0, height-1);
-
-						value += matrix[ky*matrix_size+kx] * raster_src->get(source_x, source_y);
-					}
-				}
-				if (value > max) value = max;
-				if (value < min) value = min;
-				raster_dest->set(x, y, value);
-			}
-		}
-
-		return raster_dest_guard;
-	}
-};
-
 #include "operators/processing/raster/matrixkernel.cl.h"
 
 std::unique_ptr<GenericRaster> MatrixOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	auto raster_in = getRasterFromSource(0, rect, tools);
+	// request a halo of the pixels under the window, so tiles of a larger query fit together seamlessly
+	const int halo = matrixsize / 2;
+	QueryRectangle rect_halo = rect;
+	rect_halo.enlargePixels(halo);
+	auto raster_in = getRasterFromSource(0, rect_halo, tools, RasterQM::EXACT);
+
+	// only convolutions are implemented in OpenCL
+	if (operation != FocalKernel::Operation::CONVOLUTION)
+		return FocalKernel(operation, matrixsize).apply(*raster_in, Configuration::get<uint32_t>("operators.matrixkernel.threads", 0))->cut(halo, halo, rect.xres, rect.yres);
 
 #ifndef MAPPING_NO_OPENCL
 	RasterOpenCL::init();
@@ -128,7 +126,7 @@ std::unique_ptr<GenericRaster> MatrixOperator::getRaster(const QueryRectangle &r
 			matrix_buffer_size,
 			nullptr //data
 		);
-		RasterOpenCL::getQueue()->enqueueWriteBuffer(matrixbuffer, CL_TRUE, 0, matrix_buffer_size, matrix);
+		RasterOpenCL::getQueue()->enqueueWriteBuffer(matrixbuffer, CL_TRUE, 0, matrix_buffer_size, matrix.data());
 		prog.addArg(matrixbuffer);
 		prog.run();
 
@@ -139,9 +137,9 @@ std::unique_ptr<GenericRaster> MatrixOperator::getRaster(const QueryRectangle &r
 		throw OpenCLException(ss.str(), MappingExceptionType::CONFIDENTIAL);
 	}
 
-	return raster_out;
+	return raster_out->cut(halo, halo, rect.xres, rect.yres);
 #else
-	return callUnaryOperatorFunc<matrixkernel>(raster_in.get(), matrixsize, matrix);
+	return FocalKernel(operation, matrixsize, matrix).apply(*raster_in, Configuration::get<uint32_t>("operators.matrixkernel.threads", 0))->cut(halo, halo, rect.xres, rect.yres);
 #endif
 }
 #endif
@@ -6,6 +6,7 @@
 #include "datatypes/polygoncollection.h"
 #include "operators/operator.h"
 #include "operators/processing/scripting/r_script.h"
+#include "operators/processing/scripting/rserver_connection_pool.h"
 #include "util/configuration.h"
 
 #include <mutex>
@@ -99,28 +100,25 @@ void RScriptOperator::writeSemanticParameters(std::ostringstream& stream) {
 auto RScriptOperator::runScript(const QueryRectangle &rect, char requested_type,
                                 const QueryTools &tools) -> std::unique_ptr<BinaryReadBuffer> {
 
-	auto host = Configuration::get<std::string>("operators.r.location");
-	BinaryStream stream = BinaryStream::connectURL(host);
-
-	BinaryWriteBuffer request;
-	request.write<const int &>(RSERVER_MAGIC_NUMBER);
-	request.write<char &>(requested_type);
-	request.write<std::string &>(source);
-	request.write<int>(getRasterSourceCount());
-	request.write<int>(getPointCollectionSourceCount());
-	request.write<int>(getLineCollectionSourceCount());
-	request.write<int>(getPolygonCollectionSourceCount());
-	request.write<const QueryRectangle &>(rect);
-	request.write<int>(600); // timeout
-	if(result_type == "plot") {
-		request.write<size_t &>(plot_width);
-		request.write<size_t &>(plot_height);
-	}
-	stream.write(request);
+	auto location = Configuration::get<std::string>("operators.r.location");
+	std::unique_ptr<BinaryReadBuffer> response;
+	BinaryStream stream = RServerConnectionPool::start(location, [&](BinaryWriteBuffer &request) {
+		request.write<const int &>(RSERVER_MAGIC_NUMBER);
+		request.write<char &>(requested_type);
+		request.write<std::string &>(source);
+		request.write<int>(getRasterSourceCount());
+		request.write<int>(getPointCollectionSourceCount());
+		request.write<int>(getLineCollectionSourceCount());
+		request.write<int>(getPolygonCollectionSourceCount());
+		request.write<const QueryRectangle &>(rect);
+		request.write<int>(600); // timeout
+		if(result_type == "plot") {
+			request.write<size_t &>(plot_width);
+			request.write<size_t &>(plot_height);
+		}
+	}, response);
 
 	while (true) {
-		auto response = make_unique<BinaryReadBuffer>();
-		stream.read(*response);
 		auto type = response->read<char>();
 
 		// fprintf(stderr, "Server got command %d\n", (int) type);
@@ -165,8 +163,14 @@ auto RScriptOperator::runScript(const QueryRectangle &rect, char requested_type,
                 }
             }
             stream.write(requested_data);
+
+            response = make_unique<BinaryReadBuffer>();
+            stream.read(*response);
 		}
 		else {
+			// the final output was read completely, so the connection can run the next script
+			RServerConnectionPool::release(location, std::move(stream));
+
 			if (type == -RSERVER_TYPE_ERROR) {
 				std::string err;
 				response->read(&err);
@@ -0,0 +1,70 @@
+#include "operators/processing/scripting/rserver_connection_pool.h"
+#include "util/configuration.h"
+#include "util/exceptions.h"
+#include "util/make_unique.h"
+
+#include <poll.h>
+
+
+std::mutex RServerConnectionPool::mutex;
+std::unordered_map<std::string, std::vector<BinaryStream>> RServerConnectionPool::connections;
+
+BinaryStream RServerConnectionPool::start(const std::string &location, const std::function<void(BinaryWriteBuffer &)> &write_request,
+		std::unique_ptr<BinaryReadBuffer> &response) {
+	BinaryStream stream;
+	bool reused = false;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto &idle = connections[location];
+		while (!idle.empty()) {
+			stream = std::move(idle.back());
+			idle.pop_back();
+			if (isIdle(stream)) {
+				reused = true;
+				break;
+			}
+		}
+	}
+	if (!reused)
+		stream = BinaryStream::connectURL(location);
+
+	while (true) {
+		try {
+			BinaryWriteBuffer request;
+			write_request(request);
+			response = make_unique<BinaryReadBuffer>();
+			stream.write(request);
+			stream.read(*response);
+			return stream;
+		}
+		catch (const NetworkException &) {
+			if (!reused)
+				throw;
+			// the server has closed the pooled connection in the meantime, the script did not start yet
+			stream = BinaryStream::connectURL(location);
+			reused = false;
+		}
+	}
+}
+
+void RServerConnectionPool::release(const std::string &location, BinaryStream stream) {
+	auto pool_size = Configuration::get<size_t>("operators.r.pool_size", 0);
+	std::lock_guard<std::mutex> guard(mutex);
+	auto &idle = connections[location];
+	if (idle.size() < pool_size)
+		idle.push_back(std::move(stream));
+}
+
+bool RServerConnectionPool::isIdle(const BinaryStream &stream) {
+	struct pollfd fd;
+	fd.fd = stream.getReadFD();
+	fd.events = POLLIN;
+	fd.revents = 0;
+	return poll(&fd, 1, 0) == 0;
+}
+
+size_t RServerConnectionPool::getIdleCount(const std::string &location) {
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = connections.find(location);
+	return it == connections.end() ? 0 : it->second.size();
+}
@@ -0,0 +1,48 @@
+#ifndef OPERATORS_PROCESSING_SCRIPTING_RSERVER_CONNECTION_POOL_H
+#define OPERATORS_PROCESSING_SCRIPTING_RSERVER_CONNECTION_POOL_H
+
+#include "util/binarystream.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Connections to the R server which finished a script and can run the next one.
+ *
+ * The protocol in r_script.h has the server close the connection after the final output, so connections are
+ * only kept when operators.r.pool_size is above 0, for servers that keep them open instead. Idle connections
+ * that were closed by the server are detected before they are handed out again.
+ */
+class RServerConnectionPool {
+	public:
+		/*
+		 * Sends a request on an idle connection to the server at location, or on a new one, and reads the
+		 * first reply into response. write_request is called for every attempt: if a reused connection fails
+		 * before the reply arrives, the server has closed it in the meantime and the request is sent again
+		 * on a new connection. Failures of new connections are thrown.
+		 */
+		static BinaryStream start(const std::string &location, const std::function<void(BinaryWriteBuffer &)> &write_request,
+				std::unique_ptr<BinaryReadBuffer> &response);
+
+		/*
+		 * Returns a connection whose final output has been read completely, so it can run the next script
+		 */
+		static void release(const std::string &location, BinaryStream stream);
+
+		/*
+		 * An idle connection has nothing to read, a closed one is readable because of the eof
+		 */
+		static bool isIdle(const BinaryStream &stream);
+
+		static size_t getIdleCount(const std::string &location);
+
+	private:
+		static std::mutex mutex;
+		static std::unordered_map<std::string, std::vector<BinaryStream>> connections;
+};
+
+#endif
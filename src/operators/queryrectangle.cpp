@@ -2,6 +2,7 @@
 #include "operators/queryrectangle.h"
 #include "util/exceptions.h"
 #include "util/binarystream.h"
+#include "util/concat.h"
 
 #include <algorithm>
 
@@ -74,20 +75,30 @@ QueryRectangle QueryRectangle::project(const CrsId &targetCrs, const GDAL::CRSTr
 	// calculate the bounding box and return it as the projected query rectangle
 	auto samples = sample_borders(20);
 
+	std::vector<bool> failed;
+	transformer.transform(samples, failed);
+
 	double minX = std::numeric_limits<double>::max();
 	double minY = std::numeric_limits<double>::max();
 	double maxX = -std::numeric_limits<double>::max();
 	double maxY = -std::numeric_limits<double>::max();
 
+	// samples outside the domain of either projection are skipped
+	size_t projected = 0;
 	for (size_t i = 0; i < samples.size(); ++i) {
+		if (failed[i])
+			continue;
 		Coordinate &s = samples[i];
-		transformer.transform(s.x, s.y);
 		minX = std::min(minX, s.x);
 		maxX = std::max(maxX, s.x);
 		minY = std::min(minY, s.y);
 		maxY = std::max(maxY, s.y);
+		projected++;
 	}
 
+	if (projected == 0)
+		throw GDALException(concat("QueryRectangle cannot be projected from ", crsId.to_string(), " to ", targetCrs.to_string(), ": no point of its border can be transformed"));
+
 	QueryRectangle result(
 			SpatialReference(targetCrs, minX, minY, maxX, maxY),
 			*this,
@@ -95,3 +106,8 @@ QueryRectangle QueryRectangle::project(const CrsId &targetCrs, const GDAL::CRSTr
 	);
 	return result;
 }
+
+QueryRectangle QueryRectangle::project(const CrsId &targetCrs) const {
+	auto transformer = GDAL::CRSTransformer::get(crsId, targetCrs);
+	return project(targetCrs, *transformer);
+}
@@ -49,10 +49,18 @@ class QueryRectangle : public SpatialReference, public TemporalReference, public
 		void serialize(BinaryWriteBuffer &buffer, bool is_persistent_memory) const;
 
 		/**
-		 * Project the query rectangle using gdal transformer
+		 * Project the query rectangle using gdal transformer. The result is the bounding box
+		 * of points sampled along the border. Samples that cannot be transformed are ignored,
+		 * so the result may cover only the part of the rectangle valid in both projections.
+		 * @throws GDALException if none of the samples can be transformed
 		 */
 		QueryRectangle project(const CrsId &targetCrs, const GDAL::CRSTransformer &transformer) const;
 
+		/**
+		 * Project the query rectangle using a cached transformer
+		 */
+		QueryRectangle project(const CrsId &targetCrs) const;
+
 		void enlargePixels(int pixels);
 		void enlargeFraction(double fraction);
 };
@@ -0,0 +1,41 @@
+
+#include "operators/raster_tiling.h"
+#include "util/exceptions.h"
+
+#include <algorithm>
+
+
+RasterTiling::RasterTiling(const QueryRectangle &rect, uint32_t tile_size) : rect(rect), tile_size(tile_size) {
+	if (rect.restype != QueryResolution::Type::PIXELS)
+		throw ArgumentException("RasterTiling: the query rectangle needs a pixel resolution");
+	if (tile_size == 0)
+		throw ArgumentException("RasterTiling: the tile size must be positive");
+
+	tiles_x = (rect.xres + tile_size - 1) / tile_size;
+	tiles_y = (rect.yres + tile_size - 1) / tile_size;
+}
+
+RasterTiling::Tile RasterTiling::getTile(size_t index) const {
+	if (index >= getTileCount())
+		throw ArgumentException("RasterTiling: tile index out of range");
+
+	uint32_t x = (uint32_t) (index % tiles_x) * tile_size;
+	uint32_t y = (uint32_t) (index / tiles_x) * tile_size;
+	uint32_t width = std::min(tile_size, rect.xres - x);
+	uint32_t height = std::min(tile_size, rect.yres - y);
+
+	double pixel_size_x = (rect.x2 - rect.x1) / rect.xres;
+	double pixel_size_y = (rect.y2 - rect.y1) / rect.yres;
+
+	// the borders of the last tiles are taken from the query, so rounding errors cannot add up
+	double x1 = rect.x1 + x * pixel_size_x;
+	double y1 = rect.y1 + y * pixel_size_y;
+	double x2 = x + width == rect.xres ? rect.x2 : rect.x1 + (x + width) * pixel_size_x;
+	double y2 = y + height == rect.yres ? rect.y2 : rect.y1 + (y + height) * pixel_size_y;
+
+	return Tile(x, y, QueryRectangle(
+		SpatialReference(rect.crsId, x1, y1, x2, y2),
+		rect,
+		QueryResolution::pixels(width, height)
+	));
+}
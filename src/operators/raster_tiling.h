@@ -0,0 +1,45 @@
+#ifndef OPERATORS_RASTER_TILING_H
+#define OPERATORS_RASTER_TILING_H
+
+#include "operators/queryrectangle.h"
+
+#include <cstdint>
+
+/**
+ * Splits a raster query into tiles of at most tile_size * tile_size pixels on the pixel grid of the query.
+ *
+ * Every tile is an ordinary query rectangle, so the tiles can be computed one after another by the whole
+ * operator graph. The memory needed then depends on the tile size and the depth of the graph instead of the
+ * size of the result. Operators that read neighbouring pixels request a halo around their query rectangle
+ * from their sources, so the tiles put together equal the result of the whole query.
+ */
+class RasterTiling {
+	public:
+		class Tile {
+			public:
+				Tile(uint32_t x, uint32_t y, const QueryRectangle &rect) : x(x), y(y), rect(rect) {}
+
+				// the position of the tile's first pixel in the whole raster
+				uint32_t x;
+				uint32_t y;
+				// the query of the tile, its size is rect.xres * rect.yres
+				QueryRectangle rect;
+		};
+
+		RasterTiling(const QueryRectangle &rect, uint32_t tile_size);
+
+		size_t getTileCount() const { return (size_t) tiles_x * tiles_y; }
+
+		/**
+		 * @return the tile with the given index, tiles are numbered row by row
+		 */
+		Tile getTile(size_t index) const;
+
+	private:
+		QueryRectangle rect;
+		uint32_t tile_size;
+		uint32_t tiles_x;
+		uint32_t tiles_y;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "datatypes/raster.h"
+#include "operators/operator.h"
+#include "util/gdal_timesnap.h"
+#include "util/gdal_source_datasets.h"
+#include "util/cog_reader.h"
+#include "util/configuration.h"
+
+#include <cmath>
+#include <json/json.h>
+
+/**
+ * Operator that loads raster data from tiled GeoTIFFs, e.g. cloud-optimized GeoTIFFs, without GDAL.
+ * It uses the same dataset descriptions as the gdal_source, but only reads the tiles that are needed for a query
+ * from the overview that matches the query resolution. The directories of the files are cached between queries.
+ *
+ * Parameters:
+ * 		sourcename: the name of the imported gdal dataset.
+ *		channel:	which channel is to be loaded (channels are 1 based)
+ */
+class RasterCogSourceOperator : public GenericOperator {
+	public:
+		RasterCogSourceOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params);
+		~RasterCogSourceOperator() override;
+
+		void getProvenance(ProvenanceCollection &pc) override;
+
+		std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect, const QueryTools &tools) override;
+
+	protected:
+		void writeSemanticParameters(std::ostringstream &stream) override;
+
+	private:
+		std::string sourcename;
+		int channel;
+};
+
+
+RasterCogSourceOperator::RasterCogSourceOperator(int sourcecounts[], GenericOperator *sources[], Json::Value &params) : GenericOperator(sourcecounts, sources) {
+	assumeSources(0);
+	sourcename = params.get("sourcename", "").asString();
+	if (sourcename.length() == 0)
+		throw OperatorException("CogSourceOperator: missing sourcename");
+	channel = params.get("channel", 1).asInt();
+}
+
+RasterCogSourceOperator::~RasterCogSourceOperator() = default;
+
+REGISTER_OPERATOR(RasterCogSourceOperator, "cog_source");
+
+void RasterCogSourceOperator::getProvenance(ProvenanceCollection &pc) {
+	// the same datasets as the gdal_source, so users need the same permission to read them
+	std::string local_identifier = "data.gdal_source." + sourcename;
+	Json::Value datasetJson = GDALSourceDataSets::getDataSetDescription(sourcename);
+
+	Json::Value provenanceinfo = datasetJson["provenance"];
+	if (provenanceinfo.isObject()) {
+		pc.add(Provenance(provenanceinfo.get("citation", "").asString(),
+								provenanceinfo.get("license", "").asString(),
+								provenanceinfo.get("uri", "").asString(),
+								local_identifier));
+	} else {
+		pc.add(Provenance("", "", "", local_identifier));
+	}
+}
+
+void RasterCogSourceOperator::writeSemanticParameters(std::ostringstream &stream) {
+	Json::Value params;
+
+	params["sourcename"] = sourcename;
+	params["channel"] = channel;
+
+	Json::FastWriter writer;
+	stream << writer.write(params);
+}
+
+std::unique_ptr<GenericRaster> RasterCogSourceOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
+	Json::Value datasetJson = GDALSourceDataSets::getDataSetDescription(sourcename);
+	GDALTimesnap::GDALDataLoadingInfo loadingInfo = GDALTimesnap::getDataLoadingInfo(datasetJson, channel, rect);
+
+	if (rect.crsId != loadingInfo.crsId)
+		throw OperatorException("COG Source: Requested wrong CrsId");
+
+	auto reader = CogReader::open(loadingInfo.fileName);
+	if (loadingInfo.channel < 1 || loadingInfo.channel > reader->getBandCount())
+		throw OperatorException("COG Source: rasterid not found");
+
+	// read from the coarsest overview that still has the resolution of the query
+	double query_scale_x = (rect.x2 - rect.x1) / rect.xres;
+	double query_scale_y = (rect.y2 - rect.y1) / rect.yres;
+	size_t level_index = reader->selectLevel(query_scale_x, query_scale_y);
+	auto &level = reader->getLevel(level_index);
+
+	double origin_x = reader->getOriginX(), origin_y = reader->getOriginY();
+	double scale_x = level.scale_x, scale_y = level.scale_y;
+
+	// the pixels of the level covering the query, like the gdal_source
+	int64_t pixel_x1 = static_cast<int64_t>(floor((rect.x1 - origin_x) / scale_x));
+	int64_t pixel_y1 = static_cast<int64_t>(floor((rect.y1 - origin_y) / scale_y));
+	int64_t pixel_x2 = static_cast<int64_t>(floor((rect.x2 - origin_x) / scale_x));
+	int64_t pixel_y2 = static_cast<int64_t>(floor((rect.y2 - origin_y) / scale_y));
+	if (pixel_x1 > pixel_x2)
+		std::swap(pixel_x1, pixel_x2);
+	if (pixel_y1 > pixel_y2)
+		std::swap(pixel_y1, pixel_y2);
+	auto pixel_width = static_cast<uint32_t>(pixel_x2 - pixel_x1 + 1);
+	auto pixel_height = static_cast<uint32_t>(pixel_y2 - pixel_y1 + 1);
+
+	double x1 = origin_x + scale_x * pixel_x1;
+	double y1 = origin_y + scale_y * pixel_y1;
+	double x2 = x1 + scale_x * pixel_width;
+	double y2 = y1 + scale_y * pixel_height;
+	if (x1 > x2)
+		std::swap(x1, x2);
+	if (y1 > y2)
+		std::swap(y1, y2);
+
+	bool hasnodata = reader->hasNoData();
+	double nodata = reader->getNoData();
+	if (!std::isnan(loadingInfo.nodata)) {
+		hasnodata = true;
+		nodata = loadingInfo.nodata;
+	}
+
+	DataDescription dd(reader->getDataType(), loadingInfo.unit, hasnodata, nodata);
+	SpatioTemporalReference stref(SpatialReference(rect.crsId, x1, y1, x2, y2), loadingInfo.tref);
+
+	auto width = static_cast<uint32_t>(std::max(1.0, std::ceil(pixel_width * std::abs(scale_x / query_scale_x))));
+	auto height = static_cast<uint32_t>(std::max(1.0, std::ceil(pixel_height * std::abs(scale_y / query_scale_y))));
+	auto raster = GenericRaster::create(dd, stref, width, height);
+
+	reader->read(level_index, loadingInfo.channel, pixel_x1, pixel_y1, pixel_width, pixel_height, width, height,
+			raster->getDataForWriting(), hasnodata ? nodata : 0, Configuration::get<uint32_t>("operators.cogsource.threads", 0));
+
+	//flip here so the tiff result will not be flipped, like the gdal_source
+	return raster->flip(false, true);
+}
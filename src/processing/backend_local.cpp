@@ -1,6 +1,7 @@
 
 #include "util/configuration.h"
 #include "processing/queryprocessor_backend.h"
+#include "operators/plan_cache.h"
 #include "util/make_unique.h"
 
 class LocalQueryProcessor : public QueryProcessor::QueryProcessorBackend {
@@ -23,7 +24,7 @@ LocalQueryProcessor::~LocalQueryProcessor() {
 
 std::unique_ptr<QueryProcessor::QueryResult> LocalQueryProcessor::process(const Query &q, bool includeProvenance) {
 	try {
-		auto op = GenericOperator::fromJSON(q.operatorgraph);
+		auto op = OperatorPlanCache::get(q.operatorgraph);
 
 		QueryProfiler profiler;
 		QueryTools tools(profiler);
@@ -9,11 +9,19 @@
 #include "operators/operator.h" // For QueryProfiler
 #include "util/configuration.h"
 #include "util/log.h"
+#include "util/sha1.h"
 
 #include <sstream>
+#include <fstream>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <algorithm>
 #include <unordered_map>
+#include <vector>
+#include <ctime>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
 
 namespace RasterOpenCL {
 
@@ -35,6 +43,7 @@ size_t getMaxAllocSize() {
 	return max_alloc_size;
 }
 
+void warmProgramCache();
 void init() {
 	if (initialization_status == 0) {
 		Profiler::Profiler p("CL_INIT");
@@ -105,6 +114,8 @@ void init() {
 			queue = cl::CommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE);
 
 			initialization_status = 1;
+
+			warmProgramCache();
 		}
 	}
 
@@ -241,41 +252,235 @@ const std::string &getRasterInfoStructSource() {
 
 /*
  * ProgramCache
+ *
+ * Built programs are kept for the lifetime of the process. If global.opencl.programcache.directory is set, their
+ * binaries are also stored on disk, so a fresh process loads them instead of compiling the source again. Every
+ * device and driver gets its own subdirectory, the files are named <kernel>-<hash of build options and source>.bin.
+ * A subdirectory holds at most global.opencl.programcache.size bytes; when a new binary exceeds it, the binaries
+ * that were least recently built or loaded are removed.
  */
 
 // For the first implementation, only one program may be compiled at a time, and
 // there's no replacement strategy; the cache just keeps on filling.
 static std::mutex program_cache_mutex;
 static std::unordered_map<std::string, cl::Program> program_cache;
+static ProgramCacheStatistics program_cache_statistics;
+
+static const std::string program_build_options = ""; // "-cl-std=CL2.0"
 
 void freeProgramCache() {
 	std::lock_guard<std::mutex> guard(program_cache_mutex);
 	program_cache.clear();
+	program_cache_statistics = ProgramCacheStatistics();
+}
+
+ProgramCacheStatistics getProgramCacheStatistics() {
+	std::lock_guard<std::mutex> guard(program_cache_mutex);
+	return program_cache_statistics;
+}
+
+static std::string sha1Hex(const std::string &data) {
+	SHA1 sha1;
+	sha1.addBytes(data);
+	return sha1.digest().asHex();
+}
+
+/*
+ * The directory holding the binaries for the current device, empty if binaries are not stored on disk.
+ * Binaries are only stored for contexts with a single device, which is what init() creates in practice.
+ */
+static std::string getProgramCacheDirectory() {
+	auto directory = Configuration::get<std::string>("global.opencl.programcache.directory", "");
+	if (directory.empty() || deviceList.size() != 1)
+		return "";
+
+	std::ostringstream identity;
+	identity << platform.getInfo<CL_PLATFORM_NAME>() << "\n" << platform.getInfo<CL_PLATFORM_VERSION>() << "\n"
+			<< device.getInfo<CL_DEVICE_VENDOR>() << "\n" << device.getInfo<CL_DEVICE_NAME>() << "\n"
+			<< device.getInfo<CL_DEVICE_VERSION>() << "\n" << device.getInfo<CL_DRIVER_VERSION>();
+	return directory + "/" + sha1Hex(identity.str()).substr(0, 16);
+}
+
+static cl::Program buildFromBinary(const std::string &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file.good() && !file.eof())
+		throw OpenCLException(concat("Could not read program binary ", filename));
+	if (binary.empty())
+		throw OpenCLException(concat("Program binary ", filename, " is empty"));
+
+	cl::Program::Binaries binaries(1, std::make_pair(binary.data(), binary.size()));
+	cl::Program program(context, deviceList, binaries);
+	program.build(deviceList, program_build_options.c_str());
+	return program;
+}
+
+static void storeBinary(const cl::Program &program, const std::string &directory, const std::string &filename) {
+	auto sizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
+	if (sizes.size() != 1 || sizes[0] == 0)
+		return;
+	std::vector<char> binary(sizes[0]);
+	char *binary_pointer = binary.data();
+	if (clGetProgramInfo(program(), CL_PROGRAM_BINARIES, sizeof(char *), &binary_pointer, nullptr) != CL_SUCCESS)
+		return;
+
+	// other processes may read the file at any time, so it is renamed into place once it is complete
+	boost::filesystem::create_directories(directory);
+	std::string temporary = concat(filename, ".", getpid(), ".tmp");
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file.write(binary.data(), binary.size());
+		if (!file.good())
+			throw OpenCLException(concat("Could not write program binary ", temporary));
+	}
+	boost::filesystem::rename(temporary, filename);
+}
+
+/*
+ * Removes the least recently used binaries of a directory until it fits into global.opencl.programcache.size,
+ * but never the one that was just stored. Other processes may remove files at the same time, so errors are ignored.
+ */
+static void pruneBinaries(const std::string &directory, const std::string &keep) {
+	auto max_size = Configuration::get<size_t>("global.opencl.programcache.size", 268435456);
+	if (max_size == 0)
+		return;
+
+	struct StoredBinary {
+		std::time_t used;
+		uintmax_t size;
+		boost::filesystem::path path;
+	};
+	std::vector<StoredBinary> binaries;
+	uintmax_t total_size = 0;
+	boost::system::error_code error;
+	for (boost::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+		if (it->path().extension() != ".bin")
+			continue;
+		boost::system::error_code file_error;
+		auto size = boost::filesystem::file_size(it->path(), file_error);
+		auto used = boost::filesystem::last_write_time(it->path(), file_error);
+		if (file_error)
+			continue;
+		binaries.push_back(StoredBinary{used, size, it->path()});
+		total_size += size;
+	}
+	if (total_size <= max_size)
+		return;
+
+	std::sort(binaries.begin(), binaries.end(), [](const StoredBinary &a, const StoredBinary &b) {
+		return a.used < b.used;
+	});
+	for (auto &binary : binaries) {
+		if (total_size <= max_size)
+			break;
+		if (binary.path == keep)
+			continue;
+		boost::system::error_code remove_error;
+		if (boost::filesystem::remove(binary.path, remove_error))
+			total_size -= binary.size;
+	}
 }
 
-cl::Program compileSource(const std::string &sourcecode) {
+cl::Program compileSource(const std::string &sourcecode, const std::string &kernelname) {
 	std::lock_guard<std::mutex> guard(program_cache_mutex);
 
-	if (program_cache.count(sourcecode) == 1) {
-		return program_cache.at(sourcecode);
+	std::string key = sha1Hex(program_build_options + "\n" + sourcecode);
+	auto cached = program_cache.find(key);
+	if (cached != program_cache.end()) {
+		program_cache_statistics.memory_hits++;
+		return cached->second;
+	}
+
+	std::string directory = getProgramCacheDirectory();
+	std::string filename = directory.empty() ? "" : concat(directory, "/", kernelname, "-", key, ".bin");
+	if (!filename.empty() && boost::filesystem::exists(filename)) {
+		try {
+			cl::Program program = buildFromBinary(filename);
+			program_cache[key] = program;
+			program_cache_statistics.disk_hits++;
+			// the modification time tells pruneBinaries() which binaries are still in use
+			boost::system::error_code error;
+			boost::filesystem::last_write_time(filename, std::time(nullptr), error);
+			return program;
+		}
+		catch (const std::exception &e) {
+			// e.g. a truncated file or a binary the driver no longer accepts, it is replaced below
+			Log::warn(concat("Ignoring cached OpenCL program ", filename, ": ", e.what()));
+		}
 	}
 
 	cl::Program program;
 	try {
 		cl::Program::Sources sources(1, std::make_pair(sourcecode.c_str(), sourcecode.length()));
 		program = cl::Program(context, sources);
-		program.build(deviceList,""); // "-cl-std=CL2.0"
+		program.build(deviceList, program_build_options.c_str());
 	}
 	catch (const cl::Error &e) {
 		std::stringstream ss;
 		ss << "Error building cl::Program: " << e.what() << " " << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(deviceList[0]);
 		throw OpenCLException(ss.str(), MappingExceptionType::CONFIDENTIAL);
 	}
+	program_cache_statistics.builds++;
 
-	program_cache[sourcecode] = program;
+	if (!filename.empty()) {
+		try {
+			storeBinary(program, directory, filename);
+			pruneBinaries(directory, filename);
+		}
+		catch (const std::exception &e) {
+			Log::warn(concat("Could not store OpenCL program ", filename, ": ", e.what()));
+		}
+	}
+
+	program_cache[key] = program;
 	return program;
 }
 
+/*
+ * Loads the binaries of the kernels listed in global.opencl.programcache.warmup from the disk cache, "*" loads all
+ * of them, which global.opencl.programcache.size bounds. Called by init(), so the first queries of a process do not
+ * wait for the driver. Loading does not count as a use for pruneBinaries(), or "*" would keep every binary alive.
+ */
+void warmProgramCache() {
+	std::vector<std::string> kernels;
+	try {
+		kernels = Configuration::getVector<std::string>("global.opencl.programcache.warmup");
+	}
+	catch (const ArgumentException &) {
+		return;
+	}
+	std::string directory = getProgramCacheDirectory();
+	if (kernels.empty() || directory.empty() || !boost::filesystem::is_directory(directory))
+		return;
+
+	bool all_kernels = std::find(kernels.begin(), kernels.end(), "*") != kernels.end();
+	auto start = std::chrono::steady_clock::now();
+	size_t loaded = 0;
+
+	std::lock_guard<std::mutex> guard(program_cache_mutex);
+	for (boost::filesystem::directory_iterator it(directory), end; it != end; ++it) {
+		// <kernel>-<key>.bin, the key is a 40 character sha1
+		std::string name = it->path().filename().string();
+		if (name.size() < 46 || name.compare(name.size() - 4, 4, ".bin") != 0 || name[name.size() - 45] != '-')
+			continue;
+		std::string kernel = name.substr(0, name.size() - 45);
+		std::string key = name.substr(name.size() - 44, 40);
+		if ((!all_kernels && std::find(kernels.begin(), kernels.end(), kernel) == kernels.end()) || program_cache.count(key) > 0)
+			continue;
+
+		try {
+			program_cache[key] = buildFromBinary(it->path().string());
+			loaded++;
+		}
+		catch (const std::exception &e) {
+			Log::warn(concat("Ignoring cached OpenCL program ", it->path().string(), ": ", e.what()));
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Log::info(concat("Loaded ", loaded, " cached OpenCL programs in ", seconds, "s"));
+}
+
 
 /*
  * CLProgram
@@ -351,7 +556,7 @@ void CLProgram::compile(const std::string &sourcecode, const char *kernelname) {
 
 	assembled_source << sourcecode;
 
-	cl::Program program = compileSource(assembled_source.str());
+	cl::Program program = compileSource(assembled_source.str(), kernelname);
 
 	try {
 		kernel = make_unique<cl::Kernel>(program, kernelname);
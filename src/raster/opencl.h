@@ -35,6 +35,17 @@ namespace RasterOpenCL {
 
 	size_t getMaxAllocSize();
 
+	/**
+	 * How compiled programs were obtained since the process started or free() last emptied the program cache.
+	 * Binaries loaded by the warmup in init() are not counted.
+	 */
+	struct ProgramCacheStatistics {
+		size_t memory_hits = 0; // the program was already built in this process
+		size_t disk_hits = 0; // the binary was loaded from global.opencl.programcache.directory
+		size_t builds = 0; // the source was compiled
+	};
+	ProgramCacheStatistics getProgramCacheStatistics();
+
 	/**
 	 * This class allows the execution of OpenCL kernels on mapping input data
 	 */
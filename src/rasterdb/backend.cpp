@@ -55,6 +55,13 @@ void RasterDBBackend::writeTile(rasterid_t rasterid, ByteBuffer &buffer, uint32_
 	throw std::runtime_error("RasterDBBackend::writeTile() not implemented in this backend");
 }
 
+void RasterDBBackend::writeTiles(rasterid_t rasterid, const std::vector<TileData> &tiles, const std::string &compression) {
+	for (auto &tile : tiles) {
+		if (!hasTile(rasterid, tile.width, tile.height, tile.depth, tile.offx, tile.offy, tile.offz, tile.zoom))
+			writeTile(rasterid, *tile.buffer, tile.width, tile.height, tile.depth, tile.offx, tile.offy, tile.offz, tile.zoom, compression);
+	}
+}
+
 void RasterDBBackend::linkRaster(int channelid, double time_of_reference, double time_start, double time_end) {
 	throw std::runtime_error("RasterDBBackend::linkRaster() not implemented in this backend");
 }
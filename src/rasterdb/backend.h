@@ -45,6 +45,17 @@ class RasterDBBackend {
 				double time_end;
 		};
 
+		class TileData {
+			public:
+				TileData(std::unique_ptr<ByteBuffer> buffer, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom)
+					: buffer(std::move(buffer)), width(width), height(height), depth(depth), offx(offx), offy(offy), offz(offz), zoom(zoom) {}
+
+				std::unique_ptr<ByteBuffer> buffer;
+				uint32_t width, height, depth;
+				int offx, offy, offz;
+				int zoom;
+		};
+
 		static std::unique_ptr<RasterDBBackend> create(const std::string &backend, const std::string &location, const ConfigurationTable& params);
 
 		virtual ~RasterDBBackend() {};
@@ -56,6 +67,11 @@ class RasterDBBackend {
 
 		virtual rasterid_t createRaster(int channel, double time_start, double time_end, const AttributeMaps &global_attributes);
 		virtual void writeTile(rasterid_t rasterid, ByteBuffer &buffer, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom, const std::string &compression);
+		/**
+		 * Writes all tiles of a raster at once, skipping tiles that already exist. The default implementation
+		 * calls hasTile() and writeTile() for each tile, backends should override it to batch their writes.
+		 */
+		virtual void writeTiles(rasterid_t rasterid, const std::vector<TileData> &tiles, const std::string &compression);
 		virtual void linkRaster(int channelid, double time_of_reference, double time_start, double time_end);
 
 		virtual std::string readJSON() = 0;
@@ -1,7 +1,9 @@
 
 #include "rasterdb/backend.h"
+#include "rasterdb/tile_index.h"
 
 #include "util/sqlite.h"
+#include "util/log.h"
 
 #include <sys/file.h> // flock()
 #include <sys/types.h> // the next three are for posix open()
@@ -9,6 +11,8 @@
 #include <fcntl.h>
 
 #include <string>
+#include <mutex>
+#include <unordered_map>
 
 #include <iostream>
 #include <fstream>
@@ -27,6 +31,7 @@ class LocalRasterDBBackend : public RasterDBBackend {
 		virtual std::string readJSON();
 		virtual rasterid_t createRaster(int channel, double time_start, double time_end, const AttributeMaps &attributes);
 		virtual void writeTile(rasterid_t rasterid, ByteBuffer &buffer, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom, const std::string &compression);
+		virtual void writeTiles(rasterid_t rasterid, const std::vector<TileData> &tiles, const std::string &compression);
 		virtual void linkRaster(int channelid, double time_of_reference, double time_start, double time_end);
 
 
@@ -40,8 +45,13 @@ class LocalRasterDBBackend : public RasterDBBackend {
 	private:
 		void init();
 		void cleanup();
+		std::shared_ptr<const RasterDBTileIndex> loadIndex();
 
 		int lockedfile;
+		bool use_index;
+		size_t index_size;
+		// only used when opened read-only, the shared lock keeps imports out while the source is open
+		std::shared_ptr<const RasterDBTileIndex> index;
 		std::string location;
 		std::string sourcename;
 		std::string filename_json;
@@ -53,6 +63,9 @@ class LocalRasterDBBackend : public RasterDBBackend {
 
 
 LocalRasterDBBackend::LocalRasterDBBackend(const std::string &location, const ConfigurationTable& params) : lockedfile(-1), location(location) {
+	ConfigurationTable table(params);
+	use_index = table.get<bool>("index", true);
+	index_size = table.get<size_t>("index_size", 1048576);
 }
 
 LocalRasterDBBackend::~LocalRasterDBBackend() {
@@ -182,9 +195,110 @@ void LocalRasterDBBackend::open(const std::string &_sourcename, bool writeable)
 		db.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_rik ON attributes (rasterid, isstring, key)");
 	}
 
+	/*
+	 * Step #3: load the in-memory index of rasters and tiles
+	 */
+	if (!writeable && use_index)
+		index = loadIndex();
+
 	is_opened = true;
 }
 
+/*
+ * The indexes outlive the backends, so sources that are opened again and again are only indexed once.
+ * Rows are never deleted and new rows get higher ids, so an index is up to date as long as the highest ids did not change.
+ * Together the cached indexes hold at most rasterdb.local.index_size tiles, the least recently used are dropped first.
+ * Backends that still use a dropped index keep it alive until they are closed.
+ */
+namespace {
+	struct CachedTileIndex {
+		int64_t max_rasterid;
+		int64_t max_tileid;
+		uint64_t last_used;
+		std::shared_ptr<const RasterDBTileIndex> index;
+	};
+}
+static std::unordered_map<std::string, CachedTileIndex> tile_indexes;
+static std::mutex tile_indexes_mutex;
+static uint64_t tile_indexes_uses = 0;
+
+// drops the least recently used indexes except the given one until all fit into max_tiles, call with tile_indexes_mutex held
+static void evictTileIndexes(size_t max_tiles, const std::string &keep) {
+	size_t tiles = 0;
+	for (auto &entry : tile_indexes)
+		tiles += entry.second.index->getTileCount();
+
+	while (tiles > max_tiles) {
+		auto oldest = tile_indexes.end();
+		for (auto it = tile_indexes.begin(); it != tile_indexes.end(); ++it) {
+			if (it->first != keep && (oldest == tile_indexes.end() || it->second.last_used < oldest->second.last_used))
+				oldest = it;
+		}
+		if (oldest == tile_indexes.end())
+			break;
+		tiles -= oldest->second.index->getTileCount();
+		tile_indexes.erase(oldest);
+	}
+}
+
+std::shared_ptr<const RasterDBTileIndex> LocalRasterDBBackend::loadIndex() {
+	int64_t max_rasterid, max_tileid;
+	try {
+		auto stmt = db.prepareRead("SELECT (SELECT IFNULL(MAX(id), 0) FROM rasters), (SELECT IFNULL(MAX(id), 0) FROM tiles)");
+		if (!stmt.next())
+			return nullptr;
+		max_rasterid = stmt.getInt64(0);
+		max_tileid = stmt.getInt64(1);
+	}
+	catch (const SQLiteException &e) {
+		// nothing has been imported yet
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(tile_indexes_mutex);
+		auto it = tile_indexes.find(filename_db);
+		if (it != tile_indexes.end() && it->second.max_rasterid == max_rasterid && it->second.max_tileid == max_tileid) {
+			it->second.last_used = ++tile_indexes_uses;
+			return it->second.index;
+		}
+	}
+
+	// building large indexes takes a while, other sources can be opened in the meantime
+	auto index = std::make_shared<RasterDBTileIndex>();
+
+	auto stmt_rasters = db.prepareRead("SELECT id, channel, time_start, time_end FROM rasters");
+	while (stmt_rasters.next())
+		index->addRaster(stmt_rasters.getInt(1), RasterDescription{stmt_rasters.getInt64(0), stmt_rasters.getDouble(2), stmt_rasters.getDouble(3)});
+	stmt_rasters.finalize();
+
+	auto stmt_tiles = db.prepareRead("SELECT id, rasterid, x1, y1, x2, y2, zoom, filenr, fileoffset, filebytes, compression FROM tiles");
+	while (stmt_tiles.next()) {
+		uint32_t x1 = stmt_tiles.getInt(2);
+		uint32_t y1 = stmt_tiles.getInt(3);
+		uint32_t x2 = stmt_tiles.getInt(4);
+		uint32_t y2 = stmt_tiles.getInt(5);
+		int zoom = stmt_tiles.getInt(6);
+		TileDescription tile{stmt_tiles.getInt64(0), 0, stmt_tiles.getInt(7), (size_t) stmt_tiles.getInt64(8), (size_t) stmt_tiles.getInt64(9), x1, y1, 0, (x2-x1) >> zoom, (y2-y1) >> zoom, 0, stmt_tiles.getString(10)};
+		index->addTile(stmt_tiles.getInt64(1), zoom, tile, x2, y2);
+	}
+	stmt_tiles.finalize();
+
+	index->build();
+	Log::info("RasterDB: indexed %lu tiles of %s", index->getTileCount(), sourcename.c_str());
+
+	std::lock_guard<std::mutex> guard(tile_indexes_mutex);
+	auto it = tile_indexes.find(filename_db);
+	if (it != tile_indexes.end() && it->second.max_rasterid == max_rasterid && it->second.max_tileid == max_tileid) {
+		// another backend indexed the same source at the same time
+		it->second.last_used = ++tile_indexes_uses;
+		return it->second.index;
+	}
+	tile_indexes[filename_db] = CachedTileIndex{max_rasterid, max_tileid, ++tile_indexes_uses, index};
+	evictTileIndexes(index_size, filename_db);
+	return index;
+}
+
 void LocalRasterDBBackend::cleanup() {
 	if (lockedfile != -1) {
 		close(lockedfile); // also removes the lock acquired by flock()
@@ -301,6 +415,84 @@ void LocalRasterDBBackend::writeTile(rasterid_t rasterid, ByteBuffer &buffer, ui
 	stmt.exec();
 }
 
+void LocalRasterDBBackend::writeTiles(rasterid_t rasterid, const std::vector<TileData> &tiles, const std::string &compression) {
+	if (!this->is_opened)
+		throw ArgumentException("Cannot call writeTiles() before open() on a RasterDBBackend");
+
+	// Step 1: skip the tiles of earlier imports
+	std::vector<const TileData *> missing_tiles;
+	for (auto &tile : tiles) {
+		if (!hasTile(rasterid, tile.width, tile.height, tile.depth, tile.offx, tile.offy, tile.offz, tile.zoom))
+			missing_tiles.push_back(&tile);
+	}
+	if (missing_tiles.empty())
+		return;
+
+	// Step 2: append all data to the file, buffered into large sequential writes
+	size_t filenr = 0;
+
+	FILE *f = fopen(filename_data.c_str(), "ab");
+	if (!f)
+		throw SourceException("Could not open data file");
+	setvbuf(f, nullptr, _IOFBF, 8 << 20);
+
+	if (fseek(f, 0, SEEK_END) != 0) {
+		fclose(f);
+		throw SourceException("tell failed");
+	}
+	long int fileoffset = ftell(f);
+	if (fileoffset < 0) {
+		fclose(f);
+		throw SourceException("tell failed");
+	}
+
+	std::vector<long int> fileoffsets;
+	fileoffsets.reserve(missing_tiles.size());
+	for (auto tile : missing_tiles) {
+		auto &buffer = *tile->buffer;
+		if (fwrite(buffer.data, sizeof(unsigned char), buffer.size, f) != buffer.size) {
+			fclose(f);
+			throw SourceException("writing failed, disk full?");
+		}
+		fileoffsets.push_back(fileoffset);
+		fileoffset += buffer.size;
+	}
+	if (fclose(f) != 0)
+		throw SourceException("writing failed, disk full?");
+
+	// Step 3: insert all tiles into the DB in a single transaction
+	db.exec("BEGIN TRANSACTION");
+	try {
+		auto stmt = db.prepare("INSERT INTO tiles (rasterid, x1, y1, z1, x2, y2, z2, zoom, filenr, fileoffset, filebytes, compression)"
+			" VALUES (?,?,?,?,?,?,?,?,?,?,?,?)");
+
+		for (size_t i = 0; i < missing_tiles.size(); i++) {
+			auto &tile = *missing_tiles[i];
+			int zoomfactor = 1 << tile.zoom;
+
+			stmt.bind(1, rasterid);
+			stmt.bind(2, tile.offx); // x1
+			stmt.bind(3, tile.offy); // y1
+			stmt.bind(4, tile.offz); // z1
+			stmt.bind(5, (int32_t) (tile.offx+tile.width*zoomfactor)); // x2
+			stmt.bind(6, (int32_t) (tile.offy+tile.height*zoomfactor)); // y2
+			stmt.bind(7, (int32_t) 0/*(offz+depth*zoomfactor)*/); // z2
+			stmt.bind(8, tile.zoom);
+			stmt.bind(9, (int32_t) filenr);
+			stmt.bind(10, (int64_t) fileoffsets[i]);
+			stmt.bind(11, (int64_t) tile.buffer->size);
+			stmt.bind(12, compression);
+
+			stmt.exec();
+		}
+	}
+	catch (...) {
+		db.exec("ROLLBACK");
+		throw;
+	}
+	db.exec("COMMIT");
+}
+
 void LocalRasterDBBackend::linkRaster(int channelid, double time_of_reference, double time_start, double time_end) {
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call linkRaster() before open() on a RasterDBBackend");
@@ -339,8 +531,15 @@ RasterDBBackend::RasterDescription LocalRasterDBBackend::getClosestRaster(int ch
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call getClosestRaster() before open() on a RasterDBBackend");
 
+	if (index) {
+		auto raster = index->getClosestRaster(channelid, t1, t2);
+		if (!raster)
+			throw NoRasterForGivenTimeException( concat("No raster found for the given time (source=", sourcename, ", channel=", channelid, ", time=", t1, "-", t2, ")"));
+		return *raster;
+	}
+
 	// find a raster that's valid during the given timestamp
-	auto stmt = db.prepare("SELECT id, time_start, time_end FROM rasters WHERE channel = ? AND time_start <= ? AND time_end >= ? ORDER BY time_start DESC limit 1");
+	auto stmt = db.prepareRead("SELECT id, time_start, time_end FROM rasters WHERE channel = ? AND time_start <= ? AND time_end >= ? ORDER BY time_start DESC limit 1");
 	stmt.bind(1, channelid);
 	stmt.bind(2, t1);
 	stmt.bind(3, t2);
@@ -358,7 +557,7 @@ void LocalRasterDBBackend::readAttributes(rasterid_t rasterid, AttributeMaps &at
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call readAttributes() before open() on a RasterDBBackend");
 
-	auto stmt_md = db.prepare("SELECT isstring, key, value FROM attributes WHERE rasterid = ?");
+	auto stmt_md = db.prepareRead("SELECT isstring, key, value FROM attributes WHERE rasterid = ?");
 	stmt_md.bind(1, rasterid);
 	while (stmt_md.next()) {
 		int isstring = stmt_md.getInt(0);
@@ -377,7 +576,14 @@ int LocalRasterDBBackend::getBestZoom(rasterid_t rasterid, int desiredzoom) {
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call getBestZoom() before open() on a RasterDBBackend");
 
-	auto stmt_z = db.prepare("SELECT MAX(zoom) FROM tiles WHERE rasterid = ? AND zoom <= ?");
+	if (index) {
+		auto max_zoom = index->getBestZoom(rasterid, desiredzoom);
+		if (max_zoom < 0)
+			throw SourceException("No zoom level found for the given channel and timestamp");
+		return max_zoom;
+	}
+
+	auto stmt_z = db.prepareRead("SELECT MAX(zoom) FROM tiles WHERE rasterid = ? AND zoom <= ?");
 	stmt_z.bind(1, rasterid);
 	stmt_z.bind(2, desiredzoom);
 
@@ -396,10 +602,13 @@ const std::vector<RasterDBBackend::TileDescription> LocalRasterDBBackend::enumer
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call enumerateTiles() before open() on a RasterDBBackend");
 
+	if (index)
+		return index->enumerateTiles(channelid, rasterid, x1, y1, x2, y2, zoom);
+
 	std::vector<TileDescription> result;
 
 	// find all overlapping rasters in DB
-	auto stmt = db.prepare("SELECT id,x1,y1,z1,x2,y2,z2,filenr,fileoffset,filebytes,compression FROM tiles"
+	auto stmt = db.prepareRead("SELECT id,x1,y1,z1,x2,y2,z2,filenr,fileoffset,filebytes,compression FROM tiles"
 		" WHERE rasterid = ? AND zoom = ? AND x1 < ? AND y1 < ? AND x2 > ? AND y2 > ? ORDER BY filenr ASC, fileoffset ASC");
 
 	stmt.bind(1, rasterid);
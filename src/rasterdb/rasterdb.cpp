@@ -7,10 +7,14 @@
 #include "util/sqlite.h"
 #include "util/configuration.h"
 #include "util/make_unique.h"
+#include "util/parallel_for.h"
 #include "operators/operator.h"
 
 
 #include <unordered_map>
+#include <deque>
+#include <thread>
+#include <condition_variable>
 #include <limits.h>
 #include <stdio.h>
 #include <cstdlib>
@@ -298,6 +302,11 @@ void RasterDB::import(const char *filename, int sourcechannel, int channelid, do
 
 	std::lock_guard<std::mutex> guard(mutex);
 
+	auto raster = readImportFile(filename, sourcechannel);
+	import(raster.get(), channelid, time_start, time_end, compression);
+}
+
+std::unique_ptr<GenericRaster> RasterDB::readImportFile(const char *filename, int sourcechannel) {
 	bool raster_flipx, raster_flipy;
 	auto raster = GenericRaster::fromGDAL(filename, sourcechannel, raster_flipx, raster_flipy, crs->crsId);
 
@@ -316,7 +325,7 @@ void RasterDB::import(const char *filename, int sourcechannel, int channelid, do
 		raster = raster->flip(need_flipx, need_flipy);
 	}
 
-	import(raster.get(), channelid, time_start, time_end, compression);
+	return raster;
 }
 
 
@@ -395,6 +404,139 @@ void RasterDB::import(GenericRaster *raster, int channelid, double time_start, d
 }
 
 
+/*
+ * Bulk import
+ */
+// cuts the raster into compressed tiles for all zoom levels, just like the import of a single raster
+static std::vector<RasterDBBackend::TileData> encodeTiles(GenericRaster *raster, const GDALCRS &crs, const DataDescription &dd, const std::string &compression) {
+	std::vector<RasterDBBackend::TileData> tiles;
+	uint32_t tilesize = DEFAULT_TILE_SIZE;
+
+	for (int zoom=0;;zoom++) {
+		int zoomfactor = 1 << zoom;
+
+		if (zoom > 0 && crs.size[0] / zoomfactor < tilesize && crs.size[1] / zoomfactor < tilesize && crs.size[2] / zoomfactor < tilesize)
+			break;
+
+		// all zoom levels are scaled from the same decoded raster
+		GenericRaster *zoomedraster = raster;
+		std::unique_ptr<GenericRaster> zoomedraster_guard;
+		if (zoom > 0) {
+			zoomedraster_guard = raster->scale(crs.size[0] / zoomfactor, crs.size[1] / zoomfactor, crs.size[2] / zoomfactor);
+			zoomedraster = zoomedraster_guard.get();
+		}
+
+		uint32_t zoff = 0;
+		uint32_t zsize = 0;
+		for (uint32_t yoff = 0; yoff == 0 || yoff < zoomedraster->height; yoff += tilesize) {
+			uint32_t ysize = std::min(zoomedraster->height - yoff, tilesize);
+			for (uint32_t xoff = 0; xoff < zoomedraster->width; xoff += tilesize) {
+				uint32_t xsize = std::min(zoomedraster->width - xoff, tilesize);
+
+				auto tile = GenericRaster::create(dd, SpatioTemporalReference::unreferenced(), xsize, ysize, zsize);
+				tile->blit(zoomedraster, -(int)xoff, -(int)yoff, -(int)zoff);
+
+				tiles.emplace_back(RasterConverter::direct_encode(tile.get(), compression), xsize, ysize, zsize, xoff*zoomfactor, yoff*zoomfactor, zoff*zoomfactor, zoom);
+			}
+		}
+	}
+	return tiles;
+}
+
+namespace {
+	// a raster that was read and encoded, waiting to be written
+	struct EncodedRaster {
+		const RasterDB::ImportFile *file;
+		AttributeMaps attributes;
+		std::vector<RasterDBBackend::TileData> tiles;
+	};
+}
+
+void RasterDB::import(const std::vector<ImportFile> &files, const std::string &compression, uint32_t num_threads) {
+	if (!isWriteable())
+		throw SourceException("Cannot import into a source opened as read-only");
+	for (auto &file : files) {
+		if (file.channelid < 0 || file.channelid >= channelcount)
+			throw SourceException(concat("RasterDB::import: unknown channel ", file.channelid, " for ", file.filename));
+	}
+
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (num_threads == 0)
+		num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	// rasters waiting for the writer are kept in memory, so their number is limited
+	size_t queue_capacity = num_threads;
+
+	std::mutex queue_mutex;
+	std::condition_variable queue_changed;
+	std::deque<EncodedRaster> queue;
+	bool reading_done = false, writing_failed = false;
+	std::exception_ptr reading_error;
+
+	std::thread reader([&] {
+		try {
+			parallelFor(files.size(), 1, num_threads, [&] (size_t begin, size_t end) {
+				for (auto i = begin; i < end; i++) {
+					auto &file = files[i];
+					auto raster = readImportFile(file.filename.c_str(), file.sourcechannel);
+					EncodedRaster encoded{&file, raster->global_attributes, encodeTiles(raster.get(), *crs, channels[file.channelid]->dd, compression)};
+					raster.reset();
+
+					std::unique_lock<std::mutex> lock(queue_mutex);
+					queue_changed.wait(lock, [&] { return queue.size() < queue_capacity || writing_failed; });
+					if (writing_failed)
+						throw SourceException("import aborted");
+					queue.push_back(std::move(encoded));
+					queue_changed.notify_all();
+				}
+			});
+		}
+		catch (...) {
+			reading_error = std::current_exception();
+		}
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		reading_done = true;
+		queue_changed.notify_all();
+	});
+
+	// only this thread writes to the backend
+	try {
+		size_t imported = 0;
+		while (true) {
+			EncodedRaster encoded;
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+				queue_changed.wait(lock, [&] { return !queue.empty() || reading_done; });
+				if (queue.empty())
+					break;
+				encoded = std::move(queue.front());
+				queue.pop_front();
+				queue_changed.notify_all();
+			}
+
+			auto &file = *encoded.file;
+			auto rasterid = backend->createRaster(file.channelid, file.time_start, file.time_end, encoded.attributes);
+			backend->writeTiles(rasterid, encoded.tiles, compression);
+			imported++;
+			printf("imported %s with %lu tiles (%lu of %lu)\n", file.filename.c_str(), encoded.tiles.size(), imported, files.size());
+		}
+	}
+	catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			writing_failed = true;
+			queue_changed.notify_all();
+		}
+		reader.join();
+		throw;
+	}
+	reader.join();
+
+	if (reading_error)
+		std::rethrow_exception(reading_error);
+}
+
+
 void RasterDB::linkRaster(int channelid, double time_of_reference, double time_start, double time_end) {
 	if (!isWriteable())
 		throw SourceException("Cannot link rasters in a source opened as read-only");
@@ -555,7 +697,11 @@ std::unique_ptr<GenericRaster> RasterDB::query(const QueryRectangle &rect, Query
 	if (crs->crsId != rect.crsId)
 		throw OperatorException(concat("SourceOperator: wrong crsId requested. Source is ", crs->crsId.to_string(), ", requested ", rect.crsId.to_string()));
 
-	std::lock_guard<std::mutex> guard(mutex);
+	// Read-only sources are shared-locked against imports, so their tiles cannot change. Their queries run
+	// concurrently, each thread reads the tile index on its own connection.
+	std::unique_lock<std::mutex> guard(mutex, std::defer_lock);
+	if (isWriteable())
+		guard.lock();
 
 	// Get all pixel coordinates that need to be returned. The endpoints of the QueryRectangle are inclusive.
 	// floor() returns the index of the pixel containing our boundary points.
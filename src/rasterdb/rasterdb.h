@@ -5,6 +5,7 @@
 #include <exception>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include "datatypes/raster.h"
 #include "rasterdb/converters/converter.h"
@@ -96,7 +97,20 @@ class RasterDB {
 		virtual ~RasterDB();
 
 	public:
+		struct ImportFile {
+			std::string filename;
+			int sourcechannel;
+			int channelid;
+			double time_start;
+			double time_end;
+		};
+
 		void import(const char *filename, int sourcechannel, int channelid, double time_start, double time_end, const std::string &compression); //  = "GZIP"
+		/**
+		 * Imports many files at once. Files are read, tiled and compressed on num_threads threads (0 uses one
+		 * per core), while the finished rasters are written one after another with batched writes.
+		 */
+		void import(const std::vector<ImportFile> &files, const std::string &compression, uint32_t num_threads = 0);
 		void linkRaster(int channelid, double time_of_reference, double time_start, double time_end);
 		std::unique_ptr<GenericRaster> query(const QueryRectangle &rect, QueryProfiler &profiler, int channelid, bool transform = true);
 
@@ -107,6 +121,7 @@ class RasterDB {
 		static std::string getSourceDescription(const std::string &sourcename);
 
 	private:
+		std::unique_ptr<GenericRaster> readImportFile(const char *filename, int sourcechannel);
 		void import(GenericRaster *raster, int channelid, double time_start, double time_end, const std::string &compression); //  = "GZIP"
 		std::unique_ptr<GenericRaster> load(int channelid, const TemporalReference &t, int x1, int y1, int x2, int y2, int zoom = 0, bool transform = true, size_t *io_cost = nullptr);
 
@@ -0,0 +1,182 @@
+
+#include "rasterdb/tile_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+void RasterDBTileIndex::addRaster(int channelid, const RasterDescription &raster) {
+	channels[channelid].rasters.push_back(raster);
+}
+
+void RasterDBTileIndex::addTile(rasterid_t rasterid, int zoom, const TileDescription &tile, uint32_t x2, uint32_t y2) {
+	tiles[rasterid][zoom].add(tile, Box{tile.x1, tile.y1, x2, y2});
+	tilecount++;
+}
+
+void RasterDBTileIndex::build() {
+	for (auto &c : channels) {
+		auto &channel = c.second;
+		std::sort(channel.rasters.begin(), channel.rasters.end(), [] (const RasterDescription &a, const RasterDescription &b) {
+			return a.time_start < b.time_start;
+		});
+		channel.max_time_end.resize(channel.rasters.size());
+		for (size_t i = 0; i < channel.rasters.size(); i++)
+			channel.max_time_end[i] = i == 0 ? channel.rasters[i].time_end : std::max(channel.max_time_end[i-1], channel.rasters[i].time_end);
+	}
+
+	for (auto &raster : tiles) {
+		for (auto &zoom : raster.second)
+			zoom.second.pack();
+	}
+}
+
+const RasterDBTileIndex::RasterDescription *RasterDBTileIndex::getClosestRaster(int channelid, double t1, double t2) const {
+	auto it = channels.find(channelid);
+	if (it == channels.end())
+		return nullptr;
+	auto &channel = it->second;
+
+	// the last raster starting at or before t1
+	auto pos = std::upper_bound(channel.rasters.begin(), channel.rasters.end(), t1, [] (double t, const RasterDescription &raster) {
+		return t < raster.time_start;
+	}) - channel.rasters.begin();
+
+	// walk back until a raster lasts until t2, or no earlier raster can
+	for (auto i = pos - 1; i >= 0 && channel.max_time_end[i] >= t2; i--) {
+		if (channel.rasters[i].time_end >= t2)
+			return &channel.rasters[i];
+	}
+	return nullptr;
+}
+
+int RasterDBTileIndex::getBestZoom(rasterid_t rasterid, int desiredzoom) const {
+	auto it = tiles.find(rasterid);
+	if (it == tiles.end())
+		return -1;
+
+	auto zoom = it->second.upper_bound(desiredzoom);
+	if (zoom == it->second.begin())
+		return -1;
+	return std::prev(zoom)->first;
+}
+
+std::vector<RasterDBTileIndex::TileDescription> RasterDBTileIndex::enumerateTiles(int channelid, rasterid_t rasterid, int x1, int y1, int x2, int y2, int zoom) const {
+	std::vector<TileDescription> result;
+
+	auto it = tiles.find(rasterid);
+	if (it == tiles.end())
+		return result;
+	auto index = it->second.find(zoom);
+	if (index == it->second.end())
+		return result;
+
+	std::vector<const TileDescription *> found;
+	index->second.query(Box{x1, y1, x2, y2}, found);
+
+	// reading in file order keeps the reads sequential
+	std::sort(found.begin(), found.end(), [] (const TileDescription *a, const TileDescription *b) {
+		return a->fileid < b->fileid || (a->fileid == b->fileid && a->offset < b->offset);
+	});
+
+	result.reserve(found.size());
+	for (auto tile : found) {
+		result.push_back(*tile);
+		// linked rasters share their tiles with the raster of another channel
+		result.back().channelid = channelid;
+	}
+	return result;
+}
+
+
+/*
+ * SpatialIndex
+ */
+void RasterDBTileIndex::SpatialIndex::add(const TileDescription &tile, const Box &box) {
+	tiles.push_back(tile);
+	boxes.push_back(box);
+}
+
+/*
+ * Sort-Tile-Recursive packing: the tiles are sorted into vertical slices by x, and by y within each slice.
+ * Consecutive tiles then form the leaf nodes, which are grouped the same way up to the root.
+ */
+void RasterDBTileIndex::SpatialIndex::pack() {
+	auto count = tiles.size();
+	if (count == 0)
+		return;
+
+	std::vector<size_t> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	auto center_x = [this] (size_t i) { return boxes[i].x1 + boxes[i].x2; };
+	auto center_y = [this] (size_t i) { return boxes[i].y1 + boxes[i].y2; };
+
+	std::sort(order.begin(), order.end(), [&] (size_t a, size_t b) { return center_x(a) < center_x(b); });
+	auto leaves = (count + NODE_SIZE - 1) / NODE_SIZE;
+	auto slice_size = NODE_SIZE * (size_t) std::ceil(std::sqrt((double) leaves));
+	for (size_t start = 0; start < count; start += slice_size) {
+		auto end = std::min(start + slice_size, count);
+		std::sort(order.begin() + start, order.begin() + end, [&] (size_t a, size_t b) { return center_y(a) < center_y(b); });
+	}
+
+	std::vector<TileDescription> sorted_tiles;
+	std::vector<Box> sorted_boxes;
+	sorted_tiles.reserve(count);
+	sorted_boxes.reserve(count);
+	for (auto i : order) {
+		sorted_tiles.push_back(std::move(tiles[i]));
+		sorted_boxes.push_back(boxes[i]);
+	}
+	tiles.swap(sorted_tiles);
+	boxes.swap(sorted_boxes);
+
+	level_ends.clear();
+	level_ends.push_back(count);
+	size_t level_start = 0;
+	while (level_ends.back() - level_start > 1) {
+		auto level_end = level_ends.back();
+		for (auto child = level_start; child < level_end; child += NODE_SIZE) {
+			Box node = boxes[child];
+			for (auto i = child + 1; i < std::min(child + NODE_SIZE, level_end); i++) {
+				node.x1 = std::min(node.x1, boxes[i].x1);
+				node.y1 = std::min(node.y1, boxes[i].y1);
+				node.x2 = std::max(node.x2, boxes[i].x2);
+				node.y2 = std::max(node.y2, boxes[i].y2);
+			}
+			boxes.push_back(node);
+		}
+		level_start = level_end;
+		level_ends.push_back(boxes.size());
+	}
+}
+
+void RasterDBTileIndex::SpatialIndex::query(const Box &box, std::vector<const TileDescription *> &result) const {
+	if (tiles.empty())
+		return;
+
+	auto levelStart = [this] (size_t level) { return level == 0 ? 0 : level_ends[level-1]; };
+	auto overlaps = [&box] (const Box &other) {
+		return other.x1 < box.x2 && other.y1 < box.y2 && other.x2 > box.x1 && other.y2 > box.y1;
+	};
+
+	// pairs of level and position in boxes, starting at the root
+	std::vector<std::pair<size_t, size_t>> stack;
+	stack.emplace_back(level_ends.size() - 1, boxes.size() - 1);
+	while (!stack.empty()) {
+		auto level = stack.back().first;
+		auto node = stack.back().second;
+		stack.pop_back();
+		if (!overlaps(boxes[node]))
+			continue;
+
+		if (level == 0) {
+			result.push_back(&tiles[node]);
+			continue;
+		}
+		auto first_child = levelStart(level - 1) + (node - levelStart(level)) * NODE_SIZE;
+		auto last_child = std::min(first_child + NODE_SIZE, level_ends[level - 1]);
+		for (auto child = first_child; child < last_child; child++)
+			stack.emplace_back(level - 1, child);
+	}
+}
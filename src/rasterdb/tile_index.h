@@ -0,0 +1,74 @@
+#ifndef RASTERDB_TILE_INDEX_H
+#define RASTERDB_TILE_INDEX_H
+
+#include "rasterdb/backend.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An in-memory index over the rasters and tiles of a RasterDB source, answering the lookups of a query
+ * without any round trips to the database.
+ *
+ * Rasters are indexed by time for each channel, tiles by their extent with a packed R-tree for each raster and zoom level.
+ * Fill the index with addRaster() and addTile(), then call build(). The built index is immutable and can be
+ * queried from several threads.
+ */
+class RasterDBTileIndex {
+	public:
+		using rasterid_t = RasterDBBackend::rasterid_t;
+		using RasterDescription = RasterDBBackend::RasterDescription;
+		using TileDescription = RasterDBBackend::TileDescription;
+
+		void addRaster(int channelid, const RasterDescription &raster);
+		// x2 and y2 are the exclusive end of the tile in unzoomed pixels, as stored in the database
+		void addTile(rasterid_t rasterid, int zoom, const TileDescription &tile, uint32_t x2, uint32_t y2);
+		void build();
+
+		/**
+		 * The latest raster of the channel which is valid from t1 to t2, or nullptr
+		 */
+		const RasterDescription *getClosestRaster(int channelid, double t1, double t2) const;
+		/**
+		 * The highest zoom level of the raster that is not above desiredzoom, or -1
+		 */
+		int getBestZoom(rasterid_t rasterid, int desiredzoom) const;
+		/**
+		 * All tiles overlapping the rectangle from (x1, y1) to (x2, y2), ordered by their position in the data files
+		 */
+		std::vector<TileDescription> enumerateTiles(int channelid, rasterid_t rasterid, int x1, int y1, int x2, int y2, int zoom) const;
+
+		size_t getTileCount() const { return tilecount; }
+	private:
+		struct Box {
+			int64_t x1, y1, x2, y2;
+		};
+
+		class SpatialIndex {
+			public:
+				void add(const TileDescription &tile, const Box &box);
+				void pack();
+				void query(const Box &box, std::vector<const TileDescription *> &result) const;
+			private:
+				static const size_t NODE_SIZE = 16;
+				std::vector<TileDescription> tiles;
+				// the boxes of the tiles, followed by the boxes of the nodes of each level up to the root
+				std::vector<Box> boxes;
+				// the end of each level in boxes
+				std::vector<size_t> level_ends;
+		};
+
+		struct Channel {
+			// sorted by time_start
+			std::vector<RasterDescription> rasters;
+			// the maximum time_end of all rasters up to each position
+			std::vector<double> max_time_end;
+		};
+
+		std::unordered_map<int, Channel> channels;
+		std::unordered_map<rasterid_t, std::map<int, SpatialIndex>> tiles;
+		size_t tilecount = 0;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <unistd.h>
 #include "util/make_unique.h"
 #include "util/base64.h"
 #include <Poco/URI.h>
@@ -36,6 +37,21 @@ static std::string getFCGIParam(FCGX_Request &request, std::string key) {
 	return string;
 }
 
+/**
+ * Adds a single "HTTP_*" environment entry to the params as "header.<name>"
+ */
+static void parseHeaderEntry(const char *entry, Parameters &params) {
+	static const std::string prefix = "HTTP_";
+	const char *separator = std::strchr(entry, '=');
+	if (separator == nullptr || std::strncmp(entry, prefix.c_str(), prefix.length()) != 0)
+		return;
+
+	std::string name(entry + prefix.length(), separator);
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	std::replace(name.begin(), name.end(), '_', '-');
+	params.insert(std::make_pair("header." + name, std::string(separator + 1)));
+}
+
 /**
  * Gets the data from a POST request
  */
@@ -117,6 +133,14 @@ void parseGetData(Parameters &params) {
 	parseQuery(query_string, params);
 }
 
+/**
+ * Parses the HTTP request headers, which the web server passes as HTTP_* variables
+ */
+void parseHeaders(Parameters &params) {
+	for (char **entry = environ; entry != nullptr && *entry != nullptr; ++entry)
+		parseHeaderEntry(*entry, params);
+}
+
 /**
  * Parses POST data from a HTTP request FCGI
  */
@@ -151,3 +175,11 @@ void parseGetData(Parameters &params, FCGX_Request &request) {
 	std::string query_string = getFCGIParam(request, "QUERY_STRING");
 	parseQuery(query_string, params);
 }
+
+/**
+ * Parses the HTTP request headers from a HTTP request FCGI
+ */
+void parseHeaders(Parameters &params, FCGX_Request &request) {
+	for (char **entry = request.envp; entry != nullptr && *entry != nullptr; ++entry)
+		parseHeaderEntry(*entry, params);
+}
@@ -9,8 +9,14 @@ void parseQuery(const std::string& query, Parameters &params);
 void parseGetData(Parameters &params);
 void parsePostData(Parameters &params, std::istream &in);
 
+/**
+ * Adds the HTTP request headers to the params as "header.<name>", e.g. "header.if-none-match"
+ */
+void parseHeaders(Parameters &params);
+
 void parseGetData(Parameters &params, FCGX_Request &request);
 void parsePostData(Parameters &params, std::istream &in, FCGX_Request &request);
+void parseHeaders(Parameters &params, FCGX_Request &request);
 std::unique_ptr<Poco::Net::MultipartReader> getMultipartPostDataReader(Parameters &params, std::istream &in);
 std::string getenv_str(const std::string& varname, bool to_lower);
 
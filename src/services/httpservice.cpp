@@ -53,6 +53,7 @@ void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *e
 		Parameters params;
 		parseGetData(params);
 		parsePostData(params, input);
+		parseHeaders(params);
 
 		auto servicename = params.get("service");
 		auto service = HTTPService::getRegisteredService(servicename, params, response, error);
@@ -60,15 +61,21 @@ void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *e
 		service->run();
 	}
     catch(const MappingException &e){
-        catchExceptions(response, e);
+		// once the headers are out, anything written now would become part of the body, so the response is left
+		// shorter than announced and the client sees an incomplete transfer instead of corrupt data
+		if (response.hasSentHeaders())
+			error << "Request failed after sending the headers: " << e.what() << "\n";
+		else
+			catchExceptions(response, e);
     }
 	catch (const std::exception &e) {
 		error << "Request failed with an exception: " << e.what() << "\n";
-		if (Configuration::get<bool>("global.debug", false)) {
-            response.send500(concat("invalid request: ", e.what()));
-        } else {
-            response.send500("invalid request");
-        }
+		if (!response.hasSentHeaders()) {
+			if (Configuration::get<bool>("global.debug", false))
+				response.send500(concat("invalid request: ", e.what()));
+			else
+				response.send500("invalid request");
+		}
 
 	}
 	Log::off();
@@ -89,6 +96,7 @@ void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *e
 		Parameters params;
 		parseGetData(params, request);
 		parsePostData(params, input, request);
+		parseHeaders(params, request);
 
 		auto servicename = params.get("service");
 		auto service = HTTPService::getRegisteredService(servicename, params, response, error);
@@ -96,15 +104,19 @@ void HTTPService::run(std::streambuf *in, std::streambuf *out, std::streambuf *e
 		service->run();
 	}
     catch(const MappingException &e){
-        catchExceptions(response, e);
+		if (response.hasSentHeaders())
+			error << "Request failed after sending the headers: " << e.what() << "\n";
+		else
+			catchExceptions(response, e);
     }
 	catch (const std::exception &e) {
 		error << "Request failed with an exception: " << e.what() << "\n";
-		if (Configuration::get<bool>("global.debug", false)) {
-            response.send500(concat("invalid request: ", e.what()));
-        } else {
-            response.send500("invalid request");
-        }
+		if (!response.hasSentHeaders()) {
+			if (Configuration::get<bool>("global.debug", false))
+				response.send500(concat("invalid request: ", e.what()));
+			else
+				response.send500("invalid request");
+		}
 	}
 	Log::off();
 }
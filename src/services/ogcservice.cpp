@@ -147,7 +147,7 @@ void OGCService::outputSimpleFeatureCollectionGeoJSON(SimpleFeatureCollection *c
 	response.sendDebugHeader();
 	response.sendContentType("application/json");
 	response.finishHeaders();
-	response << collection->toGeoJSON(displayMetadata);
+	collection->toGeoJSON(response, displayMetadata);
 }
 
 void OGCService::outputSimpleFeatureCollectionCSV(SimpleFeatureCollection *collection) {
@@ -155,7 +155,7 @@ void OGCService::outputSimpleFeatureCollectionCSV(SimpleFeatureCollection *colle
 	response.sendContentType("text/csv");
 	response.sendHeader("Content-Disposition", "attachment; filename=\"export.csv\"");
 	response.finishHeaders();
-	response << collection->toCSV();
+	collection->toCSV(response);
 }
 
 void OGCService::outputSimpleFeatureCollectionARFF(SimpleFeatureCollection* collection){
@@ -163,7 +163,14 @@ void OGCService::outputSimpleFeatureCollectionARFF(SimpleFeatureCollection* coll
 	response.sendContentType("text/arff");
 	response.sendHeader("Content-Disposition", "attachment; filename=\"export.arff\"");
 	response.finishHeaders();
-	response << collection->toARFF();
+	collection->toARFF(response);
+}
+
+void OGCService::outputSimpleFeatureCollectionColumnar(SimpleFeatureCollection *collection) {
+	response.sendDebugHeader();
+	response.sendContentType(COLUMNAR_MIME);
+	response.finishHeaders();
+	collection->toColumnar(response);
 }
 
 void OGCService::exportZip(const std::string &operatorGraph, const char* data, size_t dataLength, const std::string &format, ProvenanceCollection &provenance) {
@@ -175,6 +182,8 @@ void OGCService::exportZip(const std::string &operatorGraph, const char* data, s
 		fileExtension = "csv";
 	else if (format == "image/tiff")
 		fileExtension = "tiff";
+	else if (format == COLUMNAR_MIME)
+		fileExtension = "mapcol";
 	else
 		throw ArgumentException("OGCService: unknown output format");
 	std::string fileName = "data." + fileExtension;
@@ -23,10 +23,13 @@ class OGCService : public HTTPService {
 		void outputSimpleFeatureCollectionGeoJSON(SimpleFeatureCollection *collection, bool displayMetadata = false);
 		void outputSimpleFeatureCollectionCSV(SimpleFeatureCollection *collection);
 		void outputSimpleFeatureCollectionARFF(SimpleFeatureCollection* collection);
+		void outputSimpleFeatureCollectionColumnar(SimpleFeatureCollection *collection);
 
 		void exportZip(const std::string &operatorGraph, const char* data, size_t dataLength, const std::string &format, ProvenanceCollection &provenance);
 
 		static constexpr const char* EXPORT_MIME_PREFIX = "application/x-export;";
+		// binary columnar feature format, see SimpleFeatureCollection::toColumnar()
+		static constexpr const char* COLUMNAR_MIME = "application/x-mapping-columnar";
 };
 
 
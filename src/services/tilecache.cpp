@@ -0,0 +1,244 @@
+
+#include "services/tilecache.h"
+#include "util/configuration.h"
+#include "util/sha1.h"
+#include "util/log.h"
+#include "util/make_unique.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+
+
+size_t TileCache::Entry::getByteSize() const {
+	size_t size = sizeof(Entry) + key.size() + etag.size() + content_type.size() + body.size();
+	for (auto &identifier : identifiers)
+		size += identifier.size();
+	return size;
+}
+
+
+TileCache::TileCache(size_t max_bytes, size_t max_entry_bytes, time_t ttl, const std::string &spill_directory, size_t spill_max_bytes)
+	: max_bytes(max_bytes), max_entry_bytes(max_entry_bytes), ttl(ttl), spill_directory(spill_directory),
+	  spill_max_bytes(spill_directory.empty() ? 0 : spill_max_bytes), current_bytes(0), spilled_bytes(0) {
+}
+
+TileCache::~TileCache() {
+	std::lock_guard<std::mutex> guard(mutex);
+	for (auto &file : spilled_lru)
+		std::remove(getSpillFilename(file.first).c_str());
+}
+
+TileCache *TileCache::getInstance() {
+	// static initialization is thread safe
+	static std::unique_ptr<TileCache> instance = []() -> std::unique_ptr<TileCache> {
+		if (!Configuration::get<bool>("wms.tilecache.enabled", false))
+			return nullptr;
+		auto table = Configuration::getSubTable("wms.tilecache");
+		return make_unique<TileCache>(
+			table.get<size_t>("size", 64 * 1024 * 1024),
+			table.get<size_t>("entrysize", 4 * 1024 * 1024),
+			table.get<time_t>("ttl", 300),
+			table.get<std::string>("spill.directory", ""),
+			table.get<size_t>("spill.size", 0)
+		);
+	}();
+	return instance.get();
+}
+
+std::string TileCache::computeETag(const std::string &key) {
+	SHA1 sha1;
+	sha1.addBytes(key);
+	return sha1.digest().asHex();
+}
+
+bool TileCache::isExpired(const Entry &entry, time_t now) const {
+	return ttl > 0 && entry.created + ttl < now;
+}
+
+std::shared_ptr<const TileCache::Entry> TileCache::get(const std::string &key) {
+	auto etag = computeETag(key);
+	auto now = time(nullptr);
+
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = entries.find(etag);
+	if (it != entries.end()) {
+		auto entry = *(it->second);
+		if (entry->key != key)
+			return nullptr;
+		if (isExpired(*entry, now)) {
+			current_bytes -= entry->getByteSize();
+			lru.erase(it->second);
+			entries.erase(it);
+			return nullptr;
+		}
+		// move to the front of the lru list
+		lru.splice(lru.begin(), lru, it->second);
+		return entry;
+	}
+
+	if (spilled.count(etag) == 0)
+		return nullptr;
+
+	auto entry = loadSpilled(etag, key);
+	removeSpilled(etag);
+	if (!entry || isExpired(*entry, now))
+		return nullptr;
+
+	lru.push_front(entry);
+	entries[etag] = lru.begin();
+	current_bytes += entry->getByteSize();
+	evict();
+	return entry;
+}
+
+std::shared_ptr<const TileCache::Entry> TileCache::put(const std::string &key, const std::string &content_type, std::string body, const std::vector<std::string> &identifiers) {
+	auto entry = std::make_shared<Entry>();
+	entry->key = key;
+	entry->etag = computeETag(key);
+	entry->content_type = content_type;
+	entry->body = std::move(body);
+	entry->identifiers = identifiers;
+	entry->created = time(nullptr);
+
+	size_t size = entry->getByteSize();
+	if (size > max_entry_bytes || size > max_bytes)
+		return nullptr;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = entries.find(entry->etag);
+	if (it != entries.end()) {
+		current_bytes -= (*it->second)->getByteSize();
+		lru.erase(it->second);
+		entries.erase(it);
+	}
+	if (spilled.count(entry->etag) > 0)
+		removeSpilled(entry->etag);
+
+	lru.push_front(entry);
+	entries[entry->etag] = lru.begin();
+	current_bytes += size;
+	evict();
+	return entry;
+}
+
+void TileCache::clear() {
+	std::lock_guard<std::mutex> guard(mutex);
+	lru.clear();
+	entries.clear();
+	current_bytes = 0;
+	while (!spilled_lru.empty())
+		removeSpilled(spilled_lru.front().first);
+}
+
+size_t TileCache::getCurrentBytes() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return current_bytes;
+}
+
+size_t TileCache::getEntryCount() {
+	std::lock_guard<std::mutex> guard(mutex);
+	return entries.size();
+}
+
+/*
+ * Private methods, the caller must hold the lock
+ */
+void TileCache::evict() {
+	auto now = time(nullptr);
+	while (current_bytes > max_bytes && !lru.empty()) {
+		auto entry = lru.back();
+		lru.pop_back();
+		entries.erase(entry->etag);
+		current_bytes -= entry->getByteSize();
+		if (spill_max_bytes > 0 && !isExpired(*entry, now))
+			spill(*entry);
+	}
+}
+
+std::string TileCache::getSpillFilename(const std::string &etag) const {
+	return spill_directory + "/" + etag + ".tile";
+}
+
+static void writeSpillString(std::ofstream &out, const std::string &str) {
+	uint64_t size = str.size();
+	out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+	out.write(str.data(), str.size());
+}
+
+static bool readSpillString(std::ifstream &in, std::string &str) {
+	uint64_t size = 0;
+	if (!in.read(reinterpret_cast<char *>(&size), sizeof(size)))
+		return false;
+	str.resize(size);
+	return (bool) in.read(&str[0], size);
+}
+
+void TileCache::spill(const Entry &entry) {
+	size_t size = entry.getByteSize();
+	if (size > spill_max_bytes)
+		return;
+
+	std::ofstream out(getSpillFilename(entry.etag), std::ios::binary | std::ios::trunc);
+	if (!out) {
+		Log::warn("TileCache: could not write to spill directory %s", spill_directory.c_str());
+		return;
+	}
+	int64_t created = entry.created;
+	out.write(reinterpret_cast<const char *>(&created), sizeof(created));
+	writeSpillString(out, entry.key);
+	writeSpillString(out, entry.content_type);
+	uint64_t identifier_count = entry.identifiers.size();
+	out.write(reinterpret_cast<const char *>(&identifier_count), sizeof(identifier_count));
+	for (auto &identifier : entry.identifiers)
+		writeSpillString(out, identifier);
+	writeSpillString(out, entry.body);
+	out.close();
+	if (!out) {
+		std::remove(getSpillFilename(entry.etag).c_str());
+		return;
+	}
+
+	spilled_lru.emplace_back(entry.etag, size);
+	spilled[entry.etag] = std::prev(spilled_lru.end());
+	spilled_bytes += size;
+
+	while (spilled_bytes > spill_max_bytes && !spilled_lru.empty())
+		removeSpilled(spilled_lru.front().first);
+}
+
+std::shared_ptr<const TileCache::Entry> TileCache::loadSpilled(const std::string &etag, const std::string &key) {
+	std::ifstream in(getSpillFilename(etag), std::ios::binary);
+	if (!in)
+		return nullptr;
+
+	auto entry = std::make_shared<Entry>();
+	entry->etag = etag;
+	int64_t created = 0;
+	uint64_t identifier_count = 0;
+	if (!in.read(reinterpret_cast<char *>(&created), sizeof(created))
+			|| !readSpillString(in, entry->key)
+			|| entry->key != key
+			|| !readSpillString(in, entry->content_type)
+			|| !in.read(reinterpret_cast<char *>(&identifier_count), sizeof(identifier_count)))
+		return nullptr;
+	entry->created = created;
+	entry->identifiers.resize(identifier_count);
+	for (auto &identifier : entry->identifiers) {
+		if (!readSpillString(in, identifier))
+			return nullptr;
+	}
+	if (!readSpillString(in, entry->body))
+		return nullptr;
+	return entry;
+}
+
+void TileCache::removeSpilled(const std::string &etag) {
+	auto it = spilled.find(etag);
+	if (it == spilled.end())
+		return;
+	std::remove(getSpillFilename(etag).c_str());
+	spilled_bytes -= it->second->second;
+	spilled_lru.erase(it->second);
+	spilled.erase(it);
+}
@@ -0,0 +1,109 @@
+#ifndef SERVICES_TILECACHE_H
+#define SERVICES_TILECACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <ctime>
+
+/**
+ * A bounded cache for encoded response bodies of tile requests (e.g. WMS GetMap).
+ *
+ * Tiled web clients request the same tiles over and over again. Even if the operator
+ * result is cached, the service has to fit the raster to the query rectangle, colorize
+ * and encode it. This cache stores the final response body, so repeated requests only
+ * cost a hash lookup.
+ *
+ * Entries are identified by a normalized key string, which is hashed to a SHA1 value. The
+ * hash doubles as the ETag of the response. Entries are evicted in LRU order once the
+ * configured amount of bytes is exceeded. If a spill directory is configured, evicted
+ * entries are written to disk and reloaded on a later miss in memory.
+ *
+ * Each entry remembers the provenance identifiers of the result, so the service can
+ * check the permissions of the user without running the query again.
+ */
+class TileCache {
+	public:
+		class Entry {
+			public:
+				std::string key;
+				std::string etag;
+				std::string content_type;
+				std::string body;
+				std::vector<std::string> identifiers;
+				time_t created;
+
+				size_t getByteSize() const;
+		};
+
+		/**
+		 * Creates a cache
+		 * @param max_bytes the maximum amount of bytes held in memory
+		 * @param max_entry_bytes responses larger than this are not cached
+		 * @param ttl the time in seconds an entry is valid, 0 for unlimited
+		 * @param spill_directory directory for evicted entries, empty to disable spilling
+		 * @param spill_max_bytes the maximum amount of bytes held in the spill directory
+		 */
+		TileCache(size_t max_bytes, size_t max_entry_bytes, time_t ttl, const std::string &spill_directory = "", size_t spill_max_bytes = 0);
+		~TileCache();
+		TileCache(const TileCache &) = delete;
+		TileCache &operator=(const TileCache &) = delete;
+
+		/**
+		 * Returns the process-wide instance configured by the "wms.tilecache" section of the
+		 * configuration or nullptr, if the cache is disabled
+		 */
+		static TileCache *getInstance();
+
+		/**
+		 * Computes the ETag for a given key
+		 */
+		static std::string computeETag(const std::string &key);
+
+		/**
+		 * Looks up the entry for the given key. Returns nullptr if there is no valid entry.
+		 */
+		std::shared_ptr<const Entry> get(const std::string &key);
+
+		/**
+		 * Stores a response body under the given key.
+		 * @return the inserted entry or nullptr, if the body was too large for the cache
+		 */
+		std::shared_ptr<const Entry> put(const std::string &key, const std::string &content_type, std::string body, const std::vector<std::string> &identifiers);
+
+		void clear();
+
+		size_t getCurrentBytes();
+		size_t getEntryCount();
+
+	private:
+		typedef std::list<std::shared_ptr<const Entry>> LruList;
+
+		void evict();
+		void spill(const Entry &entry);
+		std::shared_ptr<const Entry> loadSpilled(const std::string &etag, const std::string &key);
+		void removeSpilled(const std::string &etag);
+		std::string getSpillFilename(const std::string &etag) const;
+		bool isExpired(const Entry &entry, time_t now) const;
+
+		const size_t max_bytes;
+		const size_t max_entry_bytes;
+		const time_t ttl;
+		const std::string spill_directory;
+		const size_t spill_max_bytes;
+
+		std::mutex mutex;
+		LruList lru;
+		std::unordered_map<std::string, LruList::iterator> entries;
+		size_t current_bytes;
+
+		// spilled entries in the order they were written, with their size on disk
+		std::list<std::pair<std::string, size_t>> spilled_lru;
+		std::unordered_map<std::string, std::list<std::pair<std::string, size_t>>::iterator> spilled;
+		size_t spilled_bytes;
+};
+
+#endif
@@ -1,8 +1,19 @@
 
 #include "services/ogcservice.h"
 #include "operators/operator.h"
+#include "operators/raster_tiling.h"
 #include "datatypes/raster.h"
 #include "util/timeparser.h"
+#include "util/configuration.h"
+#include "util/geotiff_writer.h"
+
+#include <functional>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include <cpl_conv.h>
+#include <cpl_vsi.h>
 
 /**
  * Implementation of the OGC WCS standard http://www.opengeospatial.org/standards/wcs
@@ -13,9 +24,32 @@ class WCSService : public OGCService {
 		using OGCService::OGCService;
 		virtual ~WCSService() = default;
 		virtual void run();
+	private:
+		ProvenanceCollection streamCoverage(const std::string &coverage, const QueryRectangle &query_rect, UserDB::User &user, std::ostream &stream, uint32_t tile_size, const std::function<void(uint64_t)> &on_start);
+		ProvenanceCollection writeTiledCoverage(const std::string &coverage, const QueryRectangle &query_rect, UserDB::User &user, const std::string &filename, uint32_t tile_size);
 };
 REGISTER_HTTP_SERVICE(WCSService, "WCS");
 
+/**
+ * A stream buffer that appends everything to a string, so written data can be used without copying it out of a stream
+ */
+class StringAppendBuffer : public std::streambuf {
+	public:
+		explicit StringAppendBuffer(std::string &target) : target(target) {}
+	protected:
+		virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+			target.append(s, (size_t) n);
+			return n;
+		}
+		virtual int_type overflow(int_type c) {
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+				target.push_back(traits_type::to_char_type(c));
+			return traits_type::not_eof(c);
+		}
+	private:
+		std::string &target;
+};
+
 /**
  * This method extracts the CRS information from a semantic opengis.net uri.
  * It accepts simple CRS strings like http://www.opengis.net/def/crs/EPSG/0/4326
@@ -131,11 +165,8 @@ void WCSService::run() {
 			QueryResolution::pixels(sizeX, sizeY)
 		);
 
-		Query query(params.get("coverageid"), Query::ResultType::RASTER, query_rect);
-		auto result = processQuery(query, user);
-		auto result_raster = result->getRaster(GenericOperator::RasterQM::EXACT);
-
-		// TODO: check permissions
+		// large coverages are computed in tiles, so the whole raster never has to be in memory
+		const uint32_t tile_size = Configuration::get<uint32_t>("wcs.tile_size", 2048);
 
 		auto format = params.get("format", "image/tiff");
 		fprintf(stderr,format.c_str());
@@ -145,39 +176,205 @@ void WCSService::run() {
 			format = format.substr(strlen(EXPORT_MIME_PREFIX));
 		}
 
-		GByte* outDataBuffer;
-		vsi_l_offset length;
-		std::string gdalFileName;
-		if(format == "image/tiff") {
-			//setup the output parameters
-			std::string gdalDriver = "GTiff";
-			std::string gdalPrefix = "/vsimem/";
-			gdalFileName = "test.tif";
-			std::string gdalOutFileName = gdalPrefix+gdalFileName;
+		if(format != "image/tiff")
+			throw ArgumentException("WCSService: unknown format");
+		std::string gdalFileName = "test.tif";
+
+		// GeoTIFFs in EPSG projections are written directly into the response while the coverage is computed
+		if(GeoTiffWriter::supportsCrs(query_crsId)) {
+			if(exportMode) {
+				std::string data;
+				StringAppendBuffer data_buffer(data);
+				std::ostream data_stream(&data_buffer);
+				auto provenance = streamCoverage(params.get("coverageid"), query_rect, user, data_stream, tile_size, [&](uint64_t length) {
+					data.reserve(length);
+				});
+				exportZip(params.get("coverageid"), data.data(), data.size(), format, provenance);
+			} else {
+				streamCoverage(params.get("coverageid"), query_rect, user, response, tile_size, [&](uint64_t length) {
+					response.sendHeader("Content-Disposition", concat("attachment; filename=\"",gdalFileName,"\""));
+					response.sendHeader("Content-Length", concat(length));
+					response.finishHeaders();
+				});
+			}
+			return;
+		}
+
+		// other crs are written by GDAL. Large coverages go into a temporary file, so they are never in memory as a whole.
+		// The names must be unique, as several requests may be processed at the same time.
+		GDAL::init();
+		std::string gdalDriver = "GTiff";
+		bool tiled = tile_size > 0 && (sizeX > tile_size || sizeY > tile_size);
+		std::string gdalTempName = CPLGenerateTempFilename("mapping_wcs");
+		std::string gdalOutFileName = tiled ? concat(gdalTempName, ".tif") : concat("/vsimem/", CPLGetFilename(gdalTempName.c_str()), ".tif");
 
+		try {
 			//write the raster into a GDAL file
-			result_raster->toGDAL(gdalOutFileName.c_str(), gdalDriver.c_str());
+			ProvenanceCollection provenance;
+			if (tiled)
+				provenance = writeTiledCoverage(params.get("coverageid"), query_rect, user, gdalOutFileName, tile_size);
+			else {
+				Query query(params.get("coverageid"), Query::ResultType::RASTER, query_rect);
+				auto result = processQuery(query, user);
+				provenance = result->getProvenance();
+				auto result_raster = result->getRaster(GenericOperator::RasterQM::EXACT);
+				result_raster->toGDAL(gdalOutFileName.c_str(), gdalDriver.c_str());
+			}
+
+			VSIStatBufL stat;
+			VSILFILE *file = VSIFOpenL(gdalOutFileName.c_str(), "rb");
+			if (file == nullptr || VSIStatL(gdalOutFileName.c_str(), &stat) != 0) {
+				if (file != nullptr)
+					VSIFCloseL(file);
+				throw ExporterException("WCSService: could not open the written GeoTIFF");
+			}
+			size_t length = static_cast<size_t>(stat.st_size);
+
+			// the file is copied in chunks, the export only keeps it in memory for zipping it
+			std::vector<char> buffer(exportMode ? length : std::min(length, (size_t) 1 << 20));
+			if(exportMode) {
+				bool complete = VSIFReadL(buffer.data(), 1, length, file) == length;
+				VSIFCloseL(file);
+				if (!complete)
+					throw ExporterException("WCSService: could not read the written GeoTIFF");
+				exportZip(params.get("coverageid"), buffer.data(), length, format, provenance);
+			} else {
+				//put the HTML headers for download
+				//response.sendContentType("???"); // TODO
+				response.sendHeader("Content-Disposition", concat("attachment; filename=\"",gdalFileName,"\""));
+				response.sendHeader("Content-Length", concat(length));
+				response.finishHeaders();
+
+				//write the data into the output stream
+				size_t remaining = length;
+				while (remaining > 0) {
+					size_t chunk = VSIFReadL(buffer.data(), 1, std::min(remaining, buffer.size()), file);
+					if (chunk == 0)
+						break;
+					response.write(buffer.data(), chunk);
+					remaining -= chunk;
+				}
+				VSIFCloseL(file);
+			}
+		}
+		catch (...) {
+			VSIUnlink(gdalOutFileName.c_str());
+			throw;
+		}
 
-			//get the bytearray (buffer) and its size
+		//clean the GDAL resources
+		VSIUnlink(gdalOutFileName.c_str());
+	}
+}
 
-			outDataBuffer = VSIGetMemFileBuffer(gdalOutFileName.c_str(), &length, true);
-		} else
-			throw ArgumentException("WCSService: unknown format");
+/**
+ * Computes the coverage tile by tile and writes it as GeoTIFF into the stream. Without compression (the default)
+ * every tile is written as soon as it is computed, so large downloads start right away and only one tile is in
+ * memory, but a failing tile can only leave the response incomplete. With wcs.geotiff.compression set to "deflate",
+ * the tiles are compressed in parallel, but kept in memory and written once all are done.
+ * on_start is called with the size of the file before its first byte is written.
+ * @return the provenance of the coverage
+ */
+ProvenanceCollection WCSService::streamCoverage(const std::string &coverage, const QueryRectangle &query_rect, UserDB::User &user, std::ostream &stream, uint32_t tile_size, const std::function<void(uint64_t)> &on_start) {
+	// tiles in a GeoTIFF are a multiple of 16 pixels wide and high, but not larger than needed for small coverages
+	auto roundUp = [](uint32_t size) { return (size + 15) / 16 * 16; };
+	if (tile_size == 0)
+		tile_size = std::max(query_rect.xres, query_rect.yres);
+	tile_size = roundUp(tile_size);
+	const uint32_t tile_width = std::min(tile_size, roundUp(query_rect.xres));
+	const uint32_t tile_height = std::min(tile_size, roundUp(query_rect.yres));
+
+	GeoTiffWriter::Compression compression;
+	auto compression_name = Configuration::get<std::string>("wcs.geotiff.compression", "none");
+	if (compression_name == "none")
+		compression = GeoTiffWriter::Compression::NONE;
+	else if (compression_name == "deflate")
+		compression = GeoTiffWriter::Compression::DEFLATE;
+	else
+		throw ArgumentException("WCSService: unknown GeoTIFF compression " + compression_name);
+	const uint32_t threads = Configuration::get<uint32_t>("wcs.geotiff.threads", 0);
+
+	RasterTiling tiling(query_rect, tile_size);
+	std::unique_ptr<GeoTiffWriter> writer;
+	ProvenanceCollection provenance;
+
+	for (size_t i = 0; i < tiling.getTileCount(); i++) {
+		auto tile = tiling.getTile(i);
+		Query query(coverage, Query::ResultType::RASTER, tile.rect);
+		auto result = processQuery(query, user);
+		auto raster = result->getRaster(GenericOperator::RasterQM::EXACT);
 
-		if(exportMode) {
-			exportZip(params.get("coverageid"), reinterpret_cast<char*>(outDataBuffer), static_cast<size_t>(length), format, result->getProvenance());
-		} else {
-			//put the HTML headers for download
-			//response.sendContentType("???"); // TODO
-			response.sendHeader("Content-Disposition", concat("attachment; filename=\"",gdalFileName,"\""));
-			response.sendHeader("Content-Length", concat(static_cast<size_t>(length)));
-			response.finishHeaders();
-
-			//write the data into the output stream
-			response.write(reinterpret_cast<char*>(outDataBuffer), static_cast<size_t>(length));
+		// the first tile determines the data type and the no data value of the file
+		if (!writer) {
+			provenance = result->getProvenance();
+			writer = make_unique<GeoTiffWriter>(stream, query_rect, query_rect.xres, query_rect.yres, raster->dd,
+					tile_width, tile_height, compression, threads, on_start);
 		}
+		writer->addTile(*raster);
+	}
+	writer->finish();
 
-		//clean the GDAL resources
-		VSIFree(outDataBuffer);
+	return provenance;
+}
+
+/**
+ * Computes the coverage tile by tile and writes every tile with GDAL into a tiled GeoTIFF as soon as it is computed,
+ * so only a single tile of the result is in memory at a time, as long as the file is not in /vsimem/. This is used for
+ * crs the GeoTiffWriter does not support. Each tile is processed as its own query.
+ * The first tile determines the data type and the no data value of the file.
+ * @return the provenance of the coverage
+ */
+ProvenanceCollection WCSService::writeTiledCoverage(const std::string &coverage, const QueryRectangle &query_rect, UserDB::User &user, const std::string &filename, uint32_t tile_size) {
+	GDAL::init();
+
+	RasterTiling tiling(query_rect, tile_size);
+	ProvenanceCollection provenance;
+	GDALDataset *dataset = nullptr;
+
+	try {
+		for (size_t i = 0; i < tiling.getTileCount(); i++) {
+			auto tile = tiling.getTile(i);
+			Query query(coverage, Query::ResultType::RASTER, tile.rect);
+			auto result = processQuery(query, user);
+			auto raster = result->getRaster(GenericOperator::RasterQM::EXACT);
+			raster->setRepresentation(GenericRaster::Representation::CPU);
+
+			if (dataset == nullptr) {
+				provenance = result->getProvenance();
+
+				char **options = nullptr;
+				options = CSLSetNameValue(options, "COMPRESS", "DEFLATE");
+				options = CSLSetNameValue(options, "TILED", "YES");
+				options = CSLSetNameValue(options, "BIGTIFF", "IF_SAFER");
+				GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+				dataset = driver->Create(filename.c_str(), query_rect.xres, query_rect.yres, 1, raster->dd.datatype, options);
+				CSLDestroy(options);
+				if (dataset == nullptr)
+					throw ExporterException("WCSService: could not create the GeoTIFF");
+
+				double geo_transform[6] {
+					query_rect.x1, (query_rect.x2 - query_rect.x1) / query_rect.xres, 0,
+					query_rect.y1, 0, (query_rect.y2 - query_rect.y1) / query_rect.yres
+				};
+				std::string srs = GDAL::WKTFromCrsId(query_rect.crsId);
+				dataset->SetGeoTransform(geo_transform);
+				dataset->SetProjection(srs.c_str());
+				if (raster->dd.has_no_data)
+					dataset->GetRasterBand(1)->SetNoDataValue(raster->dd.no_data);
+			}
+
+			auto res = dataset->GetRasterBand(1)->RasterIO(GF_Write, tile.x, tile.y, tile.rect.xres, tile.rect.yres,
+					const_cast<void *>(raster->getData()), tile.rect.xres, tile.rect.yres, raster->dd.datatype, 0, 0);
+			if (res != CE_None)
+				throw ExporterException("WCSService: RasterIO for writing a tile failed");
+		}
 	}
+	catch (...) {
+		if (dataset != nullptr)
+			GDALClose((GDALDatasetH) dataset);
+		throw;
+	}
+
+	GDALClose((GDALDatasetH) dataset);
+	return provenance;
 }
@@ -164,20 +164,31 @@ void WFSService::getFeature() {
 		format = format.substr(strlen(EXPORT_MIME_PREFIX));
 	}
 
-	std::string output;
-	if (format == "application/json")
-		output = features->toGeoJSON(true);
-	else if (format == "csv")
-		output = features->toCSV();
-	else
+	if (format != "application/json" && format != "csv" && format != COLUMNAR_MIME)
 		throw ArgumentException("WFSService: unknown output format");
 
 	if(exportMode) {
+		std::string output;
+		if (format == "application/json")
+			output = features->toGeoJSON(true);
+		else if (format == "csv")
+			output = features->toCSV();
+		else {
+			std::ostringstream columnar;
+			features->toColumnar(columnar);
+			output = columnar.str();
+		}
 		exportZip(operatorgraph, output.c_str(), output.length(), format, result->getProvenance());
+	} else if (format == COLUMNAR_MIME) {
+		outputSimpleFeatureCollectionColumnar(features.get());
 	} else {
+		// stream the result, so the document is never held in memory as a whole
 		response.sendContentType(format + "; charset=utf-8");
 		response.finishHeaders();
-		response << output;
+		if (format == "application/json")
+			features->toGeoJSON(response, true);
+		else
+			features->toCSV(response);
 	}
 	// VSPs
 	// O
@@ -1,6 +1,8 @@
 
 #include "services/ogcservice.h"
+#include "services/tilecache.h"
 #include "processing/queryprocessor.h"
+#include "operators/plan_cache.h"
 #include "datatypes/raster.h"
 #include "datatypes/raster/raster_priv.h"
 #include "datatypes/plot.h"
@@ -8,6 +10,8 @@
 #include "util/configuration.h"
 #include "util/log.h"
 
+#include <sstream>
+
 
 /**
  * Implementation of the OGC WMS standard http://www.opengeospatial.org/standards/wms
@@ -20,6 +24,21 @@ class WMSService : public OGCService {
 		virtual void run();
 
         std::unique_ptr<Colorizer> createColorizer(GenericRaster &raster, std::string colors);
+
+	private:
+		/**
+		 * Builds the normalized key of a GetMap request for the TileCache
+		 */
+		std::string getTileCacheKey(const std::string &layers, const QueryRectangle &qrect, const std::string &colors, const std::string &format);
+		/**
+		 * Sends a cached tile, answering with 304 if the client already has it
+		 * @return false if the user is not allowed to see the tile
+		 */
+		bool outputCachedTile(const TileCache::Entry &entry, UserDB::User &user);
+		/**
+		 * Sends a tile with its ETag, answering with 304 if the client already has it
+		 */
+		void outputTile(const TileCache::Entry &entry);
 };
 REGISTER_HTTP_SERVICE(WMSService, "WMS");
 
@@ -71,9 +90,19 @@ void WMSService::run() {
 			);
 
 
+			// Rendered tiles are only cached without debug output, because the overlay changes with every request
+			TileCache *tilecache = debug ? nullptr : TileCache::getInstance();
+			std::string tilecache_key;
+			if (tilecache != nullptr) {
+				tilecache_key = getTileCacheKey(params.get("layers"), qrect, colors, format);
+				auto entry = tilecache->get(tilecache_key);
+				if (entry && outputCachedTile(*entry, user))
+					return;
+			}
+
 			Query query(params.get("layers"), Query::ResultType::RASTER, qrect);
-			auto result_raster = processQuery(query, user)
-				->getRaster(GenericOperator::RasterQM::EXACT);
+			auto query_result = processQuery(query, user);
+			auto result_raster = query_result->getRaster(GenericOperator::RasterQM::EXACT);
 
 			double bbox[4] = {sref.x1, sref.y1, sref.x2, sref.y2};
 			flipx = (bbox[2] > bbox[0]) != (result_raster->pixel_scale_x > 0);
@@ -119,7 +148,21 @@ void WMSService::run() {
 				}
 			}
 
-			outputImage(*result_raster, flipx, flipy, *createColorizer(*result_raster, colors), overlay.get());
+			if (tilecache != nullptr) {
+				std::ostringstream png;
+				result_raster->toPNG(png, *createColorizer(*result_raster, colors), flipx, flipy);
+				auto entry = tilecache->put(tilecache_key, "image/png", png.str(), query_result->getProvenance().getLocalIdentifiers());
+				// processQuery() has already checked the permissions, the entry is missing if the tile is too large to cache
+				if (entry)
+					outputTile(*entry);
+				else {
+					response.sendContentType("image/png");
+					response.finishHeaders();
+					response << png.str();
+				}
+			} else {
+				outputImage(*result_raster, flipx, flipy, *createColorizer(*result_raster, colors), overlay.get());
+			}
 		}  catch (const std::exception &e) {
 			// Alright, something went wrong.
 			// We're still in a WMS request though, so do our best to output an image with a clear error message.
@@ -228,3 +271,55 @@ std::unique_ptr<Colorizer> WMSService::createColorizer(GenericRaster& raster, st
     }
     return colorizer;
 }
+
+std::string WMSService::getTileCacheKey(const std::string &layers, const QueryRectangle &qrect, const std::string &colors, const std::string &format) {
+	// the semantic id normalizes the workflow, e.g. whitespace and the order of parameters
+	auto op = OperatorPlanCache::get(layers);
+
+	// normalize the colorizer the same way
+	std::string normalized_colors = colors;
+	if (!colors.empty()) {
+		Json::Reader reader(Json::Features::strictMode());
+		Json::Value json;
+		if (reader.parse(colors, json)) {
+			Json::FastWriter writer;
+			normalized_colors = writer.write(json);
+		}
+	}
+
+	std::ostringstream key;
+	key.precision(17);
+	key << op->getSemanticId() << "\n"
+		<< qrect.crsId.to_string() << " " << qrect.x1 << " " << qrect.y1 << " " << qrect.x2 << " " << qrect.y2 << "\n"
+		<< qrect.timetype << " " << qrect.t1 << " " << qrect.t2 << "\n"
+		<< qrect.xres << "x" << qrect.yres << "\n"
+		<< format << "\n"
+		<< normalized_colors;
+	return key.str();
+}
+
+bool WMSService::outputCachedTile(const TileCache::Entry &entry, UserDB::User &user) {
+	for (auto &identifier : entry.identifiers) {
+		if (identifier != "" && !user.hasPermission(identifier))
+			return false;
+	}
+
+	outputTile(entry);
+	return true;
+}
+
+void WMSService::outputTile(const TileCache::Entry &entry) {
+	std::string etag = "\"" + entry.etag + "\"";
+	if (params.get("header.if-none-match", "") == etag) {
+		response.sendHeader("Status", "304 Not Modified");
+		response.sendHeader("ETag", etag);
+		response.finishHeaders();
+		return;
+	}
+
+	response.sendContentType(entry.content_type);
+	response.sendHeader("ETag", etag);
+	response.sendHeader("Content-Length", concat(entry.body.size()));
+	response.finishHeaders();
+	response.write(entry.body.data(), entry.body.size());
+}
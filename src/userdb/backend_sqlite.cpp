@@ -55,6 +55,8 @@ REGISTER_USERDB_BACKEND(SQLiteUserDBBackend, "sqlite");
 
 SQLiteUserDBBackend::SQLiteUserDBBackend(const std::string &filename) {
 	db.open(filename.c_str(), false);
+	// lookups run on read connections of their own threads, WAL keeps them from blocking on writes and vice versa
+	db.exec("PRAGMA journal_mode=WAL");
 
 	db.exec("CREATE TABLE IF NOT EXISTS users ("
 		" userid INTEGER PRIMARY KEY,"
@@ -150,7 +152,7 @@ UserDBBackend::userid_t SQLiteUserDBBackend::createUser(const std::string &usern
 }
 
 UserDBBackend::UserData SQLiteUserDBBackend::loadUser(userid_t userid) {
-	auto stmt = db.prepare("SELECT username, realname, email, externalid FROM users WHERE userid = ?");
+	auto stmt = db.prepareRead("SELECT username, realname, email, externalid FROM users WHERE userid = ?");
 	stmt.bind(1, userid);
 	if (!stmt.next())
 		throw UserDB::database_error("UserDB: user not found");
@@ -162,13 +164,13 @@ UserDBBackend::UserData SQLiteUserDBBackend::loadUser(userid_t userid) {
 	if (externalid_ptr != nullptr)
 		externalid = std::string(externalid_ptr);
 	stmt.finalize();
-	stmt = db.prepare("SELECT permission FROM user_permissions WHERE userid = ?");
+	stmt = db.prepareRead("SELECT permission FROM user_permissions WHERE userid = ?");
 	stmt.bind(1, userid);
 	UserDB::Permissions permissions;
 	while (stmt.next())
 		permissions.addPermission(stmt.getString(0));
 
-	stmt = db.prepare("SELECT groupid FROM user_to_group WHERE userid = ?");
+	stmt = db.prepareRead("SELECT groupid FROM user_to_group WHERE userid = ?");
 	stmt.bind(1, userid);
 	std::vector<groupid_t> groups;
 	while (stmt.next())
@@ -179,7 +181,7 @@ UserDBBackend::UserData SQLiteUserDBBackend::loadUser(userid_t userid) {
 
 
 UserDBBackend::userid_t SQLiteUserDBBackend::loadUserId(const std::string &username) {
-	auto stmt = db.prepare("SELECT userid FROM users WHERE username = ?");
+	auto stmt = db.prepareRead("SELECT userid FROM users WHERE username = ?");
 	stmt.bind(1, username);
 	if (!stmt.next())
 		throw UserDB::database_error("UserDB: user not found");
@@ -187,7 +189,7 @@ UserDBBackend::userid_t SQLiteUserDBBackend::loadUserId(const std::string &usern
 }
 
 UserDBBackend::userid_t SQLiteUserDBBackend::authenticateUser(const std::string &username, const std::string &password) {
-	auto stmt = db.prepare("SELECT userid, pwhash FROM users WHERE username = ?");
+	auto stmt = db.prepareRead("SELECT userid, pwhash FROM users WHERE username = ?");
 	stmt.bind(1, username);
 	if (!stmt.next())
 		throw UserDB::authentication_error("UserDB: username or password wrong");
@@ -200,7 +202,7 @@ UserDBBackend::userid_t SQLiteUserDBBackend::authenticateUser(const std::string
 }
 
 UserDBBackend::userid_t SQLiteUserDBBackend::findExternalUser(const std::string &externalid) {
-	auto stmt = db.prepare("SELECT userid FROM users WHERE externalid = ?");
+	auto stmt = db.prepareRead("SELECT userid FROM users WHERE externalid = ?");
 	stmt.bind(1, externalid);
 	if (!stmt.next())
 		throw UserDB::authentication_error("UserDB: username or password wrong");
@@ -247,13 +249,13 @@ UserDBBackend::groupid_t SQLiteUserDBBackend::createGroup(const std::string &gro
 }
 
 UserDBBackend::GroupData SQLiteUserDBBackend::loadGroup(groupid_t groupid) {
-	auto stmt = db.prepare("SELECT groupname FROM groups WHERE groupid = ?");
+	auto stmt = db.prepareRead("SELECT groupname FROM groups WHERE groupid = ?");
 	stmt.bind(1, groupid);
 	if (!stmt.next())
 		throw UserDB::database_error("UserDB: group not found");
 	std::string groupname = stmt.getString(0);
 
-	stmt = db.prepare("SELECT permission FROM group_permissions WHERE groupid = ?");
+	stmt = db.prepareRead("SELECT permission FROM group_permissions WHERE groupid = ?");
 	stmt.bind(1, groupid);
 	UserDB::Permissions permissions;
 	while (stmt.next())
@@ -263,7 +265,7 @@ UserDBBackend::GroupData SQLiteUserDBBackend::loadGroup(groupid_t groupid) {
 }
 
 UserDBBackend::groupid_t SQLiteUserDBBackend::loadGroupId(const std::string &groupname) {
-	auto stmt = db.prepare("SELECT groupid FROM groups WHERE groupname = ?");
+	auto stmt = db.prepareRead("SELECT groupid FROM groups WHERE groupname = ?");
 	stmt.bind(1, groupname);
 	if (!stmt.next())
 		throw UserDB::database_error("UserDB: group not found");
@@ -314,7 +316,7 @@ std::string SQLiteUserDBBackend::createSession(userid_t userid, time_t expires)
 }
 
 UserDBBackend::SessionData SQLiteUserDBBackend::loadSession(const std::string &sessiontoken) {
-	auto stmt = db.prepare("SELECT userid, expires FROM sessions WHERE sessiontoken = ?");
+	auto stmt = db.prepareRead("SELECT userid, expires FROM sessions WHERE sessiontoken = ?");
 	stmt.bind(1, sessiontoken);
 	if (!stmt.next())
 		throw UserDB::session_expired_error();
@@ -361,7 +363,7 @@ bool SQLiteUserDBBackend::verifyPwdHash(const std::string &password, const std::
  * Artifacts
  */
 UserDBBackend::artifactid_t SQLiteUserDBBackend::loadArtifactId(userid_t userid, const std::string &type, const std::string name) {
-	auto stmt = db.prepare("SELECT artifactid from artifacts where userid = ? and type = ? and name = ?");
+	auto stmt = db.prepareRead("SELECT artifactid from artifacts where userid = ? and type = ? and name = ?");
 	stmt.bind(1, userid);
 	stmt.bind(2, type); //TODO check
 	stmt.bind(3, name);
@@ -404,7 +406,7 @@ void SQLiteUserDBBackend::updateArtifactValue(UserDBBackend::userid_t userid, co
 }
 
 UserDBBackend::ArtifactData SQLiteUserDBBackend::loadArtifact(UserDBBackend::artifactid_t artifactid) {
-	auto stmt = db.prepare("SELECT userid, type, name from artifacts WHERE artifactid = ?");
+	auto stmt = db.prepareRead("SELECT userid, type, name from artifacts WHERE artifactid = ?");
 	stmt.bind(1, artifactid);
 
 	if (!stmt.next())
@@ -414,7 +416,7 @@ UserDBBackend::ArtifactData SQLiteUserDBBackend::loadArtifact(UserDBBackend::art
 	std::string type = stmt.getString(1);
 	std::string name = stmt.getString(2);
 
-	stmt = db.prepare("SELECT timestamp FROM artifact_versions WHERE artifactid = ? ORDER BY timestamp desc");
+	stmt = db.prepareRead("SELECT timestamp FROM artifact_versions WHERE artifactid = ? ORDER BY timestamp desc");
 	stmt.bind(1, artifactid);
 
 	std::vector<time_t> versions;
@@ -432,7 +434,7 @@ UserDBBackend::ArtifactData SQLiteUserDBBackend::loadArtifact(const std::string
 }
 
 UserDBBackend::ArtifactVersionData SQLiteUserDBBackend::loadArtifactVersionData(userid_t userid, artifactid_t artifactid, time_t timestamp) {
-	auto stmt = db.prepare("SELECT timestamp, value  FROM artifact_versions WHERE artifactid = ? AND timestamp <= ? ORDER BY timestamp DESC LIMIT 1");
+	auto stmt = db.prepareRead("SELECT timestamp, value  FROM artifact_versions WHERE artifactid = ? AND timestamp <= ? ORDER BY timestamp DESC LIMIT 1");
 	stmt.bind(1, artifactid);
 	stmt.bind(2, (int64_t)timestamp);
 
@@ -447,7 +449,7 @@ UserDBBackend::ArtifactVersionData SQLiteUserDBBackend::loadArtifactVersionData(
 std::vector<UserDBBackend::ArtifactData> SQLiteUserDBBackend::loadArtifactsOfType(UserDBBackend::userid_t userid, const std::string &type) {
 	//TODO: find all artifacts that user has permission on
 
-	auto stmt = db.prepare("SELECT artifactid, name, max(timestamp) t from artifacts JOIN artifact_versions USING (artifactid) WHERE userid = ? and type = ? GROUP BY artifactid, name ORDER BY t DESC");
+	auto stmt = db.prepareRead("SELECT artifactid, name, max(timestamp) t from artifacts JOIN artifact_versions USING (artifactid) WHERE userid = ? and type = ? GROUP BY artifactid, name ORDER BY t DESC");
 	stmt.bind(1, userid);
 	stmt.bind(2, type);
 
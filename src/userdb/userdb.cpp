@@ -12,6 +12,9 @@
 #include <random>
 #include <cstring>
 #include <mutex>
+#include <list>
+#include <atomic>
+#include <algorithm>
 
 // all of these just to open /dev/urandom ..
 #include <sys/types.h>
@@ -262,47 +265,151 @@ std::string UserDB::createRandomToken(size_t length) {
 
 
 /*
- * Sessioncache
+ * Caches
  */
 /*
- * As the sessioncache is a process-local cache, global cache invalidation is impossible.
- * To make sure that permission changes or logouts take effect soon enough, this timeout should remain low.
+ * A bounded LRU cache whose entries expire after a timeout. The entries are spread over shards with a lock
+ * each, so concurrent requests rarely wait for each other.
+ *
+ * Every removal increments a generation counter. A value loaded from the backend is only stored if no removal
+ * happened since the load started, otherwise it may predate the change that caused the removal.
  */
-static int sessioncache_timeout = 0;
-static std::unordered_map<std::string, std::weak_ptr<UserDB::Session> > sessioncache;
-static std::mutex sessioncache_mutex;
-
-static std::shared_ptr<UserDB::Session> loadSessionFromCache(const std::string &sessiontoken, time_t t) {
-	if (sessioncache_timeout <= 0)
-		return nullptr;
-
-	std::lock_guard<std::mutex> lock(sessioncache_mutex);
-	auto it = sessioncache.find(sessiontoken);
-	if (it != sessioncache.end()) {
-		auto &weak_ptr = it->second;
-		auto session = weak_ptr.lock();
-		if (session && session->cache_expires >= t)
-			return session;
-		else
-			sessioncache.erase(it);
-	}
-	return nullptr;
-}
+template<typename K, typename V>
+class ShardedCache {
+	public:
+		void configure(size_t capacity, int timeout) {
+			clear();
+			this->shard_capacity = std::max((size_t) 1, capacity / SHARD_COUNT);
+			this->timeout = capacity > 0 ? timeout : 0;
+		}
 
-static void addSessionToCache(std::shared_ptr<UserDB::Session> &session, time_t t) {
-	if (sessioncache_timeout <= 0)
-		return;
+		bool enabled() const {
+			return timeout > 0;
+		}
 
-	session->cache_expires = t + sessioncache_timeout;
-	std::lock_guard<std::mutex> lock(sessioncache_mutex);
-	sessioncache[session->getSessiontoken()] = std::weak_ptr<UserDB::Session>(session);
-}
+		std::shared_ptr<V> get(const K &key, time_t t) {
+			if (!enabled())
+				return nullptr;
+
+			auto &shard = getShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto it = shard.index.find(key);
+			if (it == shard.index.end())
+				return nullptr;
+			if (it->second->expires < t) {
+				shard.lru.erase(it->second);
+				shard.index.erase(it);
+				return nullptr;
+			}
+			shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+			return it->second->value;
+		}
+
+		uint64_t generation() const {
+			return removals.load();
+		}
 
+		/*
+		 * Stores the value, unless entries were removed since generation() returned loaded_generation
+		 */
+		void put(const K &key, const std::shared_ptr<V> &value, time_t t, uint64_t loaded_generation) {
+			if (!enabled())
+				return;
+
+			auto &shard = getShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			// removals increment the counter while holding the lock of the shard, so a removal of this key either
+			// happened before this check or happens after the value is stored
+			if (removals.load() != loaded_generation)
+				return;
+			auto it = shard.index.find(key);
+			if (it != shard.index.end()) {
+				shard.lru.erase(it->second);
+				shard.index.erase(it);
+			}
+			shard.lru.push_front(Entry{key, value, t + timeout});
+			shard.index[key] = shard.lru.begin();
+			if (shard.lru.size() > shard_capacity) {
+				shard.index.erase(shard.lru.back().key);
+				shard.lru.pop_back();
+			}
+		}
+
+		void remove(const K &key) {
+			auto &shard = getShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			removals++;
+			auto it = shard.index.find(key);
+			if (it != shard.index.end()) {
+				shard.lru.erase(it->second);
+				shard.index.erase(it);
+			}
+		}
+
+		template<typename Predicate>
+		void removeIf(Predicate predicate) {
+			for (auto &shard : shards) {
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				removals++;
+				for (auto it = shard.lru.begin(); it != shard.lru.end(); ) {
+					if (predicate(*it->value)) {
+						shard.index.erase(it->key);
+						it = shard.lru.erase(it);
+					}
+					else
+						it++;
+				}
+			}
+		}
+
+		void clear() {
+			for (auto &shard : shards) {
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				removals++;
+				shard.lru.clear();
+				shard.index.clear();
+			}
+		}
+
+	private:
+		static const size_t SHARD_COUNT = 16;
+		struct Entry {
+			K key;
+			std::shared_ptr<V> value;
+			time_t expires;
+		};
+		struct Shard {
+			std::mutex mutex;
+			// most recently used first
+			std::list<Entry> lru;
+			std::unordered_map<K, typename std::list<Entry>::iterator> index;
+		};
+
+		Shard &getShard(const K &key) {
+			return shards[std::hash<K>()(key) % SHARD_COUNT];
+		}
+
+		Shard shards[SHARD_COUNT];
+		size_t shard_capacity = 1;
+		int timeout = 0;
+		std::atomic<uint64_t> removals{0};
+};
+
+/*
+ * As the caches are process-local, changes made by other processes are only noticed once the entries time out.
+ * To make sure that permission changes or logouts take effect soon enough, this timeout should remain low.
+ * Changes made through this process invalidate the affected entries right away.
+ *
+ * Users are cached together with their effective permissions. Sessions keep the user they were loaded with,
+ * loadSession() replaces it when the cached user has been invalidated in the meantime.
+ */
+static ShardedCache<std::string, UserDB::Session> sessioncache;
+static ShardedCache<int64_t, UserDB::User> usercache;
 
 /*
  * UserDB
  */
-void UserDB::init(const std::string &backend, const std::string &location, std::unique_ptr<Clock> _clock, int _sessioncache_timeout) {
+void UserDB::init(const std::string &backend, const std::string &location, std::unique_ptr<Clock> _clock, int sessioncache_timeout, size_t sessioncache_size) {
 	if (userdb_backend != nullptr)
 		throw MustNotHappenException("UserDB::init() was called multiple times");
 
@@ -321,20 +428,28 @@ void UserDB::init(const std::string &backend, const std::string &location, std::
 	else
 		clock = make_unique<UnixClock>();
 
-	sessioncache_timeout = _sessioncache_timeout;
+	sessioncache.configure(sessioncache_size, sessioncache_timeout);
+	usercache.configure(sessioncache_size, sessioncache_timeout);
 }
 
 void UserDB::initFromConfiguration() {
 	auto backend = Configuration::get<std::string>("userdb.backend");
 	auto location = Configuration::get<std::string>("userdb." + backend + ".location");
 	auto sessioncache_timeout = Configuration::get<int>("userdb.sessioncache.timeout", 0);
-	init(backend, location, nullptr, sessioncache_timeout);
+	auto sessioncache_size = Configuration::get<size_t>("userdb.sessioncache.size", 10000);
+	init(backend, location, nullptr, sessioncache_timeout, sessioncache_size);
 }
 
 void UserDB::shutdown() {
+	clearCaches();
 	userdb_backend = nullptr;
 }
 
+void UserDB::clearCaches() {
+	sessioncache.clear();
+	usercache.clear();
+}
+
 time_t UserDB::time() {
 	if (clock == nullptr)
 		throw ArgumentException("UserDB::time(), call init() first");
@@ -342,11 +457,18 @@ time_t UserDB::time() {
 }
 
 std::shared_ptr<UserDB::User> UserDB::loadUser(UserDB::userid_t userid) {
+	auto t = time();
+	auto cached = usercache.get(userid, t);
+	if (cached)
+		return cached;
+
+	auto generation = usercache.generation();
 	auto userdata = userdb_backend->loadUser(userid);
 	std::vector<std::shared_ptr<Group>> groups;
 	for (auto groupid : userdata.groupids)
 		groups.push_back(loadGroup(groupid));
 	auto user = std::make_shared<User>(userid, userdata.username, userdata.realname, userdata.email, userdata.externalid, std::move(userdata.permissions), std::move(groups));
+	usercache.put(userid, user, t, generation);
 	return user;
 }
 
@@ -366,22 +488,37 @@ std::shared_ptr<UserDB::User> UserDB::createExternalUser(const std::string &user
 	return loadUser(userid);
 }
 
+void UserDB::invalidateUser(userid_t userid) {
+	usercache.remove(userid);
+}
+
+void UserDB::invalidateGroup(groupid_t groupid) {
+	// the effective permissions of all members change
+	usercache.removeIf([groupid] (const User &user) {
+		for (auto &group : user.groups) {
+			if (group->groupid == groupid)
+				return true;
+		}
+		return false;
+	});
+}
+
 void UserDB::addUserPermission(userid_t userid, const std::string &permission) {
 	userdb_backend->addUserPermission(userid, permission);
-	// TODO: invalidate user cache
+	invalidateUser(userid);
 }
 void UserDB::removeUserPermission(userid_t userid, const std::string &permission) {
 	userdb_backend->removeUserPermission(userid, permission);
-	// TODO: invalidate user cache
+	invalidateUser(userid);
 }
 
 void UserDB::setUserPassword(userid_t userid, const std::string &password) {
 	userdb_backend->setUserPassword(userid, password);
-	// TODO: invalidate user cache
+	invalidateUser(userid);
 }
 void UserDB::setUserExternalid(userid_t userid, const std::string &externalid) {
 	userdb_backend->setUserExternalid(userid, externalid);
-	// TODO: invalidate user cache
+	invalidateUser(userid);
 }
 
 
@@ -402,20 +539,20 @@ std::shared_ptr<UserDB::Group> UserDB::loadGroup(const std::string &groupname) {
 
 void UserDB::addGroupPermission(groupid_t groupid, const std::string &permission) {
 	userdb_backend->addGroupPermission(groupid, permission);
-	// TODO: invalidate group cache
+	invalidateGroup(groupid);
 }
 void UserDB::removeGroupPermission(groupid_t groupid, const std::string &permission) {
 	userdb_backend->removeGroupPermission(groupid, permission);
-	// TODO: invalidate group cache
+	invalidateGroup(groupid);
 }
 
 void UserDB::addUserToGroup(UserDB::userid_t userid, UserDB::groupid_t groupid) {
 	userdb_backend->addUserToGroup(userid, groupid);
-	// TODO: invalidate user cache
+	invalidateUser(userid);
 }
 void UserDB::removeUserFromGroup(UserDB::userid_t userid, UserDB::groupid_t groupid) {
 	userdb_backend->removeUserFromGroup(userid, groupid);
-	// TODO: invalidate user cache
+	invalidateUser(userid);
 }
 
 
@@ -442,16 +579,24 @@ std::shared_ptr<UserDB::Session> UserDB::createSessionForExternalUser(const std:
 
 std::shared_ptr<UserDB::Session> UserDB::loadSession(const std::string &sessiontoken) {
 	auto t = time();
+	auto generation = sessioncache.generation();
 
 	// try reading from the sessioncache first
-	auto session = loadSessionFromCache(sessiontoken, t);
+	auto session = sessioncache.get(sessiontoken, t);
+	if (session) {
+		auto user = loadUser(session->user->userid);
+		if (user != session->user) {
+			session = std::make_shared<UserDB::Session>(sessiontoken, user, session->expires);
+			sessioncache.put(sessiontoken, session, t, generation);
+		}
+	}
 
 	// now read from the backend
 	if (!session) {
 		auto sessiondata = userdb_backend->loadSession(sessiontoken);
 		auto user = loadUser(sessiondata.userid);
 		session = std::make_shared<UserDB::Session>(sessiontoken, user, sessiondata.expires);
-		addSessionToCache(session, t);
+		sessioncache.put(sessiontoken, session, t, generation);
 	}
 
 	// We also store expired sessions in the cache, to make throwing this exception cheaper.
@@ -463,6 +608,7 @@ std::shared_ptr<UserDB::Session> UserDB::loadSession(const std::string &sessiont
 
 void UserDB::destroySession(const std::string &sessiontoken) {
 	userdb_backend->destroySession(sessiontoken);
+	sessioncache.remove(sessiontoken);
 }
 
 std::shared_ptr<UserDB::Artifact> UserDB::createArtifact(const UserDB::User &user, const std::string &type, const std::string &name, const std::string &value) {
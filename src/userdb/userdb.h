@@ -17,7 +17,8 @@
  * copies everywhere is slow.
  * As a consequence, every method call that would change an object will return a shared_ptr to a new, immutable object.
  *
- * TODO: cache objects
+ * Sessions and users are cached for userdb.sessioncache.timeout seconds. Changes made through the UserDB invalidate
+ * the affected entries.
  */
 class UserDB {
 	protected:
@@ -128,6 +129,7 @@ class UserDB {
 				std::string groupname;
 				Permissions group_permissions;
 				friend class User;
+				friend class UserDB;
 		};
 		class Session : public Cacheable {
 			public:
@@ -138,6 +140,7 @@ class UserDB {
 				const std::string &getSessiontoken() { return sessiontoken; }
 				bool isExpired();
 			private:
+				friend class UserDB;
 				std::string sessiontoken;
 				std::shared_ptr<User> user;
 				time_t expires;
@@ -196,8 +199,12 @@ class UserDB {
 
 		// static methods
 		static void initFromConfiguration();
-		static void init(const std::string &backend, const std::string &location, std::unique_ptr<Clock> clock = nullptr, int sessioncache_timeout = 0);
+		static void init(const std::string &backend, const std::string &location, std::unique_ptr<Clock> clock = nullptr, int sessioncache_timeout = 0, size_t sessioncache_size = 10000);
 		static void shutdown();
+		/**
+		 * Drops all cached sessions and users, e.g. after the database was changed by another process.
+		 */
+		static void clearCaches();
 
 		static std::shared_ptr<User> createUser(const std::string &username, const std::string &realname, const std::string &email, const std::string &password);
 		static std::shared_ptr<User> createExternalUser(const std::string &username, const std::string &realname, const std::string &email, const std::string &externalid);
@@ -223,6 +230,9 @@ class UserDB {
 		static void removeGroupPermission(groupid_t groupid, const std::string &permission);
 		static void addUserToGroup(userid_t userid, groupid_t groupid);
 		static void removeUserFromGroup(userid_t userid, groupid_t groupid);
+		// drop cached users after their permissions or groups changed
+		static void invalidateUser(userid_t userid);
+		static void invalidateGroup(groupid_t groupid);
 
 		static void destroySession(const std::string &sessiontoken);
 
@@ -5,6 +5,7 @@
 #include <errno.h>
 #include <memory>
 #include <algorithm>
+#include <limits.h> // IOV_MAX
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -16,6 +17,8 @@
 #include <netinet/tcp.h>
 #include <fcntl.h>
 
+// the number of bytes an incrementally read BinaryReadBuffer reads ahead for small reads
+static const size_t INCREMENTAL_READ_AHEAD = 64 * 1024;
 
 /*
  * BinaryStream
@@ -205,15 +208,22 @@ void BinaryStream::write(BinaryWriteBuffer &buffer) {
 		writeNB(buffer);
 }
 
-void BinaryStream::writeNB(BinaryWriteBuffer &buffer) {
+void BinaryStream::writeNB(BinaryWriteBuffer &buffer, bool *would_block) {
+	if (would_block)
+		*would_block = false;
 	buffer.prepareForWriting();
 	if (!buffer.isWriting())
 		throw ArgumentException("cannot writeNB() a BinaryWriteBuffer when not prepared for writing");
 
-	auto written = writev(write_fd, (const iovec *) &buffer.areas.at(buffer.areas_sent), buffer.areas.size()-buffer.areas_sent);
+	// writev() fails when given more than IOV_MAX areas, the remaining ones are sent by the next call
+	auto area_count = std::min(buffer.areas.size()-buffer.areas_sent, (size_t) IOV_MAX);
+	auto written = writev(write_fd, (const iovec *) &buffer.areas.at(buffer.areas_sent), area_count);
 	if (written < 0) {
-		if (!is_blocking && (errno == EAGAIN || errno == EWOULDBLOCK))
+		if (!is_blocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (would_block)
+				*would_block = true;
 			return;
+		}
 		throw NetworkException(concat("BinaryStream: writev() failed: ", strerror(errno)));
 	}
 	if (written == 0) {
@@ -237,7 +247,37 @@ bool BinaryStream::read(BinaryReadBuffer &buffer, bool allow_eof) {
 	return false;
 }
 
-bool BinaryStream::readNB(BinaryReadBuffer &buffer, bool allow_eof) {
+void BinaryStream::readIncrementally(BinaryReadBuffer &buffer) {
+	if (!is_blocking)
+		throw NetworkException("Cannot readIncrementally() on a nonblocking stream");
+	if (!buffer.isEmpty())
+		throw ArgumentException("cannot readIncrementally() into a BinaryReadBuffer that has already been read");
+
+	size_t packet_size;
+	readExactly((char *) &packet_size, sizeof(packet_size));
+	buffer.source = this;
+	buffer.status = BinaryReadBuffer::Status::FINISHED;
+	buffer.size_total = packet_size - sizeof(size_t);
+	buffer.size_read = 0;
+	buffer.chunk_start = buffer.chunk_end = 0;
+	buffer.buffer.resize(std::min(buffer.size_total, INCREMENTAL_READ_AHEAD));
+}
+
+void BinaryStream::readExactly(char *buffer, size_t len) {
+	while (len > 0) {
+		auto bytes_read = ::read(read_fd, buffer, len);
+		if (bytes_read == -1)
+			throw NetworkException(concat("BinaryStream: unexpected error while reading a BinaryReadBuffer: ", strerror(errno)));
+		if (bytes_read == 0)
+			throw NetworkException("BinaryStream: unexpected eof while reading a BinaryReadBuffer");
+		buffer += bytes_read;
+		len -= bytes_read;
+	}
+}
+
+bool BinaryStream::readNB(BinaryReadBuffer &buffer, bool allow_eof, bool *would_block) {
+	if (would_block)
+		*would_block = false;
 	if (buffer.isRead())
 		throw ArgumentException("cannot read() a BinaryReadBuffer that's already fully read");
 
@@ -245,8 +285,11 @@ bool BinaryStream::readNB(BinaryReadBuffer &buffer, bool allow_eof) {
 
 	auto bytes_read = ::read(read_fd, buffer.buffer.data()+buffer.size_read, buffer.size_total-buffer.size_read);
 	if (bytes_read == -1) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			if (would_block)
+				*would_block = true;
 			return false;
+		}
 		throw NetworkException(concat("BinaryStream: unexpected error while reading a BinaryReadBuffer: ", strerror(errno)));
 	}
 	if (bytes_read == 0) {
@@ -376,18 +419,39 @@ SHA1::SHA1Value BinaryWriteBuffer::hash() {
 }
 
 
+size_t BinaryWriteBuffer::getPayloadSize() {
+	prepareForWriting();
+	return size_total - sizeof(size_total);
+}
+
+void BinaryWriteBuffer::copyPayload(char *destination) {
+	prepareForWriting();
+	if (!isWriting() || size_sent != 0)
+		throw ArgumentException("cannot copyPayload() of a BinaryWriteBuffer that is being sent");
+
+	// skip the size prefix
+	for (size_t i=1;i<areas.size();i++) {
+		memcpy(destination, areas[i].start, areas[i].len);
+		destination += areas[i].len;
+	}
+}
+
+
 /*
  * BinaryReadBuffer
  */
-BinaryReadBuffer::BinaryReadBuffer() {
+BinaryReadBuffer::BinaryReadBuffer() : external_data(nullptr), source(nullptr), chunk_start(0), chunk_end(0) {
 	status = Status::READING_SIZE;
 	prepareBuffer(sizeof(size_t));
 }
+BinaryReadBuffer::BinaryReadBuffer(const char *data, size_t len)
+	: external_data(data), source(nullptr), chunk_start(0), chunk_end(0), status(Status::FINISHED), size_total(len), size_read(0) {
+}
 BinaryReadBuffer::~BinaryReadBuffer() {
 
 }
 
-void BinaryReadBuffer::read(char *buffer, size_t len) {
+const char *BinaryReadBuffer::readInPlace(size_t len) {
 	if (status != Status::FINISHED)
 		throw ArgumentException("cannot read() from a BinaryReadBuffer until it has been filled");
 
@@ -395,18 +459,51 @@ void BinaryReadBuffer::read(char *buffer, size_t len) {
 	if (remaining < len)
 		throw NetworkException(concat("BinaryReadBuffer: not enough data to satisfy read, ", remaining, " of ", size_total, " remaining, ", len, " requested"));
 
-	// copy data where it should go.
-	const char *vec_start = this->buffer.data() + size_read;
-	memcpy(buffer, vec_start, len);
+	const char *vec_start = (external_data ? external_data : this->buffer.data()) + size_read;
 	size_read += len;
+	return vec_start;
+}
+
+void BinaryReadBuffer::read(char *buffer, size_t len) {
+	if (source == nullptr) {
+		// copy data where it should go.
+		memcpy(buffer, readInPlace(len), len);
+		return;
+	}
+
+	size_t remaining = size_total - size_read;
+	if (remaining < len)
+		throw NetworkException(concat("BinaryReadBuffer: not enough data to satisfy read, ", remaining, " of ", size_total, " remaining, ", len, " requested"));
+	size_t in_stream = remaining - (chunk_end - chunk_start);
+	size_read += len;
+
+	size_t buffered = std::min(len, chunk_end - chunk_start);
+	memcpy(buffer, this->buffer.data() + chunk_start, buffered);
+	chunk_start += buffered;
+	buffer += buffered;
+	len -= buffered;
+
+	if (len >= this->buffer.size()) {
+		// large data is read from the stream right where it should go
+		source->readExactly(buffer, len);
+	}
+	else if (len > 0) {
+		// small reads are batched to save syscalls
+		chunk_end = std::min(this->buffer.size(), in_stream);
+		source->readExactly(this->buffer.data(), chunk_end);
+		memcpy(buffer, this->buffer.data(), len);
+		chunk_start = len;
+	}
 }
 
 void BinaryReadBuffer::read(std::string *string) {
 	auto len = read<size_t>();
-
-	std::unique_ptr<char[]> buffer( new char[len] );
-	read(buffer.get(), len);
-	string->assign(buffer.get(), len);
+	if (source != nullptr) {
+		string->resize(len);
+		read(&(*string)[0], len);
+		return;
+	}
+	string->assign(readInPlace(len), len);
 }
 
 
@@ -419,7 +516,8 @@ size_t BinaryReadBuffer::getPayloadSize() const {
 void BinaryReadBuffer::prepareBuffer(size_t expected_size) {
 	size_read = 0;
 	size_total = expected_size;
-	buffer.assign(size_total, 0); // TODO: can we avoid pre-filling this vector?
+	// the allocator leaves the new bytes uninitialized, they are overwritten by the stream anyway
+	buffer.resize(size_total);
 }
 
 void BinaryReadBuffer::markBytesAsRead(size_t read) {
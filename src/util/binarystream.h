@@ -86,8 +86,9 @@ class BinaryStream {
 		void write(BinaryWriteBuffer &buffer);
 		/*
 		 * Write the contents of a BinaryWriteBuffer to the stream (non-blocking)
+		 * @param would_block if given, set to whether the write stopped because the stream was not ready
 		 */
-		void writeNB(BinaryWriteBuffer &buffer);
+		void writeNB(BinaryWriteBuffer &buffer, bool *would_block = nullptr);
 		/*
 		 * Fill a BinaryReadBuffer with contents from the stream (blocking)
 		 * @return true if eof was encountered and allow_eof = true, otherwise false
@@ -95,9 +96,17 @@ class BinaryStream {
 		bool read(BinaryReadBuffer &buffer, bool allow_eof = false);
 		/*
 		 * Fill a BinaryReadBuffer with contents from the stream (non-blocking)
+		 * @param would_block if given, set to whether the read stopped because no data was available
 		 * @return true if eof was encountered and allow_eof = true, otherwise false
 		 */
-		bool readNB(BinaryReadBuffer &buffer, bool allow_eof = false);
+		bool readNB(BinaryReadBuffer &buffer, bool allow_eof = false, bool *would_block = nullptr);
+		/*
+		 * Read only the size of the next packet into an empty BinaryReadBuffer (blocking). The payload is read from
+		 * the stream while it is read from the buffer, so large data like rasters or vectors go straight from the
+		 * stream into their final storage instead of through a buffer holding the whole packet.
+		 * The stream must outlive the buffer, and the payload must be read completely before the stream is used again.
+		 */
+		void readIncrementally(BinaryReadBuffer &buffer);
 
 		/*
 		 * Returns the file descriptor used for reading.
@@ -117,6 +126,9 @@ class BinaryStream {
 	private:
 		// This constructor is private. Use the static named constructors instead.
 		BinaryStream(int read_fd, int write_fd);
+		// reads exactly len bytes (blocking), used by incrementally read buffers
+		void readExactly(char *buffer, size_t len);
+		friend class BinaryReadBuffer;
 
 		bool is_blocking;
 		int read_fd;
@@ -192,6 +204,16 @@ class BinaryWriteBuffer {
 		 */
 		SHA1::SHA1Value hash();
 
+		/*
+		 * The number of bytes in this buffer, without the size prefix
+		 */
+		size_t getPayloadSize();
+		/*
+		 * Copy the contents of this buffer, without the size prefix, to memory of getPayloadSize() bytes.
+		 * This allows handing the data to another process without a stream, e.g. in shared memory.
+		 */
+		void copyPayload(char *destination);
+
 		bool isWriting() { return status == Status::WRITING; }
 		bool isFinished() { return status == Status::FINISHED; }
 		void markBytesAsWritten(size_t written);
@@ -318,6 +340,30 @@ class BinaryWriteBufferWithSharedObject : public BinaryWriteBuffer {
 
 
 
+namespace detail {
+	/*
+	 * An allocator which leaves new elements of a std::vector uninitialized on resize().
+	 * The BinaryReadBuffer is overwritten by read() anyway, so zero-filling it first would only cost
+	 * another pass over the memory.
+	 */
+	template <typename T>
+	class default_init_allocator : public std::allocator<T> {
+		public:
+			template <typename U> struct rebind { using other = default_init_allocator<U>; };
+			using std::allocator<T>::allocator;
+
+			template <typename U>
+			void construct(U *ptr) {
+				::new(static_cast<void *>(ptr)) U;
+			}
+			template <typename U, typename... Args>
+			void construct(U *ptr, Args&&... args) {
+				::new(static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+			}
+	};
+}
+
+
 /**
  * A buffer used for reading a batch of data sent using a BinaryWriteBuffer
  *
@@ -333,6 +379,11 @@ class BinaryReadBuffer {
 		};
 	public:
 		BinaryReadBuffer();
+		/*
+		 * Creates a filled buffer for reading a payload from external memory, e.g. a shared memory segment written
+		 * by BinaryWriteBuffer::copyPayload(). The memory is not copied, it must stay valid while the buffer is read.
+		 */
+		BinaryReadBuffer(const char *data, size_t len);
 		~BinaryReadBuffer();
 
 		/*
@@ -384,7 +435,17 @@ class BinaryReadBuffer {
 		void markBytesAsRead(size_t read);
 	private:
 		void prepareBuffer(size_t expected_size);
-		std::vector<char> buffer;
+		/*
+		 * Skips len bytes and returns a pointer to them. The pointer is valid as long as the buffer.
+		 */
+		const char *readInPlace(size_t len);
+		std::vector<char, detail::default_init_allocator<char>> buffer;
+		// the payload when reading from external memory, otherwise nullptr
+		const char *external_data;
+		// the stream when reading incrementally, otherwise nullptr. buffer then holds the bytes from chunk_start to
+		// chunk_end that were read ahead from the stream for small reads.
+		BinaryStream *source;
+		size_t chunk_start, chunk_end;
 		Status status;
 		size_t size_total, size_read;
 
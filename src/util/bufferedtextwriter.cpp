@@ -0,0 +1,82 @@
+
+#include "util/bufferedtextwriter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+
+BufferedTextWriter::BufferedTextWriter(std::ostream &output, DoubleFormat format, size_t buffer_size)
+	: output(output), format(format), buffer(buffer_size > 0 ? buffer_size : 1), used(0) {
+}
+
+BufferedTextWriter::~BufferedTextWriter() {
+	flush();
+}
+
+void BufferedTextWriter::flush() {
+	if (used > 0) {
+		output.write(buffer.data(), used);
+		used = 0;
+	}
+}
+
+BufferedTextWriter &BufferedTextWriter::operator<<(double value) {
+	char str[MAX_DOUBLE_LENGTH];
+	write(str, formatDouble(value, format, str));
+	return *this;
+}
+
+BufferedTextWriter &BufferedTextWriter::operator<<(size_t value) {
+	char str[24];
+	int pos = sizeof(str);
+	do {
+		str[--pos] = '0' + (value % 10);
+		value /= 10;
+	} while (value > 0);
+	write(&str[pos], sizeof(str) - pos);
+	return *this;
+}
+
+size_t BufferedTextWriter::formatDouble(double value, DoubleFormat format, char *out) {
+	/*
+	 * Fast path for fixed notation with 6 decimals, which covers all coordinates.
+	 * The scaled value is computed in extended precision. If it is too close to a rounding
+	 * boundary to decide the rounding direction reliably, we fall back to snprintf, which
+	 * rounds the exact binary value.
+	 * Below 1e9, the scaled value stays below 2^50, so the error of the 64 bit mantissa is about 1e-4,
+	 * well within that margin. Larger values always take the slow path.
+	 */
+	if (format == DoubleFormat::FIXED && std::isfinite(value) && std::fabs(value) < 1e9) {
+		long double scaled = std::fabs((long double) value) * 1000000.0L;
+		long double integral = std::floor(scaled);
+		long double fraction = scaled - integral;
+		if (std::fabs(fraction - 0.5L) > 1e-3L) {
+			uint64_t units = (uint64_t) integral + (fraction > 0.5L ? 1 : 0);
+			uint64_t integer_part = units / 1000000;
+			uint32_t decimals = (uint32_t) (units % 1000000);
+
+			char digits[20];
+			int count = 0;
+			do {
+				digits[count++] = '0' + (integer_part % 10);
+				integer_part /= 10;
+			} while (integer_part > 0);
+
+			size_t pos = 0;
+			if (std::signbit(value))
+				out[pos++] = '-';
+			while (count > 0)
+				out[pos++] = digits[--count];
+			out[pos++] = '.';
+			for (int i = 5; i >= 0; i--) {
+				out[pos + i] = '0' + (decimals % 10);
+				decimals /= 10;
+			}
+			return pos + 6;
+		}
+	}
+
+	int len = snprintf(out, MAX_DOUBLE_LENGTH, format == DoubleFormat::FIXED ? "%.6f" : "%g", value);
+	return len > 0 ? len : 0;
+}
@@ -0,0 +1,74 @@
+#ifndef UTIL_BUFFEREDTEXTWRITER_H
+#define UTIL_BUFFEREDTEXTWRITER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+/**
+ * A writer for large text exports (GeoJSON, CSV, WKT, ...) that collects its output in a
+ * fixed-size buffer and hands it to the underlying stream in large chunks.
+ *
+ * Unlike a std::ostringstream, the document never exists as a whole in memory. Formatting
+ * of doubles avoids the locale machinery of std::ostream, while producing the same output as
+ * an ostream with std::fixed (FIXED) or with default flags (GENERAL) and precision 6.
+ */
+class BufferedTextWriter {
+	public:
+		enum class DoubleFormat {
+			FIXED,
+			GENERAL
+		};
+
+		BufferedTextWriter(std::ostream &output, DoubleFormat format = DoubleFormat::FIXED, size_t buffer_size = 64 * 1024);
+		~BufferedTextWriter();
+
+		BufferedTextWriter(const BufferedTextWriter &) = delete;
+		BufferedTextWriter &operator=(const BufferedTextWriter &) = delete;
+
+		void write(const char *data, size_t len) {
+			if (len > buffer.size() - used) {
+				flush();
+				if (len > buffer.size()) {
+					output.write(data, len);
+					return;
+				}
+			}
+			std::memcpy(&buffer[used], data, len);
+			used += len;
+		}
+
+		BufferedTextWriter &operator<<(char c) {
+			if (used == buffer.size())
+				flush();
+			buffer[used++] = c;
+			return *this;
+		}
+		BufferedTextWriter &operator<<(const char *str) { write(str, std::strlen(str)); return *this; }
+		BufferedTextWriter &operator<<(const std::string &str) { write(str.data(), str.size()); return *this; }
+		BufferedTextWriter &operator<<(double value);
+		BufferedTextWriter &operator<<(size_t value);
+
+		/**
+		 * Writes the buffered content to the underlying stream
+		 */
+		void flush();
+
+		// enough for any double in fixed notation with 6 decimals
+		static const size_t MAX_DOUBLE_LENGTH = 352;
+
+		/**
+		 * Formats a double the way an ostream with precision 6 would
+		 * @return the number of characters written to out, which must hold MAX_DOUBLE_LENGTH bytes
+		 */
+		static size_t formatDouble(double value, DoubleFormat format, char *out);
+
+	private:
+		std::ostream &output;
+		DoubleFormat format;
+		std::vector<char> buffer;
+		size_t used;
+};
+
+#endif
@@ -0,0 +1,675 @@
+
+#include "util/cog_reader.h"
+#include "util/parallel_for.h"
+#include "util/exceptions.h"
+
+#include <zlib.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <map>
+#include <mutex>
+#include <set>
+
+
+// TIFF tags
+static const uint16_t TAG_NEW_SUBFILE_TYPE = 254;
+static const uint16_t TAG_IMAGE_WIDTH = 256;
+static const uint16_t TAG_IMAGE_LENGTH = 257;
+static const uint16_t TAG_BITS_PER_SAMPLE = 258;
+static const uint16_t TAG_COMPRESSION = 259;
+static const uint16_t TAG_SAMPLES_PER_PIXEL = 277;
+static const uint16_t TAG_PLANAR_CONFIGURATION = 284;
+static const uint16_t TAG_PREDICTOR = 317;
+static const uint16_t TAG_TILE_WIDTH = 322;
+static const uint16_t TAG_TILE_LENGTH = 323;
+static const uint16_t TAG_TILE_OFFSETS = 324;
+static const uint16_t TAG_TILE_BYTE_COUNTS = 325;
+static const uint16_t TAG_SAMPLE_FORMAT = 339;
+static const uint16_t TAG_MODEL_PIXEL_SCALE = 33550;
+static const uint16_t TAG_MODEL_TIEPOINT = 33922;
+static const uint16_t TAG_MODEL_TRANSFORMATION = 34264;
+static const uint16_t TAG_GEO_KEY_DIRECTORY = 34735;
+static const uint16_t TAG_GDAL_NODATA = 42113;
+
+static const uint16_t GEO_KEY_RASTER_TYPE = 1025;
+static const uint16_t RASTER_PIXEL_IS_POINT = 2;
+
+static const uint16_t COMPRESSION_NONE = 1;
+static const uint16_t COMPRESSION_LZW = 5;
+static const uint16_t COMPRESSION_DEFLATE = 8;
+static const uint16_t COMPRESSION_DEFLATE_OLD = 32946;
+
+// the number of files whose directories are kept by CogReader::open()
+static const size_t CACHED_FILES = 256;
+
+
+/*
+ * Closes a file descriptor when leaving the scope
+ */
+class FileDescriptor {
+	public:
+		FileDescriptor(const std::string &filename) : fd(::open(filename.c_str(), O_RDONLY | O_CLOEXEC)) {
+			if (fd < 0)
+				throw SourceException(concat("COG: could not open ", filename));
+		}
+		~FileDescriptor() {
+			::close(fd);
+		}
+		FileDescriptor(const FileDescriptor &) = delete;
+		FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+		void read(void *buffer, size_t size, uint64_t offset) const {
+			char *position = (char *) buffer;
+			while (size > 0) {
+				ssize_t r = pread(fd, position, size, (off_t) offset);
+				if (r < 0 && errno == EINTR)
+					continue;
+				if (r <= 0)
+					throw SourceException("COG: could not read from file");
+				position += r;
+				size -= r;
+				offset += r;
+			}
+		}
+
+		const int fd;
+};
+
+
+/*
+ * The fields of an image file directory, with their values read from the file
+ */
+class Directory {
+	public:
+		Directory(const FileDescriptor &file, uint64_t offset, bool bigtiff);
+
+		bool has(uint16_t tag) const {
+			return fields.count(tag) > 0;
+		}
+		std::vector<uint64_t> integers(uint16_t tag) const;
+		std::vector<double> doubles(uint16_t tag) const;
+		std::string string(uint16_t tag) const;
+
+		uint64_t integer(uint16_t tag, uint64_t default_value) const {
+			if (!has(tag))
+				return default_value;
+			auto values = integers(tag);
+			if (values.empty())
+				throw SourceException(concat("COG: empty field ", tag));
+			return values[0];
+		}
+
+		uint64_t next;
+
+	private:
+		struct Field {
+			uint16_t type;
+			uint64_t count;
+			std::string data;
+		};
+
+		static size_t typeSize(uint16_t type);
+		const Field &field(uint16_t tag) const;
+
+		std::map<uint16_t, Field> fields;
+};
+
+size_t Directory::typeSize(uint16_t type) {
+	switch (type) {
+		case 1: case 2: case 6: case 7:
+			return 1;
+		case 3: case 8:
+			return 2;
+		case 4: case 9: case 11: case 13:
+			return 4;
+		case 5: case 10: case 12: case 16: case 17: case 18:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+Directory::Directory(const FileDescriptor &file, uint64_t offset, bool bigtiff) {
+	uint64_t count = 0;
+	if (bigtiff)
+		file.read(&count, 8, offset);
+	else {
+		uint16_t count16;
+		file.read(&count16, 2, offset);
+		count = count16;
+	}
+	if (count > 4096)
+		throw SourceException("COG: invalid image file directory");
+
+	const size_t entry_size = bigtiff ? 20 : 12, inline_size = bigtiff ? 8 : 4, count_size = bigtiff ? 8 : 2;
+	std::string entries(count * entry_size + inline_size, '\0');
+	file.read(&entries[0], entries.size(), offset + count_size);
+
+	for (uint64_t i = 0; i < count; i++) {
+		const char *entry = entries.data() + i * entry_size;
+		uint16_t tag, type;
+		memcpy(&tag, entry, 2);
+		memcpy(&type, entry + 2, 2);
+
+		Field field;
+		field.type = type;
+		field.count = 0;
+		if (bigtiff)
+			memcpy(&field.count, entry + 4, 8);
+		else
+			memcpy(&field.count, entry + 4, 4);
+
+		// fields of unknown types are skipped, they are not needed
+		size_t size = typeSize(type);
+		if (size == 0 || field.count > (1ULL << 32) / size)
+			continue;
+
+		const char *value = entry + (bigtiff ? 12 : 8);
+		size_t data_size = size * field.count;
+		if (data_size <= inline_size)
+			field.data.assign(value, data_size);
+		else {
+			uint64_t data_offset = 0;
+			memcpy(&data_offset, value, inline_size);
+			field.data.resize(data_size);
+			file.read(&field.data[0], data_size, data_offset);
+		}
+		fields.emplace(tag, std::move(field));
+	}
+
+	next = 0;
+	memcpy(&next, entries.data() + count * entry_size, inline_size);
+}
+
+const Directory::Field &Directory::field(uint16_t tag) const {
+	auto it = fields.find(tag);
+	if (it == fields.end())
+		throw SourceException(concat("COG: missing field ", tag));
+	return it->second;
+}
+
+std::vector<uint64_t> Directory::integers(uint16_t tag) const {
+	auto &f = field(tag);
+	std::vector<uint64_t> values(f.count);
+	for (uint64_t i = 0; i < f.count; i++) {
+		switch (f.type) {
+			case 1: values[i] = (uint8_t) f.data[i]; break;
+			case 3: { uint16_t v; memcpy(&v, f.data.data() + i * 2, 2); values[i] = v; break; }
+			case 4: case 13: { uint32_t v; memcpy(&v, f.data.data() + i * 4, 4); values[i] = v; break; }
+			case 16: case 18: memcpy(&values[i], f.data.data() + i * 8, 8); break;
+			default:
+				throw SourceException(concat("COG: field ", tag, " is not an unsigned integer"));
+		}
+	}
+	return values;
+}
+
+std::vector<double> Directory::doubles(uint16_t tag) const {
+	auto &f = field(tag);
+	if (f.type != 12)
+		throw SourceException(concat("COG: field ", tag, " is not a double"));
+	std::vector<double> values(f.count);
+	memcpy(values.data(), f.data.data(), f.data.size());
+	return values;
+}
+
+std::string Directory::string(uint16_t tag) const {
+	auto &f = field(tag);
+	if (f.type != 2)
+		throw SourceException(concat("COG: field ", tag, " is not a string"));
+	return std::string(f.data.c_str());
+}
+
+
+static GDALDataType dataType(uint64_t bits, uint64_t format) {
+	if (format == 1) {
+		if (bits == 8) return GDT_Byte;
+		if (bits == 16) return GDT_UInt16;
+		if (bits == 32) return GDT_UInt32;
+	}
+	else if (format == 2) {
+		if (bits == 16) return GDT_Int16;
+		if (bits == 32) return GDT_Int32;
+	}
+	else if (format == 3) {
+		if (bits == 32) return GDT_Float32;
+		if (bits == 64) return GDT_Float64;
+	}
+	throw SourceException(concat("COG: unsupported sample format ", format, " with ", bits, " bits"));
+}
+
+static size_t dataTypeSize(GDALDataType datatype) {
+	switch (datatype) {
+		case GDT_Byte: return 1;
+		case GDT_UInt16: case GDT_Int16: return 2;
+		case GDT_UInt32: case GDT_Int32: case GDT_Float32: return 4;
+		case GDT_Float64: return 8;
+		default: throw SourceException("COG: unsupported data type");
+	}
+}
+
+template<typename T>
+static void encodeValue(double value, char *out) {
+	T typed = (T) value;
+	memcpy(out, &typed, sizeof(T));
+}
+
+static void encodeFillValue(double value, GDALDataType datatype, char *out) {
+	switch (datatype) {
+		case GDT_Byte: encodeValue<uint8_t>(value, out); break;
+		case GDT_UInt16: encodeValue<uint16_t>(value, out); break;
+		case GDT_Int16: encodeValue<int16_t>(value, out); break;
+		case GDT_UInt32: encodeValue<uint32_t>(value, out); break;
+		case GDT_Int32: encodeValue<int32_t>(value, out); break;
+		case GDT_Float32: encodeValue<float>(value, out); break;
+		case GDT_Float64: encodeValue<double>(value, out); break;
+		default: throw SourceException("COG: unsupported data type");
+	}
+}
+
+
+CogReader::CogReader(const std::string &filename) : filename(filename), bands(1), planar_separate(false), datatype(GDT_Byte),
+		compression(COMPRESSION_NONE), predictor(1), origin_x(0), origin_y(0), has_nodata(false), nodata(0) {
+	FileDescriptor file(filename);
+
+	char header[16];
+	file.read(header, 8, 0);
+	if (header[0] != 'I' || header[1] != 'I')
+		throw SourceException(concat("COG: ", filename, " is not a little endian TIFF"));
+	uint16_t magic;
+	memcpy(&magic, header + 2, 2);
+	bool bigtiff = magic == 43;
+	if (magic != 42 && !bigtiff)
+		throw SourceException(concat("COG: ", filename, " is not a TIFF"));
+
+	uint64_t offset = 0;
+	if (bigtiff) {
+		file.read(header + 8, 8, 8);
+		memcpy(&offset, header + 8, 8);
+	}
+	else
+		memcpy(&offset, header + 4, 4);
+
+	std::set<uint64_t> visited;
+	while (offset != 0) {
+		if (!visited.insert(offset).second || visited.size() > 64)
+			throw SourceException(concat("COG: invalid chain of image file directories in ", filename));
+
+		Directory directory(file, offset, bigtiff);
+		offset = directory.next;
+
+		// the first directory is the full resolution image, later ones are overviews or masks
+		uint64_t subfile_type = directory.integer(TAG_NEW_SUBFILE_TYPE, 0);
+		bool first = levels.empty();
+		if (!first && ((subfile_type & 1) == 0 || (subfile_type & 4) != 0))
+			continue;
+
+		if (!directory.has(TAG_TILE_OFFSETS))
+			throw SourceException(concat("COG: ", filename, " is not tiled"));
+
+		auto level_bands = (int) directory.integer(TAG_SAMPLES_PER_PIXEL, 1);
+		auto level_planar_separate = directory.integer(TAG_PLANAR_CONFIGURATION, 1) == 2;
+		auto level_datatype = dataType(directory.integer(TAG_BITS_PER_SAMPLE, 1), directory.integer(TAG_SAMPLE_FORMAT, 1));
+		auto level_compression = (uint16_t) directory.integer(TAG_COMPRESSION, COMPRESSION_NONE);
+		auto level_predictor = (uint16_t) directory.integer(TAG_PREDICTOR, 1);
+
+		if (first) {
+			bands = level_bands;
+			planar_separate = level_planar_separate;
+			datatype = level_datatype;
+			compression = level_compression;
+			predictor = level_predictor;
+
+			if (compression != COMPRESSION_NONE && compression != COMPRESSION_LZW && compression != COMPRESSION_DEFLATE && compression != COMPRESSION_DEFLATE_OLD)
+				throw SourceException(concat("COG: unsupported compression ", compression, " in ", filename));
+			if (predictor < 1 || predictor > 3 || (predictor == 3 && datatype != GDT_Float32 && datatype != GDT_Float64))
+				throw SourceException(concat("COG: unsupported predictor ", predictor, " in ", filename));
+		}
+		else if (level_bands != bands || level_planar_separate != planar_separate || level_datatype != datatype
+				|| level_compression != compression || level_predictor != predictor)
+			throw SourceException(concat("COG: overviews of ", filename, " are stored differently than the image"));
+
+		Level level;
+		level.width = (uint32_t) directory.integer(TAG_IMAGE_WIDTH, 0);
+		level.height = (uint32_t) directory.integer(TAG_IMAGE_LENGTH, 0);
+		level.tile_width = (uint32_t) directory.integer(TAG_TILE_WIDTH, 0);
+		level.tile_height = (uint32_t) directory.integer(TAG_TILE_LENGTH, 0);
+		if (level.width == 0 || level.height == 0 || level.tile_width == 0 || level.tile_height == 0)
+			throw SourceException(concat("COG: invalid image size in ", filename));
+		level.tiles_x = (level.width + level.tile_width - 1) / level.tile_width;
+		level.tiles_y = (level.height + level.tile_height - 1) / level.tile_height;
+		level.tile_offsets = directory.integers(TAG_TILE_OFFSETS);
+		level.tile_byte_counts = directory.integers(TAG_TILE_BYTE_COUNTS);
+
+		size_t tiles = (size_t) level.tiles_x * level.tiles_y * (planar_separate ? bands : 1);
+		if (level.tile_offsets.size() != tiles || level.tile_byte_counts.size() != tiles)
+			throw SourceException(concat("COG: wrong number of tiles in ", filename));
+
+		if (first) {
+			// the georeference of the whole file is stored with the full resolution image
+			if (directory.has(TAG_MODEL_TRANSFORMATION)) {
+				auto m = directory.doubles(TAG_MODEL_TRANSFORMATION);
+				if (m.size() != 16 || m[1] != 0 || m[4] != 0)
+					throw SourceException(concat("COG: rotated rasters are not supported, in ", filename));
+				origin_x = m[3];
+				origin_y = m[7];
+				level.scale_x = m[0];
+				level.scale_y = m[5];
+			}
+			else if (directory.has(TAG_MODEL_PIXEL_SCALE) && directory.has(TAG_MODEL_TIEPOINT)) {
+				auto scale = directory.doubles(TAG_MODEL_PIXEL_SCALE);
+				auto tiepoint = directory.doubles(TAG_MODEL_TIEPOINT);
+				if (scale.size() < 2 || tiepoint.size() < 6)
+					throw SourceException(concat("COG: invalid georeference in ", filename));
+				level.scale_x = scale[0];
+				level.scale_y = -scale[1];
+				origin_x = tiepoint[3] - tiepoint[0] * level.scale_x;
+				origin_y = tiepoint[4] - tiepoint[1] * level.scale_y;
+			}
+			else
+				throw SourceException(concat("COG: ", filename, " has no georeference"));
+
+			// like GDAL, move the origin to the corner of the first pixel if the coordinates refer to its center
+			if (directory.has(TAG_GEO_KEY_DIRECTORY)) {
+				auto keys = directory.integers(TAG_GEO_KEY_DIRECTORY);
+				for (size_t i = 4; i + 3 < keys.size(); i += 4) {
+					if (keys[i] == GEO_KEY_RASTER_TYPE && keys[i + 1] == 0 && keys[i + 3] == RASTER_PIXEL_IS_POINT) {
+						origin_x -= level.scale_x / 2;
+						origin_y -= level.scale_y / 2;
+					}
+				}
+			}
+
+			if (directory.has(TAG_GDAL_NODATA)) {
+				auto value = directory.string(TAG_GDAL_NODATA);
+				char *end = nullptr;
+				nodata = std::strtod(value.c_str(), &end);
+				has_nodata = end != value.c_str();
+			}
+		}
+		else {
+			level.scale_x = levels[0].scale_x * levels[0].width / level.width;
+			level.scale_y = levels[0].scale_y * levels[0].height / level.height;
+		}
+
+		levels.push_back(std::move(level));
+	}
+
+	if (levels.empty())
+		throw SourceException(concat("COG: ", filename, " contains no image"));
+}
+
+std::shared_ptr<const CogReader> CogReader::open(const std::string &filename) {
+	struct CacheEntry {
+		struct timespec modified;
+		off_t size;
+		uint64_t last_used;
+		std::shared_ptr<const CogReader> reader;
+	};
+	static std::mutex mutex;
+	static std::map<std::string, CacheEntry> cache;
+	static uint64_t uses = 0;
+
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0)
+		throw SourceException(concat("COG: could not open ", filename));
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = cache.find(filename);
+		if (it != cache.end()) {
+			auto &entry = it->second;
+			if (entry.size == st.st_size && entry.modified.tv_sec == st.st_mtim.tv_sec && entry.modified.tv_nsec == st.st_mtim.tv_nsec) {
+				entry.last_used = ++uses;
+				return entry.reader;
+			}
+			cache.erase(it);
+		}
+	}
+
+	// parse outside of the lock, so slow files do not block reads of others
+	auto reader = std::make_shared<const CogReader>(filename);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (cache.size() >= CACHED_FILES) {
+		auto oldest = std::min_element(cache.begin(), cache.end(), [](const std::pair<const std::string, CacheEntry> &a, const std::pair<const std::string, CacheEntry> &b) {
+			return a.second.last_used < b.second.last_used;
+		});
+		cache.erase(oldest);
+	}
+	cache[filename] = CacheEntry{st.st_mtim, st.st_size, ++uses, reader};
+	return reader;
+}
+
+size_t CogReader::selectLevel(double pixel_size_x, double pixel_size_y) const {
+	const double tolerance = 1 + 1e-9;
+	size_t best = 0;
+	for (size_t i = 1; i < levels.size(); i++) {
+		double size_x = std::abs(levels[i].scale_x), size_y = std::abs(levels[i].scale_y);
+		if (size_x <= pixel_size_x * tolerance && size_y <= pixel_size_y * tolerance && size_x > std::abs(levels[best].scale_x))
+			best = i;
+	}
+	return best;
+}
+
+
+/*
+ * Decodes TIFF LZW: codes start with 9 bits, are packed from the most significant bit and grow one code
+ * early, as written by libtiff.
+ */
+static void decodeLZW(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size) {
+	const uint32_t CLEAR = 256, END = 257, MAX_CODES = 4096;
+	std::vector<uint16_t> prefix(MAX_CODES), length(MAX_CODES);
+	std::vector<uint8_t> suffix(MAX_CODES), first(MAX_CODES);
+	for (uint32_t i = 0; i < 256; i++) {
+		suffix[i] = first[i] = (uint8_t) i;
+		length[i] = 1;
+	}
+
+	uint32_t next = 258, bits = 9, buffer = 0, buffered = 0;
+	int32_t previous = -1;
+	size_t in_position = 0, out_position = 0;
+
+	// writes the string of a code backwards from its last byte, bytes beyond the output are dropped
+	auto emit = [&](uint32_t code) {
+		size_t position = out_position + length[code] - 1;
+		out_position += length[code];
+		while (true) {
+			if (position < out_size)
+				out[position] = suffix[code];
+			if (length[code] == 1)
+				break;
+			code = prefix[code];
+			position--;
+		}
+	};
+	auto add = [&](uint32_t code, uint8_t c) {
+		if (next >= MAX_CODES)
+			return;
+		prefix[next] = (uint16_t) code;
+		suffix[next] = c;
+		first[next] = first[code];
+		length[next] = (uint16_t) (length[code] + 1);
+		next++;
+		if (next >= (1u << bits) - 1 && bits < 12)
+			bits++;
+	};
+
+	while (out_position < out_size) {
+		while (buffered < bits && in_position < in_size) {
+			buffer = (buffer << 8) | in[in_position++];
+			buffered += 8;
+		}
+		if (buffered < bits)
+			break;
+		uint32_t code = (buffer >> (buffered - bits)) & ((1u << bits) - 1);
+		buffered -= bits;
+
+		if (code == END)
+			break;
+		if (code == CLEAR) {
+			next = 258;
+			bits = 9;
+			previous = -1;
+			continue;
+		}
+		if (previous < 0) {
+			if (code >= 256)
+				throw SourceException("COG: invalid LZW data");
+		}
+		else if (code < next)
+			add((uint32_t) previous, first[code]);
+		else if (code == next)
+			add((uint32_t) previous, first[previous]);
+		else
+			throw SourceException("COG: invalid LZW data");
+
+		emit(code);
+		previous = (int32_t) code;
+	}
+
+	if (out_position < out_size)
+		throw SourceException("COG: LZW data is too short");
+}
+
+template<typename T>
+static void undoHorizontalPredictor(uint8_t *data, size_t width, size_t height, size_t samples) {
+	for (size_t row = 0; row < height; row++) {
+		T *values = (T *) data + row * width * samples;
+		for (size_t i = samples; i < width * samples; i++)
+			values[i] = (T) (values[i] + values[i - samples]);
+	}
+}
+
+// the floating point predictor stores the bytes of a row in planes from the most significant byte, differenced bytewise
+static void undoFloatingPointPredictor(uint8_t *data, size_t width, size_t height, size_t samples, size_t bytes) {
+	size_t values = width * samples, row_bytes = values * bytes;
+	std::vector<uint8_t> row_copy(row_bytes);
+	for (size_t row = 0; row < height; row++) {
+		uint8_t *row_data = data + row * row_bytes;
+		for (size_t i = samples; i < row_bytes; i++)
+			row_data[i] = (uint8_t) (row_data[i] + row_data[i - samples]);
+		memcpy(row_copy.data(), row_data, row_bytes);
+		for (size_t i = 0; i < values; i++)
+			for (size_t b = 0; b < bytes; b++)
+				row_data[i * bytes + b] = row_copy[(bytes - b - 1) * values + i];
+	}
+}
+
+void CogReader::read(size_t level_index, int band, int64_t x, int64_t y, uint32_t width, uint32_t height,
+		uint32_t out_width, uint32_t out_height, void *buffer, double fill_value, uint32_t threads) const {
+	auto &level = getLevel(level_index);
+	if (band < 1 || band > bands)
+		throw SourceException(concat("COG: band ", band, " does not exist in ", filename));
+	if (width == 0 || height == 0 || out_width == 0 || out_height == 0)
+		throw ArgumentException("COG: cannot read an empty window");
+
+	const size_t bytes = dataTypeSize(datatype);
+	char fill[8];
+	encodeFillValue(fill_value, datatype, fill);
+	char *out = (char *) buffer;
+
+	// the pixel of the level each output pixel is sampled from
+	std::vector<int64_t> source_x(out_width), source_y(out_height);
+	for (uint32_t i = 0; i < out_width; i++)
+		source_x[i] = x + (int64_t) std::floor((i + 0.5) * width / out_width);
+	for (uint32_t i = 0; i < out_height; i++)
+		source_y[i] = y + (int64_t) std::floor((i + 0.5) * height / out_height);
+
+	auto fillPixels = [&](uint32_t x1, uint32_t x2, uint32_t y1, uint32_t y2) {
+		for (uint32_t out_y = y1; out_y < y2; out_y++)
+			for (uint32_t out_x = x1; out_x < x2; out_x++)
+				memcpy(out + ((size_t) out_y * out_width + out_x) * bytes, fill, bytes);
+	};
+
+	if (source_x.front() < 0 || source_y.front() < 0 || source_x.back() >= level.width || source_y.back() >= level.height)
+		fillPixels(0, out_width, 0, out_height);
+
+	// the output pixels sampled from each tile column and row, as they are monotonic these are contiguous ranges
+	struct Range {
+		uint32_t tile;
+		uint32_t begin;
+		uint32_t end;
+	};
+	auto ranges = [](const std::vector<int64_t> &source, uint32_t size, uint32_t tile_size) {
+		std::vector<Range> result;
+		for (uint32_t i = 0; i < source.size(); i++) {
+			if (source[i] < 0 || source[i] >= size)
+				continue;
+			auto tile = (uint32_t) (source[i] / tile_size);
+			if (result.empty() || result.back().tile != tile)
+				result.push_back(Range{tile, i, i + 1});
+			else
+				result.back().end = i + 1;
+		}
+		return result;
+	};
+	auto columns = ranges(source_x, level.width, level.tile_width);
+	auto rows = ranges(source_y, level.height, level.tile_height);
+
+	FileDescriptor file(filename);
+
+	const size_t tile_samples = planar_separate ? 1 : bands, sample = planar_separate ? 0 : band - 1;
+	const size_t tile_bytes = (size_t) level.tile_width * level.tile_height * tile_samples * bytes;
+	const size_t band_offset = planar_separate ? (size_t) (band - 1) * level.tiles_x * level.tiles_y : 0;
+
+	parallelFor(columns.size() * rows.size(), 1, threads, [&](size_t begin, size_t end) {
+		std::vector<uint8_t> compressed, tile(tile_bytes);
+		for (size_t i = begin; i < end; i++) {
+			auto &column = columns[i % columns.size()];
+			auto &row = rows[i / columns.size()];
+			size_t index = band_offset + (size_t) row.tile * level.tiles_x + column.tile;
+			uint64_t offset = level.tile_offsets[index], byte_count = level.tile_byte_counts[index];
+
+			// sparse tiles are not stored
+			if (offset == 0 || byte_count == 0) {
+				fillPixels(column.begin, column.end, row.begin, row.end);
+				continue;
+			}
+
+			if (compression == COMPRESSION_NONE) {
+				if (byte_count < tile_bytes)
+					throw SourceException(concat("COG: tile ", index, " of ", filename, " is too short"));
+				file.read(tile.data(), tile_bytes, offset);
+			}
+			else {
+				compressed.resize(byte_count);
+				file.read(compressed.data(), byte_count, offset);
+				if (compression == COMPRESSION_LZW)
+					decodeLZW(compressed.data(), compressed.size(), tile.data(), tile_bytes);
+				else {
+					uLongf size = tile_bytes;
+					auto result = uncompress(tile.data(), &size, compressed.data(), compressed.size());
+					if ((result != Z_OK && result != Z_BUF_ERROR) || size != tile_bytes)
+						throw SourceException(concat("COG: could not inflate tile ", index, " of ", filename));
+				}
+			}
+
+			if (predictor == 2) {
+				switch (bytes) {
+					case 1: undoHorizontalPredictor<uint8_t>(tile.data(), level.tile_width, level.tile_height, tile_samples); break;
+					case 2: undoHorizontalPredictor<uint16_t>(tile.data(), level.tile_width, level.tile_height, tile_samples); break;
+					case 4: undoHorizontalPredictor<uint32_t>(tile.data(), level.tile_width, level.tile_height, tile_samples); break;
+					default: undoHorizontalPredictor<uint64_t>(tile.data(), level.tile_width, level.tile_height, tile_samples); break;
+				}
+			}
+			else if (predictor == 3)
+				undoFloatingPointPredictor(tile.data(), level.tile_width, level.tile_height, tile_samples, bytes);
+
+			int64_t tile_x = (int64_t) column.tile * level.tile_width, tile_y = (int64_t) row.tile * level.tile_height;
+			for (uint32_t out_y = row.begin; out_y < row.end; out_y++) {
+				const uint8_t *tile_row = tile.data() + (size_t) (source_y[out_y] - tile_y) * level.tile_width * tile_samples * bytes;
+				char *out_row = out + (size_t) out_y * out_width * bytes;
+				for (uint32_t out_x = column.begin; out_x < column.end; out_x++)
+					memcpy(out_row + out_x * bytes, tile_row + ((size_t) (source_x[out_x] - tile_x) * tile_samples + sample) * bytes, bytes);
+			}
+		}
+	});
+}
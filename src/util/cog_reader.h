@@ -0,0 +1,90 @@
+#ifndef UTIL_COG_READER_H
+#define UTIL_COG_READER_H
+
+#include <gdal_priv.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Reads windows of tiled GeoTIFFs, e.g. cloud-optimized GeoTIFFs, without GDAL.
+ *
+ * The image file directories of the full resolution image and its overviews are parsed once when the
+ * reader is created, including the offsets and sizes of all tiles. A read only fetches the tiles that
+ * contribute to the requested window with pread() and decodes them in parallel. Tiles may be uncompressed,
+ * deflate or LZW compressed, with or without a predictor.
+ *
+ * Only little endian files are supported. The georeference is taken from the ModelTransformationTag or
+ * from the ModelPixelScaleTag and ModelTiepointTag, the crs is not read.
+ */
+class CogReader {
+	public:
+		class Level {
+			public:
+				uint32_t width;
+				uint32_t height;
+				uint32_t tile_width;
+				uint32_t tile_height;
+				uint32_t tiles_x;
+				uint32_t tiles_y;
+				double scale_x;
+				double scale_y;
+				std::vector<uint64_t> tile_offsets;
+				std::vector<uint64_t> tile_byte_counts;
+		};
+
+		/**
+		 * Parses the header and image file directories of the file
+		 */
+		explicit CogReader(const std::string &filename);
+
+		/**
+		 * Returns the reader of a file from a process-wide cache, so its directories are only parsed again
+		 * when the file was modified.
+		 */
+		static std::shared_ptr<const CogReader> open(const std::string &filename);
+
+		/**
+		 * Returns the coarsest level whose pixels are not larger than the given pixel size,
+		 * or the full resolution if the pixel size is smaller than the one of the file.
+		 */
+		size_t selectLevel(double pixel_size_x, double pixel_size_y) const;
+
+		/**
+		 * Reads a window of a level into buffer, sampled to out_width x out_height pixels with nearest
+		 * neighbour. The buffer holds the rows in the order of the file without padding. Pixels outside the
+		 * image are set to fill_value.
+		 *
+		 * @param band the band to read, 1 based
+		 * @param x, y the upper left pixel of the window in the level, may lie outside the image
+		 * @param threads the number of threads decoding tiles, 0 for one per core
+		 */
+		void read(size_t level, int band, int64_t x, int64_t y, uint32_t width, uint32_t height,
+				uint32_t out_width, uint32_t out_height, void *buffer, double fill_value, uint32_t threads) const;
+
+		size_t getLevelCount() const { return levels.size(); }
+		const Level &getLevel(size_t level) const { return levels.at(level); }
+		int getBandCount() const { return bands; }
+		GDALDataType getDataType() const { return datatype; }
+		double getOriginX() const { return origin_x; }
+		double getOriginY() const { return origin_y; }
+		bool hasNoData() const { return has_nodata; }
+		double getNoData() const { return nodata; }
+
+	private:
+		std::string filename;
+		std::vector<Level> levels;
+		int bands;
+		bool planar_separate;
+		GDALDataType datatype;
+		uint16_t compression;
+		uint16_t predictor;
+		double origin_x;
+		double origin_y;
+		bool has_nodata;
+		double nodata;
+};
+
+#endif
@@ -0,0 +1,145 @@
+
+#include "util/epoll_reactor.h"
+#include "util/exceptions.h"
+#include "util/concat.h"
+
+#include <limits>
+#include <algorithm>
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+
+const uint32_t EpollReactor::READ;
+const uint32_t EpollReactor::WRITE;
+const uint32_t EpollReactor::EDGE_TRIGGERED;
+const uint32_t EpollReactor::HANGUP;
+const uint32_t EpollReactor::ERROR;
+
+// the tag of the internal wakeup descriptor, which is never returned to the caller
+static const uint64_t WAKEUP_TAG = std::numeric_limits<uint64_t>::max();
+
+
+EpollReactor::EpollReactor() : epoll_fd(-1), wakeup_fd(-1), kernel_events(256) {
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0)
+		throw PlatformException(concat("epoll_create1() failed: ", strerror(errno)));
+
+	wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeup_fd < 0) {
+		::close(epoll_fd);
+		throw PlatformException(concat("eventfd() failed: ", strerror(errno)));
+	}
+
+	add(wakeup_fd, READ, WAKEUP_TAG);
+}
+
+EpollReactor::~EpollReactor() {
+	if (epoll_fd >= 0)
+		::close(epoll_fd);
+	::close(wakeup_fd);
+}
+
+void EpollReactor::add(int fd, uint32_t events, uint64_t tag) {
+	if (epoll_fd < 0)
+		return;
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.u64 = tag;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		throw NetworkException(concat("epoll_ctl(ADD) failed: ", strerror(errno)));
+}
+
+void EpollReactor::modify(int fd, uint32_t events, uint64_t tag) {
+	if (epoll_fd < 0)
+		return;
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.u64 = tag;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)
+		throw NetworkException(concat("epoll_ctl(MOD) failed: ", strerror(errno)));
+}
+
+void EpollReactor::remove(int fd, uint64_t tag) {
+	// after fork(), the activation_mutex may have been held by another thread of the parent
+	if (epoll_fd < 0)
+		return;
+	if (fd >= 0) {
+		// kernels before 2.6.9 require a non-null event, even though it is ignored
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+	}
+
+	std::lock_guard<std::mutex> lock(activation_mutex);
+	activated.erase(std::remove_if(activated.begin(), activated.end(), [tag](const Event &e) { return e.tag == tag; }), activated.end());
+}
+
+void EpollReactor::activate(uint64_t tag, uint32_t events) {
+	if (epoll_fd < 0)
+		return;
+	bool was_empty;
+	{
+		std::lock_guard<std::mutex> lock(activation_mutex);
+		was_empty = activated.empty();
+		activated.emplace_back(tag, events);
+	}
+	// a single wakeup is enough until the activations are collected
+	if (was_empty)
+		wakeup();
+}
+
+void EpollReactor::wakeup() {
+	uint64_t one = 1;
+	// this can only fail if the counter overflows, in which case a wakeup is pending anyway
+	auto res = ::write(wakeup_fd, &one, sizeof(one));
+	(void) res;
+}
+
+void EpollReactor::consumeWakeup() {
+	uint64_t count;
+	auto res = ::read(wakeup_fd, &count, sizeof(count));
+	(void) res;
+}
+
+const std::vector<EpollReactor::Event> &EpollReactor::wait(int timeout_ms) {
+	ready.clear();
+	if (epoll_fd < 0)
+		throw MustNotHappenException("EpollReactor: wait() called after closeAfterFork()");
+
+	int res = epoll_wait(epoll_fd, kernel_events.data(), (int) kernel_events.size(), timeout_ms);
+	if (res < 0) {
+		if (errno != EINTR)
+			throw NetworkException(concat("epoll_wait() failed: ", strerror(errno)));
+		res = 0;
+	}
+
+	for (int i = 0; i < res; i++) {
+		// struct epoll_event is packed on some platforms, so we copy its fields
+		uint64_t tag = kernel_events[i].data.u64;
+		uint32_t events = kernel_events[i].events;
+		if (tag == WAKEUP_TAG)
+			consumeWakeup();
+		else
+			ready.emplace_back(tag, events);
+	}
+	// if the buffer was too small, the remaining events are returned by the next call
+	if ((size_t) res == kernel_events.size())
+		kernel_events.resize(kernel_events.size() * 2);
+
+	std::lock_guard<std::mutex> lock(activation_mutex);
+	ready.insert(ready.end(), activated.begin(), activated.end());
+	activated.clear();
+
+	return ready;
+}
+
+void EpollReactor::closeAfterFork() {
+	if (epoll_fd >= 0)
+		::close(epoll_fd);
+	epoll_fd = -1;
+}
@@ -0,0 +1,97 @@
+#ifndef UTIL_EPOLL_REACTOR_H
+#define UTIL_EPOLL_REACTOR_H
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include <sys/epoll.h>
+
+
+/*
+ * An event loop primitive based on epoll, shared by our non-blocking servers.
+ *
+ * File descriptors are registered once and stay registered until they are removed or closed.
+ * Each registration carries a 64 bit tag chosen by the caller (a connection id or pointer),
+ * which is returned with every event. Unlike poll() or select(), the cost of a call to wait()
+ * depends on the number of ready descriptors, not on the number of registered ones.
+ *
+ * Descriptors registered with EDGE_TRIGGERED only report transitions, e.g. from "no data" to
+ * "data available". The owner must keep track of the readiness itself and may only consider a
+ * descriptor not ready after a read() or write() failed with EAGAIN.
+ *
+ * Besides kernel events, tags can be activated manually, e.g. when a connection has data to
+ * send without any change on its socket. Activation is thread-safe and interrupts a running wait().
+ */
+class EpollReactor {
+	public:
+		static const uint32_t READ = EPOLLIN;
+		static const uint32_t WRITE = EPOLLOUT;
+		static const uint32_t EDGE_TRIGGERED = EPOLLET;
+		static const uint32_t HANGUP = EPOLLHUP | EPOLLRDHUP;
+		static const uint32_t ERROR = EPOLLERR;
+
+		struct Event {
+			Event(uint64_t tag, uint32_t events) : tag(tag), events(events) {}
+			uint64_t tag;
+			uint32_t events;
+		};
+
+		EpollReactor();
+		~EpollReactor();
+
+		EpollReactor(const EpollReactor &) = delete;
+		EpollReactor &operator=(const EpollReactor &) = delete;
+
+		/*
+		 * Registers a file descriptor for the given events
+		 */
+		void add(int fd, uint32_t events, uint64_t tag);
+		/*
+		 * Changes the events or the tag of a registered file descriptor
+		 */
+		void modify(int fd, uint32_t events, uint64_t tag);
+		/*
+		 * Removes a file descriptor and drops pending activations of its tag. This must be called
+		 * before the descriptor is closed, if the underlying socket may still be open in another
+		 * process or thread. Unknown descriptors are ignored.
+		 */
+		void remove(int fd, uint64_t tag);
+
+		/*
+		 * Queues an event for the given tag, which is returned by the next call to wait()
+		 */
+		void activate(uint64_t tag, uint32_t events);
+		/*
+		 * Interrupts a running or the next call to wait()
+		 */
+		void wakeup();
+
+		/*
+		 * Waits for events. A timeout of -1 waits indefinitely.
+		 * Returns an empty list on timeout, on a wakeup() or when interrupted by a signal.
+		 * The returned reference is valid until the next call to wait(). The events may refer to
+		 * tags that are removed later on, so they should be dispatched before any tag is removed.
+		 */
+		const std::vector<Event> &wait(int timeout_ms);
+
+		/*
+		 * To be called in a child process after fork(). The epoll set is shared with the parent,
+		 * so the child must not modify it. This closes the child's handle, all further calls
+		 * to add(), modify(), remove() and activate() are ignored without locking anything.
+		 */
+		void closeAfterFork();
+	private:
+		void consumeWakeup();
+
+		int epoll_fd;
+		int wakeup_fd;
+
+		std::vector<struct epoll_event> kernel_events;
+		std::vector<Event> ready;
+
+		std::mutex activation_mutex;
+		std::vector<Event> activated;
+};
+
+#endif
@@ -0,0 +1,330 @@
+
+#include "util/focal_kernel.h"
+#include "util/parallel_for.h"
+#include "util/exceptions.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/typejuggling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+
+FocalKernel::FocalKernel(Operation operation, int size, std::vector<int> matrix)
+	: operation(operation), size(size), matrix(std::move(matrix)), separable(false), divisor(1) {
+	if (size <= 1 || size % 2 != 1)
+		throw ArgumentException("FocalKernel: size must be odd and greater than 1");
+	if (operation == Operation::CONVOLUTION) {
+		if (this->matrix.size() != (size_t) size * size)
+			throw ArgumentException("FocalKernel: matrix has the wrong length");
+		detectSeparability();
+	}
+}
+
+void FocalKernel::detectSeparability() {
+	// use the entry with the largest magnitude as pivot
+	size_t pivot = 0;
+	for (size_t i = 1; i < matrix.size(); i++) {
+		if (std::abs((int64_t) matrix[i]) > std::abs((int64_t) matrix[pivot]))
+			pivot = i;
+	}
+	if (matrix[pivot] == 0)
+		return;
+	int pivot_y = pivot / size, pivot_x = pivot % size;
+
+	// a matrix has rank one iff every entry equals row * column / pivot
+	std::vector<int> h(matrix.begin() + pivot_y * size, matrix.begin() + (pivot_y + 1) * size);
+	std::vector<int> v(size);
+	for (int y = 0; y < size; y++)
+		v[y] = matrix[y * size + pivot_x];
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			if ((int64_t) matrix[y * size + x] * matrix[pivot] != (int64_t) v[y] * h[x])
+				return;
+		}
+	}
+
+	separable = true;
+	horizontal = std::move(h);
+	vertical = std::move(v);
+	divisor = matrix[pivot];
+}
+
+
+template<typename T> static T cap(T v, T min, T max) {
+	return std::min(max, std::max(v, min));
+}
+
+/*
+ * Calls op(x, source_x) for all x in [0, width), where source_x = x + dx clamped to the row.
+ * Only the pixels near the border need clamping, the interior is a plain loop.
+ */
+template<typename Op>
+static void forShifted(int width, int dx, const Op &op) {
+	int interior_begin = cap(-dx, 0, width);
+	int interior_end = cap(width - dx, interior_begin, width);
+	for (int x = 0; x < interior_begin; x++)
+		op(x, 0);
+	for (int x = interior_begin; x < interior_end; x++)
+		op(x, x + dx);
+	for (int x = interior_end; x < width; x++)
+		op(x, width - 1);
+}
+
+template<typename T>
+struct focal_kernel {
+	// integer convolutions are computed exactly
+	using accumulator = typename std::conditional<RasterTypeInfo<T>::isinteger, int64_t, double>::type;
+
+	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster_src, const FocalKernel *kernel, uint32_t num_threads) {
+		raster_src->setRepresentation(GenericRaster::Representation::CPU);
+		auto raster_dest_guard = GenericRaster::create(raster_src->dd, *raster_src, GenericRaster::Representation::CPU);
+
+		focal_kernel<T> context(raster_src, (Raster2D<T> *) raster_dest_guard.get(), kernel, num_threads);
+		switch (kernel->getOperation()) {
+			case FocalKernel::Operation::CONVOLUTION:
+				if (kernel->isSeparable())
+					context.convolveSeparable();
+				else
+					context.convolve();
+				break;
+			case FocalKernel::Operation::MEAN:
+				context.reduce<accumulator>(0, [](accumulator a, T b) { return a + b; }, [](accumulator a, accumulator b) { return a + b; },
+					[](accumulator sum, uint32_t count) { return (double) sum / count; });
+				break;
+			case FocalKernel::Operation::MIN:
+				context.reduce<T>(std::numeric_limits<T>::max(), [](T a, T b) { return std::min(a, b); }, [](T a, T b) { return std::min(a, b); },
+					[](T min, uint32_t) { return (double) min; });
+				break;
+			case FocalKernel::Operation::MAX:
+				context.reduce<T>(std::numeric_limits<T>::lowest(), [](T a, T b) { return std::max(a, b); }, [](T a, T b) { return std::max(a, b); },
+					[](T max, uint32_t) { return (double) max; });
+				break;
+			case FocalKernel::Operation::MEDIAN:
+				context.median();
+				break;
+		}
+
+		return raster_dest_guard;
+	}
+
+	focal_kernel(Raster2D<T> *src, Raster2D<T> *dest, const FocalKernel *kernel, uint32_t num_threads)
+		: src(src), dest(dest), kernel(kernel), num_threads(num_threads), width(src->width), height(src->height),
+		  radius(kernel->getSize() / 2), check_invalid(src->dd.has_no_data || !RasterTypeInfo<T>::isinteger) {
+		min = std::max(src->dd.unit.getMin(), src->dd.getMinByDatatype());
+		max = std::min(src->dd.unit.getMax(), src->dd.getMaxByDatatype());
+		invalid_value = src->dd.has_no_data ? (T) src->dd.no_data : invalidWithoutNoData();
+
+		if (check_invalid) {
+			invalid.resize((size_t) width * height);
+			forRows([&](int y) {
+				for (size_t i = (size_t) y * width; i < (size_t) (y + 1) * width; i++)
+					invalid[i] = src->dd.is_no_data(src->data[i]) || std::isnan((double) src->data[i]);
+			});
+		}
+	}
+
+	static T invalidWithoutNoData() {
+		// integer rasters without no data never contain invalid pixels
+		return RasterTypeInfo<T>::isinteger ? 0 : (T) std::numeric_limits<double>::quiet_NaN();
+	}
+
+	template<typename Op>
+	void forRows(const Op &op) {
+		parallelFor(height, 16, num_threads, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++)
+				op((int) y);
+		});
+	}
+
+	const T *row(int y) const {
+		return &src->data[(size_t) cap(y, 0, height - 1) * width];
+	}
+
+	const uint8_t *invalidRow(int y) const {
+		return &invalid[(size_t) cap(y, 0, height - 1) * width];
+	}
+
+	T output(double value) const {
+		if (std::isnan(value))
+			return invalid_value;
+		value = cap(value, min, max);
+		if (RasterTypeInfo<T>::isinteger)
+			value = std::round(value);
+		return (T) value;
+	}
+
+	void writeRow(int y, const accumulator *sums, const uint8_t *bad, int64_t divisor) {
+		T *out = &dest->data[(size_t) y * width];
+		for (int x = 0; x < width; x++)
+			out[x] = (check_invalid && bad[x]) ? invalid_value : output((double) sums[x] / divisor);
+	}
+
+	void convolve() {
+		const int size = kernel->getSize();
+		const auto &matrix = kernel->getMatrix();
+
+		forRows([&](int y) {
+			std::vector<accumulator> sums(width, 0);
+			std::vector<uint8_t> bad(width, 0);
+			for (int ky = 0; ky < size; ky++) {
+				const T *in = row(y + ky - radius);
+				const uint8_t *in_invalid = check_invalid ? invalidRow(y + ky - radius) : nullptr;
+				for (int kx = 0; kx < size; kx++) {
+					const accumulator w = matrix[ky * size + kx];
+					if (w == 0)
+						continue;
+					forShifted(width, kx - radius, [&](int x, int sx) { sums[x] += w * in[sx]; });
+					if (check_invalid)
+						forShifted(width, kx - radius, [&](int x, int sx) { bad[x] |= in_invalid[sx]; });
+				}
+			}
+			writeRow(y, sums.data(), bad.data(), 1);
+		});
+	}
+
+	void convolveSeparable() {
+		const int size = kernel->getSize();
+		const auto &horizontal = kernel->getHorizontal();
+		const auto &vertical = kernel->getVertical();
+
+		std::vector<accumulator> tmp((size_t) width * height, 0);
+		std::vector<uint8_t> tmp_bad(check_invalid ? (size_t) width * height : 0, 0);
+
+		forRows([&](int y) {
+			const T *in = row(y);
+			const uint8_t *in_invalid = check_invalid ? invalidRow(y) : nullptr;
+			accumulator *sums = &tmp[(size_t) y * width];
+			uint8_t *bad = check_invalid ? &tmp_bad[(size_t) y * width] : nullptr;
+			for (int k = 0; k < size; k++) {
+				const accumulator w = horizontal[k];
+				if (w == 0)
+					continue;
+				forShifted(width, k - radius, [&](int x, int sx) { sums[x] += w * in[sx]; });
+				if (check_invalid)
+					forShifted(width, k - radius, [&](int x, int sx) { bad[x] |= in_invalid[sx]; });
+			}
+		});
+
+		forRows([&](int y) {
+			std::vector<accumulator> sums(width, 0);
+			std::vector<uint8_t> bad(width, 0);
+			for (int k = 0; k < size; k++) {
+				const accumulator w = vertical[k];
+				if (w == 0)
+					continue;
+				size_t offset = (size_t) cap(y + k - radius, 0, height - 1) * width;
+				const accumulator *in = &tmp[offset];
+				for (int x = 0; x < width; x++)
+					sums[x] += w * in[x];
+				if (check_invalid) {
+					const uint8_t *in_invalid = &tmp_bad[offset];
+					for (int x = 0; x < width; x++)
+						bad[x] |= in_invalid[x];
+				}
+			}
+			writeRow(y, sums.data(), bad.data(), kernel->getDivisor());
+		});
+	}
+
+	/*
+	 * Reduces the valid values of the window in a horizontal and a vertical pass, counting them along the way.
+	 */
+	template<typename V, typename Add, typename Combine, typename Finish>
+	void reduce(V identity, const Add &add, const Combine &combine, const Finish &finish) {
+		const int size = kernel->getSize();
+		std::vector<V> tmp((size_t) width * height, identity);
+		std::vector<uint32_t> tmp_count((size_t) width * height, 0);
+
+		forRows([&](int y) {
+			const T *in = row(y);
+			const uint8_t *in_invalid = check_invalid ? invalidRow(y) : nullptr;
+			V *values = &tmp[(size_t) y * width];
+			uint32_t *counts = &tmp_count[(size_t) y * width];
+			for (int k = 0; k < size; k++) {
+				if (check_invalid) {
+					forShifted(width, k - radius, [&](int x, int sx) {
+						if (!in_invalid[sx]) {
+							values[x] = add(values[x], in[sx]);
+							counts[x]++;
+						}
+					});
+				}
+				else
+					forShifted(width, k - radius, [&](int x, int sx) { values[x] = add(values[x], in[sx]); });
+			}
+			if (!check_invalid)
+				std::fill(counts, counts + width, (uint32_t) size);
+		});
+
+		forRows([&](int y) {
+			std::vector<V> values(width, identity);
+			std::vector<uint32_t> counts(width, 0);
+			for (int k = 0; k < size; k++) {
+				size_t offset = (size_t) cap(y + k - radius, 0, height - 1) * width;
+				for (int x = 0; x < width; x++) {
+					values[x] = combine(values[x], tmp[offset + x]);
+					counts[x] += tmp_count[offset + x];
+				}
+			}
+			T *out = &dest->data[(size_t) y * width];
+			for (int x = 0; x < width; x++)
+				out[x] = counts[x] > 0 ? output(finish(values[x], counts[x])) : invalid_value;
+		});
+	}
+
+	void median() {
+		const int size = kernel->getSize();
+
+		forRows([&](int y) {
+			std::vector<const T *> rows(size);
+			std::vector<const uint8_t *> invalid_rows(size, nullptr);
+			for (int k = 0; k < size; k++) {
+				rows[k] = row(y + k - radius);
+				if (check_invalid)
+					invalid_rows[k] = invalidRow(y + k - radius);
+			}
+
+			std::vector<T> values;
+			values.reserve((size_t) size * size);
+			T *out = &dest->data[(size_t) y * width];
+			for (int x = 0; x < width; x++) {
+				values.clear();
+				bool interior = x >= radius && x + radius < width;
+				for (int ky = 0; ky < size; ky++) {
+					for (int kx = 0; kx < size; kx++) {
+						int sx = interior ? x + kx - radius : cap(x + kx - radius, 0, width - 1);
+						if (!check_invalid || !invalid_rows[ky][sx])
+							values.push_back(rows[ky][sx]);
+					}
+				}
+				if (values.empty()) {
+					out[x] = invalid_value;
+					continue;
+				}
+
+				auto middle = values.begin() + values.size() / 2;
+				std::nth_element(values.begin(), middle, values.end());
+				double median = *middle;
+				if (values.size() % 2 == 0)
+					median = (median + *std::max_element(values.begin(), middle)) / 2;
+				out[x] = output(median);
+			}
+		});
+	}
+
+	Raster2D<T> *src, *dest;
+	const FocalKernel *kernel;
+	uint32_t num_threads;
+	int width, height, radius;
+	bool check_invalid;
+	std::vector<uint8_t> invalid;
+	double min, max;
+	T invalid_value;
+};
+
+
+std::unique_ptr<GenericRaster> FocalKernel::apply(GenericRaster &raster, uint32_t num_threads) const {
+	return callUnaryOperatorFunc<focal_kernel>(&raster, this, num_threads);
+}
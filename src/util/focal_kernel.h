@@ -0,0 +1,66 @@
+#ifndef UTIL_FOCAL_KERNEL_H
+#define UTIL_FOCAL_KERNEL_H
+
+#include "datatypes/raster.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+/*
+ * Computes a raster where each pixel is derived from the square window of size x size pixels around
+ * it in the input raster. Pixels outside the raster are replaced by the closest pixel on the border.
+ *
+ * CONVOLUTION weights the window with an integer matrix. A pixel becomes no data if any pixel with a
+ * non-zero weight is no data. Matrices of rank one (e.g. box or binomial filters) are detected and
+ * computed as a horizontal and a vertical pass, which needs 2*size instead of size*size operations
+ * per pixel. Integer results are exact in both cases.
+ *
+ * MEAN, MIN, MAX and MEDIAN ignore no data values and only become no data if the whole window is.
+ *
+ * All operations accumulate whole rows, so the interior of a row is processed without bounds checks.
+ * The rows are split across threads. Results are clamped to the range of the unit and the data type.
+ */
+class FocalKernel {
+	public:
+		enum class Operation {
+			CONVOLUTION,
+			MEAN,
+			MIN,
+			MAX,
+			MEDIAN
+		};
+
+		/*
+		 * @param size the odd width and height of the window
+		 * @param matrix the size*size weights in row-major order, only used for CONVOLUTION
+		 */
+		FocalKernel(Operation operation, int size, std::vector<int> matrix = {});
+
+		std::unique_ptr<GenericRaster> apply(GenericRaster &raster, uint32_t num_threads = 0) const;
+
+		/*
+		 * Whether the convolution is computed as two one-dimensional passes.
+		 */
+		bool isSeparable() const { return separable; }
+
+		Operation getOperation() const { return operation; }
+		int getSize() const { return size; }
+		const std::vector<int> &getMatrix() const { return matrix; }
+		// the factors of a separable matrix: matrix[y*size+x] * divisor == vertical[y] * horizontal[x]
+		const std::vector<int> &getHorizontal() const { return horizontal; }
+		const std::vector<int> &getVertical() const { return vertical; }
+		int64_t getDivisor() const { return divisor; }
+	private:
+		void detectSeparability();
+
+		Operation operation;
+		int size;
+		std::vector<int> matrix;
+		bool separable;
+		std::vector<int> horizontal, vertical;
+		int64_t divisor;
+};
+
+#endif
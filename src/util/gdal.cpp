@@ -6,6 +6,10 @@
 #include "util/CrsDirectory.h"
 
 #include <mutex>
+#include <map>
+#include <tuple>
+#include <limits>
+#include <algorithm>
 
 #include <gdal_alg.h>
 
@@ -111,5 +115,98 @@ bool CRSTransformer::transform(double &px, double &py, double &pz) const {
 	return true;
 }
 
+size_t CRSTransformer::transform(size_t count, double *px, double *py, int *success) const {
+	// GDAL takes the number of points as int
+	const size_t max_chunk = std::numeric_limits<int>::max();
+	for (size_t offset = 0; offset < count; offset += max_chunk) {
+		int chunk = (int) std::min(count - offset, max_chunk);
+		// The return value only tells whether all points succeeded. GDAL may bail out without
+		// touching the success flags, so they are cleared beforehand.
+		std::fill(success + offset, success + offset + chunk, 0);
+		GDALReprojectionTransform(transformer, false, chunk, px + offset, py + offset, nullptr, success + offset);
+	}
+
+	size_t transformed = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (success[i])
+			transformed++;
+	}
+	return transformed;
+}
+
+bool CRSTransformer::transform(std::vector<Coordinate> &coordinates, std::vector<bool> &failed) const {
+	size_t count = coordinates.size();
+	failed.assign(count, false);
+	if (count == 0)
+		return true;
+
+	// GDAL expects separate arrays for each dimension
+	std::vector<double> px(count), py(count);
+	std::vector<int> success(count);
+	for (size_t i = 0; i < count; i++) {
+		px[i] = coordinates[i].x;
+		py[i] = coordinates[i].y;
+	}
+
+	size_t transformed = transform(count, px.data(), py.data(), success.data());
+
+	for (size_t i = 0; i < count; i++) {
+		coordinates[i].x = px[i];
+		coordinates[i].y = py[i];
+		if (!success[i])
+			failed[i] = true;
+	}
+	return transformed == count;
+}
+
+
+/*
+ * The cache of idle transformers. It is never destroyed, so handles may outlive static destruction.
+ */
+namespace {
+	using CacheKey = std::tuple<std::string, uint32_t, std::string, uint32_t>;
+
+	// more idle transformers than concurrent users per pair of projections are not useful
+	const size_t MAX_IDLE_TRANSFORMERS = 16;
+
+	struct TransformerCache {
+		std::mutex mutex;
+		std::map<CacheKey, std::vector<std::unique_ptr<CRSTransformer>>> idle;
+	};
+
+	TransformerCache &transformerCache() {
+		static TransformerCache *cache = new TransformerCache();
+		return *cache;
+	}
+
+	CacheKey cacheKey(const CrsId &in_crsId, const CrsId &out_crsId) {
+		return CacheKey(in_crsId.authority, in_crsId.code, out_crsId.authority, out_crsId.code);
+	}
+}
+
+CRSTransformer::Handle CRSTransformer::get(const CrsId &in_crsId, const CrsId &out_crsId) {
+	auto &cache = transformerCache();
+	{
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		auto it = cache.idle.find(cacheKey(in_crsId, out_crsId));
+		if (it != cache.idle.end() && !it->second.empty()) {
+			Handle handle(it->second.back().release());
+			it->second.pop_back();
+			return handle;
+		}
+	}
+	// creating the transformer may take a while, so it is done without holding the lock
+	return Handle(new CRSTransformer(in_crsId, out_crsId));
+}
+
+void CRSTransformer::ReturnToCache::operator()(CRSTransformer *transformer) const {
+	std::unique_ptr<CRSTransformer> owned(transformer);
+	auto &cache = transformerCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	auto &idle = cache.idle[cacheKey(transformer->in_crsId, transformer->out_crsId)];
+	if (idle.size() < MAX_IDLE_TRANSFORMERS)
+		idle.push_back(std::move(owned));
+}
+
 
 } // End namespace GDAL
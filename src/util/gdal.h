@@ -2,6 +2,8 @@
 #define UTIL_GDAL_H
 
 #include <string>
+#include <vector>
+#include <memory>
 #include <stdint.h>
 #include "datatypes/spatiotemporal.h"
 
@@ -11,9 +13,27 @@ namespace GDAL {
 
 	/**
 	 * This class allows the transformation of coordinates between two projections
+	 *
+	 * An instance must not be used by multiple threads at the same time.
 	 */
 	class CRSTransformer {
+		private:
+			struct ReturnToCache {
+				void operator()(CRSTransformer *transformer) const;
+			};
 		public:
+			/**
+			 * A transformer borrowed from the cache, it is returned on destruction
+			 */
+			using Handle = std::unique_ptr<CRSTransformer, ReturnToCache>;
+
+			/**
+			 * Returns a transformer from a process-wide cache. Setting up a transformer is expensive,
+			 * so unused ones are kept for each pair of projections. A transformer is never handed
+			 * out twice at the same time, so the returned one may be used without locking.
+			 */
+			static Handle get(const CrsId &in_crsId, const CrsId &out_crsId);
+
 			CRSTransformer(CrsId in_crsId, CrsId out_crsId);
 			~CRSTransformer();
 
@@ -22,6 +42,18 @@ namespace GDAL {
 
 			bool transform(double &px, double &py, double &pz) const;
 			bool transform(double &px, double &py) const { double pz = 0.0; return transform(px, py, pz); }
+			/**
+			 * Transforms count coordinates in place with as few calls to PROJ as possible.
+			 * success[i] is set to 0 if the i-th coordinate could not be transformed.
+			 * @return the number of successfully transformed coordinates
+			 */
+			size_t transform(size_t count, double *px, double *py, int *success) const;
+			/**
+			 * Transforms all coordinates in place with as few calls to PROJ as possible.
+			 * failed[i] is set if the i-th coordinate could not be transformed, its value is undefined then.
+			 * @return true if all coordinates were transformed
+			 */
+			bool transform(std::vector<Coordinate> &coordinates, std::vector<bool> &failed) const;
 			const CrsId in_crsId;
             const CrsId out_crsId;
 
@@ -0,0 +1,326 @@
+
+#include "util/geotiff_writer.h"
+#include "util/exceptions.h"
+
+#include <zlib.h>
+#include <ogr_spatialref.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+
+// TIFF field types
+static const uint16_t TIFF_ASCII = 2;
+static const uint16_t TIFF_SHORT = 3;
+static const uint16_t TIFF_LONG = 4;
+static const uint16_t TIFF_DOUBLE = 12;
+static const uint16_t TIFF_LONG8 = 16;
+
+template<typename T>
+static void appendValue(std::string &buffer, T value) {
+	buffer.append((const char *) &value, sizeof(T));
+}
+
+template<typename T>
+static std::string encodeValues(const std::vector<T> &values) {
+	std::string data;
+	for (auto value : values)
+		appendValue(data, value);
+	return data;
+}
+
+static uint16_t sampleFormat(GDALDataType datatype) {
+	switch (datatype) {
+		case GDT_Byte:
+		case GDT_UInt16:
+		case GDT_UInt32:
+			return 1;
+		case GDT_Int16:
+		case GDT_Int32:
+			return 2;
+		case GDT_Float32:
+		case GDT_Float64:
+			return 3;
+		default:
+			throw ArgumentException("GeoTiffWriter: unsupported data type");
+	}
+}
+
+enum class CrsKind {
+	GEOGRAPHIC,
+	PROJECTED,
+	OTHER
+};
+
+// GeoTIFF has separate keys for geographic and projected crs, other kinds cannot be given as a code
+static CrsKind getCrsKind(const CrsId &crsId) {
+	if (crsId.authority != "EPSG" || crsId.code > std::numeric_limits<uint16_t>::max())
+		return CrsKind::OTHER;
+	OGRSpatialReference srs(nullptr);
+	if (srs.importFromEPSG((int) crsId.code) != OGRERR_NONE)
+		return CrsKind::OTHER;
+	if (srs.IsGeographic())
+		return CrsKind::GEOGRAPHIC;
+	if (srs.IsProjected())
+		return CrsKind::PROJECTED;
+	return CrsKind::OTHER;
+}
+
+static std::string compressTile(const std::string &tile) {
+	uLongf size = compressBound(tile.size());
+	std::string result(size, '\0');
+	if (compress2((Bytef *) &result[0], &size, (const Bytef *) tile.data(), tile.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+		throw ExporterException("GeoTiffWriter: deflate failed");
+	result.resize(size);
+	return result;
+}
+
+
+GeoTiffWriter::GeoTiffWriter(std::ostream &stream, const SpatialReference &sref, uint32_t width, uint32_t height, const DataDescription &dd,
+		uint32_t tile_width, uint32_t tile_height, Compression compression, uint32_t threads,
+		const std::function<void(uint64_t file_size)> &on_start)
+	: stream(stream), sref(sref), width(width), height(height), dd(dd), tile_width(tile_width), tile_height(tile_height),
+	  compression(compression), threads(threads), on_start(on_start), tiles_added(0) {
+
+	// the tile data is written as it is in memory
+	const uint16_t one = 1;
+	if (*(const char *) &one != 1)
+		throw ExporterException("GeoTiffWriter: only little endian systems are supported");
+
+	if (!supportsCrs(sref.crsId))
+		throw ArgumentException("GeoTiffWriter: the crs must be a geographic or projected crs given by an EPSG code");
+	if (width == 0 || height == 0)
+		throw ArgumentException("GeoTiffWriter: the raster is empty");
+	if (tile_width == 0 || tile_height == 0 || tile_width % 16 != 0 || tile_height % 16 != 0)
+		throw ArgumentException("GeoTiffWriter: the tile size must be a positive multiple of 16");
+	sampleFormat(dd.datatype);
+
+	tiles_x = (width + tile_width - 1) / tile_width;
+	tiles_y = (height + tile_height - 1) / tile_height;
+
+	if (this->threads == 0)
+		this->threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+GeoTiffWriter::~GeoTiffWriter() = default;
+
+bool GeoTiffWriter::supportsCrs(const CrsId &crsId) {
+	return getCrsKind(crsId) != CrsKind::OTHER;
+}
+
+std::string GeoTiffWriter::padTile(GenericRaster &tile) const {
+	const uint32_t x = (uint32_t) (tiles_added % tiles_x) * tile_width;
+	const uint32_t y = (uint32_t) (tiles_added / tiles_x) * tile_height;
+	const uint32_t tile_data_width = std::min(tile_width, width - x);
+	const uint32_t tile_data_height = std::min(tile_height, height - y);
+	if (tile.width != tile_data_width || tile.height != tile_data_height)
+		throw ArgumentException("GeoTiffWriter: the tile has the wrong size");
+	if (tile.dd.datatype != dd.datatype)
+		throw ArgumentException("GeoTiffWriter: the tile has the wrong data type");
+
+	tile.setRepresentation(GenericRaster::Representation::CPU);
+	const size_t bpp = dd.getBPP();
+	const char *data = (const char *) tile.getData();
+
+	// the parts of border tiles outside of the raster are filled with zeros
+	std::string result((size_t) tile_width * tile_height * bpp, '\0');
+	for (uint32_t row = 0; row < tile_data_height; row++)
+		memcpy(&result[row * tile_width * bpp], data + row * tile_data_width * bpp, tile_data_width * bpp);
+	return result;
+}
+
+void GeoTiffWriter::addTile(GenericRaster &tile) {
+	if (tiles_added >= getTileCount())
+		throw ArgumentException("GeoTiffWriter: all tiles were added already");
+
+	std::string data = padTile(tile);
+	tiles_added++;
+
+	if (compression == Compression::NONE) {
+		if (tiles_added == 1)
+			start(std::vector<uint64_t>(getTileCount(), data.size()));
+		stream.write(data.data(), data.size());
+		stream.flush();
+		return;
+	}
+
+	if (compressing.size() >= threads) {
+		compressed.push_back(compressing.front().get());
+		compressing.pop_front();
+	}
+	compressing.push_back(std::async(std::launch::async, compressTile, std::move(data)));
+}
+
+void GeoTiffWriter::finish() {
+	if (tiles_added != getTileCount())
+		throw ArgumentException("GeoTiffWriter: not all tiles were added");
+
+	if (compression == Compression::DEFLATE) {
+		while (!compressing.empty()) {
+			compressed.push_back(compressing.front().get());
+			compressing.pop_front();
+		}
+
+		std::vector<uint64_t> byte_counts;
+		for (auto &tile : compressed)
+			byte_counts.push_back(tile.size());
+		start(byte_counts);
+
+		for (auto &tile : compressed) {
+			stream.write(tile.data(), tile.size());
+			std::string().swap(tile);
+		}
+	}
+	stream.flush();
+}
+
+void GeoTiffWriter::start(const std::vector<uint64_t> &byte_counts) {
+	uint64_t data_size = 0;
+	for (auto count : byte_counts)
+		data_size += count;
+
+	// offsets in classic TIFFs have 32 bits
+	bool bigtiff = encodeHeader(byte_counts, false).size() + data_size > std::numeric_limits<uint32_t>::max();
+	std::string header = encodeHeader(byte_counts, bigtiff);
+
+	if (on_start)
+		on_start(header.size() + data_size);
+	stream.write(header.data(), header.size());
+}
+
+/*
+ * Encodes the TIFF header and the single IFD, followed by the values that do not fit into their IFD entries.
+ * The tile data follows directly after it.
+ */
+std::string GeoTiffWriter::encodeHeader(const std::vector<uint64_t> &byte_counts, bool bigtiff) const {
+	const uint16_t offset_type = bigtiff ? TIFF_LONG8 : TIFF_LONG;
+	const size_t offset_size = bigtiff ? 8 : 4;
+	const uint64_t tile_count = byte_counts.size();
+
+	std::string byte_count_data;
+	for (auto count : byte_counts) {
+		if (bigtiff)
+			appendValue<uint64_t>(byte_count_data, count);
+		else
+			appendValue<uint32_t>(byte_count_data, (uint32_t) count);
+	}
+
+	double pixel_scale_x = (sref.x2 - sref.x1) / width;
+	double pixel_scale_y = (sref.y2 - sref.y1) / height;
+
+	const bool geographic = getCrsKind(sref.crsId) == CrsKind::GEOGRAPHIC;
+	std::vector<uint16_t> geo_keys {
+		1, 1, 0, 3, // version 1.1.0 with 3 keys
+		1024, 0, 1, (uint16_t) (geographic ? 2 : 1), // GTModelTypeGeoKey
+		1025, 0, 1, 1, // GTRasterTypeGeoKey: PixelIsArea
+		(uint16_t) (geographic ? 2048 : 3072), 0, 1, (uint16_t) sref.crsId.code // GeographicTypeGeoKey or ProjectedCSTypeGeoKey
+	};
+
+	// sorted by tag
+	std::vector<Entry> entries {
+		{256, TIFF_LONG, 1, encodeValues<uint32_t>({width})}, // ImageWidth
+		{257, TIFF_LONG, 1, encodeValues<uint32_t>({height})}, // ImageLength
+		{258, TIFF_SHORT, 1, encodeValues<uint16_t>({(uint16_t) (dd.getBPP() * 8)})}, // BitsPerSample
+		{259, TIFF_SHORT, 1, encodeValues<uint16_t>({(uint16_t) (compression == Compression::DEFLATE ? 8 : 1)})}, // Compression
+		{262, TIFF_SHORT, 1, encodeValues<uint16_t>({1})}, // PhotometricInterpretation: BlackIsZero
+		{277, TIFF_SHORT, 1, encodeValues<uint16_t>({1})}, // SamplesPerPixel
+		{284, TIFF_SHORT, 1, encodeValues<uint16_t>({1})}, // PlanarConfiguration: contiguous
+		{322, TIFF_LONG, 1, encodeValues<uint32_t>({tile_width})}, // TileWidth
+		{323, TIFF_LONG, 1, encodeValues<uint32_t>({tile_height})}, // TileLength
+		{324, offset_type, tile_count, std::string(tile_count * offset_size, '\0')}, // TileOffsets, filled in below
+		{325, offset_type, tile_count, byte_count_data}, // TileByteCounts
+		{339, TIFF_SHORT, 1, encodeValues<uint16_t>({sampleFormat(dd.datatype)})}, // SampleFormat
+		{34264, TIFF_DOUBLE, 16, encodeValues<double>({ // ModelTransformationTag
+			pixel_scale_x, 0, 0, sref.x1,
+			0, pixel_scale_y, 0, sref.y1,
+			0, 0, 0, 0,
+			0, 0, 0, 1
+		})},
+		{34735, TIFF_SHORT, geo_keys.size(), encodeValues<uint16_t>(geo_keys)} // GeoKeyDirectoryTag
+	};
+	if (dd.has_no_data) {
+		std::ostringstream no_data;
+		no_data.precision(std::numeric_limits<double>::max_digits10);
+		if (std::isnan(dd.no_data))
+			no_data << "nan";
+		else
+			no_data << dd.no_data;
+		std::string value = no_data.str();
+		entries.push_back(Entry{42113, TIFF_ASCII, value.size() + 1, value + '\0'}); // GDAL_NODATA
+	}
+
+	// layout: header, IFD, values that do not fit into their entries, tile data
+	const size_t inline_size = bigtiff ? 8 : 4;
+	const uint64_t ifd_offset = bigtiff ? 16 : 8;
+	uint64_t offset = ifd_offset + (bigtiff ? 8 : 2) + entries.size() * (bigtiff ? 20 : 12) + offset_size;
+	std::vector<uint64_t> value_offsets(entries.size(), 0);
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].data.size() > inline_size) {
+			offset += offset % 2;
+			value_offsets[i] = offset;
+			offset += entries[i].data.size();
+		}
+	}
+	// the TileOffsets have been placed, so the start of the tile data is known
+	const uint64_t data_offset = offset + (8 - offset % 8) % 8;
+	std::string &tile_offsets = std::find_if(entries.begin(), entries.end(), [](const Entry &entry) { return entry.tag == 324; })->data;
+	tile_offsets.clear();
+	uint64_t tile_offset = data_offset;
+	for (auto count : byte_counts) {
+		if (bigtiff)
+			appendValue<uint64_t>(tile_offsets, tile_offset);
+		else
+			appendValue<uint32_t>(tile_offsets, (uint32_t) tile_offset);
+		tile_offset += count;
+	}
+
+	std::string header("II");
+	if (bigtiff) {
+		appendValue<uint16_t>(header, 43);
+		appendValue<uint16_t>(header, 8);
+		appendValue<uint16_t>(header, 0);
+		appendValue<uint64_t>(header, ifd_offset);
+		appendValue<uint64_t>(header, entries.size());
+	}
+	else {
+		appendValue<uint16_t>(header, 42);
+		appendValue<uint32_t>(header, (uint32_t) ifd_offset);
+		appendValue<uint16_t>(header, (uint16_t) entries.size());
+	}
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		const Entry &entry = entries[i];
+		appendValue<uint16_t>(header, entry.tag);
+		appendValue<uint16_t>(header, entry.type);
+		if (bigtiff)
+			appendValue<uint64_t>(header, entry.count);
+		else
+			appendValue<uint32_t>(header, (uint32_t) entry.count);
+
+		if (entry.data.size() <= inline_size) {
+			// values that fit are stored left-aligned in the entry
+			header.append(entry.data);
+			header.append(inline_size - entry.data.size(), '\0');
+		}
+		else if (bigtiff)
+			appendValue<uint64_t>(header, value_offsets[i]);
+		else
+			appendValue<uint32_t>(header, (uint32_t) value_offsets[i]);
+	}
+	// there is no next IFD
+	header.append(offset_size, '\0');
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (value_offsets[i] == 0)
+			continue;
+		header.append(value_offsets[i] - header.size(), '\0');
+		header.append(entries[i].data);
+	}
+	header.append(data_offset - header.size(), '\0');
+
+	return header;
+}
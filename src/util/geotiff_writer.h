@@ -0,0 +1,94 @@
+#ifndef UTIL_GEOTIFF_WRITER_H
+#define UTIL_GEOTIFF_WRITER_H
+
+#include "datatypes/raster.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <functional>
+#include <cstdint>
+
+/**
+ * Writes a single band, tiled GeoTIFF into a stream while its tiles are still being computed.
+ *
+ * Without compression all tiles have the same size, so the header with the offsets of all tiles is written
+ * with the first tile and every tile is written as soon as it is added. With deflate compression the offsets
+ * are only known once all tiles are compressed. The stream cannot seek back to fill them in, so the compressed
+ * tiles are kept in memory and written by finish(). They are compressed by background threads while the next
+ * tiles are added.
+ *
+ * Tiles are added row by row. The tiles at the right and bottom border may be smaller than the tile size,
+ * all others must have it. The georeference is written as a model transformation, like the geotransform of
+ * GenericRaster::toGDAL(), with the crs as EPSG code.
+ */
+class GeoTiffWriter {
+	public:
+		enum class Compression {
+			NONE,
+			DEFLATE
+		};
+
+		/**
+		 * @param tile_width, tile_height the size of the tiles in the file, multiples of 16
+		 * @param threads the number of tiles compressed at the same time, 0 for one per core
+		 * @param on_start is called with the size of the file in bytes right before the first byte is written
+		 */
+		GeoTiffWriter(std::ostream &stream, const SpatialReference &sref, uint32_t width, uint32_t height, const DataDescription &dd,
+				uint32_t tile_width, uint32_t tile_height, Compression compression, uint32_t threads = 0,
+				const std::function<void(uint64_t file_size)> &on_start = nullptr);
+		~GeoTiffWriter();
+
+		GeoTiffWriter(const GeoTiffWriter &) = delete;
+		GeoTiffWriter &operator=(const GeoTiffWriter &) = delete;
+
+		/**
+		 * Adds the next tile. Its data type must be the one of the file.
+		 */
+		void addTile(GenericRaster &tile);
+
+		/**
+		 * Writes the remaining data after all tiles were added
+		 */
+		void finish();
+
+		size_t getTileCount() const { return (size_t) tiles_x * tiles_y; }
+
+		/**
+		 * @return whether rasters in this crs can be written, i.e. it is a geographic or projected crs with an EPSG code
+		 */
+		static bool supportsCrs(const CrsId &crsId);
+
+	private:
+		struct Entry {
+			uint16_t tag;
+			uint16_t type;
+			uint64_t count;
+			std::string data;
+		};
+
+		std::string padTile(GenericRaster &tile) const;
+		std::string encodeHeader(const std::vector<uint64_t> &byte_counts, bool bigtiff) const;
+		void start(const std::vector<uint64_t> &byte_counts);
+
+		std::ostream &stream;
+		SpatialReference sref;
+		uint32_t width;
+		uint32_t height;
+		DataDescription dd;
+		uint32_t tile_width;
+		uint32_t tile_height;
+		uint32_t tiles_x;
+		uint32_t tiles_y;
+		Compression compression;
+		uint32_t threads;
+		std::function<void(uint64_t)> on_start;
+
+		size_t tiles_added;
+		std::deque<std::future<std::string>> compressing;
+		std::vector<std::string> compressed;
+};
+
+#endif
@@ -0,0 +1,60 @@
+
+#include "util/parallel_for.h"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+
+
+void parallelFor(size_t count, size_t chunk_size, uint32_t num_threads, const std::function<void(size_t begin, size_t end)> &fn) {
+	if (count == 0)
+		return;
+	chunk_size = std::max(chunk_size, (size_t) 1);
+	if (num_threads == 0)
+		num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	size_t chunks = (count + chunk_size - 1) / chunk_size;
+	num_threads = (uint32_t) std::min((size_t) num_threads, chunks);
+
+	if (num_threads <= 1) {
+		fn(0, count);
+		return;
+	}
+
+	std::atomic<size_t> next_chunk(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		while (true) {
+			size_t chunk = next_chunk++;
+			if (chunk >= chunks)
+				return;
+			try {
+				size_t begin = chunk * chunk_size;
+				fn(begin, std::min(begin + chunk_size, count));
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+				// skip the remaining chunks
+				next_chunk = chunks;
+				return;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads - 1);
+	for (uint32_t i = 1; i < num_threads; i++)
+		threads.emplace_back(work);
+	work();
+	for (auto &thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
@@ -0,0 +1,17 @@
+#ifndef UTIL_PARALLEL_FOR_H
+#define UTIL_PARALLEL_FOR_H
+
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Calls fn(begin, end) for consecutive chunks of [0, count) on up to num_threads threads, including the
+ * calling one. A num_threads of 0 uses one thread per core.
+ *
+ * Chunks are handed out on demand, so items with uneven costs are balanced across the threads. The first
+ * exception thrown by fn is rethrown once all threads have finished.
+ */
+void parallelFor(size_t count, size_t chunk_size, uint32_t num_threads, const std::function<void(size_t begin, size_t end)> &fn);
+
+#endif
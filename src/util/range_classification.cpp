@@ -0,0 +1,103 @@
+
+#include "util/range_classification.h"
+#include "util/parallel_for.h"
+#include "util/exceptions.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/typejuggling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+
+RangeClassification::RangeClassification(const std::vector<float> &lower_borders, const std::vector<float> &upper_borders,
+		const std::vector<int> &classes, int unclassified_class, int no_data_class) : no_data_class(no_data_class) {
+	const size_t ranges = classes.size();
+	if (lower_borders.size() != ranges || upper_borders.size() != ranges)
+		throw ArgumentException("RangeClassification: every class needs a lower and an upper border");
+
+	for (size_t i = 0; i < ranges; i++) {
+		if (std::isnan(lower_borders[i]) || std::isnan(upper_borders[i]))
+			throw ArgumentException("RangeClassification: borders must not be NaN");
+		breakpoints.push_back(lower_borders[i]);
+		breakpoints.push_back(upper_borders[i]);
+	}
+	std::sort(breakpoints.begin(), breakpoints.end());
+	breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+
+	// every range either covers a segment completely or not at all, so testing its borders is enough
+	const size_t count = breakpoints.size();
+	segment_classes.assign(2 * count + 2, unclassified_class);
+	for (size_t i = 0; i < ranges; i++) {
+		double lower = lower_borders[i], upper = upper_borders[i];
+		for (size_t b = 0; b < count; b++) {
+			if (lower <= breakpoints[b] && breakpoints[b] <= upper)
+				segment_classes[2 * b + 1] = classes[i];
+			if (b > 0 && lower <= breakpoints[b - 1] && breakpoints[b] <= upper)
+				segment_classes[2 * b] = classes[i];
+		}
+	}
+
+	breakpoints.push_back(std::numeric_limits<double>::infinity());
+}
+
+
+template<typename T>
+struct range_classification {
+	// types small enough to classify every possible value upfront
+	static const bool has_lookup_table = sizeof(T) <= 2 && RasterTypeInfo<T>::isinteger;
+	static const size_t table_size = (size_t) 1 << (has_lookup_table ? 8 * sizeof(T) : 0);
+
+	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster_src, const RangeClassification *classification, const DataDescription *out_dd, uint32_t num_threads) {
+		raster_src->setRepresentation(GenericRaster::Representation::CPU);
+		auto raster_dest_guard = GenericRaster::create(*out_dd, *raster_src, GenericRaster::Representation::CPU);
+		auto raster_dest = (Raster2D<int32_t> *) raster_dest_guard.get();
+
+		if (has_lookup_table && raster_src->getPixelCount() > table_size)
+			classifyByTable(raster_src, raster_dest, classification, num_threads);
+		else
+			classifyBySearch(raster_src, raster_dest, classification, num_threads);
+
+		return raster_dest_guard;
+	}
+
+	static void classifyBySearch(Raster2D<T> *raster_src, Raster2D<int32_t> *raster_dest, const RangeClassification *classification, uint32_t num_threads) {
+		const DataDescription &dd = raster_src->dd;
+		const int no_data_class = classification->getNoDataClass();
+		const size_t width = raster_src->width;
+		parallelFor(raster_src->height, 16, num_threads, [&](size_t begin, size_t end) {
+			const T *in = &raster_src->data[begin * width];
+			int32_t *out = &raster_dest->data[begin * width];
+			const size_t size = (end - begin) * width;
+			for (size_t i = 0; i < size; i++)
+				out[i] = dd.is_no_data(in[i]) ? no_data_class : classification->classify(in[i]);
+		});
+	}
+
+	static void classifyByTable(Raster2D<T> *raster_src, Raster2D<int32_t> *raster_dest, const RangeClassification *classification, uint32_t num_threads) {
+		// indices are the values minus the smallest value of the type
+		using table_type = typename std::conditional<has_lookup_table, T, uint8_t>::type;
+		const int64_t offset = std::numeric_limits<table_type>::lowest();
+		std::vector<int32_t> table(table_size);
+		for (size_t i = 0; i < table.size(); i++) {
+			T value = (T) (offset + (int64_t) i);
+			table[i] = raster_src->dd.is_no_data(value) ? classification->getNoDataClass() : classification->classify(value);
+		}
+
+		const size_t width = raster_src->width;
+		parallelFor(raster_src->height, 16, num_threads, [&](size_t begin, size_t end) {
+			const T *in = &raster_src->data[begin * width];
+			int32_t *out = &raster_dest->data[begin * width];
+			const size_t size = (end - begin) * width;
+			for (size_t i = 0; i < size; i++)
+				out[i] = table[(int64_t) in[i] - offset];
+		});
+	}
+};
+
+std::unique_ptr<GenericRaster> RangeClassification::apply(GenericRaster &raster, const DataDescription &out_dd, uint32_t num_threads) const {
+	if (out_dd.datatype != GDT_Int32)
+		throw ArgumentException("RangeClassification: the output must be GDT_Int32");
+	return callUnaryOperatorFunc<range_classification>(&raster, this, &out_dd, num_threads);
+}
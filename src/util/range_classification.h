@@ -0,0 +1,58 @@
+#ifndef UTIL_RANGE_CLASSIFICATION_H
+#define UTIL_RANGE_CLASSIFICATION_H
+
+#include "datatypes/raster.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+/*
+ * Maps raster values to classes given by a list of ranges [lower, upper]. Like the OpenCL kernel, both
+ * borders are inclusive and if ranges overlap, the one listed last wins. Values in no range get the
+ * unclassified class, no data values get the no data class.
+ *
+ * All borders are sorted into one breakpoint table on construction. Between two neighbouring breakpoints
+ * the class cannot change, so a value is classified by a binary search in the table instead of testing every
+ * range. The search takes the same number of steps for every value and compiles to conditional moves.
+ * For 8 and 16 bit rasters with more pixels than possible values, every value is classified once into a
+ * lookup table instead.
+ *
+ * The rows are split across threads.
+ */
+class RangeClassification {
+	public:
+		RangeClassification(const std::vector<float> &lower_borders, const std::vector<float> &upper_borders,
+				const std::vector<int> &classes, int unclassified_class, int no_data_class);
+
+		/*
+		 * @return the class of a value that is not no data
+		 */
+		int classify(double value) const {
+			// number of breakpoints smaller than value; the sentinel at the end is never searched
+			size_t position = 0;
+			for (size_t n = breakpoints.size() - 1; n > 1; n -= n / 2)
+				position = breakpoints[position + n / 2] < value ? position + n / 2 : position;
+			position += breakpoints[position] < value;
+			return segment_classes[2 * position + (breakpoints[position] == value)];
+		}
+
+		int getNoDataClass() const { return no_data_class; }
+
+		/*
+		 * Classifies all pixels into a new GDT_Int32 raster described by out_dd
+		 */
+		std::unique_ptr<GenericRaster> apply(GenericRaster &raster, const DataDescription &out_dd, uint32_t num_threads = 0) const;
+	private:
+		// the sorted, distinct borders, followed by +infinity as sentinel
+		std::vector<double> breakpoints;
+		/*
+		 * segment 2i is the open interval below breakpoint i (and above breakpoint i-1), segment 2i+1 is
+		 * breakpoint i itself. The last two segments belong to the sentinel and are unclassified.
+		 */
+		std::vector<int> segment_classes;
+		int no_data_class;
+};
+
+#endif
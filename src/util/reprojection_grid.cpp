@@ -0,0 +1,169 @@
+
+#include "util/reprojection_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+ReprojectionGrid::ReprojectionGrid(uint32_t width, uint32_t height, const BatchTransform &transform, double max_error, uint32_t initial_step)
+	: width(width), height(height), step(std::max(initial_step, (uint32_t) 1)), cells_x(0), cells_y(0) {
+	if (width == 0 || height == 0)
+		return;
+
+	while (true) {
+		buildControlGrid(transform);
+		if (step == 1 || checkCellCenters(transform) <= max_error)
+			break;
+		step = std::max(step / 2, (uint32_t) 1);
+	}
+
+	transformFailedCells(transform);
+}
+
+static void controlPositions(uint32_t size, uint32_t step, std::vector<uint32_t> &positions) {
+	positions.clear();
+	for (uint32_t p = 0; p < size; p += step)
+		positions.push_back(p);
+	if (positions.back() != size - 1)
+		positions.push_back(size - 1);
+}
+
+void ReprojectionGrid::buildControlGrid(const BatchTransform &transform) {
+	controlPositions(width, step, xs);
+	controlPositions(height, step, ys);
+	cells_x = std::max((uint32_t) xs.size() - 1, (uint32_t) 1);
+	cells_y = std::max((uint32_t) ys.size() - 1, (uint32_t) 1);
+	exact_cells.clear();
+
+	size_t count = xs.size() * ys.size();
+	control_x.resize(count);
+	control_y.resize(count);
+	control_valid.resize(count);
+
+	// one batch per grid row
+	std::vector<int> success(xs.size());
+	for (uint32_t cy = 0; cy < ys.size(); cy++) {
+		double *row_x = &control_x[controlIndex(0, cy)];
+		double *row_y = &control_y[controlIndex(0, cy)];
+		for (uint32_t cx = 0; cx < xs.size(); cx++) {
+			row_x[cx] = xs[cx];
+			row_y[cx] = ys[cy];
+		}
+		transform(xs.size(), row_x, row_y, success.data());
+		for (uint32_t cx = 0; cx < xs.size(); cx++)
+			control_valid[controlIndex(cx, cy)] = success[cx] != 0;
+	}
+}
+
+bool ReprojectionGrid::cornersValid(uint32_t cx, uint32_t cy) const {
+	uint32_t cx2 = std::min(cx + 1, (uint32_t) xs.size() - 1);
+	uint32_t cy2 = std::min(cy + 1, (uint32_t) ys.size() - 1);
+	return control_valid[controlIndex(cx, cy)] && control_valid[controlIndex(cx2, cy)]
+		&& control_valid[controlIndex(cx, cy2)] && control_valid[controlIndex(cx2, cy2)];
+}
+
+/*
+ * Transforms the center of each cell and compares it to the interpolated value.
+ * Cells with an invalid center are marked for exact transformation.
+ * Returns the largest error.
+ */
+double ReprojectionGrid::checkCellCenters(const BatchTransform &transform) {
+	double max_error = 0;
+
+	std::vector<double> center_x(cells_x), center_y(cells_x);
+	std::vector<int> success(cells_x);
+	for (uint32_t cy = 0; cy < cells_y; cy++) {
+		uint32_t cy2 = std::min(cy + 1, (uint32_t) ys.size() - 1);
+		for (uint32_t cx = 0; cx < cells_x; cx++) {
+			uint32_t cx2 = std::min(cx + 1, (uint32_t) xs.size() - 1);
+			center_x[cx] = (xs[cx] + xs[cx2]) / 2.0;
+			center_y[cx] = (ys[cy] + ys[cy2]) / 2.0;
+		}
+		transform(cells_x, center_x.data(), center_y.data(), success.data());
+
+		for (uint32_t cx = 0; cx < cells_x; cx++) {
+			if (!cornersValid(cx, cy))
+				continue;
+			if (!success[cx]) {
+				exact_cells[cellIndex(cx, cy)];
+				continue;
+			}
+			uint32_t cx2 = std::min(cx + 1, (uint32_t) xs.size() - 1);
+			double interpolated_x = (control_x[controlIndex(cx, cy)] + control_x[controlIndex(cx2, cy)]
+				+ control_x[controlIndex(cx, cy2)] + control_x[controlIndex(cx2, cy2)]) / 4;
+			double interpolated_y = (control_y[controlIndex(cx, cy)] + control_y[controlIndex(cx2, cy)]
+				+ control_y[controlIndex(cx, cy2)] + control_y[controlIndex(cx2, cy2)]) / 4;
+			max_error = std::max(max_error, std::hypot(interpolated_x - center_x[cx], interpolated_y - center_y[cx]));
+		}
+	}
+	return max_error;
+}
+
+void ReprojectionGrid::transformFailedCells(const BatchTransform &transform) {
+	for (uint32_t cy = 0; cy < cells_y; cy++) {
+		for (uint32_t cx = 0; cx < cells_x; cx++) {
+			if (cornersValid(cx, cy) && exact_cells.count(cellIndex(cx, cy)) == 0)
+				continue;
+
+			uint32_t x0 = xs[cx], x1 = xs[std::min(cx + 1, (uint32_t) xs.size() - 1)];
+			uint32_t y0 = ys[cy], y1 = ys[std::min(cy + 1, (uint32_t) ys.size() - 1)];
+			size_t cell_width = x1 - x0 + 1;
+			size_t count = cell_width * (y1 - y0 + 1);
+
+			auto &cell = exact_cells[cellIndex(cx, cy)];
+			cell.x.resize(count);
+			cell.y.resize(count);
+			cell.valid.resize(count);
+			std::vector<int> success(cell_width);
+			for (uint32_t y = y0; y <= y1; y++) {
+				size_t offset = (y - y0) * cell_width;
+				for (uint32_t x = x0; x <= x1; x++) {
+					cell.x[offset + x - x0] = x;
+					cell.y[offset + x - x0] = y;
+				}
+				transform(cell_width, &cell.x[offset], &cell.y[offset], success.data());
+				for (size_t i = 0; i < cell_width; i++)
+					cell.valid[offset + i] = success[i] != 0;
+			}
+		}
+	}
+}
+
+void ReprojectionGrid::getRow(uint32_t y, double *src_x, double *src_y, bool *valid) const {
+	uint32_t cy = std::min(y / step, cells_y - 1);
+	uint32_t cy2 = std::min(cy + 1, (uint32_t) ys.size() - 1);
+	double ty = ys[cy2] > ys[cy] ? (double) (y - ys[cy]) / (ys[cy2] - ys[cy]) : 0.0;
+
+	for (uint32_t cx = 0; cx < cells_x; cx++) {
+		uint32_t cx2 = std::min(cx + 1, (uint32_t) xs.size() - 1);
+		uint32_t x0 = xs[cx], x1 = xs[cx2];
+		// adjacent cells share their border, which is computed by the right one
+		uint32_t x_end = (cx == cells_x - 1) ? width : x1;
+
+		auto exact = exact_cells.find(cellIndex(cx, cy));
+		if (exact != exact_cells.end()) {
+			auto &cell = exact->second;
+			size_t offset = (size_t) (y - ys[cy]) * (x1 - x0 + 1);
+			for (uint32_t x = x0; x < x_end; x++) {
+				src_x[x] = cell.x[offset + x - x0];
+				src_y[x] = cell.y[offset + x - x0];
+				valid[x] = cell.valid[offset + x - x0];
+			}
+			continue;
+		}
+
+		// interpolate the left and right edge of the cell, then along the row
+		auto lerp = [ty](double a, double b) { return a + (b - a) * ty; };
+		double left_x = lerp(control_x[controlIndex(cx, cy)], control_x[controlIndex(cx, cy2)]);
+		double left_y = lerp(control_y[controlIndex(cx, cy)], control_y[controlIndex(cx, cy2)]);
+		double right_x = lerp(control_x[controlIndex(cx2, cy)], control_x[controlIndex(cx2, cy2)]);
+		double right_y = lerp(control_y[controlIndex(cx2, cy)], control_y[controlIndex(cx2, cy2)]);
+		double scale = x1 > x0 ? 1.0 / (x1 - x0) : 0.0;
+		for (uint32_t x = x0; x < x_end; x++) {
+			double tx = (x - x0) * scale;
+			src_x[x] = left_x + (right_x - left_x) * tx;
+			src_y[x] = left_y + (right_y - left_y) * tx;
+			valid[x] = true;
+		}
+	}
+}
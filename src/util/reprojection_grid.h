@@ -0,0 +1,67 @@
+#ifndef UTIL_REPROJECTION_GRID_H
+#define UTIL_REPROJECTION_GRID_H
+
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+
+/*
+ * Maps the pixels of a destination raster to (fractional) pixel coordinates of a source raster
+ * without transforming every single pixel.
+ *
+ * Only a sparse grid of control points is transformed, one batch per grid row. The coordinates of
+ * all other pixels are interpolated bilinearly between the four surrounding control points. The
+ * grid is refined until the interpolation error at the cell centers is below max_error source
+ * pixels. Cells touching a point that cannot be transformed are transformed exactly instead.
+ *
+ * After construction, the grid is read-only and getRow() may be called from multiple threads.
+ */
+class ReprojectionGrid {
+	public:
+		/*
+		 * Transforms count destination pixel coordinates to source pixel coordinates in place.
+		 * success[i] must be set to 0 if the i-th coordinate could not be transformed.
+		 */
+		typedef std::function<void(size_t count, double *x, double *y, int *success)> BatchTransform;
+
+		ReprojectionGrid(uint32_t width, uint32_t height, const BatchTransform &transform, double max_error = 0.125, uint32_t initial_step = 32);
+
+		/*
+		 * Computes the source coordinates of all width pixels of row y.
+		 * valid[x] is set to false if the pixel could not be transformed.
+		 */
+		void getRow(uint32_t y, double *src_x, double *src_y, bool *valid) const;
+
+		/*
+		 * The distance between control points in pixels, 1 if every pixel was transformed.
+		 */
+		uint32_t getStep() const { return step; }
+	private:
+		struct ExactCell {
+			std::vector<double> x, y;
+			std::vector<char> valid;
+		};
+
+		void buildControlGrid(const BatchTransform &transform);
+		double checkCellCenters(const BatchTransform &transform);
+		void transformFailedCells(const BatchTransform &transform);
+
+		size_t controlIndex(uint32_t cx, uint32_t cy) const { return (size_t) cy * xs.size() + cx; }
+		size_t cellIndex(uint32_t cx, uint32_t cy) const { return (size_t) cy * cells_x + cx; }
+		bool cornersValid(uint32_t cx, uint32_t cy) const;
+
+		uint32_t width, height;
+		uint32_t step;
+		// pixel positions of the control points in each dimension, including the last pixel
+		std::vector<uint32_t> xs, ys;
+		uint32_t cells_x, cells_y;
+		std::vector<double> control_x, control_y;
+		std::vector<char> control_valid;
+		// cells that are not interpolated, by cell index
+		std::map<size_t, ExactCell> exact_cells;
+};
+
+#endif
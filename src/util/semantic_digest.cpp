@@ -0,0 +1,79 @@
+
+#include "util/semantic_digest.h"
+
+#include <cstring>
+#include <cstdio>
+
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+// MurmurHash3_x64_128 by Austin Appleby, who placed it in the public domain
+SemanticDigest::SemanticDigest(const std::string &str) {
+	const uint8_t *data = (const uint8_t *) str.data();
+	const size_t len = str.size();
+	const size_t nblocks = len / 16;
+
+	uint64_t h1 = 0, h2 = 0;
+	const uint64_t c1 = 0x87c37b91114253d5ULL;
+	const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+	for (size_t i = 0; i < nblocks; i++) {
+		uint64_t k1, k2;
+		memcpy(&k1, data + i * 16, 8);
+		memcpy(&k2, data + i * 16 + 8, 8);
+
+		k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+		k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	const uint8_t *tail = data + nblocks * 16;
+	uint64_t k1 = 0, k2 = 0;
+	switch (len & 15) {
+		case 15: k2 ^= ((uint64_t) tail[14]) << 48; // fall through
+		case 14: k2 ^= ((uint64_t) tail[13]) << 40; // fall through
+		case 13: k2 ^= ((uint64_t) tail[12]) << 32; // fall through
+		case 12: k2 ^= ((uint64_t) tail[11]) << 24; // fall through
+		case 11: k2 ^= ((uint64_t) tail[10]) << 16; // fall through
+		case 10: k2 ^= ((uint64_t) tail[ 9]) << 8; // fall through
+		case  9: k2 ^= ((uint64_t) tail[ 8]);
+			k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+			// fall through
+		case  8: k1 ^= ((uint64_t) tail[ 7]) << 56; // fall through
+		case  7: k1 ^= ((uint64_t) tail[ 6]) << 48; // fall through
+		case  6: k1 ^= ((uint64_t) tail[ 5]) << 40; // fall through
+		case  5: k1 ^= ((uint64_t) tail[ 4]) << 32; // fall through
+		case  4: k1 ^= ((uint64_t) tail[ 3]) << 24; // fall through
+		case  3: k1 ^= ((uint64_t) tail[ 2]) << 16; // fall through
+		case  2: k1 ^= ((uint64_t) tail[ 1]) << 8; // fall through
+		case  1: k1 ^= ((uint64_t) tail[ 0]);
+			k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+	}
+
+	h1 ^= len; h2 ^= len;
+	h1 += h2; h2 += h1;
+	h1 = fmix64(h1); h2 = fmix64(h2);
+	h1 += h2; h2 += h1;
+
+	high = h1;
+	low = h2;
+}
+
+std::string SemanticDigest::asHex() const {
+	char buffer[33];
+	snprintf(buffer, sizeof(buffer), "%016llx%016llx", (unsigned long long) high, (unsigned long long) low);
+	return std::string(buffer);
+}
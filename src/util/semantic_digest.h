@@ -0,0 +1,40 @@
+#ifndef UTIL_SEMANTIC_DIGEST_H
+#define UTIL_SEMANTIC_DIGEST_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+/*
+ * A fixed-size 128 bit digest (MurmurHash3, x64 variant) of a semantic id or another canonical string.
+ *
+ * Semantic ids of deep workflows are several kilobytes long, so maps key their entries by the digest
+ * instead. Equal strings always have equal digests; users that need certainty keep the full string
+ * next to the entry and compare it on a hit.
+ */
+class SemanticDigest {
+	public:
+		SemanticDigest() : high(0), low(0) {}
+		explicit SemanticDigest(const std::string &str);
+
+		bool operator==(const SemanticDigest &other) const { return high == other.high && low == other.low; }
+		bool operator!=(const SemanticDigest &other) const { return !(*this == other); }
+		bool operator<(const SemanticDigest &other) const { return high < other.high || (high == other.high && low < other.low); }
+
+		// 32 hex characters
+		std::string asHex() const;
+
+		uint64_t high, low;
+};
+
+namespace std {
+	template<> struct hash<SemanticDigest> {
+		size_t operator()(const SemanticDigest &digest) const {
+			// the bits are already well mixed
+			return (size_t) (digest.low ^ digest.high);
+		}
+	};
+}
+
+#endif
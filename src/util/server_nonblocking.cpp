@@ -26,7 +26,7 @@
  * Connection
  */
 NonblockingServer::Connection::Connection(NonblockingServer &server, int fd, int id)
-	: fd(fd), stream(BinaryStream::fromAcceptedSocket(fd,true)), state(State::INITIALIZING), is_closed(false), server(server), id(id) {
+	: fd(fd), stream(BinaryStream::fromAcceptedSocket(fd,true)), readable(true), writable(true), state(State::INITIALIZING), is_closed(false), server(server), id(id) {
 	stream.makeNonBlocking();
 	// the client is supposed to send the first data, so we'll start reading.
 	waitForData();
@@ -60,7 +60,11 @@ void NonblockingServer::Connection::close() {
 		// we must not remove them while another thread may be using the connection.
 		readbuffer.reset(nullptr);
 		writebuffer.reset(nullptr);
+		server.reactor.remove(fd, id);
 		stream.close();
+		// make sure the main loop notices and reaps the connection
+		if (server.running)
+			server.activate(id);
 	}
 }
 
@@ -73,7 +77,7 @@ void NonblockingServer::Connection::startWritingData(std::unique_ptr<BinaryWrite
 	auto &server = this->server;
 	state = State::WRITING_DATA;
 	if (old_state != State::PROCESSING_DATA)
-		server.wake();
+		server.activate(id);
 }
 
 void NonblockingServer::Connection::enqueueForAsyncProcessing() {
@@ -99,6 +103,9 @@ void NonblockingServer::Connection::forkAndProcess(int timeout_seconds) {
 	if (!server.running || !server.allow_forking)
 		throw MustNotHappenException("Connection::forkAndProcess(): server is not running or not configured for forking");
 
+	// The epoll set is shared with the child, so we unregister the socket while we still own it.
+	server.reactor.remove(fd, id);
+
 	// Do the actual forking
 	pid_t pid = fork();
 	if (pid < 0)
@@ -121,12 +128,11 @@ void NonblockingServer::Connection::forkAndProcess(int timeout_seconds) {
 			// Neither the stream nor the buffers may remain accessible.
 			state = State::PROCESSING_DATA_FORKED;
 
-			// We "steal" the stream from the connection before closing it. The child process can access the stream directly.
+			// We "steal" the stream from the connection. The child process can access the stream directly.
 			BinaryStream new_stream = std::move(stream);
 			new_stream.makeBlocking();
-			close();
 
-			// now that we have the only stream we're interested in, let the server close all the connections.
+			// now that we have the only stream we're interested in, let the server close all the connections, including this one.
 			server.cleanupAfterFork();
 
 			Log::info("New child process starting");
@@ -257,8 +263,11 @@ static int getListeningSocket(const std::string &socket_path, int umode) {
 /*
  * Nonblocking Server
  */
+// tags of the listen sockets, the lower bits contain the fd. Connections are tagged with their (positive) id.
+static const uint64_t LISTEN_TAG = (uint64_t) 1 << 63;
+
 NonblockingServer::NonblockingServer()
-	: num_workers(0), allow_forking(false), next_connection_id(1), running(false), wakeup_pipe(BinaryStream::makePipe()) {
+	: num_workers(0), allow_forking(false), next_connection_id(1), running(false) {
 }
 
 NonblockingServer::~NonblockingServer() {
@@ -268,7 +277,10 @@ NonblockingServer::~NonblockingServer() {
 
 void NonblockingServer::readNB(Connection &c) {
 	try {
-		auto is_eof = c.stream.readNB(*(c.readbuffer), true);
+		bool would_block;
+		auto is_eof = c.stream.readNB(*(c.readbuffer), true, &would_block);
+		if (would_block)
+			c.readable = false;
 		if (is_eof) {
 			c.close();
 			return;
@@ -294,7 +306,10 @@ void NonblockingServer::readNB(Connection &c) {
 
 void NonblockingServer::writeNB(Connection &c) {
 	try {
-		c.stream.writeNB(*(c.writebuffer));
+		bool would_block;
+		c.stream.writeNB(*(c.writebuffer), &would_block);
+		if (would_block)
+			c.writable = false;
 		if (c.writebuffer->isFinished()) {
 			Log::debug("%d: response sent", c.id);
 			c.waitForData();
@@ -313,6 +328,8 @@ void NonblockingServer::writeNB(Connection &c) {
 void NonblockingServer::enqueueTask(Connection *connection) {
 	std::unique_lock<std::mutex> lock(job_queue_mutex);
 	try {
+		// the worker thread will take over the socket, so the main loop must not see its events any more
+		reactor.remove(connection->fd, connection->id);
 		job_queue.push(connection);
 	}
 	catch (...) {
@@ -339,6 +356,7 @@ NonblockingServer::Connection *NonblockingServer::popTask() {
 			// it's possible that the connection had a problem somewhere..
 			// We don't want to spend work on it, but we need to pass ownership back to the main thread so it can be reaped.
 			connection->state = Connection::State::IDLE;
+			activate(connection->id);
 			continue;
 		}
 		if (connection->state != Connection::State::PROCESSING_DATA_ASYNC)
@@ -352,8 +370,10 @@ NonblockingServer::Connection *NonblockingServer::popTask() {
 
 NonblockingServer::Connection *NonblockingServer::getIdleConnectionById(int id) {
 	std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
-	for (auto &c : connections) {
-		if (c->id == id && c->state == Connection::State::IDLE && !c->is_closed)
+	auto it = connections.find(id);
+	if (it != connections.end()) {
+		auto &c = it->second;
+		if (c->state == Connection::State::IDLE && !c->is_closed)
 			return c.get();
 	}
 	throw ArgumentException("No idle connection with the given ID found");
@@ -409,11 +429,14 @@ void NonblockingServer::worker_thread() {
 			new_stream.makeBlocking();
 			connection->close();
 
+			int id = connection->id;
 			connection->processDataAsync(std::move(new_stream));
 			// as soon as this method call returns, the main thread may or may not have deleted the connection,
 			// which means that unfortunately we cannot safely check this.
 			//if (connection->state == Connection::State::PROCESSING_DATA_ASYNC)
 			//	throw MustNotHappenException("processData() did not change the state, expected PROCESS_ASYNC, IDLE or a reply");
+			// Have the main thread look at the connection again, so it can be reaped.
+			activate(id);
 		}
 	}
 	catch (const std::exception &e) {
@@ -481,23 +504,41 @@ void NonblockingServer::reapAllChildProcesses(bool force_timeout) {
 }
 
 
-class FDSet {
-	public:
-		FDSet() {
-			FD_ZERO(&fds);
-			maxfd = 0;
-		}
-		void set(int fd) {
-			FD_SET(fd, &fds);
-			maxfd = std::max(maxfd, fd);
-		}
-		bool isset(int fd) {
-			return FD_ISSET(fd, &fds);
-		}
-		int maxfd;
-		fd_set fds;
-};
+void NonblockingServer::processConnection(Connection &c) {
+	// The sockets are edge-triggered, so we need to continue until the socket would block.
+	// A state change (e.g. to PROCESSING_ASYNC or IDLE) also ends the loop.
+	while (!c.is_closed) {
+		Connection::State state = c.state;
+		if (state == Connection::State::WRITING_DATA && c.writable)
+			writeNB(c);
+		else if (state == Connection::State::READING_DATA && c.readable)
+			readNB(c);
+		else
+			break;
+	}
+}
+
+void NonblockingServer::acceptConnection(int listensocket) {
+	struct sockaddr_storage remote_addr; // large enough for AF_INET, AF_INET6 and AF_UNIX
+	socklen_t sin_size = sizeof(remote_addr);
+	int new_fd = accept(listensocket, (struct sockaddr *) &remote_addr, &sin_size);
+	addNewConnectionFromAcceptedFD(new_fd);
+}
 
+void NonblockingServer::removeClosedConnections() {
+	std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
+	auto it = connections.begin();
+	while (it != connections.end()) {
+		auto &c = it->second;
+		if (c->is_closed && c->state != Connection::State::PROCESSING_DATA_ASYNC) {
+			auto id = c->id;
+			it = connections.erase(it);
+			Log::info("%d: closing, %lu clients remain", id, connections.size());
+			continue; // avoid the ++it
+		}
+		++it;
+	}
+}
 
 void NonblockingServer::start() {
 	if (listensockets_inet.empty() && listensockets_unix.empty())
@@ -509,93 +550,57 @@ void NonblockingServer::start() {
 	for (int i=0;i<num_workers;i++)
 		workers.emplace_back(&NonblockingServer::worker_thread, this);
 
+	// The listen sockets are level-triggered, we accept one connection per event.
+	for (auto sock : listensockets_inet)
+		reactor.add(sock, EpollReactor::READ, LISTEN_TAG | (uint64_t) sock);
+	for (auto sock : listensockets_unix)
+		reactor.add(sock, EpollReactor::READ, LISTEN_TAG | (uint64_t) sock);
+
 	while (true) {
 		reapAllChildProcesses();
 
-		struct timeval tv{60,0};
-		FDSet readfds;
-		FDSet writefds;
-
-		std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
-		auto it = connections.begin();
-		while (it != connections.end()) {
-			auto &c = *it;
-			int fd = c->fd;
-			Connection::State state = c->state;
-			if (c->is_closed) {
-				if (state != Connection::State::PROCESSING_DATA_ASYNC) {
-					auto id = c->id;
-					it = connections.erase(it);
-					Log::info("%d: closing, %lu clients remain", id, connections.size());
-					continue; // avoid the ++it
-				}
-			}
-			else {
-				if (state == Connection::State::WRITING_DATA)
-					writefds.set(fd);
-				else if (state == Connection::State::READING_DATA)
-					readfds.set(fd);
-			}
-			++it;
-		}
-		connections_lock.unlock();
-
-		readfds.set(wakeup_pipe.getReadFD());
-
-		for (auto sock : listensockets_inet)
-			readfds.set(sock);
-
-		for (auto sock : listensockets_unix)
-			readfds.set(sock);
-
-		auto res = select(std::max(readfds.maxfd, writefds.maxfd)+1, &readfds.fds, &writefds.fds, nullptr, &tv);
-		if (res == 0) // timeout
-			continue;
-		if (res < 0) {
-			if (errno == EINTR) // interrupted by signal
-				continue;
-			throw NetworkException(concat("select() call failed: ", strerror(errno)));
-		}
+		// wake up at least once a minute to reap our children
+		auto &events = reactor.wait(60000);
 
 		if (!running) {
 			Log::info("Stopping Server");
 			break;
 		}
 
-		if (readfds.isset(wakeup_pipe.getReadFD())) {
-			// we have been woken, now we need to read any outstanding data or the pipe will remain readable
-			char buf[1024];
-			read(wakeup_pipe.getReadFD(), buf, 1024);
+		if (events.empty()) {
+			// timeout or signal. Connections closed without an event are cleaned up here.
+			removeClosedConnections();
+			continue;
 		}
 
-		connections_lock.lock();
-		for (auto &c : connections) {
-			Connection::State state = c->state;
-			if (state == Connection::State::WRITING_DATA && writefds.isset(c->fd)) {
-				writeNB(*c);
-			}
-			else if (state == Connection::State::READING_DATA && readfds.isset(c->fd)) {
-				readNB(*c);
+		std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
+		for (auto &event : events) {
+			if (event.tag & LISTEN_TAG) {
+				acceptConnection((int) (event.tag & ~LISTEN_TAG));
+				continue;
 			}
-		}
-		connections_lock.unlock();
 
-		for (int sock : listensockets_inet) {
-			if (readfds.isset(sock)) {
-				struct sockaddr_storage remote_addr; // for AF_INET
-				socklen_t sin_size = sizeof(remote_addr);
-				int new_fd = accept(sock, (struct sockaddr *) &remote_addr, &sin_size);
-				addNewConnectionFromAcceptedFD(new_fd);
-			}
-		}
-		for (int sock : listensockets_unix) {
-			if (readfds.isset(sock)) {
-				struct sockaddr_un remote_addr; // for AF_UNIX
-				socklen_t sin_size = sizeof(remote_addr);
-				int new_fd = accept(sock, (struct sockaddr *) &remote_addr, &sin_size);
-				addNewConnectionFromAcceptedFD(new_fd);
+			// The connection may have been removed by an earlier event
+			auto it = connections.find((int) event.tag);
+			if (it == connections.end())
+				continue;
+			auto &c = *(it->second);
+
+			// A hangup or an error is reported by the next read() or write()
+			if (event.events & (EpollReactor::READ | EpollReactor::HANGUP | EpollReactor::ERROR))
+				c.readable = true;
+			if (event.events & (EpollReactor::WRITE | EpollReactor::HANGUP | EpollReactor::ERROR))
+				c.writable = true;
+
+			processConnection(c);
+
+			if (c.is_closed && c.state != Connection::State::PROCESSING_DATA_ASYNC) {
+				auto id = c.id;
+				connections.erase(it);
+				Log::info("%d: closing, %lu clients remain", id, connections.size());
 			}
 		}
+		connections_lock.unlock();
 	}
 
 	stopAllWorkers();
@@ -616,7 +621,11 @@ void NonblockingServer::addNewConnectionFromAcceptedFD(int fd) {
 	}
 
 	std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
-	connections.push_back( createConnection(fd, next_connection_id++) );
+	auto id = next_connection_id++;
+	auto connection = createConnection(fd, id);
+	// Register for all events once. Edge-triggered, so we only hear about changes.
+	reactor.add(fd, EpollReactor::READ | EpollReactor::WRITE | EpollReactor::HANGUP | EpollReactor::EDGE_TRIGGERED, id);
+	connections[id] = std::move(connection);
 }
 
 
@@ -631,9 +640,11 @@ void NonblockingServer::stopAllWorkers() {
 }
 
 void NonblockingServer::wake() {
-	// if the loop is currently in a select() phase, this write will wake it up.
-	char c = 0;
-	write(wakeup_pipe.getWriteFD(), &c, 1);
+	reactor.wakeup();
+}
+
+void NonblockingServer::activate(int connection_id) {
+	reactor.activate(connection_id, 0);
 }
 
 void NonblockingServer::stop() {
@@ -648,9 +659,14 @@ void NonblockingServer::cleanupAfterFork() {
 
 	// Worker threads don't persist after fork(), so we don't need to clean up any.
 
+	// The epoll set is shared with the parent, closing our connections must not unregister them there.
+	reactor.closeAfterFork();
+
 	// It closes all fds that aren't required by the client any more.
+	// Connection::close() would lock the reactor's mutex, which another thread of the parent may have held during fork().
 	closeAllListenSockets();
 	for (auto &connection : connections) {
-		connection->close();
+		connection.second->is_closed = true;
+		connection.second->stream.close();
 	}
 }
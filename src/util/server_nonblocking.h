@@ -2,6 +2,7 @@
 #define UTIL_SERVER_NONBLOCKING_H
 
 #include "util/binarystream.h"
+#include "util/epoll_reactor.h"
 
 #include <vector>
 #include <queue>
@@ -18,6 +19,9 @@
 /*
  * A server based on non-blocking network IO.
  *
+ * All sockets are registered edge-triggered at an EpollReactor, so each iteration of the main
+ * loop only touches connections with pending events.
+ *
  * TODO: allow multiple listen sockets (ipv4, ipv6, af_unix, multiple interfaces, ...)
  */
 class NonblockingServer {
@@ -35,6 +39,9 @@ class NonblockingServer {
 
 				const int fd;
 				BinaryStream stream;
+				// readiness of the socket as reported by the reactor, only accessed by the main loop
+				bool readable;
+				bool writable;
 				std::unique_ptr<BinaryWriteBuffer> writebuffer;
 				std::unique_ptr<BinaryReadBuffer> readbuffer;
 
@@ -113,13 +120,21 @@ class NonblockingServer {
 		 */
 		Connection *getIdleConnectionById(int id);
 		/*
-		 * Wake the server up, interrupting a select() call. Used to notify the server about
-		 * changes in the connections or about stopping.
+		 * Wake the server up, interrupting a wait for events. Used to notify the server about stopping.
 		 */
 		void wake();
+		/*
+		 * Wake the server up and have it look at the given connection, e.g. because it has data to send.
+		 * This may be called from any thread.
+		 */
+		void activate(int connection_id);
 	private:
 		void readNB(Connection &connection);
 		void writeNB(Connection &connection);
+		// reads and writes until the connection has to wait for its socket or for processing
+		void processConnection(Connection &connection);
+		void acceptConnection(int listensocket);
+		void removeClosedConnections();
 
 		/*
 		 * A Server must overload this method. All it does is instantiate a new Connection
@@ -154,12 +169,12 @@ class NonblockingServer {
 		// Connections
 		std::recursive_mutex connections_mutex;
 		int next_connection_id;
-		std::vector<std::unique_ptr<Connection>> connections;
+		std::map<int, std::unique_ptr<Connection>> connections;
 		void addNewConnectionFromAcceptedFD(int fd);
 
 		// Status
 		std::atomic<bool> running;
-		BinaryStream wakeup_pipe;
+		EpollReactor reactor;
 };
 
 
@@ -0,0 +1,97 @@
+#include "util/shared_memory.h"
+#include "util/exceptions.h"
+#include "util/concat.h"
+
+#include <atomic>
+#include <utility>
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+SharedMemorySegment::SharedMemorySegment(const std::string &name, char *data, size_t size) : name(name), data(data), size(size) {
+}
+
+SharedMemorySegment::~SharedMemorySegment() {
+	if (data != nullptr)
+		munmap(data, size);
+}
+
+SharedMemorySegment::SharedMemorySegment(SharedMemorySegment &&other) : data(nullptr), size(0) {
+	*this = std::move(other);
+}
+
+SharedMemorySegment &SharedMemorySegment::operator=(SharedMemorySegment &&other) {
+	std::swap(name, other.name);
+	std::swap(data, other.data);
+	std::swap(size, other.size);
+	return *this;
+}
+
+SharedMemorySegment SharedMemorySegment::create(size_t size) {
+	static std::atomic<uint64_t> counter(0);
+	auto name = concat("/mapping_", getpid(), "_", counter++);
+
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		throw PlatformException(concat("SharedMemorySegment: shm_open(", name, ") failed: ", strerror(errno)));
+
+	// unlike ftruncate(), this fails right away if the memory is not available instead of crashing on the first write
+	int res = size > 0 ? posix_fallocate(fd, 0, size) : 0;
+	if (res != 0) {
+		::close(fd);
+		shm_unlink(name.c_str());
+		throw PlatformException(concat("SharedMemorySegment: cannot allocate ", size, " bytes: ", strerror(res)));
+	}
+
+	char *data = nullptr;
+	if (size > 0) {
+		auto mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			auto error = errno;
+			::close(fd);
+			shm_unlink(name.c_str());
+			throw PlatformException(concat("SharedMemorySegment: mmap() failed: ", strerror(error)));
+		}
+		data = (char *) mapping;
+	}
+	::close(fd);
+
+	return SharedMemorySegment(name, data, size);
+}
+
+SharedMemorySegment SharedMemorySegment::open(const std::string &name) {
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+		throw PlatformException(concat("SharedMemorySegment: shm_open(", name, ") failed: ", strerror(errno)));
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		auto error = errno;
+		::close(fd);
+		throw PlatformException(concat("SharedMemorySegment: fstat() failed: ", strerror(error)));
+	}
+	size_t size = info.st_size;
+
+	char *data = nullptr;
+	if (size > 0) {
+		auto mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			auto error = errno;
+			::close(fd);
+			throw PlatformException(concat("SharedMemorySegment: mmap() failed: ", strerror(error)));
+		}
+		data = (char *) mapping;
+	}
+	::close(fd);
+
+	return SharedMemorySegment(name, data, size);
+}
+
+void SharedMemorySegment::unlink(const std::string &name) {
+	shm_unlink(name.c_str());
+}
@@ -0,0 +1,50 @@
+#ifndef UTIL_SHARED_MEMORY_H
+#define UTIL_SHARED_MEMORY_H
+
+#include <string>
+#include <cstddef>
+
+
+/*
+ * A mapping of a named POSIX shared memory segment, used to hand large data to another process on the same host
+ * without sending it through a socket.
+ *
+ * The creator fills a new segment and passes its name to the consumer, which opens and maps it read-only.
+ * The name stays valid until either side unlinks it; the memory itself is released when the name is unlinked
+ * and the last mapping is gone. Both processes must run as the same user.
+ */
+class SharedMemorySegment {
+	public:
+		/*
+		 * Creates a new segment of the given size with a unique name and maps it for writing
+		 */
+		static SharedMemorySegment create(size_t size);
+		/*
+		 * Maps an existing segment for reading
+		 */
+		static SharedMemorySegment open(const std::string &name);
+		/*
+		 * Removes the name of a segment, errors are ignored
+		 */
+		static void unlink(const std::string &name);
+
+		~SharedMemorySegment();
+
+		// SharedMemorySegment is movable, but not copyable
+		SharedMemorySegment(const SharedMemorySegment &) = delete;
+		SharedMemorySegment &operator=(const SharedMemorySegment &) = delete;
+		SharedMemorySegment(SharedMemorySegment &&);
+		SharedMemorySegment &operator=(SharedMemorySegment &&);
+
+		const std::string &getName() const { return name; }
+		char *getData() { return data; }
+		size_t getSize() const { return size; }
+	private:
+		SharedMemorySegment(const std::string &name, char *data, size_t size);
+
+		std::string name;
+		char *data;
+		size_t size;
+};
+
+#endif
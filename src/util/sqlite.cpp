@@ -1,6 +1,7 @@
 
 #include "util/exceptions.h"
 #include "util/sqlite.h"
+#include "util/make_unique.h"
 
 #include <sqlite3.h>
 
@@ -8,33 +9,50 @@
 #include <string>
 
 
-SQLite::SQLite() : db(nullptr) {
+// statements kept per connection, beyond this they are finalized when dropped
+static const size_t MAX_IDLE_STATEMENTS = 256;
+// idle read connections kept for the next prepareRead(), beyond this they are closed when returned
+static const size_t MAX_IDLE_READ_CONNECTIONS = 8;
+
+
+SQLite::SQLite() {
 
 }
 
 SQLite::~SQLite() {
-	if (db) {
-		sqlite3_close(db);
-		db = nullptr;
-	}
+	// read connections first, they may still refer to the files of the main connection
+	idle_read_connections.clear();
+	connection.reset();
 }
 
 void SQLite::open(const char *filename, bool readonly) {
-	if (db)
+	if (connection)
 		throw SQLiteException("DB already open");
 
+	sqlite3 *db = nullptr;
 	int rc = sqlite3_open_v2(filename, &db, readonly ? (SQLITE_OPEN_READONLY) : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE), nullptr);
 
-	if (rc != SQLITE_OK)
-		throw SQLiteException(concat("Can't open database ", filename, ": ", sqlite3_errmsg(db)));
+	if (rc != SQLITE_OK) {
+		auto msg = concat("Can't open database ", filename, ": ", sqlite3_errmsg(db));
+		sqlite3_close(db);
+		throw SQLiteException(msg);
+	}
 
 	sqlite3_busy_timeout(db, 1000);
+	connection = make_unique<Connection>(db);
+
+	// in-memory and temporary databases have no file name and cannot be opened a second time
+	const char *db_filename = sqlite3_db_filename(db, "main");
+	this->filename = db_filename ? db_filename : "";
 }
 
 
 void SQLite::exec(const char *query) {
+	if (!connection)
+		throw SQLiteException("DB not open");
+
 	char *error = 0;
-	if (SQLITE_OK != sqlite3_exec(db, query, NULL, NULL, &error)) {
+	if (SQLITE_OK != sqlite3_exec(connection->db, query, NULL, NULL, &error)) {
 		auto msg = concat("Error on query ", query, ": ", error);
 		sqlite3_free(error);
 		throw SQLiteException(msg);
@@ -42,17 +60,101 @@ void SQLite::exec(const char *query) {
 }
 
 SQLite::SQLiteStatement SQLite::prepare(const char *query) {
-	return SQLiteStatement(db, query);
+	if (!connection)
+		throw SQLiteException("DB not open");
+
+	return SQLiteStatement(*connection, query);
+}
+
+SQLite::SQLiteStatement SQLite::prepareRead(const char *query) {
+	if (!connection)
+		throw SQLiteException("DB not open");
+	if (filename.empty())
+		return SQLiteStatement(*connection, query);
+
+	std::unique_ptr<Connection> read_connection;
+	{
+		std::lock_guard<std::mutex> guard(read_connections_mutex);
+		if (!idle_read_connections.empty()) {
+			read_connection = std::move(idle_read_connections.back());
+			idle_read_connections.pop_back();
+		}
+	}
+	if (!read_connection) {
+		// only the statement that checked it out uses this connection
+		sqlite3 *db = nullptr;
+		int rc = sqlite3_open_v2(filename.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+		if (rc != SQLITE_OK) {
+			auto msg = concat("Can't open read connection to database ", filename, ": ", sqlite3_errmsg(db));
+			sqlite3_close(db);
+			throw SQLiteException(msg);
+		}
+		sqlite3_busy_timeout(db, 1000);
+		read_connection = make_unique<Connection>(db);
+	}
+
+	try {
+		SQLiteStatement stmt(*read_connection, query, this);
+		read_connection.release();
+		return stmt;
+	}
+	catch (...) {
+		returnReadConnection(read_connection.release());
+		throw;
+	}
+}
+
+void SQLite::returnReadConnection(Connection *read_connection) {
+	std::unique_ptr<Connection> owned(read_connection);
+	std::lock_guard<std::mutex> guard(read_connections_mutex);
+	if (idle_read_connections.size() < MAX_IDLE_READ_CONNECTIONS)
+		idle_read_connections.push_back(std::move(owned));
+}
+
+size_t SQLite::getIdleReadConnectionCount() {
+	std::lock_guard<std::mutex> guard(read_connections_mutex);
+	return idle_read_connections.size();
 }
 
 int64_t SQLite::getLastInsertId() {
-	return sqlite3_last_insert_rowid(db);
+	if (!connection)
+		throw SQLiteException("DB not open");
+
+	return sqlite3_last_insert_rowid(connection->db);
 }
 
 
 
+SQLite::Connection::Connection(sqlite3 *db) : db(db), idle_count(0) {
+}
+
+SQLite::Connection::~Connection() {
+	for (auto &p : idle_statements) {
+		for (auto stmt : p.second)
+			sqlite3_finalize(stmt);
+	}
+	idle_statements.clear();
+	sqlite3_close(db);
+	db = nullptr;
+}
+
+sqlite3_stmt *SQLite::Connection::acquire(const char *query, const std::string *&key) {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto it = idle_statements.find(query);
+		if (it == idle_statements.end())
+			it = idle_statements.emplace(query, std::vector<sqlite3_stmt *>()).first;
+		// keys of an unordered_map stay where they are until they are erased, which never happens
+		key = &it->first;
+		if (!it->second.empty()) {
+			auto stmt = it->second.back();
+			it->second.pop_back();
+			idle_count--;
+			return stmt;
+		}
+	}
 
-SQLite::SQLiteStatement::SQLiteStatement(sqlite3 *db, const char *query) : stmt(nullptr) {
+	sqlite3_stmt *stmt = nullptr;
 	auto result = sqlite3_prepare_v2(
 		db,
 		query,
@@ -62,18 +164,49 @@ SQLite::SQLiteStatement::SQLiteStatement(sqlite3 *db, const char *query) : stmt(
 	);
 	if (result != SQLITE_OK)
 		throw SQLiteException(concat("Cannot prepare statement: ", result, ", error='", sqlite3_errmsg(db), "', query='", query, "'"));
+	return stmt;
+}
+
+void SQLite::Connection::release(const std::string *key, sqlite3_stmt *stmt) {
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		if (idle_count < MAX_IDLE_STATEMENTS) {
+			idle_statements.at(*key).push_back(stmt);
+			idle_count++;
+			return;
+		}
+	}
+	sqlite3_finalize(stmt);
+}
+
+
+
+
+SQLite::SQLiteStatement::SQLiteStatement(Connection &connection, const char *query, SQLite *read_pool) : stmt(nullptr), connection(&connection), key(nullptr), read_pool(nullptr) {
+	stmt = connection.acquire(query, key);
+	// set after acquire(), so a failed prepare leaves returning the connection to the caller
+	this->read_pool = read_pool;
 }
 
 SQLite::SQLiteStatement::~SQLiteStatement() {
 	finalize();
 }
 
-SQLite::SQLiteStatement::SQLiteStatement(SQLiteStatement &&other) : stmt(nullptr) {
+SQLite::SQLiteStatement::SQLiteStatement(SQLiteStatement &&other) : stmt(nullptr), connection(nullptr), key(nullptr), read_pool(nullptr) {
 	std::swap(stmt, other.stmt);
+	std::swap(connection, other.connection);
+	std::swap(key, other.key);
+	std::swap(read_pool, other.read_pool);
 }
 
 SQLite::SQLiteStatement &SQLite::SQLiteStatement::operator=(SQLiteStatement &&other) {
 	std::swap(stmt, other.stmt);
+	std::swap(connection, other.connection);
+	std::swap(key, other.key);
+	std::swap(read_pool, other.read_pool);
 	return *this;
 }
 
@@ -153,7 +286,12 @@ const char *SQLite::SQLiteStatement::getString(int column) {
 
 void SQLite::SQLiteStatement::finalize() {
 	if (stmt) {
-		sqlite3_finalize(stmt);
+		connection->release(key, stmt);
 		stmt = nullptr;
 	}
+	if (read_pool) {
+		read_pool->returnReadConnection(connection);
+		read_pool = nullptr;
+		connection = nullptr;
+	}
 }
@@ -6,15 +6,48 @@ class sqlite3;
 class sqlite3_stmt;
 #include <string>
 #include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 /**
  * SQLite wrapper
+ *
+ * Prepared statements are cached per connection. Dropping or finalizing a statement resets it and returns
+ * it to the cache, so the next prepare() of the same query skips parsing the SQL. Statements are never
+ * shared, concurrent users of a query get statements of their own.
+ *
+ * prepareRead() runs queries on read-only connections checked out of a pool, so concurrent readers don't
+ * serialize on the main connection. Combined with WAL journaling they don't block writers either.
+ * A statement keeps its connection until it is finalized or dropped; the pool keeps a few idle connections
+ * for the next readers and closes the rest.
  */
 class SQLite {
 	private:
+		class Connection {
+			public:
+				Connection(sqlite3 *db);
+				~Connection();
+				Connection(const Connection &other) = delete;
+				Connection &operator=(const Connection &other) = delete;
+
+				// returns a cached statement or prepares a new one, key is set to the cache key of the query
+				sqlite3_stmt *acquire(const char *query, const std::string *&key);
+				// resets the statement and keeps it for the next acquire() of the same query
+				void release(const std::string *key, sqlite3_stmt *stmt);
+
+				sqlite3 *db;
+			private:
+				std::mutex mutex;
+				std::unordered_map<std::string, std::vector<sqlite3_stmt *>> idle_statements;
+				size_t idle_count;
+		};
+
 		class SQLiteStatement {
 			public:
-				SQLiteStatement(sqlite3 *db, const char *query);
+				// read_pool is set if the connection was checked out by prepareRead() and must be returned to it
+				SQLiteStatement(Connection &connection, const char *query, SQLite *read_pool = nullptr);
 				~SQLiteStatement();
 				SQLiteStatement(const SQLiteStatement &other) = delete;
 				// this class is supposed to be movable, so SQLite::prepare can work
@@ -42,6 +75,9 @@ class SQLite {
 				void finalize();
 			private:
 				sqlite3_stmt *stmt;
+				Connection *connection;
+				const std::string *key;
+				SQLite *read_pool;
 		};
 	public:
 		SQLite();
@@ -49,11 +85,25 @@ class SQLite {
 		void open(const char *filename, bool readonly = false);
 		SQLiteStatement prepare(const char *query);
 		SQLiteStatement prepare(const std::string &query) { return prepare(query.c_str()); }
+		/**
+		 * Prepares a read-only query on an idle read connection, or on a new one if all are in use.
+		 * In-memory databases cannot be shared between connections, they use the main connection.
+		 */
+		SQLiteStatement prepareRead(const char *query);
+		SQLiteStatement prepareRead(const std::string &query) { return prepareRead(query.c_str()); }
 		void exec(const char *query);
 		int64_t getLastInsertId();
+		/**
+		 * The number of read connections that are open, but not used by a statement
+		 */
+		size_t getIdleReadConnectionCount();
 	private:
-		sqlite3 *db;
+		void returnReadConnection(Connection *read_connection);
 
+		std::unique_ptr<Connection> connection;
+		std::string filename;
+		std::mutex read_connections_mutex;
+		std::vector<std::unique_ptr<Connection>> idle_read_connections;
 };
 
 
@@ -0,0 +1,187 @@
+#include "util/zonal_statistics.h"
+#include "util/parallel_for.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/typejuggling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+ZonalStatistics::ZonalStatistics(std::vector<double> percentiles) : percentiles(std::move(percentiles)) {
+    for (double percentile : this->percentiles) {
+        if (!(percentile >= 0 && percentile <= 100))
+            throw ArgumentException("ZonalStatistics: percentiles must be between 0 and 100");
+    }
+}
+
+auto ZonalStatistics::feature_spans(const GridSpatioTemporalResult &grid, const PolygonCollection &polygons,
+                                    size_t feature) -> std::vector<Span> {
+    const auto &stref = grid.stref;
+    const auto &coordinates = polygons.coordinates;
+
+    // spans of each row, relative to the first row of the feature
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> row_spans;
+    int64_t first_row = -1;
+    std::vector<double> crossings;
+
+    for (size_t polygon = polygons.start_feature[feature]; polygon < polygons.start_feature[feature + 1]; ++polygon) {
+        size_t coordinates_begin = polygons.start_ring[polygons.start_polygon[polygon]];
+        size_t coordinates_end = polygons.start_ring[polygons.start_polygon[polygon + 1]];
+        if (coordinates_begin == coordinates_end)
+            continue;
+
+        // only the rows whose centers lie within the polygon's bounding box
+        double min_y = std::numeric_limits<double>::infinity();
+        double max_y = -std::numeric_limits<double>::infinity();
+        for (size_t i = coordinates_begin; i < coordinates_end; ++i) {
+            min_y = std::min(min_y, coordinates[i].y);
+            max_y = std::max(max_y, coordinates[i].y);
+        }
+        auto row_begin = static_cast<int64_t>(std::ceil((min_y - stref.y1) / grid.pixel_scale_y - 0.5));
+        auto row_end = static_cast<int64_t>(std::floor((max_y - stref.y1) / grid.pixel_scale_y - 0.5)) + 1;
+        row_begin = std::max(row_begin, (int64_t) 0);
+        row_end = std::min(row_end, (int64_t) grid.height);
+        if (row_begin >= row_end)
+            continue;
+
+        if (first_row < 0)
+            first_row = row_begin;
+        if (row_begin < first_row) {
+            row_spans.insert(row_spans.begin(), first_row - row_begin, {});
+            first_row = row_begin;
+        }
+        if (row_end - first_row > (int64_t) row_spans.size())
+            row_spans.resize(row_end - first_row);
+
+        for (int64_t row = row_begin; row < row_end; ++row) {
+            double world_y = stref.y1 + (row + 0.5) * grid.pixel_scale_y;
+
+            // intersect all edges of all rings with the center line of the row
+            crossings.clear();
+            for (size_t ring = polygons.start_polygon[polygon]; ring < polygons.start_polygon[polygon + 1]; ++ring) {
+                size_t ring_begin = polygons.start_ring[ring];
+                size_t ring_end = polygons.start_ring[ring + 1];
+                for (size_t i = ring_begin; i < ring_end; ++i) {
+                    // rings are closed, but do not rely on it
+                    const Coordinate &a = coordinates[i];
+                    const Coordinate &b = coordinates[i + 1 < ring_end ? i + 1 : ring_begin];
+                    if ((a.y <= world_y) != (b.y <= world_y))
+                        crossings.push_back(a.x + (world_y - a.y) * (b.x - a.x) / (b.y - a.y));
+                }
+            }
+            std::sort(crossings.begin(), crossings.end());
+
+            // the pixels with centers in [crossings[i], crossings[i+1]) are inside
+            for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+                auto x_begin = static_cast<int64_t>(std::ceil((crossings[i] - stref.x1) / grid.pixel_scale_x - 0.5));
+                auto x_end = static_cast<int64_t>(std::ceil((crossings[i + 1] - stref.x1) / grid.pixel_scale_x - 0.5));
+                x_begin = std::max(x_begin, (int64_t) 0);
+                x_end = std::min(x_end, (int64_t) grid.width);
+                if (x_begin < x_end)
+                    row_spans[row - first_row].emplace_back(x_begin, x_end);
+            }
+        }
+    }
+
+    std::vector<Span> spans;
+    for (size_t row = 0; row < row_spans.size(); ++row) {
+        auto &current = row_spans[row];
+        // polygons of a multi-polygon may overlap, each pixel must only be counted once
+        std::sort(current.begin(), current.end());
+        for (const auto &span : current) {
+            auto y = static_cast<uint32_t>(first_row + row);
+            if (!spans.empty() && spans.back().y == y && span.first <= spans.back().x_end)
+                spans.back().x_end = std::max(spans.back().x_end, span.second);
+            else
+                spans.push_back(Span{y, span.first, span.second});
+        }
+    }
+    return spans;
+}
+
+template<typename T>
+struct ZonalAccumulation {
+    static void execute(Raster2D<T> *raster, const PolygonCollection *polygons, const std::vector<double> *percentiles,
+                        std::vector<ZonalStatistics::Statistics> *results, uint32_t num_threads) {
+        raster->setRepresentation(GenericRaster::Representation::CPU);
+
+        parallelFor(polygons->getFeatureCount(), 16, num_threads, [&](size_t begin, size_t end) {
+            std::vector<double> values;
+            for (size_t feature = begin; feature < end; ++feature) {
+                auto spans = ZonalStatistics::feature_spans(*raster, *polygons, feature);
+                (*results)[feature] = accumulate(*raster, spans, *percentiles, values);
+            }
+        });
+    }
+
+    static auto accumulate(const Raster2D<T> &raster, const std::vector<ZonalStatistics::Span> &spans,
+                           const std::vector<double> &percentiles, std::vector<double> &values) -> ZonalStatistics::Statistics {
+        const bool keep_values = !percentiles.empty();
+        values.clear();
+
+        // sums are shifted by the first value for numerical stability
+        size_t n = 0;
+        double shift = 0;
+        double sum = 0;
+        double sum_of_squares = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+
+        for (const auto &span : spans) {
+            const T *row = &raster.data[(size_t) span.y * raster.width];
+            for (uint32_t x = span.x_begin; x < span.x_end; ++x) {
+                T value = row[x];
+                if (raster.dd.is_no_data(value) || std::isnan((double) value))
+                    continue;
+
+                double v = value;
+                if (n == 0)
+                    shift = v;
+                ++n;
+                sum += v - shift;
+                sum_of_squares += (v - shift) * (v - shift);
+                min = std::min(min, v);
+                max = std::max(max, v);
+                if (keep_values)
+                    values.push_back(v);
+            }
+        }
+
+        ZonalStatistics::Statistics result;
+        result.count = n;
+        if (n == 0) {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            result.mean = result.stdev = result.min = result.max = nan;
+            result.percentiles.assign(percentiles.size(), nan);
+            return result;
+        }
+
+        result.mean = shift + sum / n;
+        // sample standard deviation, undefined for a single value
+        double variance = (sum_of_squares - sum * sum / n) / (n - 1);
+        result.stdev = std::sqrt(std::max(variance, 0.0));
+        if (n == 1)
+            result.stdev = std::numeric_limits<double>::quiet_NaN();
+        result.min = min;
+        result.max = max;
+
+        if (keep_values) {
+            std::sort(values.begin(), values.end());
+            for (double percentile : percentiles) {
+                // linear interpolation between the closest ranks
+                double rank = percentile / 100.0 * (n - 1);
+                auto lower = static_cast<size_t>(std::floor(rank));
+                size_t upper = std::min(lower + 1, n - 1);
+                result.percentiles.push_back(values[lower] + (values[upper] - values[lower]) * (rank - lower));
+            }
+        }
+        return result;
+    }
+};
+
+auto ZonalStatistics::compute(GenericRaster &raster, const PolygonCollection &polygons,
+                              uint32_t num_threads) const -> std::vector<Statistics> {
+    std::vector<Statistics> results(polygons.getFeatureCount());
+    callUnaryOperatorFunc<ZonalAccumulation>(&raster, &polygons, &percentiles, &results, num_threads);
+    return results;
+}
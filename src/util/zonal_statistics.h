@@ -0,0 +1,74 @@
+#ifndef MAPPING_CORE_ZONAL_STATISTICS_H
+#define MAPPING_CORE_ZONAL_STATISTICS_H
+
+#include "datatypes/polygoncollection.h"
+#include "datatypes/raster.h"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Computes statistics of the raster values within each feature of a polygon collection.
+ *
+ * A feature is rasterized only within its bounding box, as horizontal spans of the pixels whose
+ * centers lie inside the feature (even-odd rule, so holes are excluded). The values are then read
+ * directly from the typed rows of the raster. Features are processed in parallel.
+ */
+class ZonalStatistics {
+    public:
+        /**
+         * A run of pixels [x_begin, x_end) on row y.
+         */
+        struct Span {
+            uint32_t y;
+            uint32_t x_begin;
+            uint32_t x_end;
+        };
+
+        /**
+         * The statistics of one feature. All values are NaN if there are no valid pixels.
+         */
+        struct Statistics {
+            size_t count;
+            double mean;
+            double stdev;
+            double min;
+            double max;
+            /**
+             * one value for each requested percentile, in the same order
+             */
+            std::vector<double> percentiles;
+        };
+
+        /**
+         * @param percentiles the percentiles (between 0 and 100) to compute. These require
+         *                    keeping all values of a feature in memory.
+         */
+        explicit ZonalStatistics(std::vector<double> percentiles = {});
+
+        /**
+         * Compute the statistics of all features. No-data values and NaNs are ignored.
+         * @param raster
+         * @param polygons must be in the same projection as the raster
+         * @param num_threads the number of threads, 0 for one per core
+         * @return the statistics, indexed by feature
+         */
+        auto compute(GenericRaster &raster, const PolygonCollection &polygons,
+                     uint32_t num_threads = 0) const -> std::vector<Statistics>;
+
+        /**
+         * Rasterize a feature to the pixel grid. The spans are sorted by row and do not overlap.
+         * @param grid
+         * @param polygons
+         * @param feature
+         * @return the pixel spans covered by the feature
+         */
+        static auto feature_spans(const GridSpatioTemporalResult &grid, const PolygonCollection &polygons,
+                                  size_t feature) -> std::vector<Span>;
+
+    private:
+        std::vector<double> percentiles;
+};
+
+
+#endif //MAPPING_CORE_ZONAL_STATISTICS_H
@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+#include "cache/manager.h"
+#include "cache/node/delivery.h"
+#include "cache/node/node_config.h"
+#include "cache/node/manager/local_manager.h"
+#include "cache/priv/connection.h"
+#include "cache/priv/shared.h"
+#include "datatypes/pointcollection.h"
+#include "datatypes/simplefeaturecollections/wkbutil.h"
+#include "operators/operator.h"
+#include "operators/queryprofiler.h"
+#include "util/shared_memory.h"
+
+#include <json/json.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+
+static const char *wkt = "GEOMETRYCOLLECTION(POINT(1 1), POINT(2 5), MULTIPOINT(8 6, 8 9))";
+
+static int listenOnFreePort(int &port) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t length = sizeof(address);
+	if (fd < 0 || bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(fd, 8) != 0
+			|| getsockname(fd, (struct sockaddr *) &address, &length) != 0)
+		throw PlatformException("could not listen on a free port");
+	port = ntohs(address.sin_port);
+	return fd;
+}
+
+static std::vector<char> readPayload(BinaryStream &from) {
+	BinaryReadBuffer buffer;
+	from.read(buffer);
+	std::vector<char> payload(buffer.getPayloadSize());
+	buffer.read(payload.data(), payload.size());
+	return payload;
+}
+
+static void writePayload(const std::vector<char> &payload, BinaryStream &to) {
+	BinaryWriteBuffer buffer;
+	buffer.write(payload.data(), payload.size());
+	to.write(buffer);
+}
+
+/*
+ * Stands between the frontend and the delivery port of a node and records the responses.
+ * With hide_shared_memory, segments are unlinked before the frontend sees their names,
+ * like for a node in a container with its own /dev/shm.
+ */
+class DeliveryProxy {
+	public:
+		DeliveryProxy(int node_port) : hide_shared_memory(false), node_port(node_port) {
+			listen_fd = listenOnFreePort(port);
+			thread = std::thread([this] { run(); });
+		}
+
+		~DeliveryProxy() {
+			shutdown(listen_fd, SHUT_RDWR);
+			thread.join();
+			close(listen_fd);
+		}
+
+		int port;
+		std::atomic<bool> hide_shared_memory;
+		std::vector<uint8_t> responses;
+		std::string segment_name;
+
+	private:
+		void run() {
+			int fd = accept(listen_fd, nullptr, nullptr);
+			if (fd < 0)
+				return;
+			auto frontend = BinaryStream::fromAcceptedSocket(fd);
+			auto node = BinaryStream::connectTCP("127.0.0.1", node_port);
+
+			// the handshake has no response
+			writePayload(readPayload(frontend), node);
+
+			while (true) {
+				std::vector<char> request;
+				try {
+					request = readPayload(frontend);
+				} catch (const NetworkException &) {
+					// the frontend is done
+					return;
+				}
+				writePayload(request, node);
+
+				auto response = readPayload(node);
+				BinaryReadBuffer buffer(response.data(), response.size());
+				auto code = buffer.read<uint8_t>();
+				responses.push_back(code);
+				if (code == DeliveryConnection::RESP_OK_SHARED) {
+					segment_name = buffer.read<std::string>();
+					if (hide_shared_memory)
+						SharedMemorySegment::unlink(segment_name);
+				}
+				writePayload(response, frontend);
+			}
+		}
+
+		int node_port;
+		int listen_fd;
+		std::thread thread;
+};
+
+/*
+ * Answers a single query of the frontend with the given delivery
+ */
+class FakeIndex {
+	public:
+		FakeIndex(const DeliveryResponse &delivery) : delivery(delivery) {
+			listen_fd = listenOnFreePort(port);
+			thread = std::thread([this] { run(); });
+		}
+
+		~FakeIndex() {
+			shutdown(listen_fd, SHUT_RDWR);
+			thread.join();
+			close(listen_fd);
+		}
+
+		int port;
+
+	private:
+		void run() {
+			int fd = accept(listen_fd, nullptr, nullptr);
+			if (fd < 0)
+				return;
+			auto frontend = BinaryStream::fromAcceptedSocket(fd);
+			BinaryReadBuffer magic, request;
+			frontend.read(magic);
+			frontend.read(request);
+
+			BinaryWriteBuffer response;
+			response.write(ClientConnection::RESP_OK);
+			response.write(delivery);
+			frontend.write(response);
+		}
+
+		DeliveryResponse delivery;
+		int listen_fd;
+		std::thread thread;
+};
+
+/*
+ * Delivers points from the DeliveryManager of a node to a ClientCacheManager with shared memory enabled
+ */
+class CacheDelivery : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			// the delivery manager opens its own socket, so the port is only reserved for a moment
+			int fd = listenOnFreePort(config.delivery_port);
+			close(fd);
+			node_manager = make_unique<LocalCacheManager>("never", "lru", 1 << 20, 1 << 20, 1 << 20, 1 << 20, 1 << 20, 1 << 20);
+			delivery_manager = make_unique<DeliveryManager>(config, *node_manager);
+			delivery_thread = delivery_manager->run_async();
+
+			// wait until the node accepts connections
+			for (int i = 0; i < 100; i++) {
+				try {
+					BinaryStream::connectTCP("127.0.0.1", config.delivery_port);
+					break;
+				} catch (const NetworkException &) {
+					usleep(10000);
+				}
+			}
+
+			points = WKBUtil::readPointCollection(wkt, SpatioTemporalReference::unreferenced());
+		}
+
+		void TearDown() override {
+			delivery_manager->stop();
+			delivery_thread->join();
+		}
+
+		std::unique_ptr<PointCollection> query(DeliveryProxy &proxy) {
+			auto id = delivery_manager->add_delivery(std::shared_ptr<const PointCollection>(points->clone()));
+			FakeIndex index(DeliveryResponse("127.0.0.1", proxy.port, id));
+
+			Json::Value json;
+			Json::Reader().parse(R"json({"type": "wkt_source", "params": {"type": "points", "wkt": "POINT(1 1)"}})json", json);
+			auto op = GenericOperator::fromJSON(json);
+			QueryRectangle rect(
+				SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 10, 10),
+				TemporalReference::unreferenced(),
+				QueryResolution::none()
+			);
+			QueryProfiler profiler;
+
+			ClientCacheManager client("127.0.0.1", index.port, true);
+			return client.get_point_cache().query(*op, rect, profiler);
+		}
+
+		NodeConfig config;
+		std::unique_ptr<LocalCacheManager> node_manager;
+		std::unique_ptr<DeliveryManager> delivery_manager;
+		std::unique_ptr<std::thread> delivery_thread;
+		std::unique_ptr<PointCollection> points;
+};
+
+TEST_F(CacheDelivery, deliversThroughSharedMemory) {
+	DeliveryProxy proxy(config.delivery_port);
+	auto result = query(proxy);
+
+	EXPECT_EQ(result->toWKT(), points->toWKT());
+	EXPECT_EQ(proxy.responses, std::vector<uint8_t>({DeliveryConnection::RESP_OK_SHARED}));
+	// the segment is gone
+	ASSERT_FALSE(proxy.segment_name.empty());
+	EXPECT_THROW(SharedMemorySegment::open(proxy.segment_name), PlatformException);
+}
+
+TEST_F(CacheDelivery, fallsBackToTheSocket) {
+	DeliveryProxy proxy(config.delivery_port);
+	proxy.hide_shared_memory = true;
+	auto result = query(proxy);
+
+	EXPECT_EQ(result->toWKT(), points->toWKT());
+	// the delivery can only be fetched once, but is sent again after the failed attempt
+	EXPECT_EQ(proxy.responses, std::vector<uint8_t>({DeliveryConnection::RESP_OK_SHARED, DeliveryConnection::RESP_OK}));
+}
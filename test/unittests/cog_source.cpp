@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "operators/operator.h"
+#include "operators/provenance.h"
+#include "operators/queryprofiler.h"
+#include "operators/querytools.h"
+#include "cache/manager.h"
+#include "datatypes/raster.h"
+#include "util/configuration.h"
+#include "util/gdal.h"
+
+#include <gdal_priv.h>
+#include <json/json.h>
+
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+
+static const int width = 100, height = 70;
+
+/*
+ * Writes a tiled GeoTIFF with GDAL whose pixels hold row * 100 + column, except for a no data stripe,
+ * and a dataset description for it in the working directory. Returns the name of the dataset.
+ */
+static std::string writeDataset() {
+	GDAL::init();
+	auto memory = GetGDALDriverManager()->GetDriverByName("MEM")->Create("", width, height, 1, GDT_Int16, nullptr);
+	double transform[6] = {10, 0.5, 0, 37.5, 0, -0.25};
+	memory->SetGeoTransform(transform);
+	auto band = memory->GetRasterBand(1);
+	band->SetNoDataValue(-5);
+
+	std::vector<int16_t> values((size_t) width * height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			values[(size_t) y * width + x] = (int16_t) (x == 45 ? -5 : y * 100 + x);
+	if (band->RasterIO(GF_Write, 0, 0, width, height, values.data(), width, height, GDT_Int16, 0, 0) != CE_None)
+		throw std::runtime_error("could not fill the raster");
+
+	std::string name = "cog_source_test_" + std::to_string(getpid());
+	const char *options[] = {"TILED=YES", "BLOCKXSIZE=32", "BLOCKYSIZE=32", nullptr};
+	auto tiff = GetGDALDriverManager()->GetDriverByName("GTiff")->CreateCopy((name + ".tif").c_str(), memory, false, (char **) options, nullptr, nullptr);
+	GDALClose(memory);
+	if (tiff == nullptr)
+		throw std::runtime_error("could not write " + name + ".tif");
+	GDALClose(tiff);
+
+	Json::Value description(Json::objectValue);
+	description["dataset_name"] = name;
+	description["path"] = ".";
+	description["file_name"] = name + ".tif";
+	description["coords"]["crs"] = "EPSG:4326";
+	description["provenance"]["citation"] = "citation";
+	description["provenance"]["license"] = "license";
+	description["provenance"]["uri"] = "uri";
+	std::ofstream file(name + ".json");
+	file << description;
+	return name;
+}
+
+/*
+ * Loading [gdalsource.datasets] replaces the whole [gdalsource] table of the global configuration,
+ * so the previous table is put back after each test.
+ */
+class CogSource : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			auto table = Configuration::getTomlTable();
+			if (table->contains("gdalsource"))
+				gdalsource = table->get("gdalsource");
+			Configuration::loadFromString("[gdalsource.datasets]\npath=\".\"\n");
+			sourcename = writeDataset();
+			CacheManager::init(&cache_manager);
+		}
+
+		void TearDown() override {
+			CacheManager::init(nullptr);
+			std::remove((sourcename + ".tif").c_str());
+			std::remove((sourcename + ".json").c_str());
+			auto table = Configuration::getTomlTable();
+			if (gdalsource)
+				table->insert("gdalsource", gdalsource);
+			else
+				table->erase("gdalsource");
+		}
+
+		std::unique_ptr<GenericOperator> build(const std::string &type) {
+			Json::Value json(Json::objectValue);
+			json["type"] = type;
+			json["params"]["sourcename"] = sourcename;
+			json["params"]["channel"] = 1;
+			return GenericOperator::fromJSON(json);
+		}
+
+		// compares the rasters of both sources pixel by pixel
+		void compare(const QueryRectangle &rect) {
+			QueryProfiler gdal_profiler, cog_profiler;
+			auto expected = build("gdal_source")->getCachedRaster(rect, QueryTools(gdal_profiler));
+			auto actual = build("cog_source")->getCachedRaster(rect, QueryTools(cog_profiler));
+			expected->setRepresentation(GenericRaster::Representation::CPU);
+			actual->setRepresentation(GenericRaster::Representation::CPU);
+
+			ASSERT_EQ(actual->dd.datatype, expected->dd.datatype);
+			ASSERT_EQ(actual->dd.has_no_data, expected->dd.has_no_data);
+			EXPECT_EQ(actual->dd.no_data, expected->dd.no_data);
+			ASSERT_EQ(actual->width, expected->width);
+			ASSERT_EQ(actual->height, expected->height);
+			EXPECT_DOUBLE_EQ(actual->stref.x1, expected->stref.x1);
+			EXPECT_DOUBLE_EQ(actual->stref.y1, expected->stref.y1);
+			EXPECT_DOUBLE_EQ(actual->stref.x2, expected->stref.x2);
+			EXPECT_DOUBLE_EQ(actual->stref.y2, expected->stref.y2);
+			for (uint32_t y = 0; y < expected->height; y++)
+				for (uint32_t x = 0; x < expected->width; x++)
+					ASSERT_EQ(actual->getAsDouble(x, y), expected->getAsDouble(x, y)) << "at pixel " << x << ", " << y;
+		}
+
+		NopCacheManager cache_manager;
+		std::string sourcename;
+		std::shared_ptr<cpptoml::base> gdalsource;
+};
+
+TEST_F(CogSource, readsLikeTheGdalSource) {
+	// the whole file
+	compare(QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), 10, 20, 60, 37.5),
+		TemporalReference(TIMETYPE_UNIX, 0),
+		QueryResolution::pixels(width, height)
+	));
+
+	// a window across tile borders
+	compare(QueryRectangle(
+		SpatialReference(CrsId::from_epsg_code(4326), 20, 25, 40, 32.5),
+		TemporalReference(TIMETYPE_UNIX, 0),
+		QueryResolution::pixels(40, 30)
+	));
+}
+
+TEST_F(CogSource, sharesTheProvenanceOfTheGdalSource) {
+	auto expected = build("gdal_source")->getFullProvenance();
+	auto actual = build("cog_source")->getFullProvenance();
+	EXPECT_EQ(actual->toJson(), expected->toJson());
+	EXPECT_EQ(actual->getLocalIdentifiers(), std::vector<std::string>({"data.gdal_source." + sourcename}));
+}
@@ -21,6 +21,8 @@ static void compareBinaryReadBuffers(const BinaryReadBuffer &a, const BinaryRead
 
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -114,6 +116,94 @@ TEST(Serialization, AttributeArrays) {
 	compareBinaryReadBuffers(*buf1, *buf2);
 }
 
+TEST(Serialization, ManyLinkedAreas) {
+	// more linked areas than a single writev() call accepts, and more data than fits into the pipe
+	const size_t count = 3000;
+	std::vector<std::vector<double>> vectors(count);
+	for (size_t i=0;i<count;i++)
+		vectors[i].assign(16, (double) i);
+	std::string str(100, 'x');
+
+	auto stream = BinaryStream::makePipe();
+	std::thread writer([&] {
+		BinaryWriteBuffer wb;
+		for (auto &vec : vectors)
+			wb.write(vec, true);
+		wb.write(str, true);
+		stream.write(wb);
+	});
+
+	BinaryReadBuffer rb;
+	stream.read(rb);
+	writer.join();
+
+	std::vector<double> vec;
+	for (size_t i=0;i<count;i++) {
+		rb.read(&vec);
+		EXPECT_EQ(vec, vectors[i]);
+	}
+	EXPECT_EQ(rb.read<std::string>(), str);
+}
+
+TEST(Serialization, VectorAfterOddSizedData) {
+	// the vector's data starts at an odd offset of the read buffer
+	std::vector<double> vec{1.5, -2.25, 1e300};
+	auto stream = BinaryStream::makePipe();
+	BinaryWriteBuffer wb;
+	wb.write((char) 'x');
+	wb.write(vec);
+	stream.write(wb);
+
+	BinaryReadBuffer rb;
+	stream.read(rb);
+	EXPECT_EQ(rb.read<char>(), 'x');
+	std::vector<double> result;
+	rb.read(&result);
+	EXPECT_EQ(result, vec);
+}
+
+TEST(Serialization, IncrementalRead) {
+	// a raster larger than the read-ahead between small values, followed by another packet
+	DataDescription dd(GDT_Float32, Unit::unknown());
+	SpatioTemporalReference stref(SpatialReference::unreferenced(), TemporalReference::unreferenced());
+	auto raster1 = GenericRaster::create(dd, stref, 400, 300, 1, GenericRaster::Representation::CPU);
+	raster1->clear(0);
+	raster1->printCentered(2, "Test-string on a raster");
+	std::vector<double> vec{1.5, -2.25, 1e300};
+	std::string str(100, 'x');
+
+	auto stream = BinaryStream::makePipe();
+	std::thread writer([&] {
+		BinaryWriteBuffer wb;
+		wb.write((char) 'x');
+		wb.write(str, true);
+		wb.write(*raster1, true);
+		wb.write(vec, true);
+		stream.write(wb);
+		BinaryWriteBuffer next;
+		next.write(42);
+		stream.write(next);
+	});
+
+	BinaryReadBuffer rb;
+	stream.readIncrementally(rb);
+	EXPECT_EQ(rb.read<char>(), 'x');
+	EXPECT_EQ(rb.read<std::string>(), str);
+	auto raster2 = GenericRaster::deserialize(rb);
+	ASSERT_EQ(raster2->getDataSize(), raster1->getDataSize());
+	EXPECT_EQ(memcmp(raster2->getData(), raster1->getData(), raster1->getDataSize()), 0);
+	std::vector<double> result;
+	rb.read(&result);
+	EXPECT_EQ(result, vec);
+	EXPECT_THROW(rb.read<char>(), NetworkException);
+
+	// the stream is at the start of the next packet
+	BinaryReadBuffer next;
+	stream.read(next);
+	writer.join();
+	EXPECT_EQ(next.read<int>(), 42);
+}
+
 //
 // CACHE/PRIV/SHARED
 //
@@ -0,0 +1,352 @@
+#include <gtest/gtest.h>
+#include "operators/processing/meteosat/cpu_kernels.h"
+#include "datatypes/raster/raster_priv.h"
+#include "raster/opencl.h"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+#ifndef MAPPING_NO_OPENCL
+#include "operators/processing/meteosat/radiance.cl.h"
+#include "operators/processing/meteosat/reflectance.cl.h"
+#include "operators/processing/meteosat/solarangle.cl.h"
+#include "operators/processing/meteosat/co2correction.cl.h"
+#endif
+
+
+// a part of the meteosat disk over the mediterranean, in GEOS coordinates
+static SpatioTemporalReference geosStref() {
+	return SpatioTemporalReference(SpatialReference(CrsId::unreferenced(), -1500000, 2500000, 1700000, 4500000), TemporalReference::unreferenced());
+}
+
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(const DataDescription &dd, uint32_t width, uint32_t height, const std::function<T(uint32_t, uint32_t)> &value) {
+	auto raster = GenericRaster::create(dd, geosStref(), width, height, 0, GenericRaster::Representation::CPU);
+	auto typed = dynamic_cast<Raster2D<T> *>(raster.get());
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			typed->set(x, y, value(x, y));
+	return raster;
+}
+
+static std::unique_ptr<GenericRaster> rawRaster(uint32_t width, uint32_t height) {
+	Unit unit("raw", "unknown");
+	unit.setMinMax(0, 1023);
+	DataDescription dd(GDT_Int16, unit, true, 0);
+	return createRaster<int16_t>(dd, width, height, [](uint32_t x, uint32_t y) {
+		return (int16_t) ((x * 7 + y * 13) % 1024);
+	});
+}
+
+static std::unique_ptr<GenericRaster> floatRaster(uint32_t width, uint32_t height, float min, float max) {
+	Unit unit("temperature", "k");
+	unit.setMinMax(min, max);
+	DataDescription dd(GDT_Float32, unit, true, -1);
+	return createRaster<float>(dd, width, height, [=](uint32_t x, uint32_t y) {
+		return (x + y) % 17 == 0 ? -1.0f : min + (max - min) * ((x * 31 + y * 17) % 101) / 100.0f;
+	});
+}
+
+static DataDescription floatDataDescription(double min, double max) {
+	Unit unit("unknown", "unknown");
+	unit.setMinMax(min, max);
+	DataDescription dd(GDT_Float32, unit);
+	dd.addNoData();
+	return dd;
+}
+
+static float valueAt(GenericRaster &raster, uint32_t x, uint32_t y) {
+	raster.setRepresentation(GenericRaster::Representation::CPU);
+	return dynamic_cast<Raster2D<float> &>(raster).get(x, y);
+}
+
+static bool isNoData(GenericRaster &raster, uint32_t x, uint32_t y) {
+	float value = valueAt(raster, x, y);
+	return std::isnan(value) || value == raster.dd.no_data;
+}
+
+static void expectRastersNear(GenericRaster &expected, GenericRaster &actual, double tolerance) {
+	ASSERT_EQ(expected.width, actual.width);
+	ASSERT_EQ(expected.height, actual.height);
+	for (uint32_t y = 0; y < expected.height; y++) {
+		for (uint32_t x = 0; x < expected.width; x++) {
+			ASSERT_EQ(isNoData(expected, x, y), isNoData(actual, x, y)) << "at " << x << "," << y;
+			if (!isNoData(expected, x, y)) {
+				ASSERT_NEAR(valueAt(expected, x, y), valueAt(actual, x, y), tolerance * std::max(1.0f, std::abs(valueAt(expected, x, y)))) << "at " << x << "," << y;
+			}
+		}
+	}
+}
+
+static cIntermediateVariables sun() {
+	return sunposIntermediate(2012, 6, 21, 12, 0, 0.0);
+}
+
+static const double view_angle_factor = 65536 / (-13642337 * 3000.403165817);
+
+// the pixel by pixel computation of solarangle.cl, without any precomputed terms
+static void referenceAzimuthZenith(const GenericRaster &raster, uint32_t x, uint32_t y, double &azimuth, double &zenith) {
+	const double to_radians = M_PI / 180;
+	double view_x = (x * raster.pixel_scale_x + raster.PixelToWorldX(0)) * view_angle_factor * -1 * to_radians;
+	double view_y = (y * raster.pixel_scale_y + raster.PixelToWorldY(0)) * view_angle_factor * to_radians;
+	double cosxcosy = cos(view_x) * cos(view_y);
+	double cos2yconstsin2y = pow(cos(view_y), 2) + 1.006803 * pow(sin(view_y), 2);
+	double sd = sqrt(pow(42164 * cosxcosy, 2) - cos2yconstsin2y * 1737121856);
+	double sn = (42164 * cosxcosy - sd) / cos2yconstsin2y;
+	double s1 = 42164 - sn * cosxcosy, s2 = sn * sin(view_x) * cos(view_y), s3 = -sn * sin(view_y);
+	double lon = atan(s2 / s1) / to_radians;
+	double lat = atan(1.006804 * s3 / sqrt(s1 * s1 + s2 * s2)) / to_radians;
+
+	auto sun_variables = sun();
+	double hour_angle = (sun_variables.dGreenwichMeanSiderealTime * 15 + lon) * to_radians - sun_variables.dRightAscension;
+	double latitude = lat * to_radians;
+	double zenith_rad = acos(cos(latitude) * cos(hour_angle) * cos(sun_variables.dDeclination) + sin(sun_variables.dDeclination) * sin(latitude));
+	double azimuth_rad = atan2(-sin(hour_angle), tan(sun_variables.dDeclination) * cos(latitude) - sin(latitude) * cos(hour_angle));
+	if (azimuth_rad < 0)
+		azimuth_rad += 2 * M_PI;
+	zenith_rad += (6371.01 / 149597890) * sin(zenith_rad);
+	azimuth = azimuth_rad / to_radians;
+	zenith = zenith_rad / to_radians;
+}
+
+
+TEST(MeteosatCpuKernels, radiance) {
+	auto raster = rawRaster(40, 30);
+	auto out = msg::cpu::radiance(*raster, floatDataDescription(-5, 200), -2.5f, 0.05f, 1.0f, 2);
+	auto typed = dynamic_cast<Raster2D<int16_t> *>(raster.get());
+	for (uint32_t y = 0; y < 30; y++) {
+		for (uint32_t x = 0; x < 40; x++) {
+			int16_t value = typed->get(x, y);
+			if (value == 0)
+				EXPECT_TRUE(isNoData(*out, x, y));
+			else
+				EXPECT_FLOAT_EQ(valueAt(*out, x, y), -2.5f + value * 0.05f);
+		}
+	}
+}
+
+TEST(MeteosatCpuKernels, temperatureUsesLookupTable) {
+	std::vector<float> lut(1024);
+	for (size_t i = 0; i < lut.size(); i++)
+		lut[i] = 200 + i * 0.1f;
+	Unit unit("raw", "unknown");
+	DataDescription dd(GDT_Int16, unit, true, 0);
+	auto raster = createRaster<int16_t>(dd, 4, 1, [](uint32_t x, uint32_t) {
+		int16_t values[] = {0, 1, 1023, 1024};
+		return values[x];
+	});
+
+	auto out = msg::cpu::temperature(*raster, floatDataDescription(200, 330), lut, 1);
+	EXPECT_TRUE(isNoData(*out, 0, 0));
+	EXPECT_FLOAT_EQ(valueAt(*out, 1, 0), lut[1]);
+	EXPECT_FLOAT_EQ(valueAt(*out, 2, 0), lut[1023]);
+	EXPECT_TRUE(isNoData(*out, 3, 0));
+}
+
+TEST(MeteosatCpuKernels, reflectance) {
+	auto raster = floatRaster(30, 20, 0, 150);
+	auto out = msg::cpu::reflectance(*raster, floatDataDescription(-0.1, 1.2), 20.5, 1.016, 2);
+	for (uint32_t y = 0; y < 20; y++) {
+		for (uint32_t x = 0; x < 30; x++) {
+			if (isNoData(*raster, x, y))
+				EXPECT_TRUE(isNoData(*out, x, y));
+			else
+				EXPECT_NEAR(valueAt(*out, x, y), valueAt(*raster, x, y) * 1.016 * 1.016 / 20.5, 1e-5);
+		}
+	}
+}
+
+TEST(MeteosatCpuKernels, solarAngles) {
+	auto raster = floatRaster(33, 25, 0, 150);
+	auto azimuth = msg::cpu::solarAzimuth(*raster, floatDataDescription(0, 360), sun(), view_angle_factor, 3);
+	auto zenith = msg::cpu::solarZenith(*raster, floatDataDescription(0, 360), sun(), view_angle_factor, 3);
+	auto reflectance = msg::cpu::reflectanceWithSolarCorrection(*raster, floatDataDescription(-0.1, 1.2), 20.5, 1.016, sun(), view_angle_factor, 3);
+
+	for (uint32_t y = 0; y < 25; y++) {
+		for (uint32_t x = 0; x < 33; x++) {
+			if (isNoData(*raster, x, y)) {
+				EXPECT_TRUE(isNoData(*azimuth, x, y));
+				EXPECT_TRUE(isNoData(*zenith, x, y));
+				EXPECT_TRUE(isNoData(*reflectance, x, y));
+				continue;
+			}
+			double expected_azimuth, expected_zenith;
+			referenceAzimuthZenith(*raster, x, y, expected_azimuth, expected_zenith);
+			EXPECT_NEAR(valueAt(*azimuth, x, y), expected_azimuth, 1e-3);
+			EXPECT_NEAR(valueAt(*zenith, x, y), expected_zenith, 1e-3);
+			double expected_reflectance = valueAt(*raster, x, y) * 1.016 * 1.016 / (20.5 * cos(std::min(expected_zenith, 80.0) * M_PI / 180));
+			EXPECT_NEAR(valueAt(*reflectance, x, y), expected_reflectance, 1e-4 * std::max(1.0, expected_reflectance));
+		}
+	}
+
+	// midsummer noon at about 34 degrees north, close to the tropic of cancer
+	EXPECT_GT(valueAt(*zenith, 16, 12), 5);
+	EXPECT_LT(valueAt(*zenith, 16, 12), 20);
+}
+
+TEST(MeteosatCpuKernels, co2Correction) {
+	auto bt039 = floatRaster(20, 10, 250, 300);
+	auto bt108 = floatRaster(20, 10, 240, 290);
+	auto bt134 = floatRaster(20, 10, 220, 250);
+	auto out = msg::cpu::co2Correction(*bt039, *bt108, *bt134, floatDataDescription(200, 330), 2);
+	for (uint32_t y = 0; y < 10; y++) {
+		for (uint32_t x = 0; x < 20; x++) {
+			if (isNoData(*bt039, x, y)) {
+				EXPECT_TRUE(isNoData(*out, x, y));
+				continue;
+			}
+			double v039 = valueAt(*bt039, x, y), v108 = valueAt(*bt108, x, y), v134 = valueAt(*bt134, x, y);
+			double corrected = v108 - (v108 - v134) / 4;
+			EXPECT_NEAR(valueAt(*out, x, y), pow(pow(v039, 4) + pow(v108, 4) - pow(corrected, 4), 0.25), 1e-2);
+		}
+	}
+
+	auto smaller = floatRaster(10, 10, 220, 250);
+	EXPECT_THROW(msg::cpu::co2Correction(*bt039, *bt108, *smaller, floatDataDescription(200, 330), 2), OperatorException);
+}
+
+TEST(MeteosatCpuKernels, pansharpeningKeepsHrvDetail) {
+	// the low resolution raster is the mean of the hrv blocks, so the regression is the identity
+	const int ratio = 3, low_width = 12, low_height = 9;
+	Unit unit("reflectance", "fraction");
+	unit.setMinMax(0, 100);
+	DataDescription dd(GDT_Float32, unit, true, -1);
+	auto hrv_value = [](uint32_t x, uint32_t y) {
+		return 1.0f + x * 0.25f + y * 0.5f + ((x * 7 + y * 3) % 5) * 0.1f;
+	};
+	auto hrv = createRaster<float>(dd, low_width * ratio, low_height * ratio, hrv_value);
+	auto lowres = createRaster<float>(dd, low_width, low_height, [&](uint32_t x, uint32_t y) {
+		float sum = 0;
+		for (int dy = 0; dy < ratio; dy++)
+			for (int dx = 0; dx < ratio; dx++)
+				sum += hrv_value(x * ratio + dx, y * ratio + dy);
+		return sum / (ratio * ratio) - 0.1f;
+	});
+
+	auto out = msg::cpu::pansharpening(*hrv, *lowres, hrv->stref, ratio, std::vector<float>(), 5, 1, 2);
+	ASSERT_EQ(out->width, hrv->width);
+	ASSERT_EQ(out->height, hrv->height);
+	for (uint32_t y = 0; y < out->height; y++)
+		for (uint32_t x = 0; x < out->width; x++)
+			EXPECT_NEAR(valueAt(*out, x, y), hrv_value(x, y) - 0.1f, 1e-2);
+
+	EXPECT_THROW(msg::cpu::pansharpening(*hrv, *lowres, hrv->stref, 2, std::vector<float>(), 5, 1, 2), ArgumentException);
+}
+
+TEST(MeteosatCpuKernels, replacementByRange) {
+	DataDescription dd(GDT_Float32, Unit::unknown(), true, -1);
+	auto raster = createRaster<float>(dd, 5, 1, [](uint32_t x, uint32_t) {
+		float values[] = {-1, 10, 85, 100, 170};
+		return values[x];
+	});
+
+	DataDescription out_dd = floatDataDescription(-20, 20);
+	auto out = msg::cpu::replacementByRange(*raster, out_dd, {0, 80, 90}, {80, 90, 180}, {5, -9999, 7}, -42, 2);
+	EXPECT_FLOAT_EQ(valueAt(*out, 0, 0), -42);
+	EXPECT_FLOAT_EQ(valueAt(*out, 1, 0), 5);
+	EXPECT_FLOAT_EQ(valueAt(*out, 2, 0), -9999);
+	EXPECT_FLOAT_EQ(valueAt(*out, 3, 0), 7);
+	EXPECT_FLOAT_EQ(valueAt(*out, 4, 0), 7);
+}
+
+TEST(MeteosatCpuKernels, threadsDoNotChangeTheResult) {
+	auto raster = floatRaster(50, 70, 0, 150);
+	auto single = msg::cpu::reflectanceWithSolarCorrection(*raster, floatDataDescription(-0.1, 1.2), 20.5, 1.016, sun(), view_angle_factor, 1);
+	auto multi = msg::cpu::reflectanceWithSolarCorrection(*raster, floatDataDescription(-0.1, 1.2), 20.5, 1.016, sun(), view_angle_factor, 4);
+	expectRastersNear(*single, *multi, 0);
+}
+
+#ifndef MAPPING_NO_OPENCL
+static std::unique_ptr<GenericRaster> runKernel(const char *source, const char *kernel, const DataDescription &out_dd,
+		std::vector<GenericRaster *> in_rasters, const std::function<void(RasterOpenCL::CLProgram &)> &addArgs) {
+	RasterOpenCL::init();
+	for (auto raster : in_rasters)
+		raster->setRepresentation(GenericRaster::OPENCL);
+	auto out = GenericRaster::create(out_dd, *in_rasters[0], GenericRaster::Representation::OPENCL);
+	RasterOpenCL::CLProgram prog;
+	for (auto raster : in_rasters)
+		prog.addInRaster(raster);
+	prog.addOutRaster(out.get());
+	prog.compile(source, kernel);
+	addArgs(prog);
+	prog.run();
+	return out;
+}
+
+TEST(MeteosatCpuKernels, matchOpenCL) {
+	auto raw = rawRaster(64, 48);
+	auto radiance = floatRaster(64, 48, 0, 150);
+	auto sun_variables = sun();
+
+	auto out_dd = floatDataDescription(-5, 200);
+	auto cpu_radiance = msg::cpu::radiance(*raw, out_dd, -2.5f, 0.05f, 1.0f);
+	auto cl_radiance = runKernel(operators_processing_meteosat_radiance, "radianceConvertedKernel", out_dd, {raw.get()}, [](RasterOpenCL::CLProgram &prog) {
+		prog.addArg(-2.5f);
+		prog.addArg(0.05f);
+		prog.addArg(1.0f);
+	});
+	expectRastersNear(*cl_radiance, *cpu_radiance, 1e-6);
+
+	out_dd = floatDataDescription(-0.1, 1.2);
+	auto cpu_reflectance = msg::cpu::reflectanceWithSolarCorrection(*radiance, out_dd, 20.5, 1.016, sun_variables, view_angle_factor);
+	auto cl_reflectance = runKernel(operators_processing_meteosat_reflectance, "reflectanceWithSolarCorrectionKernel", out_dd, {radiance.get()}, [&](RasterOpenCL::CLProgram &prog) {
+		prog.addArg(sun_variables.dGreenwichMeanSiderealTime);
+		prog.addArg(sun_variables.dRightAscension);
+		prog.addArg(sun_variables.dDeclination);
+		prog.addArg(view_angle_factor);
+		prog.addArg(20.5);
+		prog.addArg(1.016);
+	});
+	expectRastersNear(*cl_reflectance, *cpu_reflectance, 1e-5);
+
+	out_dd = floatDataDescription(0, 360);
+	auto cpu_zenith = msg::cpu::solarZenith(*radiance, out_dd, sun_variables, view_angle_factor);
+	auto cl_zenith = runKernel(operators_processing_meteosat_solarangle, "zenithKernel", out_dd, {radiance.get()}, [&](RasterOpenCL::CLProgram &prog) {
+		prog.addArg(view_angle_factor);
+		prog.addArg(sun_variables.dGreenwichMeanSiderealTime);
+		prog.addArg(sun_variables.dRightAscension);
+		prog.addArg(sun_variables.dDeclination);
+	});
+	expectRastersNear(*cl_zenith, *cpu_zenith, 1e-5);
+
+	auto bt039 = floatRaster(64, 48, 250, 300), bt108 = floatRaster(64, 48, 240, 290), bt134 = floatRaster(64, 48, 220, 250);
+	out_dd = floatDataDescription(200, 330);
+	auto cpu_co2 = msg::cpu::co2Correction(*bt039, *bt108, *bt134, out_dd);
+	auto cl_co2 = runKernel(operators_processing_meteosat_co2correction, "co2correctionkernel", out_dd, {bt039.get(), bt108.get(), bt134.get()}, [](RasterOpenCL::CLProgram &) {});
+	expectRastersNear(*cl_co2, *cpu_co2, 1e-5);
+}
+#endif
+
+/*
+ * Throughput of the kernels on a scene of 3072 x 3072 pixels, run with --gtest_also_run_disabled_tests
+ */
+static void benchmark(const std::string &name, uint32_t pixels, const std::function<void()> &run) {
+	run();
+	const int repetitions = 3;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repetitions; i++)
+		run();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+	std::cout << name << ": " << (pixels / seconds / 1e6) << " Mpixel/s" << std::endl;
+}
+
+static const uint32_t benchmark_size = 3072;
+
+TEST(MeteosatCpuKernels, DISABLED_benchmark) {
+	auto raw = rawRaster(benchmark_size, benchmark_size);
+	auto radiance = floatRaster(benchmark_size, benchmark_size, 0, 150);
+	auto bt108 = floatRaster(benchmark_size, benchmark_size, 240, 290), bt134 = floatRaster(benchmark_size, benchmark_size, 220, 250);
+	auto lowres = floatRaster(benchmark_size / 3, benchmark_size / 3, 0, 150);
+	std::vector<float> lut(1024, 250.0f);
+	const uint32_t pixels = benchmark_size * benchmark_size;
+
+	benchmark("radiance", pixels, [&]() { msg::cpu::radiance(*raw, floatDataDescription(-5, 200), -2.5f, 0.05f, 1.0f); });
+	benchmark("temperature", pixels, [&]() { msg::cpu::temperature(*raw, floatDataDescription(200, 330), lut); });
+	benchmark("reflectance", pixels, [&]() { msg::cpu::reflectanceWithSolarCorrection(*radiance, floatDataDescription(-0.1, 1.2), 20.5, 1.016, sun(), view_angle_factor); });
+	benchmark("solar_angle", pixels, [&]() { msg::cpu::solarZenith(*radiance, floatDataDescription(0, 360), sun(), view_angle_factor); });
+	benchmark("co2_correction", pixels, [&]() { msg::cpu::co2Correction(*radiance, *bt108, *bt134, floatDataDescription(200, 330)); });
+	benchmark("pansharpening", pixels, [&]() { msg::cpu::pansharpening(*radiance, *lowres, radiance->stref, 3, std::vector<float>(), 5, 1); });
+	benchmark("gccthermthresholddetection", pixels, [&]() { msg::cpu::replacementByRange(*radiance, floatDataDescription(-20, 20), {0, 80, 90}, {80, 90, 180}, {5, -9999, 7}, -1); });
+}
@@ -0,0 +1,141 @@
+#ifndef MAPPING_NO_OPENCL
+
+#include <gtest/gtest.h>
+#include "raster/opencl.h"
+#include "datatypes/raster/raster_priv.h"
+#include "util/configuration.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <unistd.h>
+
+/*
+ * These tests need an OpenCL runtime. A CPU runtime like pocl is enough, global.opencl.forcecpu is set.
+ */
+
+static const char *copy_kernel = R"CL(
+__kernel void copykernel(__global const IN_TYPE0 *in_data, __global const RasterInfo *in_info, __global OUT_TYPE0 *out_data, __global const RasterInfo *out_info) {
+	const int gid = get_global_id(1) * out_info->size[0] + get_global_id(0);
+	if (get_global_id(0) < out_info->size[0] && get_global_id(1) < out_info->size[1])
+		out_data[gid] = in_data[gid] + 1;
+}
+)CL";
+
+// variants differ only in a comment, so each is a program of its own
+static void runCopyKernel(int variant = 0) {
+	DataDescription dd(GDT_Float32, Unit::unknown());
+	SpatioTemporalReference stref(SpatialReference(CrsId::unreferenced(), 0, 0, 4, 4), TemporalReference::unreferenced());
+	auto in = GenericRaster::create(dd, stref, 4, 4, 0, GenericRaster::Representation::CPU);
+	auto out = GenericRaster::create(dd, stref, 4, 4, 0, GenericRaster::Representation::OPENCL);
+	dynamic_cast<Raster2D<float> *>(in.get())->set(1, 2, 41);
+
+	RasterOpenCL::CLProgram prog;
+	prog.addInRaster(in.get());
+	prog.addOutRaster(out.get());
+	prog.compile("// variant " + std::to_string(variant) + "\n" + copy_kernel, "copykernel");
+	prog.run();
+
+	out->setRepresentation(GenericRaster::Representation::CPU);
+	EXPECT_EQ(dynamic_cast<Raster2D<float> *>(out.get())->get(1, 2), 42);
+}
+
+static size_t countBinaries(const std::string &directory) {
+	size_t count = 0;
+	for (boost::filesystem::recursive_directory_iterator it(directory), end; it != end; ++it) {
+		if (it->path().extension() == ".bin") {
+			EXPECT_EQ(it->path().filename().string().find("copykernel-"), 0);
+			count++;
+		}
+	}
+	return count;
+}
+
+class OpenCLProgramCache : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			directory = "opencl_program_cache_test_" + std::to_string(getpid());
+			configure("[]");
+		}
+		void TearDown() override {
+			RasterOpenCL::free();
+			boost::filesystem::remove_all(directory);
+		}
+		void configure(const std::string &warmup, size_t size = 0) {
+			Configuration::loadFromString("[global.opencl]\nforcecpu=true\n[global.opencl.programcache]\ndirectory=\"" + directory
+					+ "\"\nwarmup=" + warmup + "\nsize=" + std::to_string(size) + "\n");
+			RasterOpenCL::free();
+			RasterOpenCL::init();
+		}
+		std::string directory;
+};
+
+TEST_F(OpenCLProgramCache, keepsProgramsInMemory) {
+	runCopyKernel();
+	runCopyKernel();
+	auto statistics = RasterOpenCL::getProgramCacheStatistics();
+	EXPECT_EQ(statistics.builds, 1);
+	EXPECT_EQ(statistics.memory_hits, 1);
+	EXPECT_EQ(countBinaries(directory), 1);
+}
+
+TEST_F(OpenCLProgramCache, loadsBinariesInFreshProcesses) {
+	runCopyKernel();
+
+	// free() drops everything a process knows about its programs
+	configure("[]");
+	runCopyKernel();
+	auto statistics = RasterOpenCL::getProgramCacheStatistics();
+	EXPECT_EQ(statistics.builds, 0);
+	EXPECT_EQ(statistics.disk_hits, 1);
+}
+
+TEST_F(OpenCLProgramCache, warmsUpListedKernels) {
+	runCopyKernel();
+
+	configure("[\"otherkernel\"]");
+	runCopyKernel();
+	EXPECT_EQ(RasterOpenCL::getProgramCacheStatistics().disk_hits, 1);
+
+	configure("[\"copykernel\"]");
+	runCopyKernel();
+	auto statistics = RasterOpenCL::getProgramCacheStatistics();
+	EXPECT_EQ(statistics.memory_hits, 1);
+	EXPECT_EQ(statistics.disk_hits, 0);
+	EXPECT_EQ(statistics.builds, 0);
+}
+
+TEST_F(OpenCLProgramCache, rebuildsBrokenBinaries) {
+	runCopyKernel();
+	for (boost::filesystem::recursive_directory_iterator it(directory), end; it != end; ++it) {
+		if (it->path().extension() == ".bin")
+			std::ofstream(it->path().string(), std::ios::trunc) << "garbage";
+	}
+
+	configure("[]");
+	runCopyKernel();
+	EXPECT_EQ(RasterOpenCL::getProgramCacheStatistics().builds, 1);
+	EXPECT_EQ(countBinaries(directory), 1);
+}
+
+TEST_F(OpenCLProgramCache, removesLeastRecentlyUsedBinaries) {
+	runCopyKernel(1);
+	runCopyKernel(2);
+	EXPECT_EQ(countBinaries(directory), 2);
+
+	// a limit of one byte keeps only the binary stored last
+	configure("[]", 1);
+	runCopyKernel(3);
+	EXPECT_EQ(countBinaries(directory), 1);
+	runCopyKernel(3);
+	EXPECT_EQ(RasterOpenCL::getProgramCacheStatistics().memory_hits, 1);
+
+	configure("[]", 1);
+	runCopyKernel(3);
+	runCopyKernel(1);
+	auto statistics = RasterOpenCL::getProgramCacheStatistics();
+	EXPECT_EQ(statistics.builds, 1);
+	EXPECT_EQ(statistics.disk_hits, 1);
+	EXPECT_EQ(countBinaries(directory), 1);
+}
+
+#endif
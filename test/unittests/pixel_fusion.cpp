@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include "operators/pixel_operator.h"
+#include "operators/queryprofiler.h"
+#include "operators/querytools.h"
+#include "cache/manager.h"
+#include "util/configuration.h"
+
+#include <json/json.h>
+
+
+// a polygon with a hole, rasterized to a byte raster which is no data outside of the polygon
+static const char *source_json = R"json({
+	"type": "rasterize_polygon",
+	"sources": {
+		"polygons": [{
+			"type": "wkt_source",
+			"params": {"type": "polygons", "wkt": "GEOMETRYCOLLECTION(POLYGON((35 10, 45 45, 15 40, 10 20, 35 10),(20 30, 35 35, 30 20, 20 30)))"}
+		}]
+	}
+})json";
+
+static Json::Value pixelOperator(const std::string &type, const Json::Value &params, const Json::Value &source) {
+	Json::Value json(Json::objectValue);
+	json["type"] = type;
+	json["params"] = params;
+	json["sources"]["raster"].append(source);
+	return json;
+}
+
+static Json::Value rasterSource() {
+	Json::Reader reader;
+	Json::Value source;
+	reader.parse(source_json, source);
+	return source;
+}
+
+// expression -> classification -> expression on a single source
+static Json::Value chain() {
+	Json::Value scale;
+	scale["expression"] = "A * 3";
+	scale["datatype"] = "Float32";
+
+	Json::Value classify;
+	classify["RemapRange"] = Json::Value(Json::arrayValue);
+	Json::Value low(Json::arrayValue);
+	low.append(0); low.append(2); low.append(5);
+	classify["RemapRange"].append(low);
+	Json::Value high(Json::arrayValue);
+	high.append(2); high.append(10); high.append(7);
+	classify["RemapRange"].append(high);
+
+	Json::Value offset;
+	offset["expression"] = "A + 1";
+
+	return pixelOperator("expression", offset, pixelOperator("classification", classify, pixelOperator("expression", scale, rasterSource())));
+}
+
+/*
+ * Loading [operators.fusion] replaces the whole [operators] table of the global configuration,
+ * so the previous table is put back after each test.
+ */
+class PixelFusion : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			auto table = Configuration::getTomlTable();
+			if (table->contains("operators"))
+				operators = table->get("operators");
+		}
+
+		void TearDown() override {
+			auto table = Configuration::getTomlTable();
+			if (operators)
+				table->insert("operators", operators);
+			else
+				table->erase("operators");
+		}
+
+		std::unique_ptr<GenericOperator> build(bool fusion) {
+			Configuration::loadFromString(std::string("[operators.fusion]\nenabled=") + (fusion ? "true" : "false") + "\n");
+			Json::Value json = chain();
+			return GenericOperator::fromJSON(json);
+		}
+
+		std::shared_ptr<cpptoml::base> operators;
+};
+
+TEST_F(PixelFusion, fusesChainWithSameSemanticId) {
+	auto unfused = build(false);
+	EXPECT_EQ(dynamic_cast<FusedPixelOperator *>(unfused.get()), nullptr);
+
+	auto fused = build(true);
+#ifdef MAPPING_NO_OPENCL
+	EXPECT_EQ(dynamic_cast<FusedPixelOperator *>(fused.get()), nullptr);
+#else
+	auto fused_operator = dynamic_cast<FusedPixelOperator *>(fused.get());
+	ASSERT_NE(fused_operator, nullptr);
+	EXPECT_EQ(fused_operator->getStageCount(), 3);
+#endif
+	EXPECT_EQ(fused->getSemanticId(), unfused->getSemanticId());
+}
+
+#ifndef MAPPING_NO_OPENCL
+TEST_F(PixelFusion, fusedResultMatchesUnfused) {
+	NopCacheManager cache_manager;
+	CacheManager::init(&cache_manager);
+
+	QueryRectangle rect(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 50, 50),
+		TemporalReference::unreferenced(),
+		QueryResolution::pixels(100, 100)
+	);
+
+	QueryProfiler unfused_profiler, fused_profiler;
+	auto unfused = build(false)->getCachedRaster(rect, QueryTools(unfused_profiler));
+	auto fused = build(true)->getCachedRaster(rect, QueryTools(fused_profiler));
+	CacheManager::init(nullptr);
+
+	unfused->setRepresentation(GenericRaster::Representation::CPU);
+	fused->setRepresentation(GenericRaster::Representation::CPU);
+
+	ASSERT_EQ(fused->dd.datatype, unfused->dd.datatype);
+	ASSERT_EQ(fused->dd.has_no_data, unfused->dd.has_no_data);
+	ASSERT_EQ(fused->width, unfused->width);
+	ASSERT_EQ(fused->height, unfused->height);
+
+	// the raster must contain both values and no data to be meaningful
+	size_t nodata_count = 0;
+	for (uint32_t y = 0; y < unfused->height; y++) {
+		for (uint32_t x = 0; x < unfused->width; x++) {
+			double value = unfused->getAsDouble(x, y);
+			if (unfused->dd.is_no_data(value))
+				nodata_count++;
+			ASSERT_EQ(fused->getAsDouble(x, y), value) << "at pixel " << x << ", " << y;
+		}
+	}
+	EXPECT_GT(nodata_count, 0u);
+	EXPECT_LT(nodata_count, (size_t) unfused->width * unfused->height);
+}
+#endif
+
+TEST_F(PixelFusion, keepsOperatorsWithSeveralSources) {
+	Configuration::loadFromString("[operators.fusion]\nenabled=true\n");
+
+	Json::Value params;
+	params["expression"] = "A + B";
+	Json::Value json = pixelOperator("expression", params, rasterSource());
+	json["sources"]["raster"].append(rasterSource());
+
+	auto op = GenericOperator::fromJSON(json);
+	EXPECT_EQ(dynamic_cast<FusedPixelOperator *>(op.get()), nullptr);
+	EXPECT_EQ(op->getType(), "expression");
+}
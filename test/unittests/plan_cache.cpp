@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "operators/plan_cache.h"
+#include "util/configuration.h"
+
+
+static const char *workflow = R"json({"type": "wkt_source", "params": {"type": "points", "wkt": "GEOMETRYCOLLECTION(POINT(1 1))"}})json";
+// the same workflow with other whitespace and key order
+static const char *reordered_workflow = R"json({ "params": { "wkt": "GEOMETRYCOLLECTION(POINT(1 1))", "type": "points" },
+	"type": "wkt_source" })json";
+static const char *other_workflow = R"json({"type": "wkt_source", "params": {"type": "points", "wkt": "GEOMETRYCOLLECTION(POINT(2 2))"}})json";
+
+static void configure(size_t size) {
+	Configuration::loadFromString("[operators.plancache]\nsize=" + std::to_string(size) + "\n");
+	OperatorPlanCache::clear();
+}
+
+TEST(OperatorPlanCache, reusesTreesOfEquivalentWorkflows) {
+	configure(4);
+	GenericOperator *first = nullptr;
+	{
+		auto op = OperatorPlanCache::get(workflow);
+		first = op.get();
+	}
+	auto op = OperatorPlanCache::get(reordered_workflow);
+	EXPECT_EQ(op.get(), first);
+	EXPECT_EQ(op->getSemanticDigest(), SemanticDigest(op->getSemanticId()));
+
+	auto statistics = OperatorPlanCache::getStatistics();
+	EXPECT_EQ(statistics.hits, 1);
+	EXPECT_EQ(statistics.misses, 1);
+
+	auto other = OperatorPlanCache::get(other_workflow);
+	EXPECT_NE(other->getSemanticId(), op->getSemanticId());
+	EXPECT_EQ(OperatorPlanCache::getStatistics().misses, 2);
+}
+
+TEST(OperatorPlanCache, lendsTreesExclusively) {
+	configure(4);
+	{
+		auto a = OperatorPlanCache::get(workflow);
+		auto b = OperatorPlanCache::get(workflow);
+		EXPECT_NE(a.get(), b.get());
+		EXPECT_EQ(a->getSemanticId(), b->getSemanticId());
+	}
+	// both trees were kept
+	auto a = OperatorPlanCache::get(workflow);
+	auto b = OperatorPlanCache::get(workflow);
+	auto statistics = OperatorPlanCache::getStatistics();
+	EXPECT_EQ(statistics.hits, 2);
+	EXPECT_EQ(statistics.misses, 2);
+}
+
+TEST(OperatorPlanCache, evictsLeastRecentlyUsedTrees) {
+	configure(1);
+	OperatorPlanCache::get(workflow);
+	OperatorPlanCache::get(other_workflow);
+
+	// only the tree of the last workflow is left
+	OperatorPlanCache::get(other_workflow);
+	OperatorPlanCache::get(workflow);
+	auto statistics = OperatorPlanCache::getStatistics();
+	EXPECT_EQ(statistics.hits, 1);
+	EXPECT_EQ(statistics.misses, 3);
+}
+
+TEST(OperatorPlanCache, disabled) {
+	configure(0);
+	OperatorPlanCache::get(workflow);
+	OperatorPlanCache::get(workflow);
+	EXPECT_EQ(OperatorPlanCache::getStatistics().hits, 0);
+
+	EXPECT_THROW(OperatorPlanCache::get("{\"type\": "), OperatorException);
+}
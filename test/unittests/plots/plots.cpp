@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 #include "datatypes/plots/histogram.h"
+#include "datatypes/plots/raster_summary.h"
+#include "datatypes/raster/raster_priv.h"
+
+#include <cmath>
 
 TEST(Plots, HistogramSerialization) {
 	Histogram histogram(10, 0.0, 1.0);
@@ -23,3 +27,112 @@ TEST(Plots, HistogramSerialization) {
 
 	EXPECT_EQ(histogram.toJSON(), hist->toJSON());
 }
+
+// a raster with one row of values, -1 is no data
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type, const std::vector<T> &values, const Unit &unit = Unit::unknown()) {
+	DataDescription dd(type, unit, true, -1);
+	SpatioTemporalReference stref(SpatialReference(CrsId::unreferenced(), 0, 0, values.size(), 1), TemporalReference::unreferenced());
+	auto raster = GenericRaster::create(dd, stref, values.size(), 1, 1, GenericRaster::Representation::CPU);
+	auto typed = dynamic_cast<Raster2D<T> *>(raster.get());
+	for (size_t i = 0; i < values.size(); i++)
+		typed->set(i, 0, values[i]);
+	return raster;
+}
+
+TEST(Plots, RasterSummaryMergeEqualsWhole) {
+	std::vector<int16_t> values;
+	RasterSummary merged;
+	for (int tile = 0; tile < 4; tile++) {
+		std::vector<int16_t> tile_values;
+		for (int i = 0; i < 500; i++)
+			tile_values.push_back((int16_t) ((i * 37 + tile * 1013) % 3000 - 500));
+		values.insert(values.end(), tile_values.begin(), tile_values.end());
+		merged.merge(RasterSummary(*createRaster<int16_t>(GDT_Int16, tile_values)));
+	}
+	RasterSummary whole(*createRaster<int16_t>(GDT_Int16, values));
+
+	EXPECT_EQ(merged.getCount(), whole.getCount());
+	EXPECT_EQ(merged.getNoDataCount(), whole.getNoDataCount());
+	EXPECT_EQ(merged.getMin(), whole.getMin());
+	EXPECT_EQ(merged.getMax(), whole.getMax());
+	EXPECT_NEAR(merged.getMean(), whole.getMean(), 1e-9);
+	EXPECT_NEAR(merged.getStdDev(), whole.getStdDev(), 1e-9);
+
+	// integers are bucketed exactly
+	Histogram expected(17, whole.getMin(), whole.getMax());
+	for (auto value : values) {
+		if (value == -1)
+			expected.incNoData();
+		else
+			expected.inc(value);
+	}
+	EXPECT_EQ(merged.toHistogram(17, whole.getMin(), whole.getMax())->toJSON(), expected.toJSON());
+}
+
+TEST(Plots, RasterSummaryWideIntegerRange) {
+	RasterSummary narrow(*createRaster<int32_t>(GDT_Int32, {0, 17, (int32_t) RasterSummary::MAX_BINS - 1}));
+	EXPECT_TRUE(narrow.isIntegral());
+	EXPECT_TRUE(narrow.isExact());
+
+	// neighbouring values share a bin
+	RasterSummary wide(*createRaster<int32_t>(GDT_Int32, {0, 17, 100000}));
+	EXPECT_TRUE(wide.isIntegral());
+	EXPECT_FALSE(wide.isExact());
+
+	narrow.merge(wide);
+	EXPECT_FALSE(narrow.isExact());
+}
+
+TEST(Plots, RasterSummaryStaysExact) {
+	// the data type alone allows more values than the summary can keep, however narrow the values are
+	RasterSummary uint16(*createRaster<uint16_t>(GDT_UInt16, {0, 17, 1000}));
+	EXPECT_TRUE(uint16.isExact());
+	EXPECT_FALSE(uint16.staysExact());
+
+	RasterSummary byte(*createRaster<uint8_t>(GDT_Byte, {0, 17, 200}));
+	EXPECT_TRUE(byte.staysExact());
+
+	// the unit can narrow the data type
+	Unit unit("elevation", "m");
+	unit.setMinMax(0, 1000);
+	RasterSummary bounded(*createRaster<uint16_t>(GDT_UInt16, {0, 17, 1000}, unit));
+	EXPECT_TRUE(bounded.staysExact());
+	bounded.merge(byte);
+	EXPECT_TRUE(bounded.staysExact());
+	bounded.merge(uint16);
+	EXPECT_FALSE(bounded.staysExact());
+
+	RasterSummary floats(*createRaster<float>(GDT_Float32, {0.5f}));
+	EXPECT_FALSE(floats.staysExact());
+}
+
+TEST(Plots, RasterSummaryFloatResolution) {
+	std::vector<float> values;
+	for (int i = 0; i < 10000; i++)
+		values.push_back(250.0f + i * 0.01f);
+	RasterSummary summary(*createRaster<float>(GDT_Float32, values));
+
+	EXPECT_EQ(summary.getCount(), values.size());
+	EXPECT_FLOAT_EQ(summary.getMin(), 250.0f);
+	EXPECT_FLOAT_EQ(summary.getMax(), values.back());
+	// the bins are at most twice as wide as range / MAX_BINS
+	EXPECT_NEAR(summary.getQuantile(0.5), 300, 2 * 100.0 / RasterSummary::MAX_BINS);
+}
+
+TEST(Plots, RasterSummarySerialization) {
+	RasterSummary summary(*createRaster<float>(GDT_Float32, {1.5f, -1.0f, 2.5f, 100.0f}));
+	EXPECT_EQ(summary.getCount(), 3u);
+	EXPECT_EQ(summary.getNoDataCount(), 1u);
+
+	auto stream = BinaryStream::makePipe();
+	BinaryWriteBuffer wb;
+	wb.write(summary);
+	stream.write(wb);
+
+	BinaryReadBuffer rb;
+	stream.read(rb);
+	std::unique_ptr<GenericPlot> copy = GenericPlot::deserialize(rb);
+
+	EXPECT_EQ(summary.toJSON(), copy->toJSON());
+}
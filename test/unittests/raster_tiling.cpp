@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "operators/raster_tiling.h"
+#include "datatypes/raster/raster_priv.h"
+
+#include <vector>
+
+
+static QueryRectangle query(uint32_t width, uint32_t height) {
+	return QueryRectangle(
+		SpatialReference(CrsId::unreferenced(), 10, 20, 10 + 0.5 * width, 20 + 0.25 * height),
+		TemporalReference::unreferenced(),
+		QueryResolution::pixels(width, height)
+	);
+}
+
+TEST(RasterTiling, tilesCoverQueryOnce) {
+	auto rect = query(1000, 515);
+	RasterTiling tiling(rect, 256);
+	ASSERT_EQ(tiling.getTileCount(), 4 * 3);
+
+	std::vector<int> covered(rect.xres * rect.yres, 0);
+	for (size_t i = 0; i < tiling.getTileCount(); i++) {
+		auto tile = tiling.getTile(i);
+		EXPECT_LE(tile.rect.xres, 256);
+		EXPECT_LE(tile.rect.yres, 256);
+
+		// the tile lies on the pixel grid of the query
+		EXPECT_DOUBLE_EQ(tile.rect.x1, rect.x1 + tile.x * 0.5);
+		EXPECT_DOUBLE_EQ(tile.rect.y1, rect.y1 + tile.y * 0.25);
+		EXPECT_DOUBLE_EQ(tile.rect.x2, rect.x1 + (tile.x + tile.rect.xres) * 0.5);
+		EXPECT_DOUBLE_EQ(tile.rect.y2, rect.y1 + (tile.y + tile.rect.yres) * 0.25);
+
+		for (uint32_t y = tile.y; y < tile.y + tile.rect.yres; y++)
+			for (uint32_t x = tile.x; x < tile.x + tile.rect.xres; x++)
+				covered[y * rect.xres + x]++;
+	}
+	for (auto count : covered)
+		EXPECT_EQ(count, 1);
+
+	auto last = tiling.getTile(tiling.getTileCount() - 1);
+	EXPECT_EQ(last.rect.x2, rect.x2);
+	EXPECT_EQ(last.rect.y2, rect.y2);
+}
+
+TEST(RasterTiling, rejectsInvalidQueries) {
+	QueryRectangle rect(SpatialReference(CrsId::unreferenced(), 0, 0, 1, 1), TemporalReference::unreferenced(), QueryResolution::none());
+	EXPECT_THROW(RasterTiling(rect, 256), ArgumentException);
+	EXPECT_THROW(RasterTiling(query(10, 10), 0), ArgumentException);
+	EXPECT_THROW(RasterTiling(query(10, 10), 4).getTile(9), ArgumentException);
+}
+
+TEST(RasterTiling, cutTilesMatchRaster) {
+	auto rect = query(13, 9);
+	DataDescription dd(GDT_Int32, Unit::unknown());
+	auto raster = GenericRaster::create(dd, SpatioTemporalReference(rect, rect), rect.xres, rect.yres, 0, GenericRaster::Representation::CPU);
+	auto typed = dynamic_cast<Raster2D<int32_t> *>(raster.get());
+	for (uint32_t y = 0; y < rect.yres; y++)
+		for (uint32_t x = 0; x < rect.xres; x++)
+			typed->set(x, y, y * 100 + x);
+
+	RasterTiling tiling(rect, 4);
+	for (size_t i = 0; i < tiling.getTileCount(); i++) {
+		auto tile = tiling.getTile(i);
+		auto cut = raster->cut(tile.x, tile.y, tile.rect.xres, tile.rect.yres);
+		EXPECT_DOUBLE_EQ(cut->stref.x1, tile.rect.x1);
+		EXPECT_DOUBLE_EQ(cut->stref.y1, tile.rect.y1);
+		EXPECT_DOUBLE_EQ(cut->stref.x2, tile.rect.x2);
+		EXPECT_DOUBLE_EQ(cut->stref.y2, tile.rect.y2);
+		for (uint32_t y = 0; y < tile.rect.yres; y++)
+			for (uint32_t x = 0; x < tile.rect.xres; x++)
+				EXPECT_EQ(cut->getAsDouble(x, y), (tile.y + y) * 100 + tile.x + x);
+	}
+}
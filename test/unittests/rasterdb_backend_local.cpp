@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "rasterdb/backend.h"
+#include "util/configuration.h"
+
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+
+class LocalRasterDBBackendTest : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			location = (boost::filesystem::temp_directory_path() / ("rasterdb_test_" + std::to_string(getpid()))).string() + "/";
+			boost::filesystem::create_directories(location);
+			std::ofstream(location + "source.json") << "{}";
+			Configuration::loadFromString("[rasterdb.local]\nlocation=\"" + location + "\"\n");
+		}
+		void TearDown() override {
+			boost::filesystem::remove_all(location);
+		}
+		std::unique_ptr<RasterDBBackend> open(bool writeable) {
+			auto backend = RasterDBBackend::create("local", location, Configuration::getSubTable("rasterdb.local"));
+			backend->open("source", writeable);
+			return backend;
+		}
+		static std::unique_ptr<ByteBuffer> bytes(char c, size_t size) {
+			auto buffer = make_unique<ByteBuffer>(size);
+			memset(buffer->data, c, size);
+			return buffer;
+		}
+		std::string location;
+};
+
+TEST_F(LocalRasterDBBackendTest, writesTilesInBatches) {
+	{
+		auto backend = open(true);
+		auto rasterid = backend->createRaster(0, 10, 20, AttributeMaps());
+
+		std::vector<RasterDBBackend::TileData> tiles;
+		tiles.emplace_back(bytes('a', 100), 1024, 1024, 0, 0, 0, 0, 0);
+		tiles.emplace_back(bytes('b', 200), 976, 1024, 0, 1024, 0, 0, 0);
+		tiles.emplace_back(bytes('c', 300), 1000, 512, 0, 0, 0, 0, 1);
+		backend->writeTiles(rasterid, tiles, "raw");
+
+		// tiles of earlier imports are skipped
+		std::vector<RasterDBBackend::TileData> more_tiles;
+		more_tiles.emplace_back(bytes('x', 100), 1024, 1024, 0, 0, 0, 0, 0);
+		more_tiles.emplace_back(bytes('d', 400), 1024, 1024, 0, 0, 1024, 0, 0);
+		backend->writeTiles(rasterid, more_tiles, "raw");
+	}
+
+	auto backend = open(false);
+	auto raster = backend->getClosestRaster(0, 15, 15);
+	EXPECT_EQ(backend->getBestZoom(raster.rasterid, 3), 1);
+
+	auto tiles = backend->enumerateTiles(0, raster.rasterid, 0, 0, 4096, 4096, 0);
+	ASSERT_EQ(tiles.size(), 3);
+	// the data of all tiles is appended in the order they were written
+	std::string expected_data = "abd";
+	std::vector<size_t> expected_offsets {0, 100, 600};
+	for (size_t i = 0; i < tiles.size(); i++) {
+		EXPECT_EQ(tiles[i].offset, expected_offsets[i]);
+		auto data = backend->readTile(tiles[i]);
+		EXPECT_EQ(data->data[0], expected_data[i]);
+		EXPECT_EQ(data->data[data->size - 1], expected_data[i]);
+	}
+	EXPECT_EQ(tiles[1].width, 976);
+
+	tiles = backend->enumerateTiles(0, raster.rasterid, 0, 0, 4096, 4096, 1);
+	ASSERT_EQ(tiles.size(), 1);
+	EXPECT_EQ(tiles[0].width, 1000);
+	EXPECT_EQ(tiles[0].height, 512);
+	EXPECT_EQ(tiles[0].size, 300);
+}
+
+TEST_F(LocalRasterDBBackendTest, dropsIndexesOfOtherSources) {
+	Configuration::loadFromString("[rasterdb.local]\nlocation=\"" + location + "\"\nindex_size=1\n");
+	std::ofstream(location + "other.json") << "{}";
+
+	for (auto sourcename : {"source", "other"}) {
+		auto backend = RasterDBBackend::create("local", location, Configuration::getSubTable("rasterdb.local"));
+		backend->open(sourcename, true);
+		auto rasterid = backend->createRaster(0, 10, 20, AttributeMaps());
+		std::vector<RasterDBBackend::TileData> tiles;
+		tiles.emplace_back(bytes(sourcename[0], 100), 1024, 1024, 0, 0, 0, 0, 0);
+		backend->writeTiles(rasterid, tiles, "raw");
+	}
+
+	// each source evicts the index of the other one, which is rebuilt when it is opened again
+	for (int i = 0; i < 2; i++) {
+		for (auto sourcename : {"source", "other"}) {
+			auto backend = RasterDBBackend::create("local", location, Configuration::getSubTable("rasterdb.local"));
+			backend->open(sourcename, false);
+			auto raster = backend->getClosestRaster(0, 15, 15);
+			auto tiles = backend->enumerateTiles(0, raster.rasterid, 0, 0, 4096, 4096, 0);
+			ASSERT_EQ(tiles.size(), 1);
+			EXPECT_EQ(backend->readTile(tiles[0])->data[0], sourcename[0]);
+		}
+	}
+}
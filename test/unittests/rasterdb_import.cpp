@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "rasterdb/rasterdb.h"
+#include "datatypes/raster.h"
+#include "operators/queryprofiler.h"
+#include "operators/queryrectangle.h"
+#include "util/configuration.h"
+#include "util/exceptions.h"
+#include "util/gdal.h"
+
+#include <gdal_priv.h>
+#include <json/json.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <unistd.h>
+
+
+/*
+ * Imports small GeoTIFFs with constant values into a local source. File i holds the value 10 * (i+1) and is
+ * imported for the time [10 * i, 10 * i + 10).
+ */
+class RasterDBImport : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			location = (boost::filesystem::temp_directory_path() / ("rasterdb_import_test_" + std::to_string(getpid()))).string() + "/";
+			boost::filesystem::create_directories(location);
+			Configuration::loadFromString("[rasterdb]\nbackend=\"local\"\n[rasterdb.local]\nlocation=\"" + location + "\"\n");
+		}
+		void TearDown() override {
+			boost::filesystem::remove_all(location);
+		}
+
+		std::vector<RasterDB::ImportFile> createFiles(const std::string &sourcename, size_t count) {
+			GDAL::init();
+			auto driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+			std::vector<RasterDB::ImportFile> files;
+			for (size_t i = 0; i < count; i++) {
+				std::string filename = location + sourcename + "_" + std::to_string(i) + ".tif";
+				auto dataset = driver->Create(filename.c_str(), 64, 32, 1, GDT_Byte, nullptr);
+				double transform[6] = {0, 1, 0, 32, 0, -1};
+				dataset->SetGeoTransform(transform);
+				dataset->SetProjection("GEOGCS[\"WGS 84\",DATUM[\"WGS_1984\",SPHEROID[\"WGS 84\",6378137,298.257223563]],PRIMEM[\"Greenwich\",0],UNIT[\"degree\",0.0174532925199433],AUTHORITY[\"EPSG\",\"4326\"]]");
+				dataset->GetRasterBand(1)->Fill(value(i));
+				GDALClose(dataset);
+				files.push_back(RasterDB::ImportFile{filename, 1, 0, 10.0 * i, 10.0 * i + 10});
+			}
+
+			// the source uses the coordinates of the first file, like mapping_manager createsource
+			auto raster = GenericRaster::fromGDAL(files[0].filename.c_str(), 1, CrsId::from_epsg_code(4326));
+			GDALCRS crs(*raster);
+			Json::Value root(Json::objectValue);
+			for (int d = 0; d < crs.dimensions; d++) {
+				root["coords"]["size"][d] = crs.size[d];
+				root["coords"]["origin"][d] = crs.origin[d];
+				root["coords"]["scale"][d] = crs.scale[d];
+			}
+			root["coords"]["crs"] = crs.crsId.to_string();
+			root["channels"][0]["datatype"] = "Byte";
+			std::ofstream(location + sourcename + ".json") << Json::FastWriter().write(root);
+			return files;
+		}
+
+		static double value(size_t i) {
+			return 10.0 * (i + 1);
+		}
+
+		static void expectImported(const std::string &sourcename, size_t i) {
+			auto db = RasterDB::open(sourcename.c_str(), RasterDB::READ_ONLY);
+			QueryRectangle rect(
+				SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 64, 32),
+				TemporalReference(TIMETYPE_UNIX, 10.0 * i + 1, 10.0 * i + 2),
+				QueryResolution::pixels(64, 32)
+			);
+			QueryProfiler profiler;
+			auto raster = db->query(rect, profiler, 0);
+			raster->setRepresentation(GenericRaster::Representation::CPU);
+			EXPECT_EQ(raster->getAsDouble(0, 0), value(i)) << "file " << i;
+			EXPECT_EQ(raster->getAsDouble(63, 31), value(i)) << "file " << i;
+		}
+
+		std::string location;
+};
+
+TEST_F(RasterDBImport, importsFilesOnSeveralThreads) {
+	auto files = createFiles("threaded", 12);
+	{
+		auto db = RasterDB::open("threaded", RasterDB::READ_WRITE);
+		db->import(files, "GZIP", 4);
+	}
+	for (size_t i = 0; i < files.size(); i++)
+		expectImported("threaded", i);
+}
+
+TEST_F(RasterDBImport, abortsWhenTheWriterFails) {
+	auto files = createFiles("unwritable", 20);
+	// the tiles are appended to <source>.dat, which cannot be opened as a file
+	boost::filesystem::create_directories(location + "unwritable.dat");
+
+	auto db = RasterDB::open("unwritable", RasterDB::READ_WRITE);
+	// the readers are blocked on the full queue and must give up, or this never returns
+	EXPECT_THROW(db->import(files, "GZIP", 2), SourceException);
+}
+
+TEST_F(RasterDBImport, rethrowsErrorsOfTheReaders) {
+	auto files = createFiles("missing", 4);
+	files[2].filename = location + "does_not_exist.tif";
+	{
+		auto db = RasterDB::open("missing", RasterDB::READ_WRITE);
+		EXPECT_THROW(db->import(files, "GZIP", 1), ImporterException);
+	}
+
+	// on a single thread, the files before the missing one were read and written
+	expectImported("missing", 0);
+	expectImported("missing", 1);
+}
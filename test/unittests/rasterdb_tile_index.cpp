@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "rasterdb/tile_index.h"
+
+#include <algorithm>
+#include <random>
+
+
+using TileDescription = RasterDBBackend::TileDescription;
+using RasterDescription = RasterDBBackend::RasterDescription;
+
+static std::vector<RasterDBBackend::tileid_t> ids(const std::vector<TileDescription> &tiles) {
+	std::vector<RasterDBBackend::tileid_t> result;
+	for (auto &tile : tiles)
+		result.push_back(tile.tileid);
+	return result;
+}
+
+TEST(RasterDBTileIndex, enumeratesOverlappingTiles) {
+	const uint32_t tilesize = 1024;
+	RasterDBTileIndex index;
+	index.addRaster(0, RasterDescription{1, 0, 10});
+
+	// a grid of 37x23 tiles for each zoom level, written in random order
+	std::vector<std::vector<TileDescription>> tiles_by_zoom(3);
+	std::mt19937 rng(42);
+	size_t tilecount = 0;
+	for (int zoom = 0; zoom < 3; zoom++) {
+		uint32_t zoomfactor = 1 << zoom;
+		auto &tiles = tiles_by_zoom[zoom];
+		for (uint32_t y = 0; y < 23 * tilesize; y += tilesize * zoomfactor) {
+			for (uint32_t x = 0; x < 37 * tilesize; x += tilesize * zoomfactor) {
+				auto width = std::min(tilesize, (37 * tilesize - x) / zoomfactor);
+				auto height = std::min(tilesize, (23 * tilesize - y) / zoomfactor);
+				tiles.push_back(TileDescription{0, 0, 0, 0, 100, x, y, 0, width, height, 0, "raw"});
+			}
+		}
+		std::shuffle(tiles.begin(), tiles.end(), rng);
+		for (auto &tile : tiles) {
+			tilecount++;
+			tile.tileid = tilecount;
+			tile.offset = tilecount * 100;
+			index.addTile(1, zoom, tile, tile.x1 + tile.width * zoomfactor, tile.y1 + tile.height * zoomfactor);
+		}
+	}
+	index.build();
+	EXPECT_EQ(index.getTileCount(), tilecount);
+
+	std::uniform_int_distribution<int> coordinate(-2000, 40 * tilesize);
+	for (int i = 0; i < 500; i++) {
+		int x1 = coordinate(rng), x2 = coordinate(rng), y1 = coordinate(rng), y2 = coordinate(rng);
+		int zoom = i % 3;
+		uint32_t zoomfactor = 1 << zoom;
+
+		// the tiles were added in the order of their offsets
+		std::vector<TileDescription> expected;
+		for (auto &tile : tiles_by_zoom[zoom]) {
+			int64_t tile_x2 = tile.x1 + tile.width * zoomfactor, tile_y2 = tile.y1 + tile.height * zoomfactor;
+			if ((int64_t) tile.x1 < x2 && (int64_t) tile.y1 < y2 && tile_x2 > x1 && tile_y2 > y1)
+				expected.push_back(tile);
+		}
+
+		auto tiles = index.enumerateTiles(7, 1, x1, y1, x2, y2, zoom);
+		EXPECT_EQ(ids(tiles), ids(expected));
+		for (auto &tile : tiles)
+			EXPECT_EQ(tile.channelid, 7);
+	}
+
+	EXPECT_TRUE(index.enumerateTiles(0, 1, 0, 0, 100, 100, 5).empty());
+	EXPECT_TRUE(index.enumerateTiles(0, 2, 0, 0, 100, 100, 0).empty());
+}
+
+TEST(RasterDBTileIndex, findsClosestRaster) {
+	RasterDBTileIndex index;
+	index.addRaster(0, RasterDescription{3, 20, 30});
+	index.addRaster(0, RasterDescription{1, 0, 10});
+	// a long raster which overlaps the others
+	index.addRaster(0, RasterDescription{2, 5, 100});
+	index.addRaster(1, RasterDescription{4, 0, 1000});
+	index.build();
+
+	auto id = [&] (int channel, double t1, double t2) {
+		auto raster = index.getClosestRaster(channel, t1, t2);
+		return raster ? raster->rasterid : -1;
+	};
+	EXPECT_EQ(id(0, 0, 0), 1);
+	EXPECT_EQ(id(0, 2, 8), 1);
+	EXPECT_EQ(id(0, 7, 8), 2);
+	EXPECT_EQ(id(0, 8, 12), 2);
+	EXPECT_EQ(id(0, 25, 25), 3);
+	EXPECT_EQ(id(0, 25, 40), 2);
+	EXPECT_EQ(id(0, 50, 50), 2);
+	EXPECT_EQ(id(0, 150, 150), -1);
+	EXPECT_EQ(id(0, -1, -1), -1);
+	EXPECT_EQ(id(1, 150, 150), 4);
+	EXPECT_EQ(id(2, 150, 150), -1);
+}
+
+TEST(RasterDBTileIndex, findsBestZoom) {
+	RasterDBTileIndex index;
+	TileDescription tile{1, 0, 0, 0, 100, 0, 0, 0, 1024, 1024, 0, "raw"};
+	index.addTile(1, 0, tile, 1024, 1024);
+	index.addTile(1, 2, tile, 4096, 4096);
+	index.addTile(2, 1, tile, 2048, 2048);
+	index.build();
+
+	EXPECT_EQ(index.getBestZoom(1, 0), 0);
+	EXPECT_EQ(index.getBestZoom(1, 1), 0);
+	EXPECT_EQ(index.getBestZoom(1, 5), 2);
+	EXPECT_EQ(index.getBestZoom(2, 0), -1);
+	EXPECT_EQ(index.getBestZoom(3, 5), -1);
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include "operators/processing/scripting/rserver_connection_pool.h"
+#include "util/configuration.h"
+#include "util/exceptions.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+/*
+ * A server on a unix socket that keeps connections open: it answers every request n with n + 1.
+ * If drop_next is set, the next request is read but the connection is closed instead of answering it,
+ * like a server that gave up on an idle connection.
+ */
+class KeepAliveServer {
+	public:
+		KeepAliveServer() : accepted(0), drop_next(false) {
+			// every server gets its own location, so connections pooled by earlier tests are not handed out
+			static std::atomic<int> servers(0);
+			path = "/tmp/rserver_connection_pool_test_" + std::to_string(getpid()) + "_" + std::to_string(servers++);
+			unlink(path.c_str());
+			listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			struct sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+			if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listen_fd, 8) != 0)
+				throw PlatformException("KeepAliveServer: could not listen on " + path);
+			acceptor = std::thread([this] { acceptConnections(); });
+		}
+
+		~KeepAliveServer() {
+			// unblocks accept() and the handlers of connections that are still in the pool
+			shutdown(listen_fd, SHUT_RDWR);
+			acceptor.join();
+			for (int fd : fds)
+				shutdown(fd, SHUT_RDWR);
+			for (auto &handler : handlers)
+				handler.join();
+			close(listen_fd);
+			unlink(path.c_str());
+		}
+
+		std::string getLocation() const { return "unix:" + path; }
+
+		std::atomic<int> accepted;
+		std::atomic<bool> drop_next;
+
+	private:
+		void acceptConnections() {
+			while (true) {
+				int fd = accept(listen_fd, nullptr, nullptr);
+				if (fd < 0)
+					return;
+				accepted++;
+				fds.push_back(fd);
+				handlers.emplace_back([this, fd] {
+					auto stream = BinaryStream::fromAcceptedSocket(fd);
+					while (true) {
+						BinaryReadBuffer request;
+						if (stream.read(request, true))
+							return;
+						auto n = request.read<int>();
+						if (drop_next.exchange(false))
+							return;
+						BinaryWriteBuffer response;
+						response.write<int>(n + 1);
+						stream.write(response);
+					}
+				});
+			}
+		}
+
+		std::string path;
+		int listen_fd;
+		std::thread acceptor;
+		std::vector<std::thread> handlers;
+		std::vector<int> fds;
+};
+
+/*
+ * Loading [operators.r] replaces the whole [operators] table of the global configuration,
+ * so the previous table is put back after each test.
+ */
+class RServerConnectionPoolTest : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			auto table = Configuration::getTomlTable();
+			if (table->contains("operators"))
+				operators = table->get("operators");
+			Configuration::loadFromString("[operators.r]\npool_size=2\n");
+		}
+
+		void TearDown() override {
+			auto table = Configuration::getTomlTable();
+			if (operators)
+				table->insert("operators", operators);
+			else
+				table->erase("operators");
+		}
+
+		static int run(const std::string &location, int n, BinaryStream *stream_out = nullptr) {
+			std::unique_ptr<BinaryReadBuffer> response;
+			auto stream = RServerConnectionPool::start(location, [n](BinaryWriteBuffer &request) {
+				request.write(n);
+			}, response);
+			int result = response->read<int>();
+			if (stream_out)
+				*stream_out = std::move(stream);
+			else
+				RServerConnectionPool::release(location, std::move(stream));
+			return result;
+		}
+
+		std::shared_ptr<cpptoml::base> operators;
+};
+
+TEST_F(RServerConnectionPoolTest, reusesConnections) {
+	KeepAliveServer server;
+	auto location = server.getLocation();
+
+	EXPECT_EQ(run(location, 1), 2);
+	EXPECT_EQ(RServerConnectionPool::getIdleCount(location), 1u);
+	EXPECT_EQ(run(location, 2), 3);
+	EXPECT_EQ(run(location, 3), 4);
+	EXPECT_EQ(server.accepted, 1);
+
+	// no more than pool_size connections are kept
+	BinaryStream first, second, third;
+	run(location, 4, &first);
+	run(location, 5, &second);
+	run(location, 6, &third);
+	EXPECT_EQ(server.accepted, 3);
+	RServerConnectionPool::release(location, std::move(first));
+	RServerConnectionPool::release(location, std::move(second));
+	RServerConnectionPool::release(location, std::move(third));
+	EXPECT_EQ(RServerConnectionPool::getIdleCount(location), 2u);
+}
+
+TEST_F(RServerConnectionPoolTest, retriesWhenTheServerClosedTheConnection) {
+	KeepAliveServer server;
+	auto location = server.getLocation();
+
+	EXPECT_EQ(run(location, 1), 2);
+	ASSERT_EQ(RServerConnectionPool::getIdleCount(location), 1u);
+
+	// the pooled connection looks idle, but fails once it is used
+	server.drop_next = true;
+	BinaryStream stream;
+	EXPECT_EQ(run(location, 10, &stream), 11);
+	EXPECT_EQ(server.accepted, 2);
+
+	// the pool is empty, and a new connection that fails is not retried
+	server.drop_next = true;
+	std::unique_ptr<BinaryReadBuffer> response;
+	EXPECT_THROW(RServerConnectionPool::start(location, [](BinaryWriteBuffer &request) { request.write<int>(20); }, response), NetworkException);
+	EXPECT_EQ(server.accepted, 3);
+}
+
+TEST_F(RServerConnectionPoolTest, detectsClosedConnections) {
+	auto pipe = BinaryStream::makePipe();
+	EXPECT_TRUE(RServerConnectionPool::isIdle(pipe));
+
+	// unread data means the connection is still in use
+	BinaryWriteBuffer buffer;
+	buffer.write<int>(42);
+	pipe.write(buffer);
+	EXPECT_FALSE(RServerConnectionPool::isIdle(pipe));
+	BinaryReadBuffer read_buffer;
+	pipe.read(read_buffer);
+	EXPECT_TRUE(RServerConnectionPool::isIdle(pipe));
+
+	KeepAliveServer server;
+	BinaryStream stream;
+	run(server.getLocation(), 1, &stream);
+	EXPECT_TRUE(RServerConnectionPool::isIdle(stream));
+
+	// a connection closed by the server is readable because of the eof
+	server.drop_next = true;
+	BinaryWriteBuffer request;
+	request.write<int>(2);
+	stream.write(request);
+	for (int i = 0; i < 100 && RServerConnectionPool::isIdle(stream); i++)
+		usleep(10000);
+	EXPECT_FALSE(RServerConnectionPool::isIdle(stream));
+}
@@ -6,6 +6,7 @@
 #include "datatypes/simplefeaturecollections/wkbutil.h"
 #include "datatypes/simplefeaturecollections/geosgeomutil.h"
 #include <vector>
+#include <sstream>
 #include <json/json.h>
 #include "util/binarystream.h"
 
@@ -281,6 +282,56 @@ TEST(PointCollection, NonSimpletoARFF) {
 	EXPECT_EQ(expected, points.toARFF());
 }
 
+TEST(PointCollection, toColumnar) {
+	auto points = createPointsWithAttributesAndTime();
+
+	std::ostringstream output;
+	points->toColumnar(output);
+
+	std::string body;
+	Json::Value header = CollectionTestUtil::parseColumnar(output.str(), body);
+	EXPECT_EQ(5, header["features"].asUInt64());
+	EXPECT_EQ("MultiPoint", header["geometry"]["type"].asString());
+
+	ASSERT_EQ(1, header["geometry"]["offsets"].size());
+	auto feature_offsets = CollectionTestUtil::readColumnarBuffer<uint32_t>(body, header["geometry"]["offsets"][0]);
+	EXPECT_EQ(points->start_feature, feature_offsets);
+
+	auto coordinates = CollectionTestUtil::readColumnarBuffer<double>(body, header["geometry"]["coordinates"]);
+	ASSERT_EQ(2 * points->coordinates.size(), coordinates.size());
+	EXPECT_EQ(8, coordinates[4]);
+	EXPECT_EQ(6, coordinates[5]);
+
+	auto time = CollectionTestUtil::readColumnarBuffer<double>(body, header["time"]);
+	EXPECT_EQ(std::vector<double>({2, 4, 4, 8, 8, 16, 16, 32, 32, 64}), time);
+
+	ASSERT_EQ(2, header["attributes"].size());
+	auto &value = header["attributes"][0];
+	EXPECT_EQ("value", value["name"].asString());
+	EXPECT_EQ(std::vector<double>({0.0, 1.1, 2.2, 3.3, 4.4}), CollectionTestUtil::readColumnarBuffer<double>(body, value));
+
+	auto &label = header["attributes"][1];
+	EXPECT_EQ("label", label["name"].asString());
+	EXPECT_EQ("utf8", label["type"].asString());
+	auto label_offsets = CollectionTestUtil::readColumnarBuffer<uint64_t>(body, label["offsets"]);
+	auto label_data = CollectionTestUtil::readColumnarBuffer<char>(body, label["data"]);
+	ASSERT_EQ(6, label_offsets.size());
+	EXPECT_EQ("l2", std::string(label_data.data() + label_offsets[2], label_offsets[3] - label_offsets[2]));
+}
+
+TEST(PointCollection, toColumnarEmptyCollection) {
+	PointCollection points(SpatioTemporalReference::unreferenced());
+
+	std::ostringstream output;
+	points.toColumnar(output);
+
+	std::string body;
+	Json::Value header = CollectionTestUtil::parseColumnar(output.str(), body);
+	EXPECT_EQ(0, header["features"].asUInt64());
+	EXPECT_EQ(0, header["time"]["length"].asUInt64());
+	EXPECT_EQ(0, header["geometry"]["coordinates"]["length"].asUInt64());
+}
+
 TEST(PointCollection, filter) {
 	PointCollection points(SpatioTemporalReference::unreferenced());
 	auto &test = points.feature_attributes.addNumericAttribute("test", Unit::unknown());
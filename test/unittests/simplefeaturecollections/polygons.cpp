@@ -6,6 +6,7 @@
 #include "datatypes/simplefeaturecollections/wkbutil.h"
 #include "datatypes/simplefeaturecollections/geosgeomutil.h"
 #include <vector>
+#include <sstream>
 #include "util/binarystream.h"
 
 #include "datatypes/pointcollection.h"
@@ -460,6 +461,36 @@ TEST(PolygonCollection, toARFF) {
 	EXPECT_EQ(expected, polygons.toARFF());
 }
 
+TEST(PolygonCollection, toColumnar) {
+	std::string wkt = "GEOMETRYCOLLECTION(POLYGON((1 1, 2 5, 8 6, 1 1), (2 2, 3 3, 2 3, 2 2)), MULTIPOLYGON(((10 10, 20 50, 80 60, 10 10)), ((40 40, 50 40, 50 50, 40 40))))";
+	auto polygons = WKBUtil::readPolygonCollection(wkt, SpatioTemporalReference::unreferenced());
+
+	std::ostringstream output;
+	polygons->toColumnar(output);
+
+	std::string body;
+	Json::Value header = CollectionTestUtil::parseColumnar(output.str(), body);
+	EXPECT_EQ(2, header["features"].asUInt64());
+	EXPECT_EQ("MultiPolygon", header["geometry"]["type"].asString());
+	EXPECT_TRUE(header["time"].isNull());
+
+	auto &offsets = header["geometry"]["offsets"];
+	ASSERT_EQ(3, offsets.size());
+	EXPECT_EQ("feature_offsets", offsets[0]["name"].asString());
+	EXPECT_EQ(std::vector<uint32_t>({0, 1, 3}), CollectionTestUtil::readColumnarBuffer<uint32_t>(body, offsets[0]));
+	EXPECT_EQ("polygon_offsets", offsets[1]["name"].asString());
+	EXPECT_EQ(std::vector<uint32_t>({0, 2, 3, 4}), CollectionTestUtil::readColumnarBuffer<uint32_t>(body, offsets[1]));
+	EXPECT_EQ("ring_offsets", offsets[2]["name"].asString());
+	EXPECT_EQ(polygons->start_ring, CollectionTestUtil::readColumnarBuffer<uint32_t>(body, offsets[2]));
+
+	auto coordinates = CollectionTestUtil::readColumnarBuffer<double>(body, header["geometry"]["coordinates"]);
+	ASSERT_EQ(2 * polygons->coordinates.size(), coordinates.size());
+	for(size_t i = 0; i < polygons->coordinates.size(); ++i){
+		EXPECT_EQ(polygons->coordinates[i].x, coordinates[2 * i]);
+		EXPECT_EQ(polygons->coordinates[i].y, coordinates[2 * i + 1]);
+	}
+}
+
 TEST(PolygonCollection, calculateMBR) {
 	PolygonCollection polygons(SpatioTemporalReference::unreferenced());
 
@@ -6,6 +6,9 @@
 #include "datatypes/polygoncollection.h"
 #include "datatypes/linecollection.h"
 
+#include <json/json.h>
+#include <cstring>
+
 class CollectionTestUtil {
 public:
 
@@ -185,6 +188,32 @@ public:
 			}
 		}
 	}
+
+	/**
+	 * Splits the output of SimpleFeatureCollection::toColumnar() into the parsed header and the body
+	 */
+	static Json::Value parseColumnar(const std::string &data, std::string &body){
+		EXPECT_EQ("MAPCOL01", data.substr(0, 8));
+		uint64_t header_length = 0;
+		for(int i = 0; i < 8; ++i)
+			header_length |= ((uint64_t) (uint8_t) data[8 + i]) << (8 * i);
+		EXPECT_EQ(0, header_length % 8);
+
+		Json::Reader reader(Json::Features::strictMode());
+		Json::Value header;
+		EXPECT_TRUE(reader.parse(data.substr(16, header_length), header));
+		body = data.substr(16 + header_length);
+		return header;
+	}
+
+	template<typename T>
+	static std::vector<T> readColumnarBuffer(const std::string &body, const Json::Value &buffer){
+		std::vector<T> values(buffer["length"].asUInt64());
+		EXPECT_EQ(0, buffer["offset"].asUInt64() % 8);
+		EXPECT_LE(buffer["offset"].asUInt64() + values.size() * sizeof(T), body.size());
+		std::memcpy(values.data(), body.data() + buffer["offset"].asUInt64(), values.size() * sizeof(T));
+		return values;
+	}
 };
 
 #endif /* UNITTESTS_SIMPLEFEATURECOLLECTIONS_UTIL_H_ */
@@ -0,0 +1,87 @@
+#include "services/tilecache.h"
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <unistd.h>
+
+TEST(TileCache, hitAndMiss) {
+	TileCache cache(1024 * 1024, 1024 * 1024, 0);
+
+	EXPECT_EQ(cache.get("tile1"), nullptr);
+
+	auto inserted = cache.put("tile1", "image/png", "content1", {"data.source1"});
+	ASSERT_NE(inserted, nullptr);
+	EXPECT_EQ(inserted->etag, TileCache::computeETag("tile1"));
+
+	auto entry = cache.get("tile1");
+	ASSERT_NE(entry, nullptr);
+	EXPECT_EQ(entry->body, "content1");
+	EXPECT_EQ(entry->content_type, "image/png");
+	ASSERT_EQ(entry->identifiers.size(), 1);
+	EXPECT_EQ(entry->identifiers[0], "data.source1");
+
+	EXPECT_EQ(cache.get("tile2"), nullptr);
+}
+
+TEST(TileCache, replace) {
+	TileCache cache(1024 * 1024, 1024 * 1024, 0);
+
+	cache.put("tile1", "image/png", "content1", {});
+	cache.put("tile1", "image/png", "content2", {});
+
+	EXPECT_EQ(cache.getEntryCount(), 1);
+	EXPECT_EQ(cache.get("tile1")->body, "content2");
+}
+
+TEST(TileCache, evictsLeastRecentlyUsed) {
+	std::string body(1000, 'x');
+	TileCache probe(1024 * 1024, 1024 * 1024, 0);
+	size_t entry_size = probe.put("tile1", "image/png", body, {})->getByteSize();
+
+	TileCache cache(entry_size * 2 + entry_size / 2, 1024 * 1024, 0);
+	cache.put("tile1", "image/png", body, {});
+	cache.put("tile2", "image/png", body, {});
+	// touch tile1, so tile2 is evicted next
+	EXPECT_NE(cache.get("tile1"), nullptr);
+	cache.put("tile3", "image/png", body, {});
+
+	EXPECT_EQ(cache.getEntryCount(), 2);
+	EXPECT_LE(cache.getCurrentBytes(), entry_size * 2 + entry_size / 2);
+	EXPECT_NE(cache.get("tile1"), nullptr);
+	EXPECT_EQ(cache.get("tile2"), nullptr);
+	EXPECT_NE(cache.get("tile3"), nullptr);
+}
+
+TEST(TileCache, rejectsLargeEntries) {
+	TileCache cache(1024 * 1024, 100, 0);
+
+	EXPECT_EQ(cache.put("tile1", "image/png", std::string(1000, 'x'), {}), nullptr);
+	EXPECT_EQ(cache.getEntryCount(), 0);
+	EXPECT_EQ(cache.get("tile1"), nullptr);
+}
+
+TEST(TileCache, spillsToDisk) {
+	char directory_template[] = "/tmp/mapping_tilecache_XXXXXX";
+	char *directory = mkdtemp(directory_template);
+	ASSERT_NE(directory, nullptr);
+
+	std::string body(1000, 'x');
+	{
+		TileCache cache(1500, 1024 * 1024, 0, directory, 1024 * 1024);
+		cache.put("tile1", "image/png", body, {"data.source1"});
+		cache.put("tile2", "image/png", body, {});
+
+		// tile1 was evicted from memory, but can be restored from disk
+		EXPECT_EQ(cache.getEntryCount(), 1);
+		auto entry = cache.get("tile1");
+		ASSERT_NE(entry, nullptr);
+		EXPECT_EQ(entry->body, body);
+		ASSERT_EQ(entry->identifiers.size(), 1);
+		EXPECT_EQ(entry->identifiers[0], "data.source1");
+
+		// and tile2 was spilled in turn
+		EXPECT_NE(cache.get("tile2"), nullptr);
+	}
+
+	rmdir(directory);
+}
@@ -0,0 +1,155 @@
+#include "userdb/userdb.h"
+#include "userdb/backend.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+#include <functional>
+#include <stdexcept>
+
+class UserDBCacheTestClock : public UserDB::Clock {
+	public:
+		UserDBCacheTestClock(time_t *now) : now(now) {}
+		virtual ~UserDBCacheTestClock() {};
+		virtual time_t time() {
+			return *now;
+		};
+		time_t *now;
+};
+
+TEST(UserDB, cachedSessionsSeePermissionChanges) {
+	time_t now = time(nullptr);
+	UserDB::init("sqlite", ":memory:", make_unique<UserDBCacheTestClock>(&now), 60, 100);
+
+	const std::string userpermission = "user_can_do_stuff";
+	const std::string grouppermission = "group_members_can_do_stuff";
+
+	auto user = UserDB::createUser("cached", "realname", "email", "12345");
+	auto session = UserDB::createSession("cached", "12345");
+	auto sessiontoken = session->getSessiontoken();
+
+	// the session is served from the cache
+	session = UserDB::loadSession(sessiontoken);
+	EXPECT_EQ(UserDB::loadSession(sessiontoken), session);
+	EXPECT_FALSE(session->getUser().hasPermission(userpermission));
+
+	// changing the user's permissions invalidates the cached user
+	user = user->addPermission(userpermission);
+	EXPECT_TRUE(UserDB::loadSession(sessiontoken)->getUser().hasPermission(userpermission));
+	user = user->removePermission(userpermission);
+	EXPECT_FALSE(UserDB::loadSession(sessiontoken)->getUser().hasPermission(userpermission));
+
+	// so does joining a group and changing the group's permissions
+	auto group = UserDB::createGroup("cachedgroup");
+	user = user->joinGroup(*group);
+	group = group->addPermission(grouppermission);
+	EXPECT_TRUE(UserDB::loadSession(sessiontoken)->getUser().hasPermission(grouppermission));
+	group = group->removePermission(grouppermission);
+	EXPECT_FALSE(UserDB::loadSession(sessiontoken)->getUser().hasPermission(grouppermission));
+	group = group->addPermission(grouppermission);
+	user = user->leaveGroup(*group);
+	EXPECT_FALSE(UserDB::loadSession(sessiontoken)->getUser().hasPermission(grouppermission));
+
+	// cached entries time out
+	session = UserDB::loadSession(sessiontoken);
+	now += 61;
+	EXPECT_NE(UserDB::loadSession(sessiontoken), session);
+
+	// logging out removes the session from the cache
+	UserDB::loadSession(sessiontoken)->logout();
+	EXPECT_THROW(UserDB::loadSession(sessiontoken), UserDB::session_expired_error);
+
+	UserDB::shutdown();
+}
+
+
+/*
+ * A minimal in-memory backend that can run code between reading a user and returning it, like a request on
+ * another thread that changes the user while it is loaded.
+ */
+class InterleavingUserDBBackend : public UserDBBackend {
+	public:
+		InterleavingUserDBBackend(const std::string &) { instance = this; }
+		virtual ~InterleavingUserDBBackend() { instance = nullptr; }
+
+		static InterleavingUserDBBackend *instance;
+		// runs once during the next loadUser(), after the data has been read
+		std::function<void()> after_load;
+
+	protected:
+		virtual userid_t createUser(const std::string &username, const std::string &, const std::string &, const std::string &, const std::string &) {
+			users.push_back(UserData{(userid_t) users.size() + 1, username, "", "", "", UserDB::Permissions(), {}});
+			return users.back().userid;
+		}
+		virtual UserData loadUser(userid_t userid) {
+			UserData data = users.at(userid - 1);
+			if (after_load) {
+				auto callback = std::move(after_load);
+				after_load = nullptr;
+				callback();
+			}
+			return data;
+		}
+		virtual userid_t loadUserId(const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual userid_t authenticateUser(const std::string &username, const std::string &) {
+			for (auto &user : users) {
+				if (user.username == username)
+					return user.userid;
+			}
+			throw UserDB::authentication_error("unknown user");
+		}
+		virtual userid_t findExternalUser(const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual void setUserExternalid(userid_t, const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual void setUserPassword(userid_t, const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual void addUserPermission(userid_t userid, const std::string &permission) { users.at(userid - 1).permissions.addPermission(permission); }
+		virtual void removeUserPermission(userid_t userid, const std::string &permission) { users.at(userid - 1).permissions.removePermission(permission); }
+
+		virtual groupid_t createGroup(const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual GroupData loadGroup(groupid_t groupid) { return GroupData{groupid, "users", UserDB::Permissions()}; }
+		virtual groupid_t loadGroupId(const std::string &) { return 1; }
+		virtual void addUserToGroup(userid_t, groupid_t) {}
+		virtual void removeUserFromGroup(userid_t, groupid_t) { throw std::runtime_error("not implemented"); }
+		virtual void addGroupPermission(groupid_t, const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual void removeGroupPermission(groupid_t, const std::string &) { throw std::runtime_error("not implemented"); }
+
+		virtual std::string createSession(userid_t userid, time_t expires) {
+			sessions.push_back(SessionData{std::to_string(sessions.size()), userid, expires});
+			return sessions.back().sessiontoken;
+		}
+		virtual SessionData loadSession(const std::string &sessiontoken) { return sessions.at(std::stoul(sessiontoken)); }
+		virtual void destroySession(const std::string &) { throw std::runtime_error("not implemented"); }
+
+		virtual artifactid_t createArtifact(userid_t, const std::string &, const std::string &, time_t, const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual void updateArtifactValue(userid_t, const std::string &, const std::string &, time_t, const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual ArtifactData loadArtifact(artifactid_t) { throw std::runtime_error("not implemented"); }
+		virtual ArtifactData loadArtifact(const std::string &, const std::string &, const std::string &) { throw std::runtime_error("not implemented"); }
+		virtual ArtifactVersionData loadArtifactVersionData(userid_t, artifactid_t, time_t) { throw std::runtime_error("not implemented"); }
+		virtual std::vector<ArtifactData> loadArtifactsOfType(userid_t, const std::string &) { throw std::runtime_error("not implemented"); }
+
+	private:
+		std::vector<UserData> users;
+		std::vector<SessionData> sessions;
+};
+InterleavingUserDBBackend *InterleavingUserDBBackend::instance = nullptr;
+REGISTER_USERDB_BACKEND(InterleavingUserDBBackend, "interleaving_test");
+
+TEST(UserDB, usersChangedDuringLoadAreNotCached) {
+	time_t now = time(nullptr);
+	UserDB::init("interleaving_test", "", make_unique<UserDBCacheTestClock>(&now), 60, 100);
+
+	const std::string permission = "granted_while_loading";
+	auto user = UserDB::createUser("interleaved", "realname", "email", "12345");
+	auto sessiontoken = UserDB::createSession("interleaved", "12345")->getSessiontoken();
+
+	// another permission is granted after the next load read the user, so that load returns the older user
+	InterleavingUserDBBackend::instance->after_load = [&] {
+		user->addPermission(permission);
+	};
+	auto loaded = user->addPermission("granted_before_loading");
+	EXPECT_TRUE(loaded->hasPermission("granted_before_loading"));
+	EXPECT_FALSE(loaded->hasPermission(permission));
+
+	// but it must not replace the newer user in the cache
+	EXPECT_TRUE(UserDB::loadSession(sessiontoken)->getUser().hasPermission(permission));
+
+	UserDB::shutdown();
+}
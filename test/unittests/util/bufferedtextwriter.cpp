@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "util/bufferedtextwriter.h"
+
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+static void checkFormat(double value) {
+	char str[BufferedTextWriter::MAX_DOUBLE_LENGTH];
+
+	std::ostringstream fixed;
+	fixed << std::fixed << value;
+	size_t len = BufferedTextWriter::formatDouble(value, BufferedTextWriter::DoubleFormat::FIXED, str);
+	EXPECT_EQ(fixed.str(), std::string(str, len));
+
+	std::ostringstream general;
+	general << value;
+	len = BufferedTextWriter::formatDouble(value, BufferedTextWriter::DoubleFormat::GENERAL, str);
+	EXPECT_EQ(general.str(), std::string(str, len));
+}
+
+TEST(BufferedTextWriter, formatsLikeOstream) {
+	std::vector<double> values = {0.0, -0.0, 1.0, -1.5, 0.0000005, 0.0000015, -0.0000025, 1.0000005, 123.4567895,
+		180.0, -90.0, 13.37, 20037508.342789244, -1e-9, 1e12, -1e13, 1e300, 4.9e-324,
+		std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), NAN};
+	for (auto value : values)
+		checkFormat(value);
+
+	for (int i = -100000; i <= 100000; i += 7)
+		checkFormat(i * 0.001789);
+
+	// around the limit of the fast path
+	for (int i = -1000; i <= 1000; i++)
+		checkFormat(1e9 + i * 0.0000005);
+}
+
+TEST(BufferedTextWriter, buffering) {
+	std::ostringstream out;
+	{
+		// smaller than some of the writes, to test flushing and direct writes
+		BufferedTextWriter writer(out, BufferedTextWriter::DoubleFormat::FIXED, 8);
+		writer << "features:" << '[' << 1.5 << ',' << (size_t) 42 << ']' << std::string("end");
+		writer.flush();
+		EXPECT_EQ(out.str(), "features:[1.500000,42]end");
+		writer << "more";
+	}
+	EXPECT_EQ(out.str(), "features:[1.500000,42]endmore");
+}
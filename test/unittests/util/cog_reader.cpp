@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include "util/cog_reader.h"
+#include "util/geotiff_writer.h"
+#include "datatypes/raster/raster_priv.h"
+#include "util/gdal.h"
+
+#include <gdal_priv.h>
+
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <stdexcept>
+#include <unistd.h>
+
+
+static const uint32_t width = 100, height = 70, tile_size = 32;
+
+// writes a GeoTIFF whose pixels hold row * 100 + column
+static std::string writeGeoTiff(GeoTiffWriter::Compression compression) {
+	DataDescription dd(GDT_Int16, Unit::unknown(), true, -5);
+	SpatialReference sref(CrsId::from_epsg_code(4326), 10, 20, 10 + width * 0.5, 20 + height * 0.25);
+
+	std::string filename = "cog_reader_test_" + std::to_string(getpid()) + (compression == GeoTiffWriter::Compression::DEFLATE ? "_deflate.tif" : ".tif");
+	std::ofstream file(filename, std::ios::binary);
+	GeoTiffWriter writer(file, sref, width, height, dd, tile_size, tile_size, compression, 2);
+	for (uint32_t y = 0; y < height; y += tile_size) {
+		for (uint32_t x = 0; x < width; x += tile_size) {
+			uint32_t tile_width = std::min(tile_size, width - x), tile_height = std::min(tile_size, height - y);
+			SpatioTemporalReference stref(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, tile_width, tile_height), TemporalReference::unreferenced());
+			auto tile = GenericRaster::create(dd, stref, tile_width, tile_height, 0, GenericRaster::Representation::CPU);
+			auto typed = dynamic_cast<Raster2D<int16_t> *>(tile.get());
+			for (uint32_t row = 0; row < tile_height; row++)
+				for (uint32_t column = 0; column < tile_width; column++)
+					typed->set(column, row, (int16_t) ((y + row) * 100 + x + column));
+			writer.addTile(*tile);
+		}
+	}
+	writer.finish();
+	return filename;
+}
+
+static void checkReader(const CogReader &reader) {
+	ASSERT_EQ(reader.getLevelCount(), 1);
+	EXPECT_EQ(reader.getBandCount(), 1);
+	EXPECT_EQ(reader.getDataType(), GDT_Int16);
+	EXPECT_TRUE(reader.hasNoData());
+	EXPECT_EQ(reader.getNoData(), -5);
+	EXPECT_DOUBLE_EQ(reader.getOriginX(), 10);
+	EXPECT_DOUBLE_EQ(reader.getOriginY(), 20);
+
+	auto &level = reader.getLevel(0);
+	EXPECT_EQ(level.width, width);
+	EXPECT_EQ(level.height, height);
+	EXPECT_EQ(level.tiles_x * level.tiles_y, 4 * 3);
+	EXPECT_DOUBLE_EQ(level.scale_x, 0.5);
+	EXPECT_DOUBLE_EQ(level.scale_y, 0.25);
+	EXPECT_EQ(reader.selectLevel(2, 2), 0);
+
+	// a window across tile borders
+	std::vector<int16_t> values(40 * 30);
+	reader.read(0, 1, 20, 25, 40, 30, 40, 30, values.data(), -5, 2);
+	for (uint32_t y = 0; y < 30; y++)
+		for (uint32_t x = 0; x < 40; x++)
+			EXPECT_EQ(values[y * 40 + x], (int) ((25 + y) * 100 + 20 + x));
+
+	// a window reaching outside of the image
+	values.assign(20 * 10, 0);
+	reader.read(0, 1, 90, -5, 20, 10, 20, 10, values.data(), -5, 2);
+	for (uint32_t y = 0; y < 10; y++)
+		for (uint32_t x = 0; x < 20; x++)
+			EXPECT_EQ(values[y * 20 + x], y < 5 || x >= 10 ? -5 : (int) ((y - 5) * 100 + 90 + x));
+
+	// the whole image at half the resolution
+	values.assign(50 * 35, 0);
+	reader.read(0, 1, 0, 0, width, height, 50, 35, values.data(), -5, 2);
+	for (uint32_t y = 0; y < 35; y++)
+		for (uint32_t x = 0; x < 50; x++)
+			EXPECT_EQ(values[y * 50 + x], (int) ((2 * y + 1) * 100 + 2 * x + 1));
+
+	EXPECT_THROW(reader.read(0, 2, 0, 0, 10, 10, 10, 10, values.data(), -5, 2), SourceException);
+}
+
+TEST(CogReader, uncompressed) {
+	auto filename = writeGeoTiff(GeoTiffWriter::Compression::NONE);
+	checkReader(CogReader(filename));
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, deflate) {
+	auto filename = writeGeoTiff(GeoTiffWriter::Compression::DEFLATE);
+	checkReader(CogReader(filename));
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, cachesDirectories) {
+	auto filename = writeGeoTiff(GeoTiffWriter::Compression::NONE);
+	auto reader = CogReader::open(filename);
+	EXPECT_EQ(CogReader::open(filename), reader);
+	std::remove(filename.c_str());
+
+	EXPECT_THROW(CogReader::open(filename), SourceException);
+}
+
+
+/*
+ * Writes a 300 x 200 raster with GDAL's COG driver, so the reader is tested against files it did not write
+ * itself. Overviews are computed with nearest neighbour and the given creation options are passed on.
+ */
+static std::string writeGdalCog(const std::string &name, GDALDataType datatype, const std::vector<std::string> &options, bool pixel_is_point = false) {
+	GDAL::init();
+	auto cog_driver = GetGDALDriverManager()->GetDriverByName("COG");
+	if (cog_driver == nullptr)
+		throw std::runtime_error("GDAL has no COG driver");
+
+	const int cog_width = 300, cog_height = 200;
+	auto memory = GetGDALDriverManager()->GetDriverByName("MEM")->Create("", cog_width, cog_height, 1, datatype, nullptr);
+	double transform[6] = {10, 0.5, 0, 20, 0, -0.25};
+	memory->SetGeoTransform(transform);
+	if (pixel_is_point)
+		memory->SetMetadataItem(GDALMD_AREA_OR_POINT, GDALMD_AOP_POINT);
+	auto band = memory->GetRasterBand(1);
+	band->SetNoDataValue(7);
+
+	// smooth values with some noise, so the predictors have something to do
+	std::vector<double> values((size_t) cog_width * cog_height);
+	for (int y = 0; y < cog_height; y++)
+		for (int x = 0; x < cog_width; x++)
+			values[(size_t) y * cog_width + x] = (x + 2 * y) % 250 + ((x * 7919 + y * 104729) % 13) * 0.125;
+	if (band->RasterIO(GF_Write, 0, 0, cog_width, cog_height, values.data(), cog_width, cog_height, GDT_Float64, 0, 0) != CE_None)
+		throw std::runtime_error("could not fill the raster");
+
+	std::vector<const char *> creation_options = {"BLOCKSIZE=64", "OVERVIEW_RESAMPLING=NEAREST"};
+	for (auto &option : options)
+		creation_options.push_back(option.c_str());
+	creation_options.push_back(nullptr);
+
+	std::string filename = "cog_reader_test_" + std::to_string(getpid()) + "_" + name + ".tif";
+	auto cog = cog_driver->CreateCopy(filename.c_str(), memory, false, (char **) creation_options.data(), nullptr, nullptr);
+	GDALClose(memory);
+	if (cog == nullptr)
+		throw std::runtime_error("the COG driver could not write " + filename);
+	GDALClose(cog);
+	return filename;
+}
+
+/*
+ * Compares the georeference and every level read by the CogReader with what GDAL reads from the same file
+ */
+static void checkAgainstGdal(const std::string &filename, const char *compression) {
+	auto dataset = (GDALDataset *) GDALOpen(filename.c_str(), GA_ReadOnly);
+	ASSERT_NE(dataset, nullptr);
+	if (compression != nullptr)
+		EXPECT_STREQ(dataset->GetMetadataItem("COMPRESSION", "IMAGE_STRUCTURE"), compression);
+
+	CogReader reader(filename);
+	auto band = dataset->GetRasterBand(1);
+	EXPECT_EQ(reader.getDataType(), band->GetRasterDataType());
+	EXPECT_TRUE(reader.hasNoData());
+	EXPECT_EQ(reader.getNoData(), 7);
+
+	double transform[6];
+	ASSERT_EQ(dataset->GetGeoTransform(transform), CE_None);
+	EXPECT_DOUBLE_EQ(reader.getOriginX(), transform[0]);
+	EXPECT_DOUBLE_EQ(reader.getOriginY(), transform[3]);
+	EXPECT_DOUBLE_EQ(reader.getLevel(0).scale_x, transform[1]);
+	EXPECT_DOUBLE_EQ(reader.getLevel(0).scale_y, transform[5]);
+
+	// the COG driver adds overviews until the image fits into a single block
+	ASSERT_GE(band->GetOverviewCount(), 2);
+	ASSERT_EQ(reader.getLevelCount(), (size_t) band->GetOverviewCount() + 1);
+
+	auto datatype = band->GetRasterDataType();
+	size_t pixel_size = GDALGetDataTypeSizeBytes(datatype);
+	for (size_t i = 0; i < reader.getLevelCount(); i++) {
+		auto level_band = i == 0 ? band : band->GetOverview((int) i - 1);
+		auto &level = reader.getLevel(i);
+		ASSERT_EQ(level.width, (uint32_t) level_band->GetXSize());
+		ASSERT_EQ(level.height, (uint32_t) level_band->GetYSize());
+		EXPECT_EQ(level.tile_width, 64u);
+
+		std::vector<char> expected(level.width * level.height * pixel_size), actual(expected.size());
+		ASSERT_EQ(level_band->RasterIO(GF_Read, 0, 0, level.width, level.height, expected.data(), level.width, level.height, datatype, 0, 0), CE_None);
+		reader.read(i, 1, 0, 0, level.width, level.height, level.width, level.height, actual.data(), 7, 2);
+		EXPECT_TRUE(expected == actual) << "level " << i << " differs from GDAL";
+	}
+
+	GDALClose(dataset);
+}
+
+TEST(CogReader, gdalLzw) {
+	auto filename = writeGdalCog("lzw", GDT_Byte, {"COMPRESS=LZW"});
+	checkAgainstGdal(filename, "LZW");
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, gdalLzwHorizontalPredictor) {
+	auto filename = writeGdalCog("lzw_predictor", GDT_Int16, {"COMPRESS=LZW", "PREDICTOR=STANDARD"});
+	checkAgainstGdal(filename, "LZW");
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, gdalDeflateFloatingPointPredictor) {
+	auto filename = writeGdalCog("float_predictor", GDT_Float32, {"COMPRESS=DEFLATE", "PREDICTOR=FLOATING_POINT"});
+	checkAgainstGdal(filename, "DEFLATE");
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, gdalBigTiff) {
+	auto filename = writeGdalCog("bigtiff", GDT_UInt16, {"COMPRESS=DEFLATE", "BIGTIFF=YES"});
+	{
+		std::ifstream file(filename, std::ios::binary);
+		char header[4];
+		file.read(header, 4);
+		EXPECT_EQ(header[2], 43);
+	}
+	checkAgainstGdal(filename, "DEFLATE");
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, gdalPixelIsPoint) {
+	auto filename = writeGdalCog("point", GDT_Byte, {}, true);
+	checkAgainstGdal(filename, nullptr);
+
+	// GDAL stores the center of the first pixel, the reader moves it back to the corner
+	CogReader reader(filename);
+	EXPECT_DOUBLE_EQ(reader.getOriginX(), 10);
+	EXPECT_DOUBLE_EQ(reader.getOriginY(), 20);
+	std::remove(filename.c_str());
+}
+
+TEST(CogReader, selectsOverviews) {
+	auto filename = writeGdalCog("overviews", GDT_Byte, {"COMPRESS=LZW"});
+	CogReader reader(filename);
+	std::remove(filename.c_str());
+
+	// the image has pixels of 0.5 x 0.25, every overview halves the resolution
+	ASSERT_GE(reader.getLevelCount(), 3);
+	EXPECT_DOUBLE_EQ(std::abs(reader.getLevel(1).scale_x), 1);
+	EXPECT_DOUBLE_EQ(std::abs(reader.getLevel(2).scale_y), 1);
+
+	EXPECT_EQ(reader.selectLevel(0.1, 0.1), 0);
+	EXPECT_EQ(reader.selectLevel(0.5, 0.25), 0);
+	EXPECT_EQ(reader.selectLevel(0.9, 0.9), 0);
+	EXPECT_EQ(reader.selectLevel(1, 0.5), 1);
+	EXPECT_EQ(reader.selectLevel(1.9, 0.9), 1);
+	// the coarser axis limits the level
+	EXPECT_EQ(reader.selectLevel(2, 0.5), 1);
+	EXPECT_EQ(reader.selectLevel(2, 1), 2);
+	EXPECT_EQ(reader.selectLevel(1000, 1000), reader.getLevelCount() - 1);
+}
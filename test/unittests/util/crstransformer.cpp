@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "util/gdal.h"
+
+#include <vector>
+
+
+TEST(CRSTransformer, bulkTransformMatchesSingle) {
+	GDAL::CRSTransformer transformer(CrsId::from_epsg_code(4326), CrsId::from_epsg_code(3857));
+
+	std::vector<Coordinate> coordinates {Coordinate(0, 0), Coordinate(8.77, 50.8), Coordinate(-120.5, -33.3)};
+	std::vector<bool> failed;
+	EXPECT_TRUE(transformer.transform(coordinates, failed));
+	ASSERT_EQ(failed.size(), coordinates.size());
+
+	double x = 8.77, y = 50.8;
+	ASSERT_TRUE(transformer.transform(x, y));
+	EXPECT_FALSE(failed[1]);
+	EXPECT_DOUBLE_EQ(coordinates[1].x, x);
+	EXPECT_DOUBLE_EQ(coordinates[1].y, y);
+}
+
+TEST(CRSTransformer, bulkTransformReportsFailures) {
+	GDAL::CRSTransformer transformer(CrsId::from_epsg_code(4326), CrsId::from_epsg_code(3857));
+
+	// web mercator is undefined at the poles
+	std::vector<Coordinate> coordinates {Coordinate(10, 10), Coordinate(0, 90), Coordinate(20, 20)};
+	std::vector<bool> failed;
+	EXPECT_FALSE(transformer.transform(coordinates, failed));
+	EXPECT_FALSE(failed[0]);
+	EXPECT_TRUE(failed[1]);
+	EXPECT_FALSE(failed[2]);
+}
+
+TEST(CRSTransformer, cacheReusesTransformers) {
+	const GDAL::CRSTransformer *first;
+	{
+		auto transformer = GDAL::CRSTransformer::get(CrsId::from_epsg_code(4326), CrsId::from_epsg_code(3857));
+		first = transformer.get();
+		EXPECT_EQ(transformer->in_crsId, CrsId::from_epsg_code(4326));
+
+		// a transformer in use is never handed out twice
+		auto second = GDAL::CRSTransformer::get(CrsId::from_epsg_code(4326), CrsId::from_epsg_code(3857));
+		EXPECT_NE(first, second.get());
+	}
+	auto transformer = GDAL::CRSTransformer::get(CrsId::from_epsg_code(4326), CrsId::from_epsg_code(3857));
+	auto other = GDAL::CRSTransformer::get(CrsId::from_epsg_code(4326), CrsId::from_epsg_code(3857));
+	EXPECT_TRUE(transformer.get() == first || other.get() == first);
+
+	auto reverse = GDAL::CRSTransformer::get(CrsId::from_epsg_code(3857), CrsId::from_epsg_code(4326));
+	EXPECT_EQ(reverse->in_crsId, CrsId::from_epsg_code(3857));
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "util/epoll_reactor.h"
+
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+
+
+static void makePipe(int fds[2]) {
+	ASSERT_EQ(pipe2(fds, O_NONBLOCK), 0);
+}
+
+TEST(EpollReactor, timeout) {
+	EpollReactor reactor;
+	EXPECT_TRUE(reactor.wait(0).empty());
+}
+
+TEST(EpollReactor, levelTriggered) {
+	int fds[2];
+	makePipe(fds);
+
+	EpollReactor reactor;
+	reactor.add(fds[0], EpollReactor::READ, 42);
+	EXPECT_TRUE(reactor.wait(0).empty());
+
+	char c = 'x';
+	ASSERT_EQ(write(fds[1], &c, 1), 1);
+
+	for (int i=0;i<2;i++) {
+		auto &events = reactor.wait(1000);
+		ASSERT_EQ(events.size(), 1);
+		EXPECT_EQ(events[0].tag, 42);
+		EXPECT_TRUE(events[0].events & EpollReactor::READ);
+	}
+
+	ASSERT_EQ(read(fds[0], &c, 1), 1);
+	EXPECT_TRUE(reactor.wait(0).empty());
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST(EpollReactor, edgeTriggered) {
+	int fds[2];
+	makePipe(fds);
+
+	EpollReactor reactor;
+	reactor.add(fds[0], EpollReactor::READ | EpollReactor::EDGE_TRIGGERED, 42);
+
+	char c = 'x';
+	ASSERT_EQ(write(fds[1], &c, 1), 1);
+	EXPECT_EQ(reactor.wait(1000).size(), 1);
+	// the data was not read, but there is no new edge
+	EXPECT_TRUE(reactor.wait(0).empty());
+
+	ASSERT_EQ(write(fds[1], &c, 1), 1);
+	EXPECT_EQ(reactor.wait(1000).size(), 1);
+
+	reactor.remove(fds[0], 42);
+	ASSERT_EQ(write(fds[1], &c, 1), 1);
+	EXPECT_TRUE(reactor.wait(0).empty());
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST(EpollReactor, activate) {
+	EpollReactor reactor;
+	reactor.activate(7, EpollReactor::WRITE);
+	reactor.activate(8, 0);
+
+	auto &events = reactor.wait(1000);
+	ASSERT_EQ(events.size(), 2);
+	EXPECT_EQ(events[0].tag, 7);
+	EXPECT_EQ(events[0].events, EpollReactor::WRITE);
+	EXPECT_EQ(events[1].tag, 8);
+
+	EXPECT_TRUE(reactor.wait(0).empty());
+
+	// removing a tag drops its pending activations
+	reactor.activate(7, 0);
+	reactor.remove(-1, 7);
+	EXPECT_TRUE(reactor.wait(0).empty());
+}
+
+TEST(EpollReactor, wakeupFromOtherThread) {
+	EpollReactor reactor;
+	std::thread t([&reactor] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		reactor.activate(1, 0);
+	});
+
+	// must not wait for the timeout
+	auto start = std::chrono::steady_clock::now();
+	auto &events = reactor.wait(10000);
+	auto duration = std::chrono::steady_clock::now() - start;
+	t.join();
+
+	ASSERT_EQ(events.size(), 1);
+	EXPECT_EQ(events[0].tag, 1);
+	EXPECT_LT(duration, std::chrono::seconds(5));
+}
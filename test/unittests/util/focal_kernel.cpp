@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "util/focal_kernel.h"
+#include "datatypes/raster/raster_priv.h"
+
+#include <cmath>
+
+
+// a 3x3 raster with the values 1 to 9
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type, bool has_no_data = false, double no_data = 0) {
+	DataDescription dd(type, Unit::unknown(), has_no_data, no_data);
+	SpatioTemporalReference stref(SpatialReference(CrsId::unreferenced(), 0, 0, 3, 3), TemporalReference::unreferenced());
+	auto raster = GenericRaster::create(dd, stref, 3, 3, 1, GenericRaster::Representation::CPU);
+	auto typed = dynamic_cast<Raster2D<T> *>(raster.get());
+	for (int y = 0; y < 3; y++)
+		for (int x = 0; x < 3; x++)
+			typed->set(x, y, y * 3 + x + 1);
+	return raster;
+}
+
+TEST(FocalKernel, detectsSeparableMatrices) {
+	FocalKernel box(FocalKernel::Operation::CONVOLUTION, 3, {1, 1, 1, 1, 1, 1, 1, 1, 1});
+	EXPECT_TRUE(box.isSeparable());
+
+	FocalKernel sobel(FocalKernel::Operation::CONVOLUTION, 3, {-1, 0, 1, -2, 0, 2, -1, 0, 1});
+	EXPECT_TRUE(sobel.isSeparable());
+	for (int y = 0; y < 3; y++)
+		for (int x = 0; x < 3; x++)
+			EXPECT_EQ(sobel.getMatrix()[y * 3 + x] * sobel.getDivisor(), sobel.getVertical()[y] * sobel.getHorizontal()[x]);
+
+	FocalKernel laplace(FocalKernel::Operation::CONVOLUTION, 3, {0, 1, 0, 1, -4, 1, 0, 1, 0});
+	EXPECT_FALSE(laplace.isSeparable());
+
+	EXPECT_THROW(FocalKernel(FocalKernel::Operation::CONVOLUTION, 3, {1, 1}), ArgumentException);
+	EXPECT_THROW(FocalKernel(FocalKernel::Operation::MEAN, 4), ArgumentException);
+}
+
+TEST(FocalKernel, convolutionReplicatesBorder) {
+	auto raster = createRaster<float>(GDT_Float32);
+
+	auto separable = FocalKernel(FocalKernel::Operation::CONVOLUTION, 3, {1, 1, 1, 1, 1, 1, 1, 1, 1}).apply(*raster, 2);
+	EXPECT_DOUBLE_EQ(separable->getAsDouble(1, 1), 45);
+	EXPECT_DOUBLE_EQ(separable->getAsDouble(0, 0), 21);
+
+	// the same box with a different center, which is not separable
+	auto general = FocalKernel(FocalKernel::Operation::CONVOLUTION, 3, {1, 1, 1, 1, 2, 1, 1, 1, 1}).apply(*raster, 2);
+	EXPECT_DOUBLE_EQ(general->getAsDouble(1, 1), 50);
+	EXPECT_DOUBLE_EQ(general->getAsDouble(0, 0), 22);
+}
+
+TEST(FocalKernel, convolutionClampsToDatatype) {
+	auto raster = createRaster<uint8_t>(GDT_Byte);
+
+	auto result = FocalKernel(FocalKernel::Operation::CONVOLUTION, 3, {0, 0, 0, 0, -1, 0, 0, 0, 100}).apply(*raster, 1);
+	EXPECT_EQ(result->getAsDouble(0, 0), 255);
+	EXPECT_EQ(result->getAsDouble(2, 2), 255);
+	auto negative = FocalKernel(FocalKernel::Operation::CONVOLUTION, 3, {0, 0, 0, 0, -1, 0, 0, 0, 0}).apply(*raster, 1);
+	EXPECT_EQ(negative->getAsDouble(1, 1), 0);
+}
+
+TEST(FocalKernel, convolutionPropagatesNoData) {
+	auto raster = createRaster<int16_t>(GDT_Int16, true, 1);
+
+	auto result = FocalKernel(FocalKernel::Operation::CONVOLUTION, 3, {1, 1, 1, 1, 1, 1, 1, 1, 1}).apply(*raster, 1);
+	EXPECT_EQ(result->getAsDouble(1, 1), 1);
+	EXPECT_EQ(result->getAsDouble(2, 2), 9 + 9 + 8 + 9 + 9 + 8 + 6 + 6 + 5);
+}
+
+TEST(FocalKernel, focalStatisticsIgnoreNoData) {
+	auto raster = createRaster<double>(GDT_Float64, true, 5);
+
+	auto mean = FocalKernel(FocalKernel::Operation::MEAN, 3).apply(*raster, 2);
+	EXPECT_DOUBLE_EQ(mean->getAsDouble(1, 1), 40.0 / 8);
+
+	auto min = FocalKernel(FocalKernel::Operation::MIN, 3).apply(*raster, 2);
+	EXPECT_DOUBLE_EQ(min->getAsDouble(2, 2), 6);
+
+	auto max = FocalKernel(FocalKernel::Operation::MAX, 3).apply(*raster, 2);
+	EXPECT_DOUBLE_EQ(max->getAsDouble(0, 0), 4);
+
+	// 1 1 2 1 1 2 4 4 without the center
+	auto median = FocalKernel(FocalKernel::Operation::MEDIAN, 3).apply(*raster, 2);
+	EXPECT_DOUBLE_EQ(median->getAsDouble(0, 0), 1.5);
+	EXPECT_DOUBLE_EQ(median->getAsDouble(1, 1), 5);
+}
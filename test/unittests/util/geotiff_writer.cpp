@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "util/geotiff_writer.h"
+#include "util/gdal.h"
+#include "datatypes/raster/raster_priv.h"
+
+#include <sstream>
+#include <cpl_vsi.h>
+
+
+static const uint32_t width = 100, height = 70;
+
+static std::unique_ptr<GenericRaster> createTile(const DataDescription &dd, uint32_t x, uint32_t y, uint32_t tile_width, uint32_t tile_height) {
+	SpatioTemporalReference stref(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, tile_width, tile_height), TemporalReference::unreferenced());
+	auto tile = GenericRaster::create(dd, stref, tile_width, tile_height, 0, GenericRaster::Representation::CPU);
+	auto typed = dynamic_cast<Raster2D<int16_t> *>(tile.get());
+	for (uint32_t row = 0; row < tile_height; row++)
+		for (uint32_t column = 0; column < tile_width; column++)
+			typed->set(column, row, (int16_t) ((y + row) * 100 + x + column));
+	return tile;
+}
+
+static std::string writeGeoTiff(GeoTiffWriter::Compression compression, uint64_t &announced_size) {
+	DataDescription dd(GDT_Int16, Unit::unknown(), true, -5);
+	SpatialReference sref(CrsId::from_epsg_code(4326), 10, 20, 10 + width * 0.5, 20 + height * 0.25);
+	const uint32_t tile_size = 32;
+
+	std::ostringstream stream;
+	GeoTiffWriter writer(stream, sref, width, height, dd, tile_size, tile_size, compression, 2, [&](uint64_t size) {
+		announced_size = size;
+	});
+	for (uint32_t y = 0; y < height; y += tile_size) {
+		for (uint32_t x = 0; x < width; x += tile_size) {
+			auto tile = createTile(dd, x, y, std::min(tile_size, width - x), std::min(tile_size, height - y));
+			writer.addTile(*tile);
+		}
+	}
+	writer.finish();
+	return stream.str();
+}
+
+static void checkWithGDAL(const std::string &data) {
+	GDAL::init();
+	const char *filename = "/vsimem/geotiff_writer_test.tif";
+	VSIFCloseL(VSIFileFromMemBuffer(filename, (GByte *) data.data(), data.size(), FALSE));
+
+	auto dataset = (GDALDataset *) GDALOpen(filename, GA_ReadOnly);
+	ASSERT_NE(dataset, nullptr);
+	EXPECT_EQ(dataset->GetRasterXSize(), (int) width);
+	EXPECT_EQ(dataset->GetRasterYSize(), (int) height);
+
+	double geo_transform[6];
+	dataset->GetGeoTransform(geo_transform);
+	EXPECT_DOUBLE_EQ(geo_transform[0], 10);
+	EXPECT_DOUBLE_EQ(geo_transform[1], 0.5);
+	EXPECT_DOUBLE_EQ(geo_transform[3], 20);
+	EXPECT_DOUBLE_EQ(geo_transform[5], 0.25);
+
+	auto band = dataset->GetRasterBand(1);
+	EXPECT_EQ(band->GetRasterDataType(), GDT_Int16);
+	int has_no_data = 0;
+	EXPECT_EQ(band->GetNoDataValue(&has_no_data), -5);
+	EXPECT_TRUE(has_no_data);
+
+	std::vector<int16_t> values(width * height);
+	ASSERT_EQ(band->RasterIO(GF_Read, 0, 0, width, height, values.data(), width, height, GDT_Int16, 0, 0), CE_None);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			EXPECT_EQ(values[y * width + x], (int) (y * 100 + x));
+
+	GDALClose((GDALDatasetH) dataset);
+	VSIUnlink(filename);
+}
+
+TEST(GeoTiffWriter, uncompressed) {
+	uint64_t announced_size = 0;
+	auto data = writeGeoTiff(GeoTiffWriter::Compression::NONE, announced_size);
+	EXPECT_EQ(announced_size, data.size());
+	checkWithGDAL(data);
+}
+
+TEST(GeoTiffWriter, deflate) {
+	uint64_t announced_size = 0;
+	auto data = writeGeoTiff(GeoTiffWriter::Compression::DEFLATE, announced_size);
+	EXPECT_EQ(announced_size, data.size());
+	EXPECT_LT(data.size(), width * height * sizeof(int16_t));
+	checkWithGDAL(data);
+}
+
+TEST(GeoTiffWriter, rejectsInvalidTiles) {
+	DataDescription dd(GDT_Int16, Unit::unknown());
+	SpatialReference sref(CrsId::from_epsg_code(4326), 0, 0, 10, 10);
+	std::ostringstream stream;
+
+	EXPECT_THROW(GeoTiffWriter(stream, sref, 40, 40, dd, 20, 20, GeoTiffWriter::Compression::NONE), ArgumentException);
+	EXPECT_FALSE(GeoTiffWriter::supportsCrs(CrsId::from_srs_string("SR-ORG:81")));
+
+	GeoTiffWriter writer(stream, sref, 40, 40, dd, 32, 32, GeoTiffWriter::Compression::NONE);
+	auto tile = createTile(dd, 0, 0, 16, 16);
+	EXPECT_THROW(writer.addTile(*tile), ArgumentException);
+	EXPECT_THROW(writer.finish(), ArgumentException);
+}
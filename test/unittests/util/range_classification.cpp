@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "util/range_classification.h"
+#include "datatypes/raster/raster_priv.h"
+
+#include <cmath>
+#include <limits>
+
+
+// the loop of the OpenCL kernel
+static int classifyNaive(const std::vector<float> &lower, const std::vector<float> &upper, const std::vector<int> &classes, int unclassified, double value) {
+	int result = unclassified;
+	for (size_t i = 0; i < classes.size(); i++) {
+		if (value >= lower[i] && value <= upper[i])
+			result = classes[i];
+	}
+	return result;
+}
+
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type, uint32_t width, uint32_t height, bool has_no_data, double no_data) {
+	DataDescription dd(type, Unit::unknown(), has_no_data, no_data);
+	SpatioTemporalReference stref(SpatialReference(CrsId::unreferenced(), 0, 0, width, height), TemporalReference::unreferenced());
+	return GenericRaster::create(dd, stref, width, height, 1, GenericRaster::Representation::CPU);
+}
+
+static DataDescription outputDescription() {
+	Unit unit = Unit::unknown();
+	unit.setMinMax(0, 100);
+	DataDescription dd(GDT_Int32, unit);
+	dd.addNoData();
+	return dd;
+}
+
+TEST(RangeClassification, matchesNaiveClassification) {
+	// overlapping, touching, empty and single value ranges
+	std::vector<float> lower {0, 5, 3, 10, 7, 20, -4.5f};
+	std::vector<float> upper {5, 7, 4, 10, 6, 30, -1.25f};
+	std::vector<int> classes {1, 2, 3, 4, 5, 6, 7};
+	RangeClassification classification(lower, upper, classes, -1, -2);
+
+	for (double value = -10; value <= 40; value += 0.125)
+		EXPECT_EQ(classification.classify(value), classifyNaive(lower, upper, classes, -1, value)) << value;
+	EXPECT_EQ(classification.classify(std::numeric_limits<double>::quiet_NaN()), -1);
+	EXPECT_EQ(classification.classify(std::numeric_limits<double>::infinity()), -1);
+	EXPECT_EQ(classification.classify(-std::numeric_limits<double>::infinity()), -1);
+}
+
+TEST(RangeClassification, handlesNoRanges) {
+	RangeClassification classification({}, {}, {}, -1, -2);
+	EXPECT_EQ(classification.classify(0), -1);
+
+	EXPECT_THROW(RangeClassification({1}, {2, 3}, {1}, -1, -2), ArgumentException);
+}
+
+TEST(RangeClassification, classifiesFloatRaster) {
+	auto raster = createRaster<float>(GDT_Float32, 40, 30, true, -1);
+	auto typed = dynamic_cast<Raster2D<float> *>(raster.get());
+	for (int y = 0; y < 30; y++)
+		for (int x = 0; x < 40; x++)
+			typed->set(x, y, (x + 40 * y) * 0.01f - 1);
+
+	std::vector<float> lower {-0.5f, 2}, upper {2, 5};
+	std::vector<int> classes {10, 20};
+	auto out_dd = outputDescription();
+	auto result = RangeClassification(lower, upper, classes, (int) out_dd.no_data, 99).apply(*raster, out_dd, 3);
+
+	ASSERT_EQ(result->dd.datatype, GDT_Int32);
+	for (int y = 0; y < 30; y++) {
+		for (int x = 0; x < 40; x++) {
+			float value = typed->get(x, y);
+			int expected = value == -1 ? 99 : classifyNaive(lower, upper, classes, (int) out_dd.no_data, value);
+			EXPECT_EQ(result->getAsDouble(x, y), expected);
+		}
+	}
+}
+
+TEST(RangeClassification, classifiesByteRasterWithLookupTable) {
+	// more pixels than byte values, so the lookup table is used
+	auto raster = createRaster<uint8_t>(GDT_Byte, 64, 64, true, 255);
+	auto typed = dynamic_cast<Raster2D<uint8_t> *>(raster.get());
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 64; x++)
+			typed->set(x, y, (x * 7 + y) % 256);
+
+	std::vector<float> lower {0, 100.5f, 200}, upper {100, 200, 255};
+	std::vector<int> classes {1, 2, 3};
+	auto out_dd = outputDescription();
+	auto result = RangeClassification(lower, upper, classes, (int) out_dd.no_data, 0).apply(*raster, out_dd, 2);
+
+	for (int y = 0; y < 64; y++) {
+		for (int x = 0; x < 64; x++) {
+			uint8_t value = typed->get(x, y);
+			int expected = value == 255 ? 0 : classifyNaive(lower, upper, classes, (int) out_dd.no_data, value);
+			EXPECT_EQ(result->getAsDouble(x, y), expected);
+		}
+	}
+}
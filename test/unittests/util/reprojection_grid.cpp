@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "util/reprojection_grid.h"
+
+#include <cmath>
+#include <memory>
+#include <functional>
+#include <vector>
+
+
+static const uint32_t width = 300, height = 200;
+
+static void checkAllPixels(const ReprojectionGrid &grid, std::function<bool(double &, double &)> exact, double max_error) {
+	std::vector<double> src_x(width), src_y(width);
+	std::unique_ptr<bool[]> valid(new bool[width]);
+	for (uint32_t y = 0; y < height; y++) {
+		grid.getRow(y, src_x.data(), src_y.data(), valid.get());
+		for (uint32_t x = 0; x < width; x++) {
+			double ex = x, ey = y;
+			bool expected_valid = exact(ex, ey);
+			ASSERT_EQ(expected_valid, valid[x]);
+			if (!expected_valid)
+				continue;
+			EXPECT_LE(std::hypot(src_x[x] - ex, src_y[x] - ey), max_error);
+		}
+	}
+}
+
+static ReprojectionGrid::BatchTransform batch(std::function<bool(double &, double &)> exact) {
+	return [exact](size_t count, double *x, double *y, int *success) {
+		for (size_t i = 0; i < count; i++)
+			success[i] = exact(x[i], y[i]);
+	};
+}
+
+TEST(ReprojectionGrid, affine) {
+	auto exact = [](double &x, double &y) { x = 2*x + 10; y = -0.5*y + 3; return true; };
+
+	size_t transformed = 0;
+	auto counting = batch(exact);
+	ReprojectionGrid grid(width, height, [&](size_t count, double *x, double *y, int *success) {
+		transformed += count;
+		counting(count, x, y, success);
+	}, 0.01, 32);
+
+	// an affine transformation is interpolated exactly
+	EXPECT_EQ(grid.getStep(), 32);
+	EXPECT_LT(transformed, (size_t) width * height / 100);
+	checkAllPixels(grid, exact, 1e-9);
+}
+
+TEST(ReprojectionGrid, refinesNonlinear) {
+	auto exact = [](double &x, double &y) { double nx = x*x / 100.0; y = y + std::sin(x / 20.0) * 5; x = nx; return true; };
+
+	ReprojectionGrid grid(width, height, batch(exact), 0.125, 64);
+	EXPECT_LT(grid.getStep(), 64);
+	EXPECT_GT(grid.getStep(), 1);
+	// the error is only checked at the cell centers, so allow some slack
+	checkAllPixels(grid, exact, 0.25);
+}
+
+TEST(ReprojectionGrid, failedTransformations) {
+	auto exact = [](double &x, double &y) {
+		if (x < 50.5 || (x > 200 && y > 150))
+			return false;
+		x = x + 1; y = y + 1;
+		return true;
+	};
+
+	ReprojectionGrid grid(width, height, batch(exact), 0.125, 32);
+	checkAllPixels(grid, exact, 1e-9);
+}
+
+TEST(ReprojectionGrid, tinyRaster) {
+	auto exact = [](double &x, double &y) { x = x * 3; y = y * 3; return true; };
+
+	ReprojectionGrid grid(1, 1, batch(exact), 0.125, 32);
+	double sx, sy;
+	bool valid;
+	grid.getRow(0, &sx, &sy, &valid);
+	EXPECT_TRUE(valid);
+	EXPECT_EQ(sx, 0);
+	EXPECT_EQ(sy, 0);
+}
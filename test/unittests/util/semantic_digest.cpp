@@ -0,0 +1,24 @@
+#include <gtest/gtest.h>
+#include "util/semantic_digest.h"
+
+#include <unordered_set>
+
+
+TEST(SemanticDigest, hash) {
+	EXPECT_EQ(SemanticDigest("").asHex(), "00000000000000000000000000000000");
+	EXPECT_EQ(SemanticDigest("hello").asHex(), "cbd8a7b341bd9b025b1e906a48ae1d19");
+	EXPECT_EQ(SemanticDigest("The quick brown fox jumps over the lazy dog").asHex(), "e34bbc7bbc071b6c7a433ca9c49a9347");
+	EXPECT_EQ(SemanticDigest("{ \"type\": \"wkt_source\" }").asHex(), "dc7e965954546f48fa8963802f7807d3");
+}
+
+TEST(SemanticDigest, distinguishesLongIds) {
+	// semantic ids of nested workflows differ in a few characters somewhere in the middle
+	std::string prefix(5000, 'a'), suffix(3000, 'b');
+	std::unordered_set<SemanticDigest> digests;
+	for (int i = 0; i < 1000; i++)
+		digests.insert(SemanticDigest(prefix + std::to_string(i) + suffix));
+	EXPECT_EQ(digests.size(), 1000);
+
+	EXPECT_EQ(SemanticDigest(prefix + suffix), SemanticDigest(prefix + suffix));
+	EXPECT_NE(SemanticDigest(prefix + suffix), SemanticDigest(suffix + prefix));
+}
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include "util/shared_memory.h"
+#include "util/binarystream.h"
+#include "util/exceptions.h"
+
+
+TEST(SharedMemorySegment, transfersBufferPayload) {
+	std::vector<double> values(10000);
+	for (size_t i=0;i<values.size();i++)
+		values[i] = i * 0.5;
+	std::string str = "shared";
+
+	BinaryWriteBuffer buffer;
+	buffer.write((uint32_t) 42);
+	buffer.write(values, true);
+	buffer.write(str);
+
+	std::string name;
+	{
+		auto segment = SharedMemorySegment::create(buffer.getPayloadSize());
+		EXPECT_EQ(segment.getSize(), sizeof(uint32_t) + sizeof(size_t) + values.size() * sizeof(double) + sizeof(size_t) + str.size());
+		buffer.copyPayload(segment.getData());
+		name = segment.getName();
+	}
+
+	auto segment = SharedMemorySegment::open(name);
+	// the mapping stays valid after the name is gone
+	SharedMemorySegment::unlink(name);
+	EXPECT_THROW(SharedMemorySegment::open(name), PlatformException);
+
+	BinaryReadBuffer read_buffer(segment.getData(), segment.getSize());
+	EXPECT_EQ(read_buffer.read<uint32_t>(), 42);
+	std::vector<double> read_values;
+	read_buffer.read(&read_values);
+	EXPECT_EQ(read_values, values);
+	EXPECT_EQ(read_buffer.read<std::string>(), str);
+	EXPECT_THROW(read_buffer.read<uint8_t>(), NetworkException);
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "util/sqlite.h"
+#include "util/exceptions.h"
+
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+
+class SQLiteTest : public ::testing::Test {
+	protected:
+		void SetUp() override {
+			filename = "sqlite_test_" + std::to_string(getpid()) + ".db";
+			db.open(filename.c_str());
+			db.exec("PRAGMA journal_mode=WAL");
+			db.exec("CREATE TABLE numbers (n INTEGER NOT NULL)");
+			auto stmt = db.prepare("INSERT INTO numbers (n) VALUES (?)");
+			for (int32_t i = 1; i <= 100; i++) {
+				stmt.bind(1, i);
+				stmt.exec();
+			}
+		}
+		void TearDown() override {
+			for (auto suffix : {"", "-wal", "-shm"})
+				std::remove((filename + suffix).c_str());
+		}
+		int64_t sum(bool read_connection, int32_t limit) {
+			auto stmt = read_connection ? db.prepareRead("SELECT SUM(n) FROM numbers WHERE n <= ?") : db.prepare("SELECT SUM(n) FROM numbers WHERE n <= ?");
+			stmt.bind(1, limit);
+			if (!stmt.next())
+				throw SQLiteException("no result");
+			return stmt.getInt64(0);
+		}
+		std::string filename;
+		SQLite db;
+};
+
+TEST_F(SQLiteTest, reusesDroppedStatements) {
+	{
+		// dropped in the middle of a result
+		auto stmt = db.prepare("SELECT n FROM numbers ORDER BY n");
+		ASSERT_TRUE(stmt.next());
+		ASSERT_TRUE(stmt.next());
+		EXPECT_EQ(stmt.getInt(0), 2);
+	}
+	auto stmt = db.prepare("SELECT n FROM numbers ORDER BY n");
+	ASSERT_TRUE(stmt.next());
+	EXPECT_EQ(stmt.getInt(0), 1);
+
+	// a second user of the same query gets its own statement
+	auto other = db.prepare("SELECT n FROM numbers ORDER BY n");
+	ASSERT_TRUE(other.next());
+	ASSERT_TRUE(stmt.next());
+	EXPECT_EQ(other.getInt(0), 1);
+	EXPECT_EQ(stmt.getInt(0), 2);
+}
+
+TEST_F(SQLiteTest, clearsBindingsOfReusedStatements) {
+	EXPECT_EQ(sum(false, 10), 55);
+	// an unbound parameter is NULL, which matches nothing
+	auto stmt = db.prepare("SELECT SUM(n) FROM numbers WHERE n <= ?");
+	ASSERT_TRUE(stmt.next());
+	EXPECT_EQ(stmt.getString(0), nullptr);
+}
+
+TEST_F(SQLiteTest, readsOnPooledConnections) {
+	EXPECT_EQ(sum(true, 100), 5050);
+	EXPECT_EQ(db.getIdleReadConnectionCount(), 1u);
+	EXPECT_EQ(sum(true, 100), 5050);
+	EXPECT_EQ(db.getIdleReadConnectionCount(), 1u);
+
+	// a statement holds its connection, a second reader gets another one
+	{
+		auto first = db.prepareRead("SELECT n FROM numbers ORDER BY n");
+		EXPECT_EQ(db.getIdleReadConnectionCount(), 0u);
+		auto second = db.prepareRead("SELECT n FROM numbers ORDER BY n");
+		ASSERT_TRUE(first.next());
+		ASSERT_TRUE(second.next());
+		ASSERT_TRUE(second.next());
+		EXPECT_EQ(first.getInt(0), 1);
+		EXPECT_EQ(second.getInt(0), 2);
+	}
+	EXPECT_EQ(db.getIdleReadConnectionCount(), 2u);
+
+	// writes on the main connection are visible to readers once they are committed
+	db.exec("INSERT INTO numbers (n) VALUES (1000)");
+	EXPECT_EQ(sum(true, 1000), 6050);
+
+	std::vector<std::thread> threads;
+	std::vector<int64_t> sums(8);
+	for (size_t i = 0; i < sums.size(); i++) {
+		threads.emplace_back([&, i] {
+			for (int j = 0; j < 100; j++)
+				sums[i] += sum(true, (int32_t) (i + 1));
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+	for (size_t i = 0; i < sums.size(); i++)
+		EXPECT_EQ(sums[i], 100 * (int64_t) ((i + 1) * (i + 2) / 2));
+
+	// many concurrent readers open many connections, but only a few are kept afterwards
+	std::vector<decltype(db.prepareRead(""))> statements;
+	for (int i = 0; i < 20; i++)
+		statements.push_back(db.prepareRead("SELECT n FROM numbers"));
+	EXPECT_EQ(db.getIdleReadConnectionCount(), 0u);
+	statements.clear();
+	EXPECT_LE(db.getIdleReadConnectionCount(), 8u);
+	EXPECT_GE(db.getIdleReadConnectionCount(), 1u);
+
+	// read connections are read-only
+	EXPECT_THROW(db.prepareRead("INSERT INTO numbers (n) VALUES (1)").exec(), SQLiteException);
+}
+
+TEST(SQLite, inMemoryDatabasesReadOnTheMainConnection) {
+	SQLite db;
+	db.open(":memory:");
+	db.exec("CREATE TABLE numbers (n INTEGER NOT NULL)");
+	db.exec("INSERT INTO numbers (n) VALUES (42)");
+	auto stmt = db.prepareRead("SELECT n FROM numbers");
+	ASSERT_TRUE(stmt.next());
+	EXPECT_EQ(stmt.getInt(0), 42);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "util/zonal_statistics.h"
+#include "datatypes/raster/raster_priv.h"
+
+#include <cmath>
+
+
+static auto createGrid() -> SpatioTemporalReference {
+	return SpatioTemporalReference(SpatialReference(CrsId::unreferenced(), 0, 0, 10, 10), TemporalReference::unreferenced());
+}
+
+static void addSquare(PolygonCollection &polygons, double x1, double y1, double x2, double y2) {
+	polygons.addCoordinate(x1, y1);
+	polygons.addCoordinate(x2, y1);
+	polygons.addCoordinate(x2, y2);
+	polygons.addCoordinate(x1, y2);
+	polygons.addCoordinate(x1, y1);
+	polygons.finishRing();
+}
+
+static void expectSpan(const ZonalStatistics::Span &span, uint32_t y, uint32_t x_begin, uint32_t x_end) {
+	EXPECT_EQ(span.y, y);
+	EXPECT_EQ(span.x_begin, x_begin);
+	EXPECT_EQ(span.x_end, x_end);
+}
+
+TEST(ZonalStatistics, spansExcludeHoles) {
+	GridSpatioTemporalResult grid(createGrid(), 10, 10);
+	PolygonCollection polygons(createGrid());
+	addSquare(polygons, 2, 2, 6, 6);
+	addSquare(polygons, 3, 3, 5, 5);
+	polygons.finishPolygon();
+	polygons.finishFeature();
+
+	auto spans = ZonalStatistics::feature_spans(grid, polygons, 0);
+	ASSERT_EQ(spans.size(), 6);
+	expectSpan(spans[0], 2, 2, 6);
+	expectSpan(spans[1], 3, 2, 3);
+	expectSpan(spans[2], 3, 5, 6);
+	expectSpan(spans[3], 4, 2, 3);
+	expectSpan(spans[4], 4, 5, 6);
+	expectSpan(spans[5], 5, 2, 6);
+}
+
+TEST(ZonalStatistics, spansMergeOverlappingPolygons) {
+	GridSpatioTemporalResult grid(createGrid(), 10, 10);
+	PolygonCollection polygons(createGrid());
+	addSquare(polygons, -5, 0, 2, 2);
+	polygons.finishPolygon();
+	addSquare(polygons, 1, 0, 3, 1);
+	polygons.finishPolygon();
+	polygons.finishFeature();
+
+	auto spans = ZonalStatistics::feature_spans(grid, polygons, 0);
+	ASSERT_EQ(spans.size(), 2);
+	expectSpan(spans[0], 0, 0, 3);
+	expectSpan(spans[1], 1, 0, 2);
+}
+
+TEST(ZonalStatistics, statistics) {
+	DataDescription dd(GDT_Float32, Unit::unknown(), true, -1);
+	auto raster = GenericRaster::create(dd, createGrid(), 10, 10, 1, GenericRaster::Representation::CPU);
+	auto typed = dynamic_cast<Raster2D<float> *>(raster.get());
+	for (int y = 0; y < 10; y++)
+		for (int x = 0; x < 10; x++)
+			typed->set(x, y, y * 10 + x);
+	typed->set(1, 1, -1);
+
+	PolygonCollection polygons(createGrid());
+	// covers 0, 1, 2, 10, 11 (no data), 12
+	addSquare(polygons, 0, 0, 3, 2);
+	polygons.finishPolygon();
+	polygons.finishFeature();
+	// outside of the raster
+	addSquare(polygons, 20, 20, 30, 30);
+	polygons.finishPolygon();
+	polygons.finishFeature();
+
+	auto statistics = ZonalStatistics({0, 50, 100}).compute(*raster, polygons, 2);
+	ASSERT_EQ(statistics.size(), 2);
+
+	EXPECT_EQ(statistics[0].count, 5);
+	EXPECT_DOUBLE_EQ(statistics[0].mean, 5);
+	EXPECT_DOUBLE_EQ(statistics[0].stdev, std::sqrt(31.0));
+	EXPECT_DOUBLE_EQ(statistics[0].min, 0);
+	EXPECT_DOUBLE_EQ(statistics[0].max, 12);
+	ASSERT_EQ(statistics[0].percentiles.size(), 3);
+	EXPECT_DOUBLE_EQ(statistics[0].percentiles[0], 0);
+	EXPECT_DOUBLE_EQ(statistics[0].percentiles[1], 2);
+	EXPECT_DOUBLE_EQ(statistics[0].percentiles[2], 12);
+
+	EXPECT_EQ(statistics[1].count, 0);
+	EXPECT_TRUE(std::isnan(statistics[1].mean));
+	EXPECT_TRUE(std::isnan(statistics[1].percentiles[1]));
+}